@@ -45,6 +45,10 @@ private Q_SLOTS:
     void compareOverOps();
     void compareOverOpsNoMask();
     void compareRgbF32OverOps();
+    void compareRgbU16AlphaDarkenOps();
+    void compareRgbU16OverOps();
+    void compareGenericMultiplyOps();
+    void compareGenericOverlayOps();
 
     void testRgb8CompositeAlphaDarkenLegacy();
     void testRgb8CompositeAlphaDarkenOptimized();
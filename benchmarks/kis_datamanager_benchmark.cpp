@@ -21,6 +21,12 @@
 
 #include <QTest>
 #include <kis_datamanager.h>
+#include "tiles3/kis_tile.h"
+#include "tiles3/kis_tile_data_store.h"
+
+#include <thread>
+#include <vector>
+#include <QElapsedTimer>
 
 // RGBA
 #define PIXEL_SIZE 4
@@ -198,5 +204,112 @@ void KisDatamanagerBenchmark::benchmarkMemCpy()
     delete[] dst;
 }
 
+/**
+ * Reports how much memory the tiles of an image, which is not
+ * aligned to the tile grid, take per megapixel. Compare the
+ * builds with different KRITA_TILE_SIZE.
+ */
+void KisDatamanagerBenchmark::benchmarkTileOverhead()
+{
+    quint8 *p = new quint8[PIXEL_SIZE];
+    memset(p, 0, PIXEL_SIZE);
+    KisDataManager dm(PIXEL_SIZE, p);
+
+    QVector<quint8> bytes(PIXEL_SIZE * GMP_IMAGE_WIDTH * GMP_IMAGE_HEIGHT, 128);
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    const qint32 numTilesBefore = store->numTiles();
+
+    dm.writeBytes(bytes.data(), 0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    const qint32 numTiles = store->numTiles() - numTilesBefore;
+    const qreal megapixels = qreal(GMP_IMAGE_WIDTH) * GMP_IMAGE_HEIGHT / 1000000.0;
+    const qreal tilesBytes = qreal(numTiles) * KisTileData::WIDTH * KisTileData::HEIGHT * PIXEL_SIZE;
+    const qreal imageBytes = qreal(GMP_IMAGE_WIDTH) * GMP_IMAGE_HEIGHT * PIXEL_SIZE;
+    const qreal objectsBytes = qreal(numTiles) * (sizeof(KisTile) + sizeof(KisTileData));
+
+    qDebug() << "tile size:" << KisTileData::WIDTH << "x" << KisTileData::HEIGHT
+             << "tiles:" << numTiles
+             << "tiles per MPix:" << numTiles / megapixels
+             << "unused pixels per MPix:" << (tilesBytes - imageBytes) / megapixels / 1024 << "KiB"
+             << "tile objects per MPix:" << objectsBytes / megapixels / 1024 << "KiB";
+
+    QBENCHMARK {
+        dm.clear();
+        dm.writeBytes(bytes.data(), 0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+    }
+
+    delete[] p;
+}
+
+void KisDatamanagerBenchmark::benchmarkConcurrentTileAccess_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    for (int i = 1; i <= 64; i *= 2) {
+        QTest::newRow(QString("%1 threads").arg(i).toLatin1()) << i;
+    }
+}
+
+/**
+ * Hammers the tile hash table of a single data manager from
+ * several threads at once. Each thread fetches all the tiles of
+ * the image, for reading and for writing, in its own order. Compare
+ * the reported throughput of the rows to see how the table scales.
+ */
+void KisDatamanagerBenchmark::benchmarkConcurrentTileAccess()
+{
+    QFETCH(int, numThreads);
+
+    quint8 *p = new quint8[PIXEL_SIZE];
+    memset(p, 0, PIXEL_SIZE);
+    KisDataManager dm(PIXEL_SIZE, p);
+
+    // create all the tiles beforehand
+    dm.clear(0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT, 128);
+
+    const int numCols = TEST_IMAGE_WIDTH / KisTileData::WIDTH;
+    const int numRows = TEST_IMAGE_HEIGHT / KisTileData::HEIGHT;
+    const int numTiles = numCols * numRows;
+    const int numPasses = 64 / numThreads;
+
+    auto accessTiles = [&dm, numCols, numTiles, numPasses] (int threadIndex) {
+        for (int pass = 0; pass < numPasses; pass++) {
+            for (int i = 0; i < numTiles; i++) {
+                const int index = (i + threadIndex * 97) % numTiles;
+                const int col = index % numCols;
+                const int row = index / numCols;
+
+                KisTileSP tile = dm.getTile(col, row, (i & 0x3) == 0);
+                Q_UNUSED(tile);
+            }
+        }
+    };
+
+    qint64 totalTime = 0;
+    qint64 totalAccesses = 0;
+
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numThreads; i++) {
+            threads.emplace_back(accessTiles, i);
+        }
+
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        totalTime += timer.nsecsElapsed();
+        totalAccesses += qint64(numTiles) * numPasses * numThreads;
+    }
+
+    qDebug() << "threads:" << numThreads
+             << "tile accesses per second:" << qreal(totalAccesses) / totalTime * 1e9;
+
+    delete[] p;
+}
 
 QTEST_MAIN(KisDatamanagerBenchmark)
@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_exact_bounds_benchmark.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_paint_device.h"
+
+/**
+ * A huge layer with a few small islands of content, which is
+ * a typical case for the layers of a big poster or a map
+ */
+const int IMAGE_WIDTH = 30000;
+const int IMAGE_HEIGHT = 30000;
+const int NUM_ISLANDS = 300;
+const int ISLAND_SIZE = 40;
+const int DAB_SIZE = 15;
+
+void KisExactBoundsBenchmark::initTestCase()
+{
+    m_colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+
+    m_transparentDevice = new KisPaintDevice(m_colorSpace);
+    fillSparseContent(m_transparentDevice);
+
+    m_opaqueDevice = new KisPaintDevice(m_colorSpace);
+    m_opaqueDevice->setDefaultPixel(KoColor(Qt::white, m_colorSpace));
+    fillSparseContent(m_opaqueDevice);
+}
+
+void KisExactBoundsBenchmark::cleanupTestCase()
+{
+    m_transparentDevice = 0;
+    m_opaqueDevice = 0;
+}
+
+void KisExactBoundsBenchmark::fillSparseContent(KisPaintDeviceSP dev)
+{
+    const KoColor color(Qt::red, m_colorSpace);
+
+    // a fixed seed, so every run measures the same layout
+    qsrand(42);
+
+    for (int i = 0; i < NUM_ISLANDS; i++) {
+        const int x = qrand() % (IMAGE_WIDTH - ISLAND_SIZE);
+        const int y = qrand() % (IMAGE_HEIGHT - ISLAND_SIZE);
+
+        dev->fill(QRect(x, y, ISLAND_SIZE, ISLAND_SIZE), color);
+    }
+
+    // make sure the bounds touch the edges of the image
+    dev->fill(QRect(0, 0, 1, 1), color);
+    dev->fill(QRect(IMAGE_WIDTH - 1, IMAGE_HEIGHT - 1, 1, 1), color);
+}
+
+QRect KisExactBoundsBenchmark::paintDab(KisPaintDeviceSP dev, int index)
+{
+    const KoColor color(index & 0x1 ? Qt::green : Qt::blue, m_colorSpace);
+
+    const QRect rc((index * 97) % (IMAGE_WIDTH - DAB_SIZE),
+                   (index * 61) % (IMAGE_HEIGHT - DAB_SIZE),
+                   DAB_SIZE, DAB_SIZE);
+
+    dev->fill(rc, color);
+    return rc;
+}
+
+void KisExactBoundsBenchmark::benchmarkExactBoundsAllTiles()
+{
+    const QRect imageRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+    QRect bounds;
+
+    QBENCHMARK {
+        /**
+         * Resetting the default pixel drops the bounds cached in
+         * the tiles, so every tile of the device is scanned
+         */
+        m_transparentDevice->setDefaultPixel(m_transparentDevice->defaultPixel());
+        bounds = m_transparentDevice->exactBounds();
+    }
+
+    QCOMPARE(bounds, imageRect);
+}
+
+void KisExactBoundsBenchmark::benchmarkExactBoundsAfterDab()
+{
+    const QRect imageRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+    QRect bounds;
+    int index = 0;
+
+    // warm up the cache of the tiles
+    bounds = m_transparentDevice->exactBounds();
+
+    QBENCHMARK {
+        // the dab is the only change, so only its tiles are scanned
+        paintDab(m_transparentDevice, index++);
+        bounds = m_transparentDevice->exactBounds();
+    }
+
+    QCOMPARE(bounds, imageRect);
+}
+
+void KisExactBoundsBenchmark::benchmarkNonDefaultPixelAreaAfterDab()
+{
+    QRect area;
+    int index = 0;
+
+    area = m_opaqueDevice->nonDefaultPixelArea();
+
+    QBENCHMARK {
+        paintDab(m_opaqueDevice, index++);
+        area = m_opaqueDevice->nonDefaultPixelArea();
+    }
+
+    QCOMPARE(area, QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT));
+}
+
+QTEST_MAIN(KisExactBoundsBenchmark)
@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_histogram_benchmark.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoBasicHistogramProducers.h>
+
+#include "kis_paint_device.h"
+#include "kis_histogram.h"
+#include "kis_iterator_ng.h"
+#include "KisIncrementalHistogram.h"
+
+/**
+ * A 100MP image, the size of the files where the histogram
+ * docker used to be the bottleneck
+ */
+const int IMAGE_WIDTH = 10000;
+const int IMAGE_HEIGHT = 10000;
+const int DAB_SIZE = 100;
+
+static KoHistogramProducer *createProducer(const KoColorSpace *cs)
+{
+    return new KoBasicU8HistogramProducer(KoID("BENCHMARK", "Benchmark"), cs);
+}
+
+void KisHistogramBenchmark::initTestCase()
+{
+    m_colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    m_device = new KisPaintDevice(m_colorSpace);
+
+    /**
+     * The content is a cheap pattern, which still spreads
+     * the pixels over all the bins
+     */
+    KisSequentialIterator it(m_device, QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT));
+    while (it.nextPixel()) {
+        const int x = it.x();
+        const int y = it.y();
+
+        quint8 *pixel = it.rawData();
+        pixel[0] = x ^ y;
+        pixel[1] = x + y;
+        pixel[2] = (x * y) >> 4;
+        pixel[3] = 255;
+    }
+}
+
+void KisHistogramBenchmark::cleanupTestCase()
+{
+    m_device = 0;
+}
+
+void KisHistogramBenchmark::benchmarkSingleThreaded()
+{
+    QScopedPointer<KoHistogramProducer> producer(createProducer(m_colorSpace));
+
+    QBENCHMARK {
+        producer->clear();
+
+        KisSequentialConstIterator it(m_device, QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT));
+        int numConseqPixels = it.nConseqPixels();
+        while (it.nextPixels(numConseqPixels)) {
+            numConseqPixels = it.nConseqPixels();
+            producer->addRegionToBin(it.oldRawData(), 0, numConseqPixels, m_colorSpace);
+        }
+    }
+
+    QCOMPARE(producer->count(), IMAGE_WIDTH * IMAGE_HEIGHT);
+}
+
+void KisHistogramBenchmark::benchmarkParallel()
+{
+    KoHistogramProducer *producer = createProducer(m_colorSpace);
+    KisHistogram histogram(m_device, QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT), producer, LINEAR);
+
+    QBENCHMARK {
+        histogram.updateHistogram();
+    }
+
+    QCOMPARE(producer->count(), IMAGE_WIDTH * IMAGE_HEIGHT);
+}
+
+void KisHistogramBenchmark::benchmarkIncrementalFull()
+{
+    KisIncrementalHistogram histogram(m_device, QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT), createProducer(m_colorSpace));
+
+    QBENCHMARK {
+        histogram.setAllDirty();
+        histogram.update();
+    }
+
+    QCOMPARE(histogram.count(), quint32(IMAGE_WIDTH * IMAGE_HEIGHT));
+}
+
+void KisHistogramBenchmark::benchmarkIncrementalAfterDab()
+{
+    KisIncrementalHistogram histogram(m_device, QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT), createProducer(m_colorSpace));
+    histogram.update();
+
+    int index = 0;
+
+    QBENCHMARK {
+        const QRect rc((index * 97) % (IMAGE_WIDTH - DAB_SIZE),
+                       (index * 61) % (IMAGE_HEIGHT - DAB_SIZE),
+                       DAB_SIZE, DAB_SIZE);
+
+        m_device->fill(rc, KoColor(index & 0x1 ? Qt::green : Qt::blue, m_colorSpace));
+        index++;
+
+        // only the cells under the dab are recalculated
+        histogram.addDirtyRect(rc);
+        histogram.update();
+    }
+
+    QCOMPARE(histogram.count(), quint32(IMAGE_WIDTH * IMAGE_HEIGHT));
+}
+
+QTEST_MAIN(KisHistogramBenchmark)
@@ -28,6 +28,7 @@
 #include <QTest>
 
 #include "kis_iterator_ng.h"
+#include "tiles3/kis_tile_data.h"
 
 void KisHLineIteratorBenchmark::initTestCase()
 {
@@ -191,4 +192,33 @@ void KisHLineIteratorBenchmark::benchmarkTwoIteratorsNoMemCpy(){
 
 
 
+/**
+ * The cost of switching between the tiles dominates here, so
+ * compare the builds with different KRITA_TILE_SIZE
+ */
+void KisHLineIteratorBenchmark::benchmarkConseqReadBytes()
+{
+    const qint32 pixelSize = m_colorSpace->pixelSize();
+    QVector<quint8> rowBuffer(TEST_IMAGE_WIDTH * pixelSize);
+
+    KisHLineConstIteratorSP cit = m_device->createHLineConstIteratorNG(0, 0, TEST_IMAGE_WIDTH);
+
+    qDebug() << "tile size:" << KisTileData::WIDTH << "x" << KisTileData::HEIGHT;
+
+    QBENCHMARK{
+        for (int j = 0; j < TEST_IMAGE_HEIGHT; j++) {
+            quint8 *dst = rowBuffer.data();
+            int numPixels = 0;
+
+            do {
+                numPixels = cit->nConseqPixels();
+                memcpy(dst, cit->oldRawData(), numPixels * pixelSize);
+                dst += numPixels * pixelSize;
+            } while (cit->nextPixels(numPixels));
+
+            cit->nextRow();
+        }
+    }
+}
+
 QTEST_MAIN(KisHLineIteratorBenchmark)
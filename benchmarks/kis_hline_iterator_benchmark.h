@@ -56,6 +56,9 @@ private Q_SLOTS:
     void benchmarkConstNoMemCpy();
     // copy from one device to another
     void benchmarkTwoIteratorsNoMemCpy();
+
+    // copy whole tile rows using nConseqPixels()
+    void benchmarkConseqReadBytes();
     
 
     
@@ -19,12 +19,16 @@
 #include "kis_low_memory_benchmark.h"
 
 #include <QTest>
+#include <QElapsedTimer>
+#include <QtMath>
+#include <algorithm>
 
 #include "kis_benchmark_values.h"
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
 
 #include <kis_image.h>
 #include <kis_layer.h>
@@ -37,6 +41,8 @@
 #include <brushengine/kis_paintop_preset.h>
 
 #include "tiles3/kis_tile_data_store.h"
+#include "tiles3/swap/kis_tile_compressor_2.h"
+#include "kis_datamanager.h"
 #include "kis_surrogate_undo_adapter.h"
 #include "kis_image_config.h"
 #define LOAD_PRESET_OR_RETURN(preset, fileName)                         \
@@ -128,6 +134,7 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
     lineTime.start();
 
     qreal rectBottom = rect.y() + rect.height();
+    QVector<int> lineLatencies;
 
     for (int i = 0; i < numCycles; i++) {
         cycleTime.restart();
@@ -147,6 +154,8 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
             painter->paintLine(pi1, pi2, &currentDistance);
             painter->device()->setDirty(painter->takeDirtyRegion());
 
+            lineLatencies << lineTime.elapsed();
+
             logStream << "L 1" << i << lineTime.elapsed()
                       << KisTileDataStore::instance()->numTilesInMemory() * 16
                       << KisTileDataStore::instance()->numTiles() * 16
@@ -173,6 +182,8 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
                   << config.memoryPoolLimitPercent() / _MiB  << endl;
     }
 
+    reportStrokeLatency(lineLatencies);
+
     config.setMemoryHardLimitPercent(oldHardLimit * _MiB);
     config.setMemorySoftLimitPercent(oldSoftLimit * _MiB);
     config.setMemoryPoolLimitPercent(oldPoolLimit * _MiB);
@@ -180,6 +191,37 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
     delete painter;
 }
 
+void KisLowMemoryBenchmark::reportStrokeLatency(QVector<int> latencies)
+{
+    if (latencies.isEmpty()) return;
+
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&latencies] (qreal value) {
+        const int index = qBound(0, qCeil(value * latencies.size()) - 1, latencies.size() - 1);
+        return latencies[index];
+    };
+
+    qDebug() << "Stroke latency (ms):"
+             << "p50" << percentile(0.50)
+             << "p90" << percentile(0.90)
+             << "p99" << percentile(0.99)
+             << "max" << latencies.last();
+
+    const KisTileDataSwapper::Statistics stats =
+        KisTileDataStore::instance()->swapperStatistics();
+
+    qDebug() << "Swapper:"
+             << "batches" << stats.numBatches
+             << "rejected" << stats.numRejectedBatches
+             << "tiles selected" << stats.numTilesSelected
+             << "swapped out (MiB)" << stats.swappedOutMetric / MiB_TO_METRIC(1)
+             << "selection (ms)" << stats.selectionTime
+             << "compression (ms)" << stats.compressionTime
+             << "write (ms)" << stats.writeTime
+             << "batch size" << stats.currentBatchSize;
+}
+
 void KisLowMemoryBenchmark::unlimitedMemoryNoHistoryNoPool()
 {
     QString presetFileName = "autobrush_300px.kpp";
@@ -227,5 +269,336 @@ void KisLowMemoryBenchmark::memory2000History100Pool500HugeBrush()
     benchmarkWideArea(presetFileName, rect, step, numCycles, true,
                       2000, 600, 500, 0);
 }
+void KisLowMemoryBenchmark::memory500History100NoPoolSwapping()
+{
+    QString presetFileName = "autobrush_300px.kpp";
+    // one cycle takes about 48 MiB of memory (total 960 MiB), so
+    // the swapper is active during the most of the strokes
+    QRectF rect(150,150,4000,4000);
+    qreal step = 250;
+    int numCycles = 20;
+
+    benchmarkWideArea(presetFileName, rect, step, numCycles, true,
+                      500, 100, 0, 0);
+}
+
+/**
+ * Paints a few strokes on a 16-bit layer and then pushes all its
+ * tiles through every swap codec supported by the build, reporting
+ * the throughput of compression and decompression and the size the
+ * tiles would occupy in the swap file.
+ */
+void KisLowMemoryBenchmark::benchmarkSwapCompression()
+{
+    QString presetFileName = "autobrush_300px.kpp";
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(QString(FILES_DATA_DIR) + QDir::separator() + presetFileName);
+    LOAD_PRESET_OR_RETURN(preset, presetFileName);
+
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb16();
+    KisImageSP image = new KisImage(0, HUGE_IMAGE_SIZE, HUGE_IMAGE_SIZE, colorSpace, "stroke sample image");
+    KisLayerSP layer = new KisPaintLayer(image, "temporary for stroke sample", OPACITY_OPAQUE_U8, colorSpace);
+    image->addNode(layer, image->root());
+
+    KisPainter painter(layer->paintDevice());
+    painter.setPaintColor(KoColor(Qt::black, colorSpace));
+    painter.setPaintOpPreset(preset, layer, image);
+
+    const QRectF rect(150, 150, 4000, 4000);
+    const qreal vstep = 250;
+
+    KisDistanceInformation currentDistance;
+    QLineF line(rect.topLeft(), rect.topLeft() + QPointF(rect.width(), 0));
+    while (line.y1() < rect.bottom()) {
+        painter.paintLine(KisPaintInformation(line.p1(), 0.0),
+                          KisPaintInformation(line.p2(), 1.0),
+                          &currentDistance);
+        line.translate(0, vstep);
+    }
+
+    KisDataManagerSP dm = layer->paintDevice()->dataManager();
+    const qint32 pixelSize = layer->paintDevice()->pixelSize();
+    const QRect extent = dm->extent();
+
+    const int firstCol = qFloor(qreal(extent.left()) / KisTileData::WIDTH);
+    const int lastCol = qFloor(qreal(extent.right()) / KisTileData::WIDTH);
+    const int firstRow = qFloor(qreal(extent.top()) / KisTileData::HEIGHT);
+    const int lastRow = qFloor(qreal(extent.bottom()) / KisTileData::HEIGHT);
+
+    QVector<KisTileSP> tiles;
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            bool existingTile = false;
+            KisTileSP tile = dm->getReadOnlyTileLazy(col, row, existingTile);
+            if (existingTile) {
+                tiles << tile;
+            }
+        }
+    }
+
+    const qreal uncompressedMiB = qreal(tiles.size()) * pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT / (1 << 20);
+
+    KisTiledDataManager scratchDataManager(pixelSize, dm->defaultPixel());
+    KisTileSP scratchTile = scratchDataManager.getTile(0, 0, true);
+
+    QVector<KisTileCompressor2::CompressionType> types;
+    types << KisTileCompressor2::LZF << KisTileCompressor2::LZ4 << KisTileCompressor2::ZSTD;
+
+    KisImageConfig config(true);
+
+    Q_FOREACH (KisTileCompressor2::CompressionType type, types) {
+        const QString name = KisTileCompressor2::compressionTypeToName(type);
+
+        if (!KisTileCompressor2::isCompressionTypeSupported(type)) {
+            qDebug() << name << "is not supported by this build, skipped";
+            continue;
+        }
+
+        KisTileCompressor2 compressor(type, config.swapCompressionLevel());
+        QVector<QByteArray> chunks(tiles.size());
+
+        QElapsedTimer timer;
+        timer.start();
+
+        qint64 swapSize = 0;
+        for (int i = 0; i < tiles.size(); i++) {
+            KisTileSP tile = tiles[i];
+            QByteArray &chunk = chunks[i];
+
+            tile->lockForRead();
+            chunk.resize(compressor.tileDataBufferSize(tile->tileData()));
+
+            qint32 bytesWritten = 0;
+            compressor.compressTileData(tile->tileData(), (quint8*)chunk.data(), chunk.size(), bytesWritten);
+            tile->unlockForRead();
+
+            chunk.resize(bytesWritten);
+            swapSize += bytesWritten;
+        }
+
+        const qint64 compressionTime = qMax(qint64(1), timer.restart());
+
+        scratchTile->lockForWrite();
+        for (int i = 0; i < chunks.size(); i++) {
+            compressor.decompressTileData((quint8*)chunks[i].data(), chunks[i].size(), scratchTile->tileData());
+        }
+        scratchTile->unlockForWrite();
+
+        const qint64 decompressionTime = qMax(qint64(1), timer.elapsed());
+
+        qDebug() << qPrintable(name)
+                 << "tiles:" << tiles.size()
+                 << "compress:" << uncompressedMiB * 1000.0 / compressionTime << "MiB/s"
+                 << "decompress:" << uncompressedMiB * 1000.0 / decompressionTime << "MiB/s"
+                 << "swap size:" << qreal(swapSize) / (1 << 20) << "MiB"
+                 << "ratio:" << qreal(swapSize) / (uncompressedMiB * (1 << 20));
+    }
+}
+
+/**
+ * Paints a few layers, pushes the whole image into the swap file and
+ * measures the time needed to regenerate the projection, that is
+ * to load every tile back from the swap.
+ */
+void KisLowMemoryBenchmark::benchmarkReprojectSwappedImage(bool fastSwap)
+{
+    QString presetFileName = "autobrush_300px.kpp";
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(QString(FILES_DATA_DIR) + QDir::separator() + presetFileName);
+    LOAD_PRESET_OR_RETURN(preset, presetFileName);
+
+    KisImageConfig config(false);
+    const bool oldFastSwap = config.fastSwap();
+    config.setFastSwap(fastSwap);
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->testingRereadConfig();
+
+    if (store->m_swappedStore.compressesSwappedData() == fastSwap) {
+        qWarning() << "The swap file is already in use, cannot switch swap mode";
+        config.setFastSwap(oldFastSwap);
+        return;
+    }
+
+    {
+        const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+        KisImageSP image = new KisImage(0, HUGE_IMAGE_SIZE, HUGE_IMAGE_SIZE, colorSpace, "swapped image");
+
+        const int numLayers = 4;
+        const QRectF rect(150, 150, 4000, 4000);
+        const qreal vstep = 250;
+
+        for (int i = 0; i < numLayers; i++) {
+            KisLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8, colorSpace);
+            image->addNode(layer, image->root());
+
+            KisPainter painter(layer->paintDevice());
+            painter.setPaintColor(KoColor(QColor::fromHsv(i * 90, 255, 255), colorSpace));
+            painter.setPaintOpPreset(preset, layer, image);
+
+            KisDistanceInformation currentDistance;
+            QLineF line(rect.topLeft() + QPointF(0, i * vstep / numLayers),
+                        rect.topRight() + QPointF(0, i * vstep / numLayers));
+
+            while (line.y1() < rect.bottom()) {
+                painter.paintLine(KisPaintInformation(line.p1(), 0.0),
+                                  KisPaintInformation(line.p2(), 1.0),
+                                  &currentDistance);
+                line.translate(0, vstep);
+            }
+        }
+
+        image->refreshGraph();
+        image->waitForDone();
+
+        store->debugSwapAll();
+        const int swappedTiles = store->numTiles() - store->numTilesInMemory();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        image->refreshGraph();
+        image->waitForDone();
+
+        qDebug() << (fastSwap ? "fast swap:" : "compressed swap:")
+                 << "reprojection:" << timer.elapsed() << "ms"
+                 << "swapped tiles:" << swappedTiles
+                 << "mapped tiles:" << store->m_swappedStore.numMappedTiles();
+    }
+
+    config.setFastSwap(oldFastSwap);
+    store->testingRereadConfig();
+}
+
+void KisLowMemoryBenchmark::reprojectSwappedImageCompressed()
+{
+    benchmarkReprojectSwappedImage(false);
+}
+
+void KisLowMemoryBenchmark::reprojectSwappedImageFastSwap()
+{
+    benchmarkReprojectSwappedImage(true);
+}
+
+/**
+ * Replays a session of 500 short strokes on a 16-bit float layer,
+ * every stroke being a separate undo step, and reports the memory
+ * occupied by the history and the latency of undo/redo, including
+ * the loading of the changed tiles. The session is generated from
+ * a fixed seed, so the runs are comparable with each other.
+ */
+void KisLowMemoryBenchmark::benchmarkHistorySession(bool deltaHistory)
+{
+    QString presetFileName = "autobrush_300px.kpp";
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(QString(FILES_DATA_DIR) + QDir::separator() + presetFileName);
+    LOAD_PRESET_OR_RETURN(preset, presetFileName);
+
+    KisImageConfig config(false);
+    const bool oldDeltaHistory = config.deltaHistoryCompression();
+    config.setDeltaHistoryCompression(deltaHistory);
+    KisTileDataStore::instance()->testingRereadConfig();
+
+    const KoColorSpace *colorSpace =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), "");
+    KisImageSP image = new KisImage(0, 4000, 4000, colorSpace, "stroke sample image");
+    KisLayerSP layer = new KisPaintLayer(image, "temporary for stroke sample", OPACITY_OPAQUE_U8, colorSpace);
+    image->addNode(layer, image->root());
+
+    KisPaintDeviceSP dev = layer->paintDevice();
+
+    KisPainter painter(dev);
+    painter.setPaintColor(KoColor(Qt::black, colorSpace));
+    painter.setPaintOpPreset(preset, layer, image);
+
+    KisSurrogateUndoAdapter undoAdapter;
+
+    const int numStrokes = 500;
+    QVector<QRect> strokeRects;
+
+    srand48(0);
+    for (int i = 0; i < numStrokes; i++) {
+        const QPointF p1(drand48() * image->width(), drand48() * image->height());
+        const QPointF p2 = p1 + QPointF((drand48() - 0.5) * 600, (drand48() - 0.5) * 600);
+
+        painter.beginTransaction();
+
+        KisDistanceInformation currentDistance;
+        painter.paintLine(KisPaintInformation(p1, 1.0),
+                          KisPaintInformation(p2, 1.0),
+                          &currentDistance);
+
+        QRect strokeRect;
+        Q_FOREACH (const QRect &rc, painter.takeDirtyRegion()) {
+            strokeRect |= rc;
+        }
+        strokeRects << strokeRect;
+
+        painter.endTransaction(&undoAdapter);
+    }
+
+    // let the last transaction be committed
+    dev->dataManager()->commit();
+
+    qint64 historySize = 0;
+    int numRevisions = 0;
+    dev->estimateHistoryMemoryStats(historySize, numRevisions);
+
+    const KisTileDataStore::MemoryStatistics stats =
+        KisTileDataStore::instance()->memoryStatistics();
+
+    QByteArray buffer;
+    QElapsedTimer timer;
+    QVector<qint64> undoLatencies;
+    QVector<qint64> redoLatencies;
+
+    auto loadRect = [&buffer, dev] (const QRect &rc) {
+        buffer.resize(rc.width() * rc.height() * dev->pixelSize());
+        dev->readBytes((quint8*)buffer.data(), rc);
+    };
+
+    for (int i = numStrokes - 1; i >= 0; i--) {
+        timer.start();
+        undoAdapter.undo();
+        loadRect(strokeRects[i]);
+        undoLatencies << timer.nsecsElapsed() / 1000;
+    }
+
+    for (int i = 0; i < numStrokes; i++) {
+        timer.start();
+        undoAdapter.redo();
+        loadRect(strokeRects[i]);
+        redoLatencies << timer.nsecsElapsed() / 1000;
+    }
+
+    auto percentile = [] (QVector<qint64> latencies, qreal value) {
+        std::sort(latencies.begin(), latencies.end());
+        const int index = qBound(0, qCeil(value * latencies.size()) - 1, latencies.size() - 1);
+        return latencies[index];
+    };
+
+    qDebug() << (deltaHistory ? "Delta history:" : "Full history:")
+             << "revisions" << numRevisions
+             << "history (MiB)" << qreal(historySize) / (1 << 20)
+             << "deltas (MiB)" << qreal(stats.historicalDeltaSize) / (1 << 20)
+             << "swap (MiB)" << qreal(stats.swapSize) / (1 << 20);
+
+    qDebug() << "Undo latency (us):"
+             << "p50" << percentile(undoLatencies, 0.50)
+             << "p99" << percentile(undoLatencies, 0.99)
+             << "Redo latency (us):"
+             << "p50" << percentile(redoLatencies, 0.50)
+             << "p99" << percentile(redoLatencies, 0.99);
+
+    config.setDeltaHistoryCompression(oldDeltaHistory);
+    KisTileDataStore::instance()->testingRereadConfig();
+}
+
+void KisLowMemoryBenchmark::historySessionFullTiles()
+{
+    benchmarkHistorySession(false);
+}
+
+void KisLowMemoryBenchmark::historySessionDeltas()
+{
+    benchmarkHistorySession(true);
+}
 
 QTEST_MAIN(KisLowMemoryBenchmark)
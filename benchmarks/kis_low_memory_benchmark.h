@@ -30,6 +30,15 @@ private Q_SLOTS:
     void unlimitedMemoryHistoryPool50();
 
     void memory2000History100Pool500HugeBrush();
+    void memory500History100NoPoolSwapping();
+
+    void benchmarkSwapCompression();
+
+    void reprojectSwappedImageCompressed();
+    void reprojectSwappedImageFastSwap();
+
+    void historySessionFullTiles();
+    void historySessionDeltas();
 
 private:
     void benchmarkWideArea(const QString presetFileName,
@@ -40,6 +49,12 @@ private:
                            int softLimitMiB,
                            int poolLimitMiB,
                            int index);
+
+    void reportStrokeLatency(QVector<int> latencies);
+
+    void benchmarkReprojectSwappedImage(bool fastSwap);
+
+    void benchmarkHistorySession(bool deltaHistory);
 };
 
 #endif /* __KIS_LOW_MEMORY_BENCHMARK_H */
@@ -319,6 +319,32 @@ void KisPainterBenchmark::benchmarkBitBltOldData()
 }
 
 
+void KisPainterBenchmark::benchmarkBitBltUniformSource()
+{
+    quint8 p = 128;
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+
+    KoColor color(&p, cs);
+    QRect fillRect(0,0,5000,5000);
+
+    /**
+     * The source has no tiles of its own, so all the reads go to
+     * the default tile, which is known to be uniform. Compare with
+     * benchmarkBitBlt2(), which composites the same color from the
+     * filled tiles.
+     */
+    src->setDefaultPixel(color);
+
+    QBENCHMARK {
+        KisPainter gc(dst);
+        gc.bitBlt(QPoint(), src, fillRect);
+    }
+}
+
+
 void benchmarkMassiveBltFixedImpl(int numDabs, int size, qreal spacing, int idealNumPatches, Qt::Orientations direction)
 {
     const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
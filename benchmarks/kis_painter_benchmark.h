@@ -51,6 +51,7 @@ private Q_SLOTS:
 
     void benchmarkBitBlt2();
     void benchmarkBitBltOldData();
+    void benchmarkBitBltUniformSource();
     void benchmarkMassiveBltFixed();
 
     
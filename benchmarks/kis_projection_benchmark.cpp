@@ -22,12 +22,18 @@
 
 #include <KoColor.h>
 
+#include <KoColorSpaceRegistry.h>
+
 #include <kis_group_layer.h>
+#include <kis_paint_layer.h>
 #include <kis_paint_device.h>
+#include <kis_image_config.h>
 #include <KisDocument.h>
 #include <kis_image.h>
 #include <KisPart.h>
 
+#include "image_config_override.h"
+
 void KisProjectionBenchmark::initTestCase()
 {
 
@@ -58,5 +64,105 @@ void KisProjectionBenchmark::benchmarkLoading()
     }
 }
 
+void KisProjectionBenchmark::benchmarkFusedComposition_data()
+{
+    QTest::addColumn<bool>("fused");
+
+    QTest::newRow("separate") << false;
+    QTest::newRow("fused") << true;
+}
+
+void KisProjectionBenchmark::benchmarkFusedComposition()
+{
+    QFETCH(bool, fused);
+
+    const int numLayers = 50;
+    const QRect imageRect(0, 0, 3000, 3000);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    /**
+     * The updater context creates its mergers on construction,
+     * so the option should be set before the image is created
+     */
+    TestUtil::ImageConfigOverride<bool> fusedOverride(&KisImageConfig::fusedLayersComposition,
+                                                      &KisImageConfig::setFusedLayersComposition,
+                                                      fused);
+
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "fused composition benchmark");
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+
+        // semi-transparent fills, so every layer is really blended
+        const QColor color = QColor::fromHsv((i * 37) % 360, 200, 200, 64 + (i * 13) % 128);
+        const int offset = (i * 29) % 200;
+
+        layer->paintDevice()->fill(imageRect.adjusted(offset, offset, -offset, -offset),
+                                   KoColor(color, cs));
+        image->addNode(layer, image->root());
+    }
+
+    image->initialRefreshGraph();
+
+    QBENCHMARK {
+        image->refreshGraph();
+    }
+}
+
+void KisProjectionBenchmark::benchmarkPaintingInLargeGroup_data()
+{
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("recompose") << false;
+    QTest::newRow("cached") << true;
+}
+
+void KisProjectionBenchmark::benchmarkPaintingInLargeGroup()
+{
+    QFETCH(bool, cached);
+
+    const int numLayers = 100;
+    const int dabSize = 50;
+    const QRect imageRect(0, 0, 2000, 2000);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // the mergers read the option on construction
+    TestUtil::ImageConfigOverride<bool> cacheOverride(&KisImageConfig::cacheBelowSiblingsProjection,
+                                                      &KisImageConfig::setCacheBelowSiblingsProjection,
+                                                      cached);
+
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "large group benchmark");
+
+    KisGroupLayerSP group = new KisGroupLayer(image, "group", OPACITY_OPAQUE_U8);
+    image->addNode(group, image->root());
+
+    KisPaintLayerSP topLayer;
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+
+        const QColor color = QColor::fromHsv((i * 37) % 360, 200, 200, 64 + (i * 13) % 128);
+        const int offset = (i * 29) % 1000;
+
+        layer->paintDevice()->fill(QRect(offset, offset, 1000, 1000), KoColor(color, cs));
+        image->addNode(layer, group);
+
+        topLayer = layer;
+    }
+
+    image->initialRefreshGraph();
+
+    /**
+     * A stroke on the topmost layer of the group. The first
+     * iteration fills the cache, the others reuse it.
+     */
+    QBENCHMARK {
+        for (int x = 0; x < imageRect.width() - dabSize; x += dabSize / 5) {
+            const int y = x * imageRect.height() / imageRect.width();
+            topLayer->setDirty(QRect(x, y, dabSize, dabSize));
+        }
+        image->waitForDone();
+    }
+}
 
 QTEST_MAIN(KisProjectionBenchmark)
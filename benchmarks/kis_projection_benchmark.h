@@ -32,6 +32,12 @@ private Q_SLOTS:
 
     void benchmarkProjection();
     void benchmarkLoading();
+
+    void benchmarkFusedComposition_data();
+    void benchmarkFusedComposition();
+
+    void benchmarkPaintingInLargeGroup_data();
+    void benchmarkPaintingInLargeGroup();
 };
 
 #endif
@@ -0,0 +1,166 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "kis_tile_data_arena_benchmark.h"
+
+#include <QTest>
+#include <QElapsedTimer>
+
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "tiles3/kis_tile_data.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "tiles3/KisTileDataArena.h"
+
+// RGBA
+#define PIXEL_SIZE 4
+
+// the total number of the tiles created and destroyed in every run
+#define NUM_TILES (1024 * 1024)
+
+// the number of tiles every thread keeps alive at once
+#define NUM_LIVE_TILES 256
+
+namespace {
+
+/**
+ * Runs \p allocate and \p free for NUM_TILES tiles spread over
+ * \p numThreads threads and reports the throughput and the state
+ * of the arena afterwards.
+ */
+void runThreads(int numThreads,
+                std::function<void*()> allocate,
+                std::function<void(void*)> free)
+{
+    auto worker = [numThreads, allocate, free] () {
+        std::vector<void*> tiles(NUM_LIVE_TILES, nullptr);
+        const int numTiles = NUM_TILES / numThreads;
+
+        for (int i = 0; i < numTiles; i++) {
+            void *&tile = tiles[i % NUM_LIVE_TILES];
+            if (tile) {
+                free(tile);
+            }
+            tile = allocate();
+        }
+
+        for (void *tile : tiles) {
+            if (tile) {
+                free(tile);
+            }
+        }
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(worker);
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    KisTileDataArena::Statistics stats = KisTileDataArena::instance()->statistics();
+
+    qDebug() << "threads:" << numThreads
+             << "tiles per second:" << qreal(NUM_TILES) / elapsed * 1e9
+             << "arena:" << stats.allocatedSize / 1024 / 1024 << "MiB"
+             << "fragmentation:" << stats.fragmentation()
+             << "allocation latency:" << stats.averageAllocationLatency << "ns";
+}
+
+}
+
+void KisTileDataArenaBenchmark::addThreadRows()
+{
+    QTest::addColumn<int>("numThreads");
+
+    for (int i = 1; i <= 16; i *= 2) {
+        QTest::newRow(QString("%1 threads").arg(i).toLatin1()) << i;
+    }
+}
+
+void KisTileDataArenaBenchmark::benchmarkArena_data()
+{
+    addThreadRows();
+}
+
+void KisTileDataArenaBenchmark::benchmarkArena()
+{
+    QFETCH(int, numThreads);
+
+    KisTileDataArena *arena = KisTileDataArena::instance();
+
+    QBENCHMARK_ONCE {
+        runThreads(numThreads,
+                   [arena] () -> void* { return arena->allocate(PIXEL_SIZE); },
+                   [arena] (void *ptr) { arena->free(static_cast<quint8*>(ptr), PIXEL_SIZE); });
+    }
+}
+
+void KisTileDataArenaBenchmark::benchmarkMalloc_data()
+{
+    addThreadRows();
+}
+
+void KisTileDataArenaBenchmark::benchmarkMalloc()
+{
+    QFETCH(int, numThreads);
+
+    const int tileSize = PIXEL_SIZE * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    QBENCHMARK_ONCE {
+        runThreads(numThreads,
+                   [tileSize] () -> void* { return std::malloc(tileSize); },
+                   [] (void *ptr) { std::free(ptr); });
+    }
+}
+
+void KisTileDataArenaBenchmark::benchmarkTileData_data()
+{
+    addThreadRows();
+}
+
+void KisTileDataArenaBenchmark::benchmarkTileData()
+{
+    QFETCH(int, numThreads);
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    const quint8 defaultPixel[PIXEL_SIZE] = {0, 0, 0, 0};
+
+    QBENCHMARK_ONCE {
+        runThreads(numThreads,
+                   [store, &defaultPixel] () -> void* {
+                       return store->createDefaultTileData(PIXEL_SIZE, defaultPixel);
+                   },
+                   [store] (void *ptr) {
+                       store->freeTileData(static_cast<KisTileData*>(ptr));
+                   });
+    }
+}
+
+QTEST_MAIN(KisTileDataArenaBenchmark)
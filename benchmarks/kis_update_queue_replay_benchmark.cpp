@@ -0,0 +1,164 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "kis_update_queue_replay_benchmark.h"
+
+#include <QTest>
+#include <QFile>
+#include <QRegularExpression>
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_image_config.h>
+#include <kis_image.h>
+
+#include "image_config_override.h"
+
+const QRect IMAGE_RECT(0, 0, 4000, 3000);
+const int NUM_LAYERS = 10;
+
+static QVector<QRect> loadTrace(const QString &fileName)
+{
+    QVector<QRect> rects;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Cannot open update trace" << fileName;
+        return rects;
+    }
+
+    const QRegularExpression re("UPDATE_TRACE\"?\\s+(-?\\d+)\\s+(-?\\d+)\\s+(\\d+)\\s+(\\d+)");
+
+    while (!file.atEnd()) {
+        const QString line = QString::fromLocal8Bit(file.readLine());
+        const QRegularExpressionMatch match = re.match(line);
+        if (!match.hasMatch()) continue;
+
+        rects << QRect(match.captured(1).toInt(), match.captured(2).toInt(),
+                       match.captured(3).toInt(), match.captured(4).toInt());
+    }
+
+    return rects;
+}
+
+/**
+ * A brush stroke: 30px dabs spaced by 5px along a wavy line
+ */
+static QVector<QRect> generateStrokeTrace()
+{
+    QVector<QRect> rects;
+
+    const int dabSize = 30;
+    const qreal spacing = 5.0;
+
+    for (qreal x = 100; x < IMAGE_RECT.width() - 100; x += spacing) {
+        const qreal y = 0.5 * IMAGE_RECT.height() + 800 * qSin(x / 500.0);
+        rects << QRect(qRound(x) - dabSize / 2, qRound(y) - dabSize / 2, dabSize, dabSize);
+    }
+
+    return rects;
+}
+
+/**
+ * Small updates scattered over the image, e.g. a spray brush
+ * or several tools updating their decorations
+ */
+static QVector<QRect> generateScatteredTrace()
+{
+    QVector<QRect> rects;
+
+    const int numRects = 2000;
+    const int size = 16;
+
+    for (int i = 0; i < numRects; i++) {
+        const int x = (i * 7919) % (IMAGE_RECT.width() - size);
+        const int y = (i * 104729) % (IMAGE_RECT.height() - size);
+        rects << QRect(x, y, size, size);
+    }
+
+    return rects;
+}
+
+void KisUpdateQueueReplayBenchmark::benchmarkReplay_data()
+{
+    QTest::addColumn<QVector<QRect>>("trace");
+    QTest::addColumn<bool>("adaptive");
+
+    const QString traceFile = qgetenv("KRITA_UPDATE_TRACE");
+
+    if (!traceFile.isEmpty()) {
+        const QVector<QRect> trace = loadTrace(traceFile);
+
+        QTest::newRow("recorded-fixed") << trace << false;
+        QTest::newRow("recorded-adaptive") << trace << true;
+    } else {
+        const QVector<QRect> stroke = generateStrokeTrace();
+        const QVector<QRect> scattered = generateScatteredTrace();
+
+        QTest::newRow("stroke-fixed") << stroke << false;
+        QTest::newRow("stroke-adaptive") << stroke << true;
+        QTest::newRow("scattered-fixed") << scattered << false;
+        QTest::newRow("scattered-adaptive") << scattered << true;
+    }
+}
+
+void KisUpdateQueueReplayBenchmark::benchmarkReplay()
+{
+    QFETCH(QVector<QRect>, trace);
+    QFETCH(bool, adaptive);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    /**
+     * The update queue reads the option on construction,
+     * so it should be set before the image is created
+     */
+    TestUtil::ImageConfigOverride<bool> adaptiveOverride(&KisImageConfig::adaptiveUpdatesCoalescing,
+                                                         &KisImageConfig::setAdaptiveUpdatesCoalescing,
+                                                         adaptive);
+
+    KisImageSP image = new KisImage(0, IMAGE_RECT.width(), IMAGE_RECT.height(), cs, "update queue replay benchmark");
+
+    KisPaintLayerSP topLayer;
+
+    for (int i = 0; i < NUM_LAYERS; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+
+        const QColor color = QColor::fromHsv((i * 37) % 360, 200, 200, 128);
+        layer->paintDevice()->fill(IMAGE_RECT, KoColor(color, cs));
+        image->addNode(layer, image->root());
+
+        topLayer = layer;
+    }
+
+    image->initialRefreshGraph();
+
+    QBENCHMARK {
+        Q_FOREACH (const QRect &rc, trace) {
+            topLayer->setDirty(rc);
+        }
+        image->waitForDone();
+    }
+}
+
+QTEST_MAIN(KisUpdateQueueReplayBenchmark)
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_UPDATE_QUEUE_REPLAY_BENCHMARK_H
+#define __KIS_UPDATE_QUEUE_REPLAY_BENCHMARK_H
+
+#include <QtTest>
+#include <QVector>
+#include <QRect>
+
+/**
+ * Replays a sequence of update rects through the image's update
+ * scheduler and compares the fixed-threshold coalescing against
+ * the cost-model-based one.
+ *
+ * The trace is loaded from a file set in KRITA_UPDATE_TRACE. The
+ * file is Krita's debug output with ENABLE_UPDATE_TRACE defined in
+ * kis_simple_update_queue.cpp. Lines without "UPDATE_TRACE" are
+ * skipped. If the variable is not set, synthetic traces are used.
+ */
+class KisUpdateQueueReplayBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchmarkReplay_data();
+    void benchmarkReplay();
+};
+
+#endif /* __KIS_UPDATE_QUEUE_REPLAY_BENCHMARK_H */
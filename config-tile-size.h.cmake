@@ -0,0 +1,4 @@
+/* config-tile-size.h.  Generated by cmake from config-tile-size.h.cmake */
+
+/* The width and height of the tiles of paint devices in pixels */
+#define KRITA_TILE_SIZE ${KRITA_TILE_SIZE}
@@ -14,20 +14,38 @@
 #include <QVector>
 #include <QMutex>
 #include <QMutexLocker>
+#include <atomic>
 #include <tiles3/kis_lockless_stack.h>
 
 #define CALL_MEMBER(obj, pmf) ((obj).*(pmf))
 
+/**
+ * Epoch-based reclamation of the objects removed from the map.
+ *
+ * The readers register in one of two sets of counters, selected by
+ * the parity of the global epoch. The counters are striped per thread
+ * and padded to a cache line, so the readers running in different
+ * threads do not write into the same memory.
+ *
+ * The epoch is advanced only when nobody reads under the other parity.
+ * An object retired in epoch E is destroyed when the epoch reaches
+ * E + 3: a reader that has loaded an old epoch and registered late is
+ * caught by one of the two checks done after the retirement.
+ *
+ * The fast path of update() does not write anything, so it can be
+ * called on every access to the map.
+ */
 class QSBR
 {
 private:
     struct Action {
         void (*func)(void*);
         quint64 param[4]; // Size limit found experimentally. Verified by assert below.
+        quint32 epoch;
 
         Action() = default;
 
-        Action(void (*f)(void*), void* p, quint64 paramSize) : func(f)
+        Action(void (*f)(void*), void* p, quint64 paramSize, quint32 _epoch) : func(f), epoch(_epoch)
         {
             KIS_ASSERT(paramSize <= sizeof(param)); // Verify size limit.
             memcpy(&param, p, paramSize);
@@ -39,36 +57,79 @@ private:
         }
     };
 
-    QAtomicInt m_rawPointerUsers;
+    struct ReadersCounter {
+        std::atomic<int> value;
+        char padding[64 - sizeof(std::atomic<int>)];
+
+        ReadersCounter() : value(0) {}
+    };
+
+    static const int NUM_STRIPES = 16;
+    static const quint32 RECLAIM_EPOCH_DISTANCE = 3;
+
+    std::atomic<quint32> m_epoch;
+    ReadersCounter m_readers[2][NUM_STRIPES];
+
     KisLocklessStack<Action> m_pendingActions;
     KisLocklessStack<Action> m_migrationReclaimActions;
 
+    static int currentThreadStripe()
+    {
+        static std::atomic<int> nextStripe(0);
+        static thread_local int stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % NUM_STRIPES;
+        return stripe;
+    }
+
+    bool hasReaders(int parity)
+    {
+        for (int i = 0; i < NUM_STRIPES; i++) {
+            if (m_readers[parity][i].value.load(std::memory_order_seq_cst)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void tryAdvanceEpoch()
+    {
+        quint32 epoch = m_epoch.load(std::memory_order_seq_cst);
+
+        if (!hasReaders((epoch + 1) & 1)) {
+            m_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+        }
+    }
+
     void releasePoolSafely(KisLocklessStack<Action> *pool, bool force = false) {
         KisLocklessStack<Action> tmp;
         tmp.mergeFrom(*pool);
         if (tmp.isEmpty()) return;
 
-        if (force || tmp.size() > 4096) {
-            while (m_rawPointerUsers.loadAcquire());
+        if (force) {
+            while (hasReaders(0) || hasReaders(1));
+        }
+
+        const quint32 epoch = m_epoch.load(std::memory_order_seq_cst);
+
+        KisLocklessStack<Action> postponed;
+        Action action;
 
-            Action action;
-            while (tmp.pop(action)) {
+        while (tmp.pop(action)) {
+            if (force || epoch - action.epoch >= RECLAIM_EPOCH_DISTANCE) {
                 action();
-            }
-        } else {
-            if (!m_rawPointerUsers.loadAcquire()) {
-                Action action;
-                while (tmp.pop(action)) {
-                    action();
-                }
             } else {
-                // push elements back to the source
-                pool->mergeFrom(tmp);
+                postponed.push(action);
             }
         }
+
+        // push elements back to the source
+        pool->mergeFrom(postponed);
     }
 
 public:
+    QSBR()
+        : m_epoch(0)
+    {
+    }
 
     template <class T>
     void enqueue(void (T::*pmf)(), T* target, bool migration = false)
@@ -85,16 +146,26 @@ public:
         };
 
         Closure closure = {pmf, target};
+        const quint32 epoch = m_epoch.load(std::memory_order_seq_cst);
 
         if (migration) {
-            m_migrationReclaimActions.push(Action(Closure::thunk, &closure, sizeof(closure)));
+            m_migrationReclaimActions.push(Action(Closure::thunk, &closure, sizeof(closure), epoch));
         } else {
-            m_pendingActions.push(Action(Closure::thunk, &closure, sizeof(closure)));
+            m_pendingActions.push(Action(Closure::thunk, &closure, sizeof(closure), epoch));
         }
     }
 
     void update(bool migrationInProgress)
     {
+        // a fast path without write ops
+        if (m_pendingActions.isEmpty() &&
+            (migrationInProgress || m_migrationReclaimActions.isEmpty())) {
+
+            return;
+        }
+
+        tryAdvanceEpoch();
+
         releasePoolSafely(&m_pendingActions);
 
         if (!migrationInProgress) {
@@ -108,14 +179,20 @@ public:
         releasePoolSafely(&m_migrationReclaimActions, true);
     }
 
-    void lockRawPointerAccess()
+    /**
+     * Returns a token that should be passed to the
+     * matching unlockRawPointerAccess() call
+     */
+    int lockRawPointerAccess()
     {
-        m_rawPointerUsers.ref();
+        const int parity = m_epoch.load(std::memory_order_seq_cst) & 1;
+        m_readers[parity][currentThreadStripe()].value.fetch_add(1, std::memory_order_seq_cst);
+        return parity;
     }
 
-    void unlockRawPointerAccess()
+    void unlockRawPointerAccess(int token)
     {
-        m_rawPointerUsers.deref();
+        m_readers[token][currentThreadStripe()].value.fetch_sub(1, std::memory_order_seq_cst);
     }
 };
 
@@ -0,0 +1,141 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisBelowSiblingsProjectionCache.h"
+
+#include <QMutexLocker>
+
+#include <KoColorSpace.h>
+
+#include "kis_paint_device.h"
+#include "kis_painter.h"
+#include "kis_projection_leaf.h"
+
+
+KisBelowSiblingsProjectionCache::KisBelowSiblingsProjectionCache()
+{
+}
+
+KisBelowSiblingsProjectionCache::~KisBelowSiblingsProjectionCache()
+{
+}
+
+bool KisBelowSiblingsProjectionCache::read(KisProjectionLeafSP splitLeaf,
+                                           const QVector<KisProjectionLeafSP> &belowLeaves,
+                                           KisPaintDeviceSP dst, const QRect &rect)
+{
+    QMutexLocker l(&m_mutex);
+
+    if (!keyMatches(splitLeaf, belowLeaves, dst)) {
+        resetKey(splitLeaf, belowLeaves, dst);
+        return false;
+    }
+
+    if (!(QRegion(rect) - m_cachedRegion).isEmpty()) return false;
+
+    KisPainter::copyAreaOptimized(rect.topLeft(), m_device, dst, rect);
+    return true;
+}
+
+void KisBelowSiblingsProjectionCache::write(KisProjectionLeafSP splitLeaf,
+                                            const QVector<KisProjectionLeafSP> &belowLeaves,
+                                            KisPaintDeviceSP src, const QRect &rect)
+{
+    if (rect.isEmpty()) return;
+
+    QMutexLocker l(&m_mutex);
+
+    if (!keyMatches(splitLeaf, belowLeaves, src)) {
+        resetKey(splitLeaf, belowLeaves, src);
+    }
+
+    KisPainter::copyAreaOptimized(rect.topLeft(), src, m_device, rect);
+    m_cachedRegion += rect;
+}
+
+void KisBelowSiblingsProjectionCache::reset()
+{
+    QMutexLocker l(&m_mutex);
+    resetImpl();
+}
+
+QRegion KisBelowSiblingsProjectionCache::cachedRegion() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_cachedRegion;
+}
+
+bool KisBelowSiblingsProjectionCache::keyMatches(KisProjectionLeafSP splitLeaf,
+                                                 const QVector<KisProjectionLeafSP> &belowLeaves,
+                                                 KisPaintDeviceSP projection) const
+{
+    /**
+     * The weak pointers become null when the leaf is deleted, so
+     * a new leaf allocated at the same address will not match
+     */
+    if (m_splitLeaf.isNull() || m_splitLeaf != splitLeaf) return false;
+    if (m_belowLeaves.size() != belowLeaves.size()) return false;
+
+    for (int i = 0; i < belowLeaves.size(); i++) {
+        if (m_belowLeaves[i].isNull() || m_belowLeaves[i] != belowLeaves[i]) return false;
+    }
+
+    return m_offset == QPoint(projection->x(), projection->y()) &&
+        m_colorSpace && *m_colorSpace == *projection->colorSpace();
+}
+
+void KisBelowSiblingsProjectionCache::resetKey(KisProjectionLeafSP splitLeaf,
+                                               const QVector<KisProjectionLeafSP> &belowLeaves,
+                                               KisPaintDeviceSP projection)
+{
+    resetImpl();
+
+    m_splitLeaf = splitLeaf;
+
+    m_belowLeaves.reserve(belowLeaves.size());
+    Q_FOREACH (KisProjectionLeafSP leaf, belowLeaves) {
+        m_belowLeaves << leaf;
+    }
+
+    m_offset = QPoint(projection->x(), projection->y());
+    m_colorSpace = projection->colorSpace();
+
+    /**
+     * The cached device should have the same default pixel as the
+     * projection, otherwise copyAreaOptimized() would write a wrong
+     * color into the empty areas
+     */
+    if (!m_device) {
+        m_device = new KisPaintDevice(projection->colorSpace());
+    }
+    m_device->prepareClone(projection);
+}
+
+void KisBelowSiblingsProjectionCache::resetImpl()
+{
+    m_splitLeaf.clear();
+    m_belowLeaves.clear();
+    m_offset = QPoint();
+    m_colorSpace = 0;
+
+    if (!m_cachedRegion.isEmpty()) {
+        m_device->clear();
+        m_cachedRegion = QRegion();
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_BELOW_SIBLINGS_PROJECTION_CACHE_H
+#define __KIS_BELOW_SIBLINGS_PROJECTION_CACHE_H
+
+#include <QVector>
+#include <QRegion>
+#include <QPoint>
+#include <QMutex>
+
+#include "kritaimage_export.h"
+#include "kis_types.h"
+
+class KoColorSpace;
+
+/**
+ * Keeps the composition of the children of a group that lie below
+ * some "split" child, usually the layer the user is painting on.
+ *
+ * When the split layer is updated, KisAsyncMerger copies the cached
+ * composition of the lower layers into the projection and composites
+ * only the split layer and the layers above it, instead of walking
+ * through the whole stack of the group.
+ *
+ * The cache is identified by the split leaf and the list of the
+ * leaves below it. Every walker that passes through the group with
+ * a different split (that is, the walker for the change of any of
+ * the lower layers, a full refresh or a change of the layers stack)
+ * drops the cached data. The cache is also dropped when the offset or
+ * the color space of the group's projection changes.
+ *
+ * The class is thread-safe, the merge jobs for different rects of the
+ * same group may access it concurrently.
+ */
+class KRITAIMAGE_EXPORT KisBelowSiblingsProjectionCache
+{
+public:
+    KisBelowSiblingsProjectionCache();
+    ~KisBelowSiblingsProjectionCache();
+
+    /**
+     * Copies the cached composition of \p belowLeaves into \p dst in
+     * \p rect. Returns false if \p rect is not cached yet. If the
+     * cache keeps the data for a different split, the data is dropped.
+     */
+    bool read(KisProjectionLeafSP splitLeaf,
+              const QVector<KisProjectionLeafSP> &belowLeaves,
+              KisPaintDeviceSP dst, const QRect &rect);
+
+    /**
+     * Saves the composition of \p belowLeaves, stored in \p src, for
+     * \p rect. If the cache keeps the data for a different split, the
+     * old data is dropped.
+     */
+    void write(KisProjectionLeafSP splitLeaf,
+               const QVector<KisProjectionLeafSP> &belowLeaves,
+               KisPaintDeviceSP src, const QRect &rect);
+
+    /**
+     * Drops all the cached data and releases the memory
+     */
+    void reset();
+
+    /**
+     * The area where the composition is cached
+     */
+    QRegion cachedRegion() const;
+
+private:
+    bool keyMatches(KisProjectionLeafSP splitLeaf,
+                    const QVector<KisProjectionLeafSP> &belowLeaves,
+                    KisPaintDeviceSP projection) const;
+    void resetKey(KisProjectionLeafSP splitLeaf,
+                  const QVector<KisProjectionLeafSP> &belowLeaves,
+                  KisPaintDeviceSP projection);
+    void resetImpl();
+
+private:
+    mutable QMutex m_mutex;
+
+    KisProjectionLeafWSP m_splitLeaf;
+    QVector<KisProjectionLeafWSP> m_belowLeaves;
+    QPoint m_offset;
+    const KoColorSpace *m_colorSpace = 0;
+
+    KisPaintDeviceSP m_device;
+    QRegion m_cachedRegion;
+};
+
+#endif /* __KIS_BELOW_SIBLINGS_PROJECTION_CACHE_H */
@@ -0,0 +1,304 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisIncrementalHistogram.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+
+#include <KoHistogramProducer.h>
+
+#include "kis_paint_device.h"
+#include "kis_iterator_ng.h"
+#include "kis_assert.h"
+
+struct KisIncrementalHistogram::Private
+{
+    KisPaintDeviceSP device;
+    QRect bounds;
+    QScopedPointer<KoHistogramProducer> producer;
+
+    int numChannels = 0;
+    int numBins = 0;
+    int numColumns = 0;
+    int numRows = 0;
+
+    /**
+     * Bins of every channel are followed by the out-of-view counters,
+     * the total number of pixels is the last element
+     */
+    int channelStride = 0;
+    int cellStride = 0;
+
+    QVector<QVector<quint32>> cells;
+    QVector<quint32> totals;
+
+    mutable QMutex dirtyLock;
+    QVector<bool> dirtyCells;
+    bool hasDirtyCells = false;
+
+    QRect cellRect(int index) const {
+        const int column = index % numColumns;
+        const int row = index / numColumns;
+
+        return QRect(bounds.x() + column * CELL_SIZE,
+                     bounds.y() + row * CELL_SIZE,
+                     CELL_SIZE, CELL_SIZE) & bounds;
+    }
+
+    void calculateCell(KisPaintDeviceSP dev, const QRect &rc, KoHistogramProducer *cellProducer, QVector<quint32> *result) const;
+
+    /**
+     * Every job calculates the cells with its own copy of the producer,
+     * the cells are taken from the shared counter
+     */
+    struct CellJob {
+        CellJob() {}
+        CellJob(const Private *_d, KisPaintDeviceSP _dev, const QVector<int> *_dirtyCells,
+                QVector<QVector<quint32>> *_results, QAtomicInt *_nextCell)
+            : d(_d),
+              dev(_dev),
+              dirtyCells(_dirtyCells),
+              results(_results),
+              nextCell(_nextCell)
+        {
+        }
+
+        void run();
+
+        const Private *d = 0;
+        KisPaintDeviceSP dev;
+        const QVector<int> *dirtyCells = 0;
+        QVector<QVector<quint32>> *results = 0;
+        QAtomicInt *nextCell = 0;
+    };
+
+    struct CellJobWrapper {
+        inline void operator() (CellJob &job) {
+            job.run();
+        }
+    };
+};
+
+void KisIncrementalHistogram::Private::calculateCell(KisPaintDeviceSP dev, const QRect &rc, KoHistogramProducer *cellProducer, QVector<quint32> *result) const
+{
+    cellProducer->clear();
+
+    KisSequentialConstIterator it(dev, rc);
+    const KoColorSpace *cs = dev->colorSpace();
+
+    int numConseqPixels = it.nConseqPixels();
+    while (it.nextPixels(numConseqPixels)) {
+        numConseqPixels = it.nConseqPixels();
+        cellProducer->addRegionToBin(it.oldRawData(), 0, numConseqPixels, cs);
+    }
+
+    result->resize(cellStride);
+    quint32 *dst = result->data();
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        for (int bin = 0; bin < numBins; bin++) {
+            *dst++ = cellProducer->getBinAt(channel, bin);
+        }
+        *dst++ = cellProducer->outOfViewLeft(channel);
+        *dst++ = cellProducer->outOfViewRight(channel);
+    }
+    *dst = cellProducer->count();
+}
+
+void KisIncrementalHistogram::Private::CellJob::run()
+{
+    QScopedPointer<KoHistogramProducer> producer(d->producer->createEmptyCopy());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(producer);
+
+    int i;
+    while ((i = nextCell->fetchAndAddOrdered(1)) < dirtyCells->size()) {
+        d->calculateCell(dev, d->cellRect(dirtyCells->at(i)), producer.data(), &(*results)[i]);
+    }
+}
+
+KisIncrementalHistogram::KisIncrementalHistogram(KisPaintDeviceSP device, const QRect &bounds, KoHistogramProducer *producer)
+    : m_d(new Private)
+{
+    KIS_ASSERT(producer);
+
+    m_d->device = device;
+    m_d->bounds = bounds;
+    m_d->producer.reset(producer);
+
+    m_d->numChannels = producer->channels().size();
+    m_d->numBins = producer->numberOfBins();
+    m_d->channelStride = m_d->numBins + 2;
+    m_d->cellStride = m_d->numChannels * m_d->channelStride + 1;
+
+    m_d->numColumns = (bounds.width() + CELL_SIZE - 1) / CELL_SIZE;
+    m_d->numRows = (bounds.height() + CELL_SIZE - 1) / CELL_SIZE;
+
+    m_d->cells.resize(m_d->numColumns * m_d->numRows);
+    m_d->totals.fill(0, m_d->cellStride);
+    m_d->dirtyCells.resize(m_d->cells.size());
+
+    setAllDirty();
+}
+
+KisIncrementalHistogram::~KisIncrementalHistogram()
+{
+}
+
+void KisIncrementalHistogram::addDirtyRect(const QRect &rc)
+{
+    const QRect dirtyRect = rc & m_d->bounds;
+    if (dirtyRect.isEmpty()) return;
+
+    const QPoint topLeft = dirtyRect.topLeft() - m_d->bounds.topLeft();
+    const QPoint bottomRight = dirtyRect.bottomRight() - m_d->bounds.topLeft();
+
+    QMutexLocker l(&m_d->dirtyLock);
+
+    for (int row = topLeft.y() / CELL_SIZE; row <= bottomRight.y() / CELL_SIZE; row++) {
+        for (int column = topLeft.x() / CELL_SIZE; column <= bottomRight.x() / CELL_SIZE; column++) {
+            m_d->dirtyCells[row * m_d->numColumns + column] = true;
+        }
+    }
+
+    m_d->hasDirtyCells = true;
+}
+
+void KisIncrementalHistogram::setAllDirty()
+{
+    QMutexLocker l(&m_d->dirtyLock);
+    m_d->dirtyCells.fill(true);
+    m_d->hasDirtyCells = !m_d->dirtyCells.isEmpty();
+}
+
+bool KisIncrementalHistogram::hasDirtyCells() const
+{
+    QMutexLocker l(&m_d->dirtyLock);
+    return m_d->hasDirtyCells;
+}
+
+QVector<int> KisIncrementalHistogram::takeDirtyCells()
+{
+    QVector<int> dirtyCells;
+
+    QMutexLocker l(&m_d->dirtyLock);
+    if (!m_d->hasDirtyCells) return dirtyCells;
+
+    for (int i = 0; i < m_d->dirtyCells.size(); i++) {
+        if (m_d->dirtyCells[i]) {
+            dirtyCells << i;
+            m_d->dirtyCells[i] = false;
+        }
+    }
+    m_d->hasDirtyCells = false;
+
+    return dirtyCells;
+}
+
+void KisIncrementalHistogram::update()
+{
+    update(takeDirtyCells());
+}
+
+void KisIncrementalHistogram::update(const QVector<int> &dirtyCells, KisPaintDeviceSP snapshot)
+{
+    if (dirtyCells.isEmpty()) return;
+
+    KisPaintDeviceSP dev = snapshot ? snapshot : m_d->device;
+    KIS_SAFE_ASSERT_RECOVER_RETURN(*dev->colorSpace() == *m_d->device->colorSpace());
+
+    QVector<QVector<quint32>> results(dirtyCells.size());
+    QAtomicInt nextCell(0);
+
+    const int numJobs = qBound(1, dirtyCells.size(), QThread::idealThreadCount());
+
+    QVector<Private::CellJob> jobs;
+    for (int i = 0; i < numJobs; i++) {
+        jobs << Private::CellJob(m_d.data(), dev, &dirtyCells, &results, &nextCell);
+    }
+
+    if (jobs.size() > 1) {
+        Private::CellJobWrapper wrapper;
+        QtConcurrent::blockingMap(jobs, wrapper);
+    } else {
+        jobs.first().run();
+    }
+
+    /**
+     * The counters are unsigned, so subtracting the old bins
+     * before adding the new ones cannot overflow the result
+     */
+    quint32 *totals = m_d->totals.data();
+
+    for (int i = 0; i < dirtyCells.size(); i++) {
+        QVector<quint32> &cell = m_d->cells[dirtyCells[i]];
+        const QVector<quint32> &newCell = results[i];
+        if (newCell.isEmpty()) continue;
+
+        if (!cell.isEmpty()) {
+            for (int j = 0; j < m_d->cellStride; j++) {
+                totals[j] -= cell[j];
+            }
+        }
+
+        for (int j = 0; j < m_d->cellStride; j++) {
+            totals[j] += newCell[j];
+        }
+
+        cell = newCell;
+    }
+}
+
+KoHistogramProducer *KisIncrementalHistogram::producer() const
+{
+    return m_d->producer.data();
+}
+
+int KisIncrementalHistogram::channelCount() const
+{
+    return m_d->numChannels;
+}
+
+int KisIncrementalHistogram::numberOfBins() const
+{
+    return m_d->numBins;
+}
+
+quint32 KisIncrementalHistogram::binAt(int channel, int bin) const
+{
+    return m_d->totals[channel * m_d->channelStride + bin];
+}
+
+quint32 KisIncrementalHistogram::outOfViewLeft(int channel) const
+{
+    return m_d->totals[channel * m_d->channelStride + m_d->numBins];
+}
+
+quint32 KisIncrementalHistogram::outOfViewRight(int channel) const
+{
+    return m_d->totals[channel * m_d->channelStride + m_d->numBins + 1];
+}
+
+quint32 KisIncrementalHistogram::count() const
+{
+    return m_d->totals[m_d->cellStride - 1];
+}
@@ -0,0 +1,110 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_INCREMENTAL_HISTOGRAM_H
+#define __KIS_INCREMENTAL_HISTOGRAM_H
+
+#include <QRect>
+#include <QScopedPointer>
+#include <QVector>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+class KoHistogramProducer;
+
+/**
+ * A histogram of a paint device, which is kept up to date by recalculating
+ * only the changed parts of the device.
+ *
+ * The bounds are split into cells of CELL_SIZE x CELL_SIZE pixels. The
+ * bins of every cell are stored separately, so when a cell is changed,
+ * its old bins are subtracted from the totals and the new ones are added
+ * without touching the rest of the device. The dirty cells are calculated
+ * in parallel, every thread accumulating into its own copy of the producer.
+ *
+ * The layout of the bins is defined by the producer passed to the
+ * constructor, the channels are in the order of producer()->channels().
+ */
+class KRITAIMAGE_EXPORT KisIncrementalHistogram
+{
+public:
+    static const int CELL_SIZE = 256;
+
+public:
+    /**
+     * The object takes the ownership of \p producer, which must support
+     * KoHistogramProducer::createEmptyCopy(). All the cells are dirty
+     * after construction.
+     */
+    KisIncrementalHistogram(KisPaintDeviceSP device, const QRect &bounds, KoHistogramProducer *producer);
+    ~KisIncrementalHistogram();
+
+    /**
+     * Marks the cells intersecting \p rc dirty. Can be called from any
+     * thread, including while update() is running.
+     */
+    void addDirtyRect(const QRect &rc);
+
+    /**
+     * Marks all the cells dirty
+     */
+    void setAllDirty();
+
+    bool hasDirtyCells() const;
+
+    /**
+     * Returns the indexes of the dirty cells and marks them clean. Call it
+     * right when taking the snapshot of the device passed to
+     * update(const QVector<int>&, KisPaintDeviceSP): the cells that are
+     * marked dirty later are left for the next update.
+     */
+    QVector<int> takeDirtyCells();
+
+    /**
+     * Recalculates the dirty cells and updates the totals. The bins should
+     * be read in the same thread after update() returns. update() must not
+     * be called from several threads at once.
+     */
+    void update();
+
+    /**
+     * Recalculates \p dirtyCells returned by takeDirtyCells(). If
+     * \p snapshot is set, the pixels are read from it instead of the
+     * device passed to the constructor. Use it when the device may be
+     * changed while the histogram is being calculated, e.g. for the
+     * projection of the image.
+     */
+    void update(const QVector<int> &dirtyCells, KisPaintDeviceSP snapshot = KisPaintDeviceSP());
+
+    KoHistogramProducer* producer() const;
+
+    int channelCount() const;
+    int numberOfBins() const;
+
+    quint32 binAt(int channel, int bin) const;
+    quint32 outOfViewLeft(int channel) const;
+    quint32 outOfViewRight(int channel) const;
+    quint32 count() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_INCREMENTAL_HISTOGRAM_H */
@@ -0,0 +1,407 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisMergeTraceRecorder.h"
+
+#include <QGlobalStatic>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "kis_debug.h"
+#include "kis_node.h"
+#include "kis_base_rects_walker.h"
+
+Q_GLOBAL_STATIC(KisMergeTraceRecorder, s_instance)
+
+
+namespace {
+
+/**
+ * Limits the memory used by a recording that has been
+ * forgotten enabled to about a hundred megabytes
+ */
+const int MAX_EVENTS = 1 << 20;
+
+thread_local int s_walkerType = -1;
+thread_local int s_levelOfDetail = 0;
+
+std::atomic<int> s_nextThreadIndex(0);
+
+int currentThreadIndex()
+{
+    static thread_local int index = s_nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+const char* walkerTypeName(int type)
+{
+    switch (type) {
+    case KisBaseRectsWalker::UPDATE:
+        return "update";
+    case KisBaseRectsWalker::UPDATE_NO_FILTHY:
+        return "update no filthy";
+    case KisBaseRectsWalker::FULL_REFRESH:
+        return "full refresh";
+    case KisBaseRectsWalker::UNSUPPORTED:
+        return "subtree refresh";
+    }
+
+    return "unknown";
+}
+
+const char* positionName(int position)
+{
+    if (position & KisBaseRectsWalker::N_EXTRA) return "extra";
+    if (position & KisBaseRectsWalker::N_FILTHY) return "filthy";
+    if (position & KisBaseRectsWalker::N_FILTHY_PROJECTION) return "filthy projection";
+    if (position & KisBaseRectsWalker::N_ABOVE_FILTHY) return "above filthy";
+    if (position & KisBaseRectsWalker::N_BELOW_FILTHY) return "below filthy";
+
+    return "";
+}
+
+}
+
+struct KisMergeTraceRecorder::Event
+{
+    const char *category;
+    QString nodeName;
+    QString nodeType;
+    int walkerType;
+    int position;
+    int levelOfDetail;
+    int numFusedNodes;
+    QRect rect;
+    qint64 startTime;
+    qint64 duration;
+    int threadIndex;
+};
+
+struct Q_DECL_HIDDEN KisMergeTraceRecorder::Private
+{
+    QElapsedTimer timer;
+
+    mutable QMutex mutex;
+    QVector<Event> events;
+    int numDroppedEvents = 0;
+
+    QString outputFileName;
+};
+
+KisMergeTraceRecorder::KisMergeTraceRecorder()
+    : m_d(new Private),
+      m_enabled(false)
+{
+    m_d->timer.start();
+
+    m_d->outputFileName = QString::fromLocal8Bit(qgetenv("KRITA_MERGE_TRACE"));
+    if (!m_d->outputFileName.isEmpty()) {
+        setEnabled(true);
+    }
+}
+
+KisMergeTraceRecorder::~KisMergeTraceRecorder()
+{
+    if (!m_d->outputFileName.isEmpty()) {
+        if (saveTrace(m_d->outputFileName)) {
+            qInfo().noquote() << summary();
+        }
+    }
+
+    delete m_d;
+}
+
+KisMergeTraceRecorder* KisMergeTraceRecorder::instance()
+{
+    return s_instance;
+}
+
+void KisMergeTraceRecorder::setEnabled(bool value)
+{
+    m_enabled.store(value);
+}
+
+void KisMergeTraceRecorder::clear()
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->events.clear();
+    m_d->numDroppedEvents = 0;
+}
+
+int KisMergeTraceRecorder::numEvents() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->events.size();
+}
+
+qint64 KisMergeTraceRecorder::currentTime() const
+{
+    return m_d->timer.nsecsElapsed();
+}
+
+void KisMergeTraceRecorder::addEvent(const Event &event)
+{
+    QMutexLocker l(&m_d->mutex);
+
+    if (m_d->events.size() >= MAX_EVENTS) {
+        m_d->numDroppedEvents++;
+        return;
+    }
+
+    m_d->events.append(event);
+}
+
+bool KisMergeTraceRecorder::saveTrace(const QString &fileName) const
+{
+    QJsonArray traceEvents;
+    int numDroppedEvents = 0;
+
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        Q_FOREACH (const Event &event, m_d->events) {
+            QJsonObject args;
+            args["type"] = event.nodeType;
+            args["walker"] = QString(walkerTypeName(event.walkerType));
+            args["position"] = QString(positionName(event.position));
+            args["lod"] = event.levelOfDetail;
+            args["rect"] = QString("%1,%2 %3x%4")
+                .arg(event.rect.x()).arg(event.rect.y())
+                .arg(event.rect.width()).arg(event.rect.height());
+            args["pixels"] = qint64(event.rect.width()) * event.rect.height();
+
+            if (event.numFusedNodes > 0) {
+                args["fused"] = event.numFusedNodes;
+            }
+
+            QJsonObject object;
+            object["name"] = event.nodeName;
+            object["cat"] = QString(event.category);
+            object["ph"] = QString("X");
+            object["ts"] = event.startTime / 1000.0;
+            object["dur"] = event.duration / 1000.0;
+            object["pid"] = 0;
+            object["tid"] = event.threadIndex;
+            object["args"] = args;
+
+            traceEvents.append(object);
+        }
+
+        numDroppedEvents = m_d->numDroppedEvents;
+    }
+
+    if (numDroppedEvents > 0) {
+        warnImage << "KisMergeTraceRecorder:" << numDroppedEvents << "events were dropped because of the events limit";
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = QString("ms");
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        warnImage << "KisMergeTraceRecorder: failed to open" << fileName << "for writing";
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+QVector<KisMergeTraceRecorder::NodeStatistics> KisMergeTraceRecorder::statistics() const
+{
+    QHash<QString, NodeStatistics> hash;
+
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        Q_FOREACH (const Event &event, m_d->events) {
+            const QString key =
+                QString("%1\n%2\n%3").arg(QString(event.category)).arg(event.nodeType).arg(event.nodeName);
+
+            NodeStatistics &stats = hash[key];
+
+            if (!stats.numEvents) {
+                stats.category = event.category;
+                stats.nodeType = event.nodeType;
+                stats.nodeName = event.nodeName;
+            }
+
+            stats.numEvents++;
+            stats.totalTime += event.duration;
+            stats.numPixels += qint64(event.rect.width()) * event.rect.height();
+        }
+    }
+
+    QVector<NodeStatistics> result;
+    result.reserve(hash.size());
+
+    Q_FOREACH (const NodeStatistics &stats, hash) {
+        result << stats;
+    }
+
+    std::sort(result.begin(), result.end(),
+              [] (const NodeStatistics &lhs, const NodeStatistics &rhs) {
+                  return lhs.totalTime > rhs.totalTime;
+              });
+
+    return result;
+}
+
+QString KisMergeTraceRecorder::summary() const
+{
+    const QVector<NodeStatistics> stats = statistics();
+
+    QString result;
+    QTextStream s(&result);
+
+    s << "Merge trace summary (the time of a layer includes its masks and layer styles,"
+      << " the time of a job includes all its nodes):" << endl;
+
+    s << QString("%1 %2 %3 %4  %5 %6 %7")
+        .arg("Time (ms)", 12)
+        .arg("Events", 8)
+        .arg("Mpx", 10)
+        .arg("ns/px", 8)
+        .arg("Category", -12)
+        .arg("Type", -28)
+        .arg("Name") << endl;
+
+    Q_FOREACH (const NodeStatistics &node, stats) {
+        const qreal nsPerPixel = node.numPixels > 0 ? qreal(node.totalTime) / node.numPixels : 0.0;
+
+        s << QString("%1 %2 %3 %4  %5 %6 %7")
+            .arg(node.totalTime / 1e6, 12, 'f', 2)
+            .arg(node.numEvents, 8)
+            .arg(node.numPixels / 1e6, 10, 'f', 2)
+            .arg(nsPerPixel, 8, 'f', 2)
+            .arg(node.category, -12)
+            .arg(node.nodeType, -28)
+            .arg(node.nodeName) << endl;
+    }
+
+    return result;
+}
+
+/*********************************************************************/
+/*                     Scopes                                        */
+/*********************************************************************/
+
+KisMergeTraceRecorder::WalkerScope::WalkerScope(const KisBaseRectsWalker &walker)
+    : m_active(KisMergeTraceRecorder::instance() &&
+               KisMergeTraceRecorder::instance()->isEnabled()),
+      m_oldWalkerType(s_walkerType),
+      m_oldLevelOfDetail(s_levelOfDetail)
+{
+    if (m_active) {
+        s_walkerType = walker.type();
+        s_levelOfDetail = walker.levelOfDetail();
+    }
+}
+
+KisMergeTraceRecorder::WalkerScope::~WalkerScope()
+{
+    if (m_active) {
+        s_walkerType = m_oldWalkerType;
+        s_levelOfDetail = m_oldLevelOfDetail;
+    }
+}
+
+KisMergeTraceRecorder::NodeScope::NodeScope(const char *category, const KisNodeSP &node,
+                                            const QRect &rect, int position,
+                                            const QString &nodeType)
+    : m_category(category),
+      m_position(position)
+{
+    KisMergeTraceRecorder *recorder = KisMergeTraceRecorder::instance();
+
+    if (recorder && recorder->isEnabled() && node) {
+        m_node = node;
+        m_nodeType = !nodeType.isEmpty() ? nodeType : QString(node->metaObject()->className());
+        m_rect = rect;
+        m_startTime = recorder->currentTime();
+    }
+}
+
+KisMergeTraceRecorder::NodeScope::~NodeScope()
+{
+    KisMergeTraceRecorder *recorder = KisMergeTraceRecorder::instance();
+    if (m_startTime < 0 || !recorder) return;
+
+    Event event;
+    event.category = m_category;
+    event.nodeName = m_node->name();
+    event.nodeType = m_nodeType;
+    event.walkerType = s_walkerType;
+    event.position = m_position;
+    event.levelOfDetail = s_levelOfDetail;
+    event.numFusedNodes = m_numFusedNodes;
+    event.rect = m_rect;
+    event.startTime = m_startTime;
+    event.duration = recorder->currentTime() - m_startTime;
+    event.threadIndex = currentThreadIndex();
+
+    recorder->addEvent(event);
+}
+
+void KisMergeTraceRecorder::NodeScope::setNumFusedNodes(int value)
+{
+    m_numFusedNodes = value;
+}
+
+KisMergeTraceRecorder::JobScope::JobScope(const KisBaseRectsWalker &walker)
+    : m_walker(walker)
+{
+    KisMergeTraceRecorder *recorder = KisMergeTraceRecorder::instance();
+
+    if (recorder && recorder->isEnabled()) {
+        m_startTime = recorder->currentTime();
+    }
+}
+
+KisMergeTraceRecorder::JobScope::~JobScope()
+{
+    KisMergeTraceRecorder *recorder = KisMergeTraceRecorder::instance();
+    if (m_startTime < 0 || !recorder) return;
+    KisNodeSP startNode = m_walker.startNode();
+
+    Event event;
+    event.category = "job";
+    event.nodeName = startNode ? startNode->name() : QString();
+    event.nodeType = startNode ? QString(startNode->metaObject()->className()) : QString();
+    event.walkerType = m_walker.type();
+    event.position = 0;
+    event.levelOfDetail = m_walker.levelOfDetail();
+    event.numFusedNodes = 0;
+    event.rect = m_walker.requestedRect();
+    event.startTime = m_startTime;
+    event.duration = recorder->currentTime() - m_startTime;
+    event.threadIndex = currentThreadIndex();
+
+    recorder->addEvent(event);
+}
@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_MERGE_TRACE_RECORDER_H
+#define __KIS_MERGE_TRACE_RECORDER_H
+
+#include <atomic>
+
+#include <QRect>
+#include <QString>
+#include <QVector>
+
+#include "kritaimage_export.h"
+#include "kis_types.h"
+
+class KisBaseRectsWalker;
+
+/**
+ * Records the time spent on every node while merging the image,
+ * so that one could find which layer, mask or layer style makes
+ * the canvas slow.
+ *
+ * Every event keeps the node, the processed rect, the type of the
+ * walker and the position of the node relative to the filthy one.
+ * The events are nested: the event of a layer includes the time of
+ * its masks, and the event of a merge job includes all the nodes
+ * processed by the job.
+ *
+ * The recording is disabled by default. It is enabled either with
+ * setEnabled() or by setting KRITA_MERGE_TRACE environment variable
+ * to the name of the output file. In the latter case the trace is
+ * saved and its summary is printed when Krita exits, which works
+ * for the headless runs as well, e.g.
+ *
+ *     QT_QPA_PLATFORM=offscreen KRITA_MERGE_TRACE=trace.json \
+ *         krita image.kra --export --export-filename out.png
+ *
+ * The trace is saved in Chrome trace-event JSON format, so it can be
+ * opened in chrome://tracing or in Perfetto UI.
+ */
+class KRITAIMAGE_EXPORT KisMergeTraceRecorder
+{
+public:
+    struct NodeStatistics {
+        QString category;
+        QString nodeType;
+        QString nodeName;
+
+        int numEvents = 0;
+        qint64 totalTime = 0; // ns
+        qint64 numPixels = 0;
+    };
+
+public:
+    KisMergeTraceRecorder();
+    ~KisMergeTraceRecorder();
+    static KisMergeTraceRecorder* instance();
+
+    inline bool isEnabled() const {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool value);
+
+    /**
+     * Drops all the recorded events
+     */
+    void clear();
+
+    int numEvents() const;
+
+    /**
+     * Saves the recorded events in Chrome trace-event JSON format
+     */
+    bool saveTrace(const QString &fileName) const;
+
+    /**
+     * The events aggregated by node, sorted by the total time
+     */
+    QVector<NodeStatistics> statistics() const;
+
+    /**
+     * Human-readable table of statistics()
+     */
+    QString summary() const;
+
+public:
+    /**
+     * Declares the walker being merged in the current thread. The
+     * events of the nodes inherit the type and the level of detail of
+     * the walker.
+     */
+    class KRITAIMAGE_EXPORT WalkerScope
+    {
+    public:
+        WalkerScope(const KisBaseRectsWalker &walker);
+        ~WalkerScope();
+
+    private:
+        bool m_active;
+        int m_oldWalkerType;
+        int m_oldLevelOfDetail;
+    };
+
+    /**
+     * Records the time of the processing of \p node in \p rect
+     * during the lifetime of the object. \p category is one of
+     * "layer", "mask" or "layer style". If \p nodeType is empty,
+     * the class name of the node is used.
+     */
+    class KRITAIMAGE_EXPORT NodeScope
+    {
+    public:
+        NodeScope(const char *category, const KisNodeSP &node,
+                  const QRect &rect, int position = 0,
+                  const QString &nodeType = QString());
+        ~NodeScope();
+
+        /**
+         * The node has been composited together with \p value
+         * other nodes in a single pass
+         */
+        void setNumFusedNodes(int value);
+
+    private:
+        const char *m_category;
+        KisNodeSP m_node;
+        QString m_nodeType;
+        QRect m_rect;
+        int m_position;
+        int m_numFusedNodes = 0;
+        qint64 m_startTime = -1;
+    };
+
+    /**
+     * Records the time of the merge job of \p walker
+     */
+    class KRITAIMAGE_EXPORT JobScope
+    {
+    public:
+        JobScope(const KisBaseRectsWalker &walker);
+        ~JobScope();
+
+    private:
+        const KisBaseRectsWalker &m_walker;
+        qint64 m_startTime = -1;
+    };
+
+private:
+    struct Event;
+    void addEvent(const Event &event);
+    qint64 currentTime() const;
+
+private:
+    struct Private;
+    Private * const m_d;
+
+    std::atomic<bool> m_enabled;
+};
+
+#endif /* __KIS_MERGE_TRACE_RECORDER_H */
@@ -0,0 +1,184 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisUpdateCostModel.h"
+
+#include <QMutexLocker>
+
+#include <config-tile-size.h>
+
+
+namespace {
+
+/**
+ * The defaults are rough values for a modern desktop CPU, they
+ * are used only until the first jobs are measured
+ */
+const qreal DEFAULT_OVERHEAD = 50000.0; // ns
+const qreal DEFAULT_PIXEL_COST = 1.0; // ns
+
+/**
+ * The weight of the older samples decays exponentially,
+ * so the model follows the changes of the workload
+ */
+const qreal HISTORY_SIZE = 256.0;
+const qreal DECAY = 1.0 - 1.0 / HISTORY_SIZE;
+
+const int MIN_SAMPLES = 16;
+
+inline qint64 tileIndex(qint64 value)
+{
+    return value >= 0 ? value / KRITA_TILE_SIZE : -((-value + KRITA_TILE_SIZE - 1) / KRITA_TILE_SIZE);
+}
+
+}
+
+KisUpdateCostModel::KisUpdateCostModel()
+{
+    reset();
+}
+
+void KisUpdateCostModel::reset()
+{
+    QMutexLocker l(&m_mutex);
+
+    m_overhead = DEFAULT_OVERHEAD;
+    m_pixelCost = DEFAULT_PIXEL_COST;
+
+    m_numSamples = 0;
+    m_sumW = 0;
+    m_sumX = 0;
+    m_sumY = 0;
+    m_sumXX = 0;
+    m_sumXY = 0;
+    m_sumNodes = 0;
+}
+
+qreal KisUpdateCostModel::workload(const QRect &rect, int numNodes)
+{
+    if (rect.isEmpty()) return 0;
+
+    const qint64 numColumns = tileIndex(rect.right()) - tileIndex(rect.left()) + 1;
+    const qint64 numRows = tileIndex(rect.bottom()) - tileIndex(rect.top()) + 1;
+
+    return qreal(numColumns * numRows) * KRITA_TILE_SIZE * KRITA_TILE_SIZE * qMax(1, numNodes);
+}
+
+qreal KisUpdateCostModel::estimate(const QRect &rect, int numNodes) const
+{
+    const qreal x = workload(rect, numNodes);
+
+    QMutexLocker l(&m_mutex);
+    return m_overhead + m_pixelCost * x;
+}
+
+bool KisUpdateCostModel::tryJoinRects(QRect &baseRect, const QRect &newRect, int numNodes) const
+{
+    const QRect unitedRect = baseRect | newRect;
+
+    const qreal baseX = workload(baseRect, numNodes);
+    const qreal newX = workload(newRect, numNodes);
+    const qreal unitedX = workload(unitedRect, numNodes);
+
+    qreal overhead;
+    qreal pixelCost;
+
+    {
+        QMutexLocker l(&m_mutex);
+        overhead = m_overhead;
+        pixelCost = m_pixelCost;
+    }
+
+    const qreal separateCost = 2 * overhead + pixelCost * (baseX + newX);
+    const qreal unitedCost = overhead + pixelCost * unitedX;
+
+    if (unitedCost <= separateCost) {
+        baseRect = unitedRect;
+        return true;
+    }
+
+    return false;
+}
+
+void KisUpdateCostModel::addSample(const QRect &rect, int numNodes, qint64 nsecs)
+{
+    const qreal x = workload(rect, numNodes);
+    const qreal y = nsecs;
+
+    if (x <= 0 || y <= 0) return;
+
+    QMutexLocker l(&m_mutex);
+
+    m_sumW = DECAY * m_sumW + 1.0;
+    m_sumX = DECAY * m_sumX + x;
+    m_sumY = DECAY * m_sumY + y;
+    m_sumXX = DECAY * m_sumXX + x * x;
+    m_sumXY = DECAY * m_sumXY + x * y;
+    m_sumNodes = DECAY * m_sumNodes + qMax(1, numNodes);
+
+    m_numSamples++;
+
+    if (m_numSamples >= MIN_SAMPLES) {
+        refit();
+    }
+}
+
+void KisUpdateCostModel::refit()
+{
+    const qreal denominator = m_sumW * m_sumXX - m_sumX * m_sumX;
+
+    /**
+     * All the samples have (almost) the same workload, so we cannot
+     * separate the overhead from the pixel cost. Keep the old values.
+     */
+    if (denominator <= 1e-6 * m_sumW * m_sumXX) return;
+
+    const qreal pixelCost = (m_sumW * m_sumXY - m_sumX * m_sumY) / denominator;
+    const qreal overhead = (m_sumY - pixelCost * m_sumX) / m_sumW;
+
+    // the noise may produce nonsense, just ignore it
+    if (pixelCost <= 0) return;
+
+    m_pixelCost = pixelCost;
+    m_overhead = qMax(0.0, overhead);
+}
+
+qreal KisUpdateCostModel::overhead() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_overhead;
+}
+
+qreal KisUpdateCostModel::pixelCost() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_pixelCost;
+}
+
+int KisUpdateCostModel::numSamples() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_numSamples;
+}
+
+qreal KisUpdateCostModel::meanNumNodes() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_sumW > 0 ? m_sumNodes / m_sumW : 0;
+}
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_UPDATE_COST_MODEL_H
+#define __KIS_UPDATE_COST_MODEL_H
+
+#include <QRect>
+#include <QMutex>
+
+#include "kritaimage_export.h"
+
+/**
+ * Estimates the time of a merge job to decide whether two update
+ * rects should be merged into a single walker or processed separately.
+ *
+ * The cost of a job is modelled as
+ *
+ *     cost = overhead + pixelCost * numNodes * tileAlignedArea(rect)
+ *
+ * where overhead is the cost of walking the graph and starting the job,
+ * and pixelCost is the cost of compositing one pixel of one node. The
+ * area is aligned to the tiles grid, since the job reads and writes the
+ * whole tiles anyway, which makes the rects touching the same tiles
+ * almost free to merge.
+ *
+ * Both coefficients are fitted online with a weighted least squares
+ * regression over the recently measured jobs, so the model adapts to
+ * the machine and to the image being edited. Until enough samples are
+ * collected, the default coefficients are used.
+ *
+ * The class is thread-safe.
+ */
+class KRITAIMAGE_EXPORT KisUpdateCostModel
+{
+public:
+    KisUpdateCostModel();
+
+    /**
+     * Estimated time of a merge job in nanoseconds
+     */
+    qreal estimate(const QRect &rect, int numNodes) const;
+
+    /**
+     * Report the measured time of a merge job
+     */
+    void addSample(const QRect &rect, int numNodes, qint64 nsecs);
+
+    /**
+     * \return true if the rects should be processed by a single job.
+     * On success \p baseRect is extended to include \p newRect.
+     */
+    bool tryJoinRects(QRect &baseRect, const QRect &newRect, int numNodes) const;
+
+    qreal overhead() const;
+    qreal pixelCost() const;
+
+    /**
+     * The number of the measured jobs and the (decayed) mean number
+     * of nodes in them, used for diagnostics only
+     */
+    int numSamples() const;
+    qreal meanNumNodes() const;
+
+    void reset();
+
+private:
+    static qreal workload(const QRect &rect, int numNodes);
+    void refit();
+
+private:
+    mutable QMutex m_mutex;
+
+    qreal m_overhead;
+    qreal m_pixelCost;
+
+    int m_numSamples;
+    qreal m_sumW;
+    qreal m_sumX;
+    qreal m_sumY;
+    qreal m_sumXX;
+    qreal m_sumXY;
+    qreal m_sumNodes;
+};
+
+#endif /* __KIS_UPDATE_COST_MODEL_H */
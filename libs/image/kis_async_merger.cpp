@@ -23,6 +23,8 @@
 #include <QBitArray>
 
 #include <KoChannelInfo.h>
+#include <KoColorSpace.h>
+#include <KoCompositeOp.h>
 #include <KoCompositeOpRegistry.h>
 
 #include "kis_node_visitor.h"
@@ -40,6 +42,10 @@
 #include "kis_clone_layer.h"
 #include "kis_processing_information.h"
 #include "kis_busy_progress_indicator.h"
+#include "kis_random_accessor_ng.h"
+#include "kis_image_config.h"
+#include "KisBelowSiblingsProjectionCache.h"
+#include "KisMergeTraceRecorder.h"
 
 
 #include "kis_merge_walker.h"
@@ -207,8 +213,16 @@ private:
 /*                     KisAsyncMerger                                */
 /*********************************************************************/
 
+KisAsyncMerger::KisAsyncMerger()
+{
+    KisImageConfig cfg(true);
+    m_useFusedComposition = cfg.fusedLayersComposition();
+    m_useBelowSiblingsCache = cfg.cacheBelowSiblingsProjection();
+}
+
 void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
     KisMergeWalker::LeafStack &leafStack = walker.leafStack();
+    KisMergeTraceRecorder::WalkerScope traceWalkerScope(walker);
 
     const bool useTempProjections = walker.needRectVaries();
 
@@ -229,6 +243,9 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
 
         QRect applyRect = item.m_applyRect;
 
+        KisMergeTraceRecorder::NodeScope traceScope("layer", currentLeaf->node(),
+                                                    applyRect, item.m_position);
+
         if (currentLeaf->isRoot()) {
             currentLeaf->projectionPlane()->recalculate(applyRect, walker.startNode());
             continue;
@@ -250,40 +267,57 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
 
         if (!m_currentProjection) {
             setupProjection(currentLeaf, applyRect, useTempProjections);
-        }
 
-        KisUpdateOriginalVisitor originalVisitor(applyRect,
-                                                 m_currentProjection,
-                                                 walker.cropRect());
+            if (m_useBelowSiblingsCache &&
+                tryReadBelowSiblingsCache(item, leafStack, walker)) {
 
-        if(item.m_position & KisMergeWalker::N_FILTHY) {
-            DEBUG_NODE_ACTION("Updating", "N_FILTHY", currentLeaf, applyRect);
-            if (currentLeaf->visible()) {
-                currentLeaf->accept(originalVisitor);
-                currentLeaf->projectionPlane()->recalculate(applyRect, walker.startNode());
+                item = leafStack.pop();
+                currentLeaf = item.m_leaf;
+                applyRect = item.m_applyRect;
             }
         }
-        else if(item.m_position & KisMergeWalker::N_ABOVE_FILTHY) {
-            DEBUG_NODE_ACTION("Updating", "N_ABOVE_FILTHY", currentLeaf, applyRect);
-            if(currentLeaf->dependsOnLowerNodes()) {
-                if (currentLeaf->visible()) {
-                    currentLeaf->accept(originalVisitor);
-                    currentLeaf->projectionPlane()->recalculate(applyRect, currentLeaf->node());
+
+        if (currentLeaf == m_belowSiblingsCacheSplitLeaf) {
+            writeBelowSiblingsCache();
+        }
+
+        prepareLeafProjection(item, walker);
+
+        if (canFuseComposition(item)) {
+            QVector<KisProjectionLeafSP> fusedLeaves;
+            fusedLeaves << currentLeaf;
+
+            while (!(item.m_position & KisMergeWalker::N_TOPMOST) &&
+                   !leafStack.isEmpty() &&
+                   leafStack.top().m_leaf != m_belowSiblingsCacheSplitLeaf &&
+                   leafStack.top().m_applyRect == applyRect &&
+                   canFuseComposition(leafStack.top())) {
+
+                item = leafStack.pop();
+                currentLeaf = item.m_leaf;
+
+                {
+                    /**
+                     * The composition of the whole run is accounted
+                     * to its first layer, the fused layers get only
+                     * the time of their own preparation
+                     */
+                    KisMergeTraceRecorder::NodeScope fusedTraceScope("layer", currentLeaf->node(),
+                                                                     applyRect, item.m_position);
+                    prepareLeafProjection(item, walker);
                 }
+                fusedLeaves << currentLeaf;
             }
-        }
-        else if(item.m_position & KisMergeWalker::N_FILTHY_PROJECTION) {
-            DEBUG_NODE_ACTION("Updating", "N_FILTHY_PROJECTION", currentLeaf, applyRect);
-            if (currentLeaf->visible()) {
-                currentLeaf->projectionPlane()->recalculate(applyRect, walker.startNode());
+
+            if (fusedLeaves.size() > 1) {
+                traceScope.setNumFusedNodes(fusedLeaves.size() - 1);
+                compositeFusedWithProjection(fusedLeaves, applyRect);
+            } else {
+                compositeWithProjection(currentLeaf, applyRect);
             }
+        } else {
+            compositeWithProjection(currentLeaf, applyRect);
         }
-        else /*if(item.m_position & KisMergeWalker::N_BELOW_FILTHY)*/ {
-            DEBUG_NODE_ACTION("Updating", "N_BELOW_FILTHY", currentLeaf, applyRect);
-            /* nothing to do */
-        }
-
-        compositeWithProjection(currentLeaf, applyRect);
 
         if(item.m_position & KisMergeWalker::N_TOPMOST) {
             writeProjection(currentLeaf, useTempProjections, applyRect);
@@ -312,6 +346,8 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
 void KisAsyncMerger::resetProjection() {
     m_currentProjection = 0;
     m_finalProjection = 0;
+
+    resetBelowSiblingsCacheRequest();
 }
 
 void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection) {
@@ -365,6 +401,270 @@ bool KisAsyncMerger::compositeWithProjection(KisProjectionLeafSP leaf, const QRe
     return true;
 }
 
+void KisAsyncMerger::prepareLeafProjection(const KisBaseRectsWalker::JobItem &item, KisBaseRectsWalker &walker) {
+    KisProjectionLeafSP leaf = item.m_leaf;
+
+    KisUpdateOriginalVisitor originalVisitor(item.m_applyRect,
+                                             m_currentProjection,
+                                             walker.cropRect());
+
+    if(item.m_position & KisMergeWalker::N_FILTHY) {
+        DEBUG_NODE_ACTION("Updating", "N_FILTHY", leaf, item.m_applyRect);
+        if (leaf->visible()) {
+            leaf->accept(originalVisitor);
+            leaf->projectionPlane()->recalculate(item.m_applyRect, walker.startNode());
+        }
+    }
+    else if(item.m_position & KisMergeWalker::N_ABOVE_FILTHY) {
+        DEBUG_NODE_ACTION("Updating", "N_ABOVE_FILTHY", leaf, item.m_applyRect);
+        if(leaf->dependsOnLowerNodes()) {
+            if (leaf->visible()) {
+                leaf->accept(originalVisitor);
+                leaf->projectionPlane()->recalculate(item.m_applyRect, leaf->node());
+            }
+        }
+    }
+    else if(item.m_position & KisMergeWalker::N_FILTHY_PROJECTION) {
+        DEBUG_NODE_ACTION("Updating", "N_FILTHY_PROJECTION", leaf, item.m_applyRect);
+        if (leaf->visible()) {
+            leaf->projectionPlane()->recalculate(item.m_applyRect, walker.startNode());
+        }
+    }
+    else /*if(item.m_position & KisMergeWalker::N_BELOW_FILTHY)*/ {
+        DEBUG_NODE_ACTION("Updating", "N_BELOW_FILTHY", leaf, item.m_applyRect);
+        /* nothing to do */
+    }
+}
+
+bool KisAsyncMerger::canFuseComposition(const KisBaseRectsWalker::JobItem &item) const {
+    if (!m_useFusedComposition || !m_currentProjection) return false;
+
+    KisProjectionLeafSP leaf = item.m_leaf;
+
+    /**
+     * The projection of the fused layers is prepared before any of
+     * them is composited, so they must not read the projection of
+     * the lower nodes
+     */
+    if ((item.m_position & KisMergeWalker::N_EXTRA) ||
+        leaf->dependsOnLowerNodes()) return false;
+
+    if (leaf->isRoot() || !leaf->visible()) return false;
+
+    KisPaintLayer *layer = dynamic_cast<KisPaintLayer*>(leaf->node().data());
+    if (!layer) return false;
+
+    // layer styles have their own projection plane
+    if (layer->projectionPlane() != layer->internalProjectionPlane()) return false;
+
+    if (layer->compositeOpId() != COMPOSITE_OVER ||
+        leaf->opacity() != OPACITY_OPAQUE_U8 ||
+        !leaf->channelFlags().isEmpty()) return false;
+
+    KisPaintDeviceSP device = layer->projection();
+    return device && *device->colorSpace() == *m_currentProjection->colorSpace();
+}
+
+void KisAsyncMerger::compositeFusedWithProjection(const QVector<KisProjectionLeafSP> &leaves, const QRect &rect) {
+    QVector<KisPaintDeviceSP> devices;
+    QVector<QRect> deviceRects;
+    QRect totalRect;
+
+    Q_FOREACH (KisProjectionLeafSP leaf, leaves) {
+        KisPaintDeviceSP device = leaf->node()->projection();
+        const QRect deviceRect = rect & device->extent();
+
+        if (!deviceRect.isEmpty()) {
+            devices << device;
+            deviceRects << deviceRect;
+            totalRect |= deviceRect;
+        }
+
+        DEBUG_NODE_ACTION("Compositing projection (fused)", "", leaf, rect);
+    }
+
+    if (devices.isEmpty()) return;
+
+    const KoColorSpace *colorSpace = m_currentProjection->colorSpace();
+    const KoCompositeOp *op = colorSpace->compositeOp(COMPOSITE_OVER);
+    const int pixelSize = m_currentProjection->pixelSize();
+
+    QVector<KisRandomConstAccessorSP> srcIts;
+    Q_FOREACH (KisPaintDeviceSP device, devices) {
+        srcIts << device->createRandomConstAccessorNG(totalRect.x(), totalRect.y());
+    }
+
+    KisRandomAccessorSP dstIt = m_currentProjection->createRandomAccessorNG(totalRect.x(), totalRect.y());
+
+    KoCompositeOp::ParameterInfo params;
+    params.opacity = 1.0f;
+    params.flow = 1.0f;
+    params.maskRowStart = 0;
+    params.maskRowStride = 0;
+
+    qint32 dstY = totalRect.y();
+    qint32 rowsRemaining = totalRect.height();
+
+    while (rowsRemaining > 0) {
+        const qint32 dstRows = qMin(dstIt->numContiguousRows(dstY), rowsRemaining);
+
+        qint32 dstX = totalRect.x();
+        qint32 columnsRemaining = totalRect.width();
+
+        while (columnsRemaining > 0) {
+            const qint32 dstColumns = qMin(dstIt->numContiguousColumns(dstX), columnsRemaining);
+            const QRect dstTileRect(dstX, dstY, dstColumns, dstRows);
+
+            const qint32 dstRowStride = dstIt->rowStride(dstX, dstY);
+            dstIt->moveTo(dstX, dstY);
+            quint8 *dstTileStart = dstIt->rawData();
+
+            /**
+             * All the layers are blended into the destination tile
+             * before moving to the next one. The source tiles may
+             * be not aligned with the destination ones, so the
+             * source rect is split into contiguous pieces.
+             */
+            for (int i = 0; i < devices.size(); i++) {
+                const QRect srcRect = dstTileRect & deviceRects[i];
+                if (srcRect.isEmpty()) continue;
+
+                KisRandomConstAccessorSP srcIt = srcIts[i];
+
+                qint32 srcY = srcRect.y();
+                qint32 srcRowsRemaining = srcRect.height();
+
+                while (srcRowsRemaining > 0) {
+                    const qint32 rows = qMin(srcIt->numContiguousRows(srcY), srcRowsRemaining);
+
+                    qint32 srcX = srcRect.x();
+                    qint32 srcColumnsRemaining = srcRect.width();
+
+                    while (srcColumnsRemaining > 0) {
+                        const qint32 columns = qMin(srcIt->numContiguousColumns(srcX), srcColumnsRemaining);
+
+                        const qint32 srcRowStride = srcIt->rowStride(srcX, srcY);
+                        srcIt->moveTo(srcX, srcY);
+
+                        params.dstRowStart = dstTileStart +
+                            (srcY - dstY) * dstRowStride +
+                            (srcX - dstX) * pixelSize;
+                        params.dstRowStride = dstRowStride;
+                        params.srcRowStart = srcIt->rawDataConst();
+                        params.srcRowStride = srcRowStride;
+                        params.rows = rows;
+                        params.cols = columns;
+
+                        op->composite(params);
+
+                        srcX += columns;
+                        srcColumnsRemaining -= columns;
+                    }
+
+                    srcY += rows;
+                    srcRowsRemaining -= rows;
+                }
+            }
+
+            dstX += dstColumns;
+            columnsRemaining -= dstColumns;
+        }
+
+        dstY += dstRows;
+        rowsRemaining -= dstRows;
+    }
+}
+
+bool KisAsyncMerger::tryReadBelowSiblingsCache(const KisBaseRectsWalker::JobItem &firstItem,
+                                               KisBaseRectsWalker::LeafStack &leafStack,
+                                               KisBaseRectsWalker &walker) {
+    /**
+     * The cache keeps the composition of the full-size image only. The
+     * walkers of the scaled planes (instant preview) do not change the
+     * layers on level 0, so they do not drop the cache either.
+     */
+    if (walker.levelOfDetail() > 0) return false;
+
+    KisProjectionLeafSP parentLeaf = firstItem.m_leaf->parent();
+    KisGroupLayerSP group = parentLeaf ? dynamic_cast<KisGroupLayer*>(parentLeaf->node().data()) : 0;
+    if (!group) return false;
+
+    KisBelowSiblingsProjectionCache *cache = group->belowSiblingsProjectionCache();
+
+    /**
+     * Find the layer being updated. All the layers below it are
+     * marked as N_BELOW_FILTHY and their composition doesn't change.
+     */
+    QVector<KisProjectionLeafSP> belowLeaves;
+    QRect belowRect = firstItem.m_applyRect;
+
+    KisBaseRectsWalker::JobItem splitItem = firstItem;
+    int nextIndex = leafStack.size() - 1;
+
+    while ((splitItem.m_position & KisMergeWalker::N_BELOW_FILTHY) && nextIndex >= 0) {
+        belowLeaves << splitItem.m_leaf;
+        belowRect &= splitItem.m_applyRect;
+        splitItem = leafStack[nextIndex--];
+    }
+
+    const bool canUseCache =
+        m_currentProjection &&
+        !belowLeaves.isEmpty() &&
+        !belowRect.isEmpty() &&
+        (firstItem.m_position & KisMergeWalker::N_BOTTOMMOST) &&
+        !(splitItem.m_position & (KisMergeWalker::N_BELOW_FILTHY | KisMergeWalker::N_EXTRA)) &&
+        splitItem.m_leaf->parent() == parentLeaf;
+
+    if (!canUseCache) {
+        /**
+         * The walker recomposes the group starting from its bottommost
+         * layer, so the lower layers might have changed
+         */
+        cache->reset();
+        return false;
+    }
+
+    if (cache->read(splitItem.m_leaf, belowLeaves, m_currentProjection, firstItem.m_applyRect)) {
+        DEBUG_NODE_ACTION("Reading below siblings cache", "", splitItem.m_leaf, firstItem.m_applyRect);
+
+        // the first item has already been taken by the caller
+        for (int i = 1; i < belowLeaves.size(); i++) {
+            leafStack.pop();
+        }
+
+        return true;
+    }
+
+    m_belowSiblingsCacheGroup = group;
+    m_belowSiblingsCacheSplitLeaf = splitItem.m_leaf;
+    m_belowSiblingsCacheLeaves = belowLeaves;
+    m_belowSiblingsCacheRect = belowRect;
+
+    return false;
+}
+
+void KisAsyncMerger::writeBelowSiblingsCache() {
+    KIS_SAFE_ASSERT_RECOVER(m_belowSiblingsCacheGroup && m_currentProjection) {
+        resetBelowSiblingsCacheRequest();
+        return;
+    }
+
+    m_belowSiblingsCacheGroup->belowSiblingsProjectionCache()->
+        write(m_belowSiblingsCacheSplitLeaf, m_belowSiblingsCacheLeaves,
+              m_currentProjection, m_belowSiblingsCacheRect);
+
+    DEBUG_NODE_ACTION("Writing below siblings cache", "", m_belowSiblingsCacheSplitLeaf, m_belowSiblingsCacheRect);
+
+    resetBelowSiblingsCacheRequest();
+}
+
+void KisAsyncMerger::resetBelowSiblingsCacheRequest() {
+    m_belowSiblingsCacheGroup = 0;
+    m_belowSiblingsCacheSplitLeaf.clear();
+    m_belowSiblingsCacheLeaves.clear();
+    m_belowSiblingsCacheRect = QRect();
+}
+
 void KisAsyncMerger::doNotifyClones(KisBaseRectsWalker &walker) {
     KisBaseRectsWalker::CloneNotificationsVector &vector =
         walker.cloneNotifications();
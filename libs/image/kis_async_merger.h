@@ -19,15 +19,20 @@
 #ifndef __KIS_ASYNC_MERGER_H
 #define __KIS_ASYNC_MERGER_H
 
+#include <QVector>
+#include <QRect>
+
 #include "kritaimage_export.h"
 #include "kis_types.h"
+#include "kis_base_rects_walker.h"
 
 class QRect;
-class KisBaseRectsWalker;
 
 class KRITAIMAGE_EXPORT KisAsyncMerger
 {
 public:
+    KisAsyncMerger();
+
     void startMerge(KisBaseRectsWalker &walker, bool notifyClones = true);
 
 private:
@@ -35,8 +40,35 @@ private:
     inline void setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection);
     inline void writeProjection(KisProjectionLeafSP topmostLeaf, bool useTempProjection, const QRect &rect);
     inline bool compositeWithProjection(KisProjectionLeafSP leaf, const QRect &rect);
+    inline void prepareLeafProjection(const KisBaseRectsWalker::JobItem &item, KisBaseRectsWalker &walker);
     inline void doNotifyClones(KisBaseRectsWalker &walker);
 
+    /**
+     * Fused composition of the layers: a run of consecutive plain
+     * paint layers with Normal blending mode, full opacity and the
+     * same color space as the projection is composited in a single
+     * pass over the tiles of the projection. Every destination tile
+     * is fetched once and all the layers are blended into it while
+     * it is still in the cache.
+     */
+    inline bool canFuseComposition(const KisBaseRectsWalker::JobItem &item) const;
+    void compositeFusedWithProjection(const QVector<KisProjectionLeafSP> &leaves, const QRect &rect);
+
+    /**
+     * Cached composition of the layers below the updated one, see
+     * KisBelowSiblingsProjectionCache. Called when the walker starts
+     * merging the children of a new group. If the cache has the
+     * composition of the lower layers, it is copied into the projection,
+     * the lower layers are removed from the stack and true is returned.
+     * Otherwise the composition is written into the cache when the
+     * merger reaches the updated layer.
+     */
+    bool tryReadBelowSiblingsCache(const KisBaseRectsWalker::JobItem &firstItem,
+                                   KisBaseRectsWalker::LeafStack &leafStack,
+                                   KisBaseRectsWalker &walker);
+    inline void writeBelowSiblingsCache();
+    inline void resetBelowSiblingsCacheRequest();
+
 private:
     /**
      * The place where intermediate results of layer's merge
@@ -62,6 +94,19 @@ private:
      * setupProjection()
      */
     KisPaintDeviceSP m_cachedPaintDevice;
+
+    bool m_useFusedComposition;
+
+    bool m_useBelowSiblingsCache;
+
+    /**
+     * The pending write into the below siblings cache of the
+     * group being merged at the moment
+     */
+    KisGroupLayerSP m_belowSiblingsCacheGroup;
+    KisProjectionLeafSP m_belowSiblingsCacheSplitLeaf;
+    QVector<KisProjectionLeafSP> m_belowSiblingsCacheLeaves;
+    QRect m_belowSiblingsCacheRect;
 };
 
 
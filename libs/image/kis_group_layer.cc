@@ -37,6 +37,7 @@
 #include "kis_selection_mask.h"
 #include "kis_psd_layer_style.h"
 #include "kis_layer_properties_icons.h"
+#include "KisBelowSiblingsProjectionCache.h"
 
 
 struct Q_DECL_HIDDEN KisGroupLayer::Private
@@ -54,6 +55,8 @@ public:
     qint32 x;
     qint32 y;
     bool passThroughMode;
+
+    KisBelowSiblingsProjectionCache belowSiblingsCache;
 };
 
 KisGroupLayer::KisGroupLayer(KisImageWSP image, const QString &name, quint8 opacity) :
@@ -201,6 +204,8 @@ void KisGroupLayer::resetCache(const KoColorSpace *colorSpace)
 
         m_d->paintDevice->clear();
     }
+
+    m_d->belowSiblingsCache.reset();
 }
 
 KisLayer* KisGroupLayer::onlyMeaningfulChild() const
@@ -275,9 +280,15 @@ bool KisGroupLayer::projectionIsValid() const
     return !tryObligeChild();
 }
 
+KisBelowSiblingsProjectionCache* KisGroupLayer::belowSiblingsProjectionCache() const
+{
+    return &m_d->belowSiblingsCache;
+}
+
 void KisGroupLayer::setDefaultProjectionColor(KoColor color)
 {
     m_d->paintDevice->setDefaultPixel(color);
+    m_d->belowSiblingsCache.reset();
 }
 
 KoColor KisGroupLayer::defaultProjectionColor() const
@@ -23,6 +23,7 @@
 #include "kis_types.h"
 
 class KoColorSpace;
+class KisBelowSiblingsProjectionCache;
 
 /**
  * A KisLayer that bundles child layers into a single layer.
@@ -107,6 +108,13 @@ public:
 
     bool projectionIsValid() const;
 
+    /**
+     * The composition of the children lying below the child being
+     * updated, used by KisAsyncMerger when
+     * KisImageConfig::cacheBelowSiblingsProjection() is enabled
+     */
+    KisBelowSiblingsProjectionCache* belowSiblingsProjectionCache() const;
+
 protected:
     KisLayer* onlyMeaningfulChild() const;
     KisPaintDeviceSP tryObligeChild() const;
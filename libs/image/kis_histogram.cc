@@ -20,6 +20,9 @@
 #include "kis_histogram.h"
 
 #include <QVector>
+#include <QSharedPointer>
+#include <QThread>
+#include <QtConcurrent>
 
 #include "kis_image.h"
 #include "kis_paint_layer.h"
@@ -27,6 +30,64 @@
 #include "KoColorSpace.h"
 #include "kis_debug.h"
 #include "kis_iterator_ng.h"
+#include "krita_utils.h"
+
+namespace {
+
+void addRectToProducer(KisPaintDeviceSP device, const QRect &rc, KoHistogramProducer *producer)
+{
+    KisSequentialConstIterator srcIt(device, rc);
+    const KoColorSpace* cs = device->colorSpace();
+
+    // XXX: the original code depended on their being a selection mask in the iterator
+    //      if the paint device had a selection. When we changed that to passing an
+    //      explicit selection to the createRectIterator call, that broke because
+    //      paint devices didn't know about their selections anymore.
+    //      updateHistogram should get a selection parameter.
+    int numConseqPixels = srcIt.nConseqPixels();
+    while (srcIt.nextPixels(numConseqPixels)) {
+
+        numConseqPixels = srcIt.nConseqPixels();
+        producer->addRegionToBin(srcIt.oldRawData(), 0, numConseqPixels, cs);
+    }
+}
+
+/**
+ * Every job accumulates the patches into its own copy of the producer,
+ * the patches are taken from the shared counter, so the jobs finish at
+ * roughly the same time even when some patches are empty
+ */
+struct AccumulationJob {
+    AccumulationJob() {}
+    AccumulationJob(KisPaintDeviceSP _device, const QVector<QRect> *_patches,
+                    QAtomicInt *_nextPatch, KoHistogramProducer *_producer)
+        : device(_device),
+          patches(_patches),
+          nextPatch(_nextPatch),
+          producer(_producer)
+    {
+    }
+
+    void run() {
+        int i;
+        while ((i = nextPatch->fetchAndAddOrdered(1)) < patches->size()) {
+            addRectToProducer(device, patches->at(i), producer.data());
+        }
+    }
+
+    KisPaintDeviceSP device;
+    const QVector<QRect> *patches = 0;
+    QAtomicInt *nextPatch = 0;
+    QSharedPointer<KoHistogramProducer> producer;
+};
+
+struct AccumulationJobWrapper {
+    inline void operator() (AccumulationJob &job) {
+        job.run();
+    }
+};
+
+}
 
 KisHistogram::KisHistogram(const KisPaintLayerSP layer,
                            KoHistogramProducer *producer,
@@ -85,23 +146,37 @@ void KisHistogram::updateHistogram()
         return;
     }
 
-    KisSequentialConstIterator srcIt(m_paintDevice, m_bounds);
-    const KoColorSpace* cs = m_paintDevice->colorSpace();
-
     // Let the producer do it's work
     m_producer->clear();
 
+    const QVector<QRect> patches =
+        KritaUtils::splitRectIntoPatches(m_bounds, KritaUtils::optimalPatchSize());
+    const int numJobs = qMin(patches.size(), QThread::idealThreadCount());
+
+    QVector<AccumulationJob> jobs;
+    QAtomicInt nextPatch(0);
+
+    if (numJobs > 1) {
+        for (int i = 0; i < numJobs; i++) {
+            KoHistogramProducer *producer = m_producer->createEmptyCopy();
+            if (!producer) {
+                // the producer doesn't support parallel accumulation
+                jobs.clear();
+                break;
+            }
+            jobs << AccumulationJob(m_paintDevice, &patches, &nextPatch, producer);
+        }
+    }
 
-    // XXX: the original code depended on their being a selection mask in the iterator
-    //      if the paint device had a selection. When we changed that to passing an
-    //      explicit selection to the createRectIterator call, that broke because
-    //      paint devices didn't know about their selections anymore.
-    //      updateHistogram should get a selection parameter.
-    int numConseqPixels = srcIt.nConseqPixels();
-    while (srcIt.nextPixels(numConseqPixels)) {
+    if (!jobs.isEmpty()) {
+        AccumulationJobWrapper wrapper;
+        QtConcurrent::blockingMap(jobs, wrapper);
 
-        numConseqPixels = srcIt.nConseqPixels();
-        m_producer->addRegionToBin(srcIt.oldRawData(), 0, numConseqPixels, cs);
+        Q_FOREACH (const AccumulationJob &job, jobs) {
+            m_producer->addBinsFrom(job.producer.data());
+        }
+    } else {
+        addRectToProducer(m_paintDevice, m_bounds, m_producer);
     }
 
     computeHistogram();
@@ -233,6 +233,8 @@ public:
 
     bool blockLevelOfDetail = false;
 
+    QHash<const QObject*, QRect> viewportRects;
+
     QPointF axesCenter;
 
     bool tryCancelCurrentStrokeAsync();
@@ -264,6 +266,8 @@ KisImage::~KisImage()
      */
     waitForDone();
 
+    KisUpdateTimeMonitor::instance()->reportViewportRects(this, QVector<QRect>());
+
     delete m_d;
     disconnect(); // in case Qt gets confused
 }
@@ -1645,10 +1649,10 @@ QVector<QRect> KisImage::enableUIUpdates()
 
 void KisImage::notifyProjectionUpdated(const QRect &rc)
 {
-    KisUpdateTimeMonitor::instance()->reportUpdateFinished(rc);
+    const int lod = currentLevelOfDetail();
+    KisUpdateTimeMonitor::instance()->reportUpdateFinished(rc, lod, this);
 
     if (!m_d->disableUIUpdateSignals) {
-        int lod = currentLevelOfDetail();
         QRect dirtyRect = !lod ? rc : KisLodTransform::upscaledRect(rc, lod);
 
         if (dirtyRect.isEmpty()) return;
@@ -1696,6 +1700,7 @@ void KisImage::requestProjectionUpdateImpl(KisNode *node,
 {
     if (rects.isEmpty()) return;
 
+    KisUpdateTimeMonitor::instance()->reportUpdateRequested(this, rects, currentLevelOfDetail());
     m_d->scheduler.updateProjection(node, rects, cropRect);
 }
 
@@ -1834,6 +1839,20 @@ void KisImage::setDesiredLevelOfDetail(int lod)
     m_d->scheduler.setDesiredLevelOfDetail(lod);
 }
 
+void KisImage::setViewportRect(const QObject *view, const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        m_d->viewportRects.remove(view);
+    } else {
+        m_d->viewportRects.insert(view, rect);
+    }
+
+    const QVector<QRect> rects = m_d->viewportRects.values().toVector();
+
+    m_d->scheduler.setPriorityRects(rects);
+    KisUpdateTimeMonitor::instance()->reportViewportRects(this, rects);
+}
+
 int KisImage::currentLevelOfDetail() const
 {
     if (m_d->blockLevelOfDetail) {
@@ -663,6 +663,14 @@ public:
      */
     void setDesiredLevelOfDetail(int lod);
 
+    /**
+     * Notify KisImage which part of it is currently visible in
+     * \p view. The updates of the visible parts of the image are
+     * processed before all the other ones. Pass an empty rect
+     * when the view is closed.
+     */
+    void setViewportRect(const QObject *view, const QRect &rect);
+
     /**
      * Relative position of the mirror axis center
      *     0,0 - topleft corner of the image
@@ -173,6 +173,72 @@ void KisImageConfig::setSwapWindowSize(int value)
     m_config.writeEntry("swapWindowSize", value);
 }
 
+QString KisImageConfig::swapCompression(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("swapCompression", "LZF") : "LZF";
+}
+
+void KisImageConfig::setSwapCompression(const QString &value)
+{
+    m_config.writeEntry("swapCompression", value);
+}
+
+int KisImageConfig::swapCompressionLevel(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("swapCompressionLevel", 3) : 3;
+}
+
+void KisImageConfig::setSwapCompressionLevel(int value)
+{
+    m_config.writeEntry("swapCompressionLevel", value);
+}
+
+bool KisImageConfig::fastSwap(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("fastSwap", false) : false;
+}
+
+void KisImageConfig::setFastSwap(bool value)
+{
+    m_config.writeEntry("fastSwap", value);
+}
+
+bool KisImageConfig::numaAwareTileAllocation(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("numaAwareTileAllocation", false) : false;
+}
+
+void KisImageConfig::setNumaAwareTileAllocation(bool value)
+{
+    m_config.writeEntry("numaAwareTileAllocation", value);
+}
+
+bool KisImageConfig::deltaHistoryCompression(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("deltaHistoryCompression", true) : true;
+}
+
+void KisImageConfig::setDeltaHistoryCompression(bool value)
+{
+    m_config.writeEntry("deltaHistoryCompression", value);
+}
+
+int KisImageConfig::historySwapDepth(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("historySwapDepth", 20) : 20;
+}
+
+void KisImageConfig::setHistorySwapDepth(int value)
+{
+    m_config.writeEntry("historySwapDepth", value);
+}
+
 int KisImageConfig::tilesHardLimit() const
 {
     qreal hp = qreal(memoryHardLimitPercent()) / 100.0;
@@ -493,6 +559,50 @@ void KisImageConfig::setUseLodForColorizeMask(bool value)
     m_config.writeEntry("useLodForColorizeMask", value);
 }
 
+bool KisImageConfig::fusedLayersComposition(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("fusedLayersComposition", true) : true;
+}
+
+void KisImageConfig::setFusedLayersComposition(bool value)
+{
+    m_config.writeEntry("fusedLayersComposition", value);
+}
+
+int KisImageConfig::updaterLocalQueueSize(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("updaterLocalQueueSize", 1) : 1;
+}
+
+void KisImageConfig::setUpdaterLocalQueueSize(int value)
+{
+    m_config.writeEntry("updaterLocalQueueSize", value);
+}
+
+bool KisImageConfig::adaptiveUpdatesCoalescing(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("adaptiveUpdatesCoalescing", true) : true;
+}
+
+void KisImageConfig::setAdaptiveUpdatesCoalescing(bool value)
+{
+    m_config.writeEntry("adaptiveUpdatesCoalescing", value);
+}
+
+bool KisImageConfig::cacheBelowSiblingsProjection(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("cacheBelowSiblingsProjection", false) : false;
+}
+
+void KisImageConfig::setCacheBelowSiblingsProjection(bool value)
+{
+    m_config.writeEntry("cacheBelowSiblingsProjection", value);
+}
+
 int KisImageConfig::maxNumberOfThreads(bool defaultValue) const
 {
     return (defaultValue ? QThread::idealThreadCount() : m_config.readEntry("maxNumberOfThreads", QThread::idealThreadCount()));
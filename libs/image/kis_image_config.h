@@ -58,6 +58,43 @@ public:
     int swapWindowSize() const;
     void setSwapWindowSize(int value);
 
+    /**
+     * The codec used for compressing tiles in the swap file:
+     * "LZF", "LZ4" or "ZSTD". Unsupported codecs fall back to LZF.
+     */
+    QString swapCompression(bool requestDefault = false) const;
+    void setSwapCompression(const QString &value);
+
+    int swapCompressionLevel(bool requestDefault = false) const; // used by ZSTD only
+    void setSwapCompressionLevel(int value);
+
+    /**
+     * "Fast swap" mode: tiles are written to the swap file
+     * uncompressed and are mapped back into memory directly
+     * instead of being read and decompressed
+     */
+    bool fastSwap(bool requestDefault = false) const;
+    void setFastSwap(bool value);
+
+    bool numaAwareTileAllocation(bool requestDefault = false) const;
+    void setNumaAwareTileAllocation(bool value);
+
+    /**
+     * Store the undo history of the tiles as compressed differences
+     * against their newer versions instead of full copies
+     */
+    bool deltaHistoryCompression(bool requestDefault = false) const;
+    void setDeltaHistoryCompression(bool value);
+
+    /**
+     * The number of the most recent revisions of the undo history,
+     * whose tiles are kept in memory until the memory usage reaches
+     * the soft limit. The tiles of older revisions are swapped out
+     * in background much earlier.
+     */
+    int historySwapDepth(bool requestDefault = false) const;
+    void setHistorySwapDepth(int value);
+
     int tilesHardLimit() const; // MiB
     int tilesSoftLimit() const; // MiB
     int poolLimit() const; // MiB
@@ -111,6 +148,27 @@ public:
     bool useLodForColorizeMask(bool requestDefault = false) const;
     void setUseLodForColorizeMask(bool value);
 
+    /**
+     * Composite runs of plain paint layers with Normal blending mode
+     * into their parent's projection in a single pass per tile,
+     * see KisAsyncMerger
+     */
+    bool fusedLayersComposition(bool requestDefault = false) const;
+    void setFusedLayersComposition(bool value);
+
+    int updaterLocalQueueSize(bool requestDefault = false) const;
+    void setUpdaterLocalQueueSize(int value);
+
+    bool adaptiveUpdatesCoalescing(bool requestDefault = false) const;
+    void setAdaptiveUpdatesCoalescing(bool value);
+
+    /**
+     * Keep the composition of the layers below the one being painted
+     * in every group, see KisBelowSiblingsProjectionCache
+     */
+    bool cacheBelowSiblingsProjection(bool requestDefault = false) const;
+    void setCacheBelowSiblingsProjection(bool value);
+
     int maxNumberOfThreads(bool defaultValue = false) const;
     void setMaxNumberOfThreads(int value);
 
@@ -60,6 +60,7 @@
 #include "kis_layer_utils.h"
 #include "kis_projection_leaf.h"
 #include "KisRecycleProjectionsJob.h"
+#include "KisMergeTraceRecorder.h"
 
 
 class KisSafeProjection {
@@ -794,6 +795,8 @@ QRect KisLayer::applyMasks(const KisPaintDeviceSP source,
                     applyRects.isEmpty() ? needRect : applyRects.top();
 
                 PositionToFilthy maskPosition = calculatePositionToFilthy(mask, filthyNode, const_cast<KisLayer*>(this));
+
+                KisMergeTraceRecorder::NodeScope traceScope("mask", mask, maskApplyRect, maskPosition);
                 mask->apply(destination, maskApplyRect, maskNeedRect, maskPosition);
             }
             Q_ASSERT(applyRects.isEmpty());
@@ -813,7 +816,11 @@ QRect KisLayer::applyMasks(const KisPaintDeviceSP source,
 
             Q_FOREACH (const KisEffectMaskSP& mask, masks) {
                 PositionToFilthy maskPosition = calculatePositionToFilthy(mask, filthyNode, const_cast<KisLayer*>(this));
-                mask->apply(tempDevice, maskApplyRect, maskNeedRect, maskPosition);
+
+                {
+                    KisMergeTraceRecorder::NodeScope traceScope("mask", mask, maskApplyRect, maskPosition);
+                    mask->apply(tempDevice, maskApplyRect, maskNeedRect, maskPosition);
+                }
 
                 if (!applyRects.isEmpty()) {
                     maskNeedRect = maskApplyRect;
@@ -26,6 +26,14 @@
 #include "kis_signal_compressor.h"
 
 #include "tiles3/kis_tile_data_store.h"
+#include "tiles3/KisTileDataArena.h"
+
+#if defined Q_OS_LINUX
+#include <unistd.h>
+#include <QFile>
+#elif defined Q_OS_MACOS
+#include <mach/mach.h>
+#endif
 
 Q_GLOBAL_STATIC(KisMemoryStatisticsServer, s_instance)
 
@@ -67,7 +75,9 @@ inline void addDevice(KisPaintDeviceSP dev,
                       qint64 &memBound,
                       qint64 &layersSize,
                       qint64 &projectionsSize,
-                      qint64 &lodSize)
+                      qint64 &lodSize,
+                      qint64 &historySize,
+                      int &numRevisions)
 {
     if (dev && !devices.contains(dev.data())) {
         devices.insert(dev.data());
@@ -88,6 +98,13 @@ inline void addDevice(KisPaintDeviceSP dev,
         }
 
         lodSize += lodData;
+
+        qint64 historyData = 0;
+        int deviceRevisions = 0;
+
+        dev->estimateHistoryMemoryStats(historyData, deviceRevisions);
+        historySize += historyData;
+        numRevisions += deviceRevisions;
     }
 }
 
@@ -95,7 +112,9 @@ qint64 calculateNodeMemoryHiBoundStep(KisNodeSP node,
                                       QSet<KisPaintDevice*> &devices,
                                       qint64 &layersSize,
                                       qint64 &projectionsSize,
-                                      qint64 &lodSize)
+                                      qint64 &lodSize,
+                                      qint64 &historySize,
+                                      int &numRevisions)
 {
     qint64 memBound = 0;
 
@@ -104,14 +123,15 @@ qint64 calculateNodeMemoryHiBoundStep(KisNodeSP node,
             node->inherits("KisAdjustmentLayer");
 
 
-    addDevice(node->paintDevice(), false, devices, memBound, layersSize, projectionsSize, lodSize);
-    addDevice(node->original(), originalIsProjection, devices, memBound, layersSize, projectionsSize, lodSize);
-    addDevice(node->projection(), true, devices, memBound, layersSize, projectionsSize, lodSize);
+    addDevice(node->paintDevice(), false, devices, memBound, layersSize, projectionsSize, lodSize, historySize, numRevisions);
+    addDevice(node->original(), originalIsProjection, devices, memBound, layersSize, projectionsSize, lodSize, historySize, numRevisions);
+    addDevice(node->projection(), true, devices, memBound, layersSize, projectionsSize, lodSize, historySize, numRevisions);
 
     node = node->firstChild();
     while (node) {
         memBound += calculateNodeMemoryHiBoundStep(node, devices,
-                                                   layersSize, projectionsSize, lodSize);
+                                                   layersSize, projectionsSize, lodSize,
+                                                   historySize, numRevisions);
         node = node->nextSibling();
     }
 
@@ -121,21 +141,52 @@ qint64 calculateNodeMemoryHiBoundStep(KisNodeSP node,
 qint64 calculateNodeMemoryHiBound(KisNodeSP node,
                                   qint64 &layersSize,
                                   qint64 &projectionsSize,
-                                  qint64 &lodSize)
+                                  qint64 &lodSize,
+                                  qint64 &historySize,
+                                  int &numRevisions)
 {
     layersSize = 0;
     projectionsSize = 0;
     lodSize = 0;
+    historySize = 0;
+    numRevisions = 0;
 
     QSet<KisPaintDevice*> devices;
     return calculateNodeMemoryHiBoundStep(node,
                                           devices,
                                           layersSize,
                                           projectionsSize,
-                                          lodSize);
+                                          lodSize,
+                                          historySize,
+                                          numRevisions);
 }
 
 
+qint64 residentSetSize()
+{
+    qint64 size = 0;
+
+#if defined Q_OS_LINUX
+    QFile file("/proc/self/statm");
+    if (file.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = file.readAll().split(' ');
+        if (fields.size() > 1) {
+            size = fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+        }
+    }
+#elif defined Q_OS_MACOS
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  (task_info_t)&info, &count) == KERN_SUCCESS) {
+        size = info.resident_size;
+    }
+#endif
+
+    return size;
+}
+
 KisMemoryStatisticsServer::Statistics
 KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
 {
@@ -148,7 +199,9 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
             calculateNodeMemoryHiBound(image->root(),
                                        stats.layersSize,
                                        stats.projectionsSize,
-                                       stats.lodSize);
+                                       stats.lodSize,
+                                       stats.historySize,
+                                       stats.numHistoryRevisions);
     }
     stats.totalMemorySize = tileStats.totalMemorySize;
     stats.realMemorySize = tileStats.realMemorySize;
@@ -156,6 +209,17 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
     stats.poolSize = tileStats.poolSize;
 
     stats.swapSize = tileStats.swapSize;
+    stats.historicalDeltaSize = tileStats.historicalDeltaSize;
+
+    KisTileDataArena::Statistics arenaStats =
+        KisTileDataArena::instance()->statistics();
+
+    stats.tilesArenaSize = arenaStats.allocatedSize;
+    stats.tilesArenaUsedSize = arenaStats.usedSize;
+    stats.tilesArenaFragmentation = arenaStats.fragmentation();
+    stats.tileAllocationLatency = arenaStats.averageAllocationLatency;
+
+    stats.residentSetSize = ::residentSetSize();
 
     KisImageConfig cfg(true);
 
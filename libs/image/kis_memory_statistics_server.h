@@ -38,6 +38,8 @@ public:
               layersSize(0),
               projectionsSize(0),
               lodSize(0),
+              historySize(0),
+              numHistoryRevisions(0),
 
               totalMemorySize(0),
               realMemorySize(0),
@@ -45,6 +47,13 @@ public:
               poolSize(0),
 
               swapSize(0),
+              historicalDeltaSize(0),
+
+              tilesArenaSize(0),
+              tilesArenaUsedSize(0),
+              tilesArenaFragmentation(0.0),
+              tileAllocationLatency(0),
+              residentSetSize(0),
 
               totalMemoryLimit(0),
               tilesHardLimit(0),
@@ -58,6 +67,14 @@ public:
         qint64 projectionsSize;
         qint64 lodSize;
 
+        /// the undo history of the image's devices, estimated on commit
+        qint64 historySize;
+        int numHistoryRevisions;
+
+        qint64 averageRevisionSize() const {
+            return numHistoryRevisions ? historySize / numHistoryRevisions : 0;
+        }
+
         qint64 totalMemorySize;
         qint64 realMemorySize;
         qint64 historicalMemorySize;
@@ -65,6 +82,15 @@ public:
 
         qint64 swapSize;
 
+        /// all the history tiles stored as deltas, in compressed form
+        qint64 historicalDeltaSize;
+
+        qint64 tilesArenaSize;
+        qint64 tilesArenaUsedSize;
+        qreal tilesArenaFragmentation;
+        qint64 tileAllocationLatency; // in nanoseconds
+        qint64 residentSetSize;
+
         qint64 totalMemoryLimit;
         qint64 tilesHardLimit;
         qint64 tilesSoftLimit;
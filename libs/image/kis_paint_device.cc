@@ -446,6 +446,21 @@ public:
         }
     }
 
+    void estimateHistoryMemoryStats(qint64 &historyData, int &numRevisions) const {
+        historyData = 0;
+        numRevisions = 0;
+
+        if (m_data) {
+            historyData += m_data->dataManager()->historyMemorySize();
+            numRevisions += m_data->dataManager()->numHistoryRevisions();
+        }
+
+        Q_FOREACH (DataSP value, m_frames.values()) {
+            historyData += value->dataManager()->historyMemorySize();
+            numRevisions += value->dataManager()->numHistoryRevisions();
+        }
+    }
+
 
 private:
 
@@ -1135,6 +1150,11 @@ void KisPaintDevice::estimateMemoryStats(qint64 &imageData, qint64 &temporaryDat
     m_d->estimateMemoryStats(imageData, temporaryData, lodData);
 }
 
+void KisPaintDevice::estimateHistoryMemoryStats(qint64 &historyData, int &numRevisions) const
+{
+    m_d->estimateHistoryMemoryStats(historyData, numRevisions);
+}
+
 void KisPaintDevice::setParentNode(KisNodeWSP parent)
 {
     m_d->parent = parent;
@@ -1373,6 +1393,33 @@ QRect calculateExactBoundsImpl(const KisPaintDevice *device, const QRect &startR
                  boundBottom - boundTop + 1);
 }
 
+template <class ComparePixelOp>
+QRect calculateCachedExactBounds(const KisPaintDevice *device, KisDataManager *dataManager, const QPoint &offset,
+                                 KisTile::ContentType type, const QRect &startRect, const QRect &endRect,
+                                 ComparePixelOp compareOp)
+{
+    /**
+     * The bounds are collected from the content rects cached
+     * in the tiles, so only the tiles written to since the
+     * previous call are actually scanned. The data manager
+     * works in its own coordinates, so the result should be
+     * translated into the coordinates of the device.
+     */
+    const QRect dataBounds =
+        dataManager->calculateExactBounds(type, compareOp).translated(offset);
+
+    /**
+     * The strategy may show only a part of the data, e.g. in the
+     * wrap-around mode. The cached rects cannot be clipped
+     * precisely, so fall back to scanning the pixels then.
+     */
+    if (!dataBounds.isEmpty() && !startRect.contains(dataBounds)) {
+        return calculateExactBoundsImpl(device, startRect, endRect, compareOp);
+    }
+
+    return endRect | dataBounds;
+}
+
 }
 
 QRect KisPaintDevice::calculateExactBounds(bool nonDefaultOnly) const
@@ -1384,8 +1431,9 @@ QRect KisPaintDevice::calculateExactBounds(bool nonDefaultOnly) const
     if (defaultOpacity != OPACITY_TRANSPARENT_U8) {
         if (!nonDefaultOnly) {
             /**
-             * We will calculate exact bounds only outside of the
-             * image bounds, and that'll be nondefault area only.
+             * The whole image bounds are filled with the default
+             * pixel, so only the nondefault area outside of them
+             * can extend the bounds.
              */
 
             endRect = defaultBounds()->bounds();
@@ -1399,10 +1447,12 @@ QRect KisPaintDevice::calculateExactBounds(bool nonDefaultOnly) const
     if (nonDefaultOnly) {
         const KoColor defaultPixel = this->defaultPixel();
         Impl::CheckNonDefault compareOp(pixelSize(), defaultPixel.data());
-        endRect = Impl::calculateExactBoundsImpl(this, startRect, endRect, compareOp);
+        endRect = Impl::calculateCachedExactBounds(this, m_d->dataManager().data(), QPoint(m_d->x(), m_d->y()),
+                                                   KisTile::NonDefaultContent, startRect, endRect, compareOp);
     } else {
         Impl::CheckFullyTransparent compareOp(m_d->colorSpace());
-        endRect = Impl::calculateExactBoundsImpl(this, startRect, endRect, compareOp);
+        endRect = Impl::calculateCachedExactBounds(this, m_d->dataManager().data(), QPoint(m_d->x(), m_d->y()),
+                                                   KisTile::NonTransparentContent, startRect, endRect, compareOp);
     }
 
     return endRect;
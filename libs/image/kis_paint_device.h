@@ -203,10 +203,11 @@ public:
     void extent(qint32 &x, qint32 &y, qint32 &w, qint32 &h) const;
 
     /**
-     * Get the exact bounds of this paint device. The real solution is
-     * very slow because it does a linear scanline search, but it
-     * uses caching, so calling to this function without changing
-     * the device is quite cheap.
+     * Get the exact bounds of this paint device. The bounds of every
+     * tile are cached in the tile itself and recalculated only after
+     * the tile has been written to, and the result is cached in the
+     * device, so calling to this function without changing the
+     * device is quite cheap.
      *
      * Exactbounds follows these rules:
      *
@@ -781,6 +782,14 @@ public:
 
     void estimateMemoryStats(qint64 &imageData, qint64 &temporaryData, qint64 &lodData) const;
 
+    /**
+     * Returns the memory occupied by the undo history of the device
+     * and the number of revisions in it
+     *
+     * \see KisMementoManager::historyMemorySize()
+     */
+    void estimateHistoryMemoryStats(qint64 &historyData, int &numRevisions) const;
+
 public:
 
     KisHLineIteratorSP createHLineIteratorNG(qint32 x, qint32 y, qint32 w);
@@ -832,9 +841,9 @@ public:
 
     /**
      * Caclculates exact bounds of the device. Used internally
-     * by a transparent caching system. The solution is very slow
-     * because it does a linear scanline search. So the complexity
-     * is n*n at worst.
+     * by a transparent caching system. Only the tiles that have
+     * changed since the previous call are scanned, the bounds
+     * of the other tiles are taken from the cache.
      *
      * \see exactBounds(), nonDefaultPixelArea()
      */
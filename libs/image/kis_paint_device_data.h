@@ -176,7 +176,7 @@ public:
 
                 m_colorSpace->convertPixelsTo(srcData, dstData,
                                               dstColorSpace,
-                                              nConseqPixels,
+                                              QRect(srcIt.x(), srcIt.y(), nConseqPixels, 1),
                                               renderingIntent, conversionFlags);
             }
         }
@@ -604,6 +604,15 @@ void KisPainter::bitBltWithFixedSelection(qint32 dstX, qint32 dstY,
     bitBltWithFixedSelection(dstX, dstY, srcDev, selection, 0, 0, 0, 0, srcWidth, srcHeight);
 }
 
+namespace {
+template <bool useOldSrcData>
+inline bool isSourceTileUniform(const KisRandomConstAccessorSP &srcIt)
+{
+    KisRandomAccessor2 *it = static_cast<KisRandomAccessor2*>(srcIt.data());
+    return useOldSrcData ? it->isCurrentOldTileUniform() : it->isCurrentTileUniform();
+}
+}
+
 template <bool useOldSrcData>
 void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                             const KisPaintDeviceSP srcDev,
@@ -695,7 +704,8 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                 d->paramInfo.dstRowStride  = dstRowStride;
                 // if we don't use the oldRawData, we need to access the rawData of the source device.
                 d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
-                d->paramInfo.srcRowStride  = srcRowStride;
+                // a uniform source tile is blended as a single color pixel
+                d->paramInfo.srcRowStride  = isSourceTileUniform<useOldSrcData>(srcIt) ? 0 : srcRowStride;
                 d->paramInfo.maskRowStart  = static_cast<KisRandomAccessor2*>(maskIt.data())->rawData();
                 d->paramInfo.maskRowStride = maskRowStride;
                 d->paramInfo.rows          = rows;
@@ -743,7 +753,8 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                 d->paramInfo.dstRowStride  = dstRowStride;
                 // if we don't use the oldRawData, we need to access the rawData of the source device.
                 d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
-                d->paramInfo.srcRowStride  = srcRowStride;
+                // a uniform source tile is blended as a single color pixel
+                d->paramInfo.srcRowStride  = isSourceTileUniform<useOldSrcData>(srcIt) ? 0 : srcRowStride;
                 d->paramInfo.maskRowStart  = 0;
                 d->paramInfo.maskRowStride = 0;
                 d->paramInfo.rows          = rows;
@@ -24,10 +24,14 @@
 #include "kis_image_config.h"
 #include "kis_full_refresh_walker.h"
 #include "kis_spontaneous_job.h"
+#include "kis_lod_transform.h"
+
+#include <config-tile-size.h>
 
 
 //#define ENABLE_DEBUG_JOIN
 //#define ENABLE_ACCUMULATOR
+//#define ENABLE_UPDATE_TRACE
 
 #ifdef ENABLE_DEBUG_JOIN
     #define DEBUG_JOIN(baseRect, newRect, alpha)                     \
@@ -40,6 +44,19 @@
 #endif /* ENABLE_DEBUG_JOIN */
 
 
+#ifdef ENABLE_UPDATE_TRACE
+    /**
+     * Prints the incoming update rects in the format understood
+     * by KisUpdateQueueReplayBenchmark
+     */
+    #define TRACE_UPDATE(rc)                                        \
+        dbgKrita << "UPDATE_TRACE" << (rc).x() << (rc).y()          \
+                 << (rc).width() << (rc).height()
+#else
+    #define TRACE_UPDATE(rc)
+#endif /* ENABLE_UPDATE_TRACE */
+
+
 #ifdef ENABLE_ACCUMULATOR
     #define DECLARE_ACCUMULATOR() static qreal _baseAmount=0, _newAmount=0
     #define ACCUMULATOR_ADD(baseAmount, newAmount) \
@@ -54,7 +71,8 @@
 
 
 KisSimpleUpdateQueue::KisSimpleUpdateQueue()
-    : m_overrideLevelOfDetail(-1)
+    : m_overrideLevelOfDetail(-1),
+      m_numDeferringJobs(0)
 {
     updateSettings();
 }
@@ -80,6 +98,8 @@ void KisSimpleUpdateQueue::updateSettings()
     m_maxCollectAlpha = config.maxCollectAlpha();
     m_maxMergeAlpha = config.maxMergeAlpha();
     m_maxMergeCollectAlpha = config.maxMergeCollectAlpha();
+
+    m_useCostModel = config.adaptiveUpdatesCoalescing();
 }
 
 int KisSimpleUpdateQueue::overrideLevelOfDetail() const
@@ -87,6 +107,38 @@ int KisSimpleUpdateQueue::overrideLevelOfDetail() const
     return m_overrideLevelOfDetail;
 }
 
+void KisSimpleUpdateQueue::setPriorityRects(const QVector<QRect> &rects)
+{
+    QMutexLocker locker(&m_lock);
+    m_priorityRects = rects;
+}
+
+void KisSimpleUpdateQueue::reportMergeJobTime(const QRect &rect, int numNodes, qint64 nsecs)
+{
+    m_costModel.addSample(rect, numNodes, nsecs);
+}
+
+const KisUpdateCostModel& KisSimpleUpdateQueue::costModel() const
+{
+    return m_costModel;
+}
+
+bool KisSimpleUpdateQueue::hasPriority(KisBaseRectsWalkerSP walker) const
+{
+    const int lod = walker->levelOfDetail();
+
+    Q_FOREACH (const QRect &rc, m_priorityRects) {
+        const QRect priorityRect = !lod ? rc :
+            KisLodTransform::scaledRect(KisLodTransform::alignedRect(rc, lod), lod);
+
+        if (walker->requestedRect().intersects(priorityRect)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void KisSimpleUpdateQueue::processQueue(KisUpdaterContext &updaterContext)
 {
     updaterContext.lock();
@@ -94,10 +146,20 @@ void KisSimpleUpdateQueue::processQueue(KisUpdaterContext &updaterContext)
     while(updaterContext.hasSpareThread() &&
           processOneJob(updaterContext));
 
+    /**
+     * When all the threads are busy, queue a few more merge jobs
+     * into their local queues, so that the threads could continue
+     * right after finishing their current jobs (or steal the jobs
+     * from each other) without waiting for the next processQueue()
+     */
+    while(!updaterContext.hasSpareThread() &&
+          updaterContext.hasSpareLocalQueueSlot() &&
+          processOneJob(updaterContext, true));
+
     updaterContext.unlock();
 }
 
-bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
+bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext, bool queueLocally)
 {
     QMutexLocker locker(&m_lock);
 
@@ -105,6 +167,13 @@ bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
     KisMutableWalkersListIterator iter(m_updatesList);
     bool jobAdded = false;
 
+    /**
+     * When some rects are visible to the user, we take the first
+     * allowed job intersecting them. Otherwise we fall back to
+     * the first allowed job in the queue.
+     */
+    KisBaseRectsWalkerSP fallbackItem;
+
     int currentLevelOfDetail = updaterContext.currentLevelOfDetail();
 
     while(iter.hasNext()) {
@@ -121,16 +190,50 @@ bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
         if ((currentLevelOfDetail < 0 || currentLevelOfDetail == item->levelOfDetail()) &&
             updaterContext.isJobAllowed(item)) {
 
-            updaterContext.addMergeJob(item);
+            if (!m_priorityRects.isEmpty() && !hasPriority(item)) {
+                if (!fallbackItem) {
+                    fallbackItem = item;
+
+                    /**
+                     * A long stroke in the viewport may keep the queue
+                     * busy forever, while the barrier jobs of the
+                     * strokes wait for the invisible updates too. So
+                     * the oldest invisible job is forced through after
+                     * a few visible ones.
+                     */
+                    if (m_numDeferringJobs >= MAX_DEFERRING_JOBS) {
+                        break;
+                    }
+                }
+                continue;
+            }
+
+            if (!queueLocally) {
+                updaterContext.addMergeJob(item);
+            } else {
+                updaterContext.addMergeJobToLocalQueue(item);
+            }
             iter.remove();
             jobAdded = true;
+            m_numDeferringJobs = fallbackItem ? m_numDeferringJobs + 1 : 0;
             break;
         }
     }
 
+    if (!jobAdded && fallbackItem) {
+        if (!queueLocally) {
+            updaterContext.addMergeJob(fallbackItem);
+        } else {
+            updaterContext.addMergeJobToLocalQueue(fallbackItem);
+        }
+        m_updatesList.removeOne(fallbackItem);
+        jobAdded = true;
+        m_numDeferringJobs = 0;
+    }
+
     if (jobAdded) return true;
 
-    if (!m_spontaneousJobsList.isEmpty()) {
+    if (!queueLocally && !m_spontaneousJobsList.isEmpty()) {
         /**
          * WARNING: Please note that this still doesn't guarantee that
          * the spontaneous jobs are exclusive, since updates and/or
@@ -189,6 +292,10 @@ void KisSimpleUpdateQueue::addJob(KisNodeSP node, const QVector<QRect> &rects,
         KisBaseRectsWalkerSP walker;
 
         if(trySplitJob(node, rc, cropRect, levelOfDetail, type)) continue;
+
+        // the split rects are traced by the recursive call
+        TRACE_UPDATE(rc);
+
         if(tryMergeJob(node, rc, cropRect, levelOfDetail, type)) continue;
 
         if (type == KisBaseRectsWalker::UPDATE) {
@@ -246,28 +353,65 @@ qint32 KisSimpleUpdateQueue::sizeMetric() const
     return m_updatesList.size() + m_spontaneousJobsList.size();
 }
 
+namespace {
+
+inline qint32 divFloor(qint32 value, qint32 divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+inline qint32 alignToTiles(qint32 value)
+{
+    return (value + KRITA_TILE_SIZE - 1) / KRITA_TILE_SIZE * KRITA_TILE_SIZE;
+}
+
+}
+
 bool KisSimpleUpdateQueue::trySplitJob(KisNodeSP node, const QRect& rc,
                                        const QRect& cropRect,
                                        int levelOfDetail,
                                        KisBaseRectsWalker::UpdateType type)
 {
-    if(rc.width() <= m_patchWidth || rc.height() <= m_patchHeight)
+    /**
+     * The patches are aligned to the tiles grid, so that two
+     * threads would never write into the same tile
+     */
+    const qint32 patchWidth = alignToTiles(m_patchWidth);
+    const qint32 patchHeight = alignToTiles(m_patchHeight);
+
+    /**
+     * Besides the rects bigger than a patch, we also split long
+     * strips (e.g. a horizontal stroke over the whole image), which
+     * would otherwise keep one thread busy while the other ones are
+     * idle. The strips shorter than two patches are not worth the
+     * overhead of an extra walker.
+     */
+    const bool splitColumns = rc.width() > patchWidth;
+    const bool splitRows = rc.height() > patchHeight;
+
+    if (!(splitColumns && splitRows) &&
+        rc.width() <= 2 * patchWidth &&
+        rc.height() <= 2 * patchHeight) {
+
         return false;
+    }
 
     // a bit of recursive splitting...
 
-    qint32 firstCol = rc.x() / m_patchWidth;
-    qint32 firstRow = rc.y() / m_patchHeight;
+    qint32 firstCol = splitColumns ? divFloor(rc.x(), patchWidth) : 0;
+    qint32 firstRow = splitRows ? divFloor(rc.y(), patchHeight) : 0;
 
-    qint32 lastCol = (rc.x() + rc.width()) / m_patchWidth;
-    qint32 lastRow = (rc.y() + rc.height()) / m_patchHeight;
+    qint32 lastCol = splitColumns ? divFloor(rc.x() + rc.width() - 1, patchWidth) : 0;
+    qint32 lastRow = splitRows ? divFloor(rc.y() + rc.height() - 1, patchHeight) : 0;
 
     QVector<QRect> splitRects;
 
     for(qint32 i = firstRow; i <= lastRow; i++) {
         for(qint32 j = firstCol; j <= lastCol; j++) {
-            QRect maxPatchRect(j * m_patchWidth, i * m_patchHeight,
-                               m_patchWidth, m_patchHeight);
+            QRect maxPatchRect(splitColumns ? j * patchWidth : rc.x(),
+                               splitRows ? i * patchHeight : rc.y(),
+                               splitColumns ? patchWidth : rc.width(),
+                               splitRows ? patchHeight : rc.height());
             QRect patchRect = rc & maxPatchRect;
             splitRects.append(patchRect);
         }
@@ -328,16 +472,23 @@ void KisSimpleUpdateQueue::optimize()
     KisBaseRectsWalkerSP baseWalker = m_updatesList.first();
     QRect baseRect = baseWalker->requestedRect();
 
-    collectJobs(baseWalker, baseRect, m_maxCollectAlpha);
+    collectJobs(baseWalker, baseRect, m_maxCollectAlpha, m_useCostModel);
 }
 
 void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
                                        QRect baseRect,
-                                       const qreal maxAlpha)
+                                       const qreal maxAlpha,
+                                       bool useCostModel)
 {
     KisBaseRectsWalkerSP item;
     KisMutableWalkersListIterator iter(m_updatesList);
 
+    /**
+     * All the collected walkers start from the same node, so they
+     * have roughly the same number of nodes to compose
+     */
+    const int numNodes = baseWalker->leafStack().size();
+
     while(iter.hasNext()) {
         item = iter.next();
 
@@ -347,7 +498,11 @@ void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
         if(item->cropRect() != baseWalker->cropRect()) continue;
         if(item->levelOfDetail() != baseWalker->levelOfDetail()) continue;
 
-        if(joinRects(baseRect, item->requestedRect(), maxAlpha)) {
+        const bool joined = useCostModel ?
+            joinRectsByCost(baseRect, item->requestedRect(), numNodes) :
+            joinRects(baseRect, item->requestedRect(), maxAlpha);
+
+        if(joined) {
             iter.remove();
         }
     }
@@ -386,6 +541,16 @@ bool KisSimpleUpdateQueue::joinRects(QRect& baseRect,
     return result;
 }
 
+bool KisSimpleUpdateQueue::joinRectsByCost(QRect& baseRect,
+                                           const QRect& newRect, int numNodes)
+{
+    QRect unitedRect = baseRect | newRect;
+    if(unitedRect.width() > m_patchWidth || unitedRect.height() > m_patchHeight)
+        return false;
+
+    return m_costModel.tryJoinRects(baseRect, newRect, numNodes);
+}
+
 KisWalkersList& KisTestableSimpleUpdateQueue::getWalkersList()
 {
     return m_updatesList;
@@ -21,6 +21,7 @@
 
 #include <QMutex>
 #include "kis_updater_context.h"
+#include "KisUpdateCostModel.h"
 
 typedef QList<KisBaseRectsWalkerSP> KisWalkersList;
 typedef QListIterator<KisBaseRectsWalkerSP> KisWalkersListIterator;
@@ -55,17 +56,37 @@ public:
 
     int overrideLevelOfDetail() const;
 
+    /**
+     * Sets the rects of the image (in LOD0 coordinates) currently
+     * visible to the user. The jobs intersecting these rects are
+     * processed before all the other ones, which stay in the queue
+     * and have more chances to be merged by optimize().
+     */
+    void setPriorityRects(const QVector<QRect> &rects);
+
+    /**
+     * Report the measured time of a merge job to the cost model
+     * used by optimize()
+     *
+     * \see KisUpdateCostModel
+     */
+    void reportMergeJobTime(const QRect &rect, int numNodes, qint64 nsecs);
+
+    const KisUpdateCostModel& costModel() const;
+
 protected:
     void addJob(KisNodeSP node, const QVector<QRect> &rects, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
 
-    bool processOneJob(KisUpdaterContext &updaterContext);
+    bool processOneJob(KisUpdaterContext &updaterContext, bool queueLocally = false);
 
     bool trySplitJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
     bool tryMergeJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
 
     void collectJobs(KisBaseRectsWalkerSP &baseWalker, QRect baseRect,
-                     const qreal maxAlpha);
+                     const qreal maxAlpha, bool useCostModel = false);
     bool joinRects(QRect& baseRect, const QRect& newRect, qreal maxAlpha);
+    bool joinRectsByCost(QRect& baseRect, const QRect& newRect, int numNodes);
+    bool hasPriority(KisBaseRectsWalkerSP walker) const;
 
 protected:
 
@@ -102,7 +123,25 @@ protected:
      */
     qreal m_maxMergeCollectAlpha;
 
+    /**
+     * When enabled, optimize() merges the jobs if the estimated
+     * time of the merged job is less than the time of the separate
+     * ones, instead of using m_maxCollectAlpha
+     */
+    bool m_useCostModel;
+    KisUpdateCostModel m_costModel;
+
     int m_overrideLevelOfDetail;
+
+    QVector<QRect> m_priorityRects;
+
+    /**
+     * The number of visible jobs started in a row while an older
+     * invisible job was waiting. When it reaches MAX_DEFERRING_JOBS,
+     * the invisible job is started regardless of the priority.
+     */
+    static const int MAX_DEFERRING_JOBS = 8;
+    int m_numDeferringJobs;
 };
 
 class KRITAIMAGE_EXPORT KisTestableSimpleUpdateQueue : public KisSimpleUpdateQueue
@@ -23,11 +23,14 @@
 
 #include <QRunnable>
 #include <QReadWriteLock>
+#include <QList>
+#include <QElapsedTimer>
 
 #include "kis_stroke_job.h"
 #include "kis_spontaneous_job.h"
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
+#include "KisMergeTraceRecorder.h"
 #include "kis_updater_context.h"
 
 
@@ -99,6 +102,12 @@ public:
             // may flip the current state from Waiting -> Running again
             m_updaterContext->jobFinished();
 
+            // if the scheduler had nothing for us, continue with the
+            // merge jobs from the local queues
+            if (!isRunning()) {
+                m_updaterContext->takeLocalMergeJob(this);
+            }
+
             m_updaterContext->m_exclusiveJobLock.unlock();
 
             // try to exit the loop. Please note, that no one can flip the state from
@@ -115,7 +124,18 @@ public:
         KIS_SAFE_ASSERT_RECOVER_RETURN(m_walker);
         // dbgKrita << "Executing merge job" << m_walker->changeRect()
         //          << "on thread" << QThread::currentThreadId();
-        m_merger.startMerge(*m_walker);
+        // the merger empties the leaf stack, so count the nodes beforehand
+        const int numNodes = m_walker->leafStack().size();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        {
+            KisMergeTraceRecorder::JobScope traceScope(*m_walker);
+            m_merger.startMerge(*m_walker);
+        }
+
+        m_updaterContext->reportMergeJobTime(m_walker->requestedRect(), numNodes, timer.nsecsElapsed());
 
         QRect changeRect = m_walker->changeRect();
         m_updaterContext->continueUpdate(changeRect);
@@ -201,6 +221,7 @@ private:
     friend class KisSimpleUpdateQueueTest;
     friend class KisStrokesQueueTest;
     friend class KisUpdateSchedulerTest;
+    friend class KisUpdaterContextTest;
     friend class KisUpdaterContext;
 
     inline KisBaseRectsWalkerSP walker() const {
@@ -246,6 +267,12 @@ private:
      */
     QRect m_accessRect;
     QRect m_changeRect;
+
+    /**
+     * Merge jobs queued for this thread while it is busy. The list
+     * is guarded by the context's lock.
+     */
+    QList<KisBaseRectsWalkerSP> m_localQueue;
 };
 
 
@@ -266,6 +266,11 @@ void KisUpdateScheduler::explicitRegenerateLevelOfDetail()
     processQueues();
 }
 
+void KisUpdateScheduler::setPriorityRects(const QVector<QRect> &rects)
+{
+    m_d->updatesQueue.setPriorityRects(rects);
+}
+
 int KisUpdateScheduler::currentLevelOfDetail() const
 {
     int levelOfDetail = m_d->updaterContext.currentLevelOfDetail();
@@ -457,6 +462,11 @@ void KisUpdateScheduler::continueUpdate(const QRect &rect)
     m_d->projectionUpdateListener->notifyProjectionUpdated(rect);
 }
 
+void KisUpdateScheduler::reportMergeJobTime(const QRect &rect, int numNodes, qint64 nsecs)
+{
+    m_d->updatesQueue.reportMergeJobTime(rect, numNodes, nsecs);
+}
+
 void KisUpdateScheduler::doSomeUsefulWork()
 {
     m_d->updatesQueue.optimize();
@@ -490,3 +500,8 @@ KisTestableSimpleUpdateQueue* KisTestableUpdateScheduler::updateQueue()
 {
     return dynamic_cast<KisTestableSimpleUpdateQueue*>(&m_d->updatesQueue);
 }
+
+const KisUpdateCostModel& KisTestableUpdateScheduler::updatesCostModel() const
+{
+    return m_d->updatesQueue.costModel();
+}
@@ -163,6 +163,14 @@ public:
      */
     void explicitRegenerateLevelOfDetail();
 
+    /**
+     * Sets the rects of the image visible to the user. The updates
+     * intersecting these rects are processed before the other ones.
+     *
+     * \see KisSimpleUpdateQueue::setPriorityRects()
+     */
+    void setPriorityRects(const QVector<QRect> &rects);
+
     /**
      * Install a factory of a stroke strategy, that will be started
      * every time when the scheduler needs to synchronize LOD caches
@@ -205,6 +213,7 @@ public:
     int currentLevelOfDetail() const;
 
     void continueUpdate(const QRect &rect);
+    void reportMergeJobTime(const QRect &rect, int numNodes, qint64 nsecs);
     void doSomeUsefulWork();
     void spareThreadAppeared();
 
@@ -236,6 +245,7 @@ protected:
 
 class KisTestableSimpleUpdateQueue;
 class KisUpdaterContext;
+class KisUpdateCostModel;
 
 class KRITAIMAGE_EXPORT KisTestableUpdateScheduler : public KisUpdateScheduler
 {
@@ -245,6 +255,7 @@ public:
 
     KisUpdaterContext* updaterContext();
     KisTestableSimpleUpdateQueue* updateQueue();
+    const KisUpdateCostModel& updatesCostModel() const;
     using KisUpdateScheduler::processQueues;
 };
 
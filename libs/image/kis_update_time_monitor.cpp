@@ -36,6 +36,7 @@
 #include "kis_debug.h"
 #include "kis_global.h"
 #include "kis_image_config.h"
+#include "kis_lod_transform.h"
 
 
 #include <brushengine/kis_paintop_preset.h>
@@ -104,6 +105,30 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
     QElapsedTimer strokeTime;
     KisPaintOpPresetSP preset;
 
+    /**
+     * Every open image has its own views, so the visible rects and
+     * the pending measurement are kept per image
+     */
+    struct ViewportState {
+        ViewportState() : visibleUpdatePending(false) {}
+
+        QVector<QRect> viewportRects;
+        QElapsedTimer visibleUpdateTime;
+        bool visibleUpdatePending;
+
+        bool intersectsViewport(const QRect &rc, int levelOfDetail) const {
+            const QRect imageRect = !levelOfDetail ? rc :
+                KisLodTransform::upscaledRect(rc, levelOfDetail);
+
+            Q_FOREACH (const QRect &viewportRect, viewportRects) {
+                if (viewportRect.intersects(imageRect)) return true;
+            }
+            return false;
+        }
+    };
+
+    QHash<const void*, ViewportState> viewports;
+
     bool loggingEnabled;
 };
 
@@ -236,12 +261,26 @@ void KisUpdateTimeMonitor::reportJobFinished(void *key, const QVector<QRect> &re
     }
 }
 
-void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect)
+void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect, int levelOfDetail, const void *image)
 {
     if (!m_d->loggingEnabled) return;
 
     QMutexLocker locker(&m_d->mutex);
 
+    auto it = m_d->viewports.find(image);
+    if (it != m_d->viewports.end() &&
+        it->visibleUpdatePending && it->intersectsViewport(rect, levelOfDetail)) {
+
+        it->visibleUpdatePending = false;
+
+        QFile logFile("log/viewport.rdata");
+        logFile.open(QIODevice::Append);
+        QTextStream stream(&logFile);
+
+        stream << i18n("Time To First Visible Pixel:") << it->visibleUpdateTime.elapsed() << endl;
+        logFile.close();
+    }
+
     Q_FOREACH (StrokeTicket *ticket, m_d->finishedTickets) {
         ticket->dirtyRegion -= rect;
         if(ticket->dirtyRegion.isEmpty()) {
@@ -256,3 +295,34 @@ void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect)
     }
     m_d->numUpdates++;
 }
+
+void KisUpdateTimeMonitor::reportViewportRects(const void *image, const QVector<QRect> &rects)
+{
+    if (!m_d->loggingEnabled) return;
+
+    QMutexLocker locker(&m_d->mutex);
+
+    if (rects.isEmpty()) {
+        m_d->viewports.remove(image);
+    } else {
+        m_d->viewports[image].viewportRects = rects;
+    }
+}
+
+void KisUpdateTimeMonitor::reportUpdateRequested(const void *image, const QVector<QRect> &rects, int levelOfDetail)
+{
+    if (!m_d->loggingEnabled) return;
+
+    QMutexLocker locker(&m_d->mutex);
+
+    auto it = m_d->viewports.find(image);
+    if (it == m_d->viewports.end() || it->visibleUpdatePending) return;
+
+    Q_FOREACH (const QRect &rc, rects) {
+        if (it->intersectsViewport(rc, levelOfDetail)) {
+            it->visibleUpdatePending = true;
+            it->visibleUpdateTime.start();
+            break;
+        }
+    }
+}
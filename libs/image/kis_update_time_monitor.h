@@ -44,7 +44,19 @@ public:
 
     void reportJobStarted(void *key);
     void reportJobFinished(void *key, const QVector<QRect> &rects);
-    void reportUpdateFinished(const QRect &rect);
+    void reportUpdateFinished(const QRect &rect, int levelOfDetail = 0, const void *image = 0);
+
+    /**
+     * Time-to-first-visible-pixel measurement: the time between
+     * the first update request touching the visible part of the
+     * image and the first projection update in the visible part.
+     * The viewport rects are passed in LOD0 image coordinates,
+     * the update rects in the coordinates of \p levelOfDetail.
+     * Every \p image is measured separately, empty \p rects
+     * stop the measurement for it.
+     */
+    void reportViewportRects(const void *image, const QVector<QRect> &rects);
+    void reportUpdateRequested(const void *image, const QVector<QRect> &rects, int levelOfDetail);
 
 
 private:
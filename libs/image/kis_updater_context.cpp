@@ -23,11 +23,14 @@
 
 #include "kis_update_job_item.h"
 #include "kis_stroke_job.h"
+#include "kis_image_config.h"
 
 const int KisUpdaterContext::useIdealThreadCountTag = -1;
 
 KisUpdaterContext::KisUpdaterContext(qint32 threadCount, QObject *parent)
-    : QObject(parent), m_scheduler(qobject_cast<KisUpdateScheduler *>(parent))
+    : QObject(parent), m_scheduler(qobject_cast<KisUpdateScheduler *>(parent)),
+      m_localQueueSize(KisImageConfig(true).updaterLocalQueueSize()),
+      m_numLocalMergeJobs(0)
 {
     if(threadCount <= 0) {
         threadCount = QThread::idealThreadCount();
@@ -59,12 +62,18 @@ void KisUpdaterContext::getJobsSnapshot(qint32 &numMergeJobs,
             numStrokeJobs++;
         }
     }
+
+    numMergeJobs += m_numLocalMergeJobs;
 }
 
 KisUpdaterContextSnapshotEx KisUpdaterContext::getContextSnapshotEx() const
 {
     KisUpdaterContextSnapshotEx state = ContextEmpty;
 
+    if (m_numLocalMergeJobs) {
+        state |= HasMergeJob;
+    }
+
     Q_FOREACH (const KisUpdateJobItem *item, m_jobs) {
         if (item->type() == KisUpdateJobItem::Type::MERGE ||
             item->type() == KisUpdateJobItem::Type::SPONTANEOUS) {
@@ -108,6 +117,18 @@ bool KisUpdaterContext::hasSpareThread()
     return found;
 }
 
+bool KisUpdaterContext::hasSpareLocalQueueSlot()
+{
+    Q_FOREACH (const KisUpdateJobItem *item, m_jobs) {
+        if (item->type() == KisUpdateJobItem::Type::MERGE &&
+            item->m_localQueue.size() < m_localQueueSize) {
+
+            return true;
+        }
+    }
+    return false;
+}
+
 bool KisUpdaterContext::isJobAllowed(KisBaseRectsWalkerSP walker)
 {
     int lod = this->currentLevelOfDetail();
@@ -120,6 +141,15 @@ bool KisUpdaterContext::isJobAllowed(KisBaseRectsWalkerSP walker)
             intersects = true;
             break;
         }
+
+        Q_FOREACH (KisBaseRectsWalkerSP queuedWalker, item->m_localQueue) {
+            if (walkersIntersect(walker, queuedWalker)) {
+                intersects = true;
+                break;
+            }
+        }
+
+        if (intersects) break;
     }
 
     return !intersects;
@@ -148,6 +178,105 @@ void KisUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
     }
 }
 
+void KisUpdaterContext::addMergeJobToLocalQueue(KisBaseRectsWalkerSP walker)
+{
+    KisUpdateJobItem *bestItem = 0;
+
+    Q_FOREACH (KisUpdateJobItem *item, m_jobs) {
+        if (item->type() == KisUpdateJobItem::Type::MERGE &&
+            item->m_localQueue.size() < m_localQueueSize &&
+            (!bestItem || item->m_localQueue.size() < bestItem->m_localQueue.size())) {
+
+            bestItem = item;
+        }
+    }
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(bestItem);
+
+    bestItem->m_localQueue.append(walker);
+    m_numLocalMergeJobs++;
+
+    /**
+     * The item might have finished its job while we were choosing it.
+     * It checks m_numLocalMergeJobs *after* switching into WAITING
+     * state, and we check the state *after* incrementing the counter,
+     * so if the item is still running, it will definitely notice the
+     * job. Otherwise the item might have already exited, so just run
+     * the job in the usual way: the item is a spare thread now.
+     */
+    if (bestItem->type() != KisUpdateJobItem::Type::MERGE) {
+        bestItem->m_localQueue.removeLast();
+        m_numLocalMergeJobs--;
+
+        addMergeJob(walker);
+        return;
+    }
+
+    m_lodCounter.addLod(walker->levelOfDetail());
+}
+
+/**
+ * Called by the job item when it has finished its job and the
+ * scheduler has not given it anything new. The item takes the
+ * oldest job from its own local queue or, if the queue is empty,
+ * steals the newest job from the longest queue of the other items.
+ *
+ * NOTE: the context's lock is taken only when there are some jobs
+ * in the local queues, because it may be held by the caller waiting
+ * for this thread in waitForDone() (see KisUpdateScheduler::fullRefresh()).
+ * The queues are always empty in such a case.
+ */
+void KisUpdaterContext::takeLocalMergeJob(KisUpdateJobItem *item)
+{
+    if (!m_numLocalMergeJobs) return;
+
+    QMutexLocker locker(&m_lock);
+
+    if (item->isRunning()) return;
+
+    KisBaseRectsWalkerSP walker;
+
+    if (!item->m_localQueue.isEmpty()) {
+        walker = item->m_localQueue.takeFirst();
+    } else {
+        KisUpdateJobItem *victim = 0;
+
+        Q_FOREACH (KisUpdateJobItem *other, m_jobs) {
+            if (!other->m_localQueue.isEmpty() &&
+                (!victim || other->m_localQueue.size() > victim->m_localQueue.size())) {
+
+                victim = other;
+            }
+        }
+
+        if (victim) {
+            walker = victim->m_localQueue.takeLast();
+        }
+    }
+
+    if (walker) {
+        /**
+         * Switch the item into MERGE state before decrementing
+         * the counter, so that the snapshots would never report
+         * the context as idle in between
+         */
+        const bool shouldStartThread = item->setWalker(walker);
+        m_numLocalMergeJobs--;
+
+        // we are called from within the thread itself
+        KIS_SAFE_ASSERT_RECOVER_NOOP(!shouldStartThread);
+    }
+}
+
+void KisUpdaterContext::clearLocalQueues()
+{
+    Q_FOREACH (KisUpdateJobItem *item, m_jobs) {
+        item->m_localQueue.clear();
+    }
+
+    m_numLocalMergeJobs = 0;
+}
+
 /**
  * This variant is for use in a testing suite only
  */
@@ -235,6 +364,13 @@ bool KisUpdaterContext::walkerIntersectsJob(KisBaseRectsWalkerSP walker,
         (job->accessRect().intersects(walker->changeRect()));
 }
 
+bool KisUpdaterContext::walkersIntersect(KisBaseRectsWalkerSP walker,
+                                         KisBaseRectsWalkerSP other)
+{
+    return (walker->accessRect().intersects(other->changeRect())) ||
+        (other->accessRect().intersects(walker->changeRect()));
+}
+
 qint32 KisUpdaterContext::findSpareThread()
 {
     for(qint32 i=0; i < m_jobs.size(); i++)
@@ -260,6 +396,7 @@ void KisUpdaterContext::setThreadsLimit(int value)
 
     for (int i = 0; i < m_jobs.size(); i++) {
         KIS_SAFE_ASSERT_RECOVER_RETURN(!m_jobs[i]->isRunning());
+        KIS_SAFE_ASSERT_RECOVER_RETURN(m_jobs[i]->m_localQueue.isEmpty());
         // don't delete the jobs until all of them are checked!
     }
 
@@ -274,6 +411,12 @@ void KisUpdaterContext::setThreadsLimit(int value)
     }
 }
 
+void KisUpdaterContext::setLocalQueueSize(int value)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(value >= 0);
+    m_localQueueSize = value;
+}
+
 int KisUpdaterContext::threadsLimit() const
 {
     KIS_SAFE_ASSERT_RECOVER_NOOP(m_jobs.size() == m_threadPool.maxThreadCount());
@@ -285,6 +428,11 @@ void KisUpdaterContext::continueUpdate(const QRect& rc)
     if (m_scheduler) m_scheduler->continueUpdate(rc);
 }
 
+void KisUpdaterContext::reportMergeJobTime(const QRect &rect, int numNodes, qint64 nsecs)
+{
+    if (m_scheduler) m_scheduler->reportMergeJobTime(rect, numNodes, nsecs);
+}
+
 void KisUpdaterContext::doSomeUsefulWork()
 {
     if (m_scheduler) m_scheduler->doSomeUsefulWork();
@@ -307,6 +455,7 @@ void KisUpdaterContext::clear()
         item->testingSetDone();
     }
 
+    clearLocalQueues();
     m_lodCounter.testingClear();
 }
 
@@ -314,6 +463,11 @@ void KisUpdaterContext::clear()
 KisTestableUpdaterContext::KisTestableUpdaterContext(qint32 threadCount)
     : KisUpdaterContext(threadCount)
 {
+    /**
+     * The local queues are disabled by default to make
+     * the distribution of the jobs predictable
+     */
+    setLocalQueueSize(0);
 }
 
 KisTestableUpdaterContext::~KisTestableUpdaterContext() {
@@ -331,6 +485,7 @@ void KisTestableUpdaterContext::clear()
         item->testingSetDone();
     }
 
+    clearLocalQueues();
     m_lodCounter.testingClear();
 }
 
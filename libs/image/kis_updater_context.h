@@ -19,6 +19,8 @@
 #ifndef __KIS_UPDATER_CONTEXT_H
 #define __KIS_UPDATER_CONTEXT_H
 
+#include <atomic>
+
 #include <QObject>
 #include <QMutex>
 #include <QReadWriteLock>
@@ -68,6 +70,15 @@ public:
      */
     bool hasSpareThread();
 
+    /**
+     * Check whether one more merge job can be queued into the local
+     * queue of one of the threads running a merge job. It should be
+     * called with the lock held.
+     *
+     * \see addMergeJobToLocalQueue()
+     */
+    bool hasSpareLocalQueueSlot();
+
     /**
      * Checks whether the walker intersects with any
      * of currently executing walkers. If it does,
@@ -90,6 +101,22 @@ public:
      */
     virtual void addMergeJob(KisBaseRectsWalkerSP walker);
 
+    /**
+     * Puts the job into the local queue of one of the busy threads
+     * running merge jobs. When the thread finishes its current job
+     * and the scheduler has nothing more urgent for it, the thread
+     * continues with the jobs from its local queue. A thread with an
+     * empty local queue steals the jobs from the queues of the other
+     * threads.
+     *
+     * The prerequisites are the same as for addMergeJob(), except
+     * that instead of a spare thread there should be a spare slot
+     * in the local queues.
+     *
+     * \see hasSpareLocalQueueSlot()
+     */
+    void addMergeJobToLocalQueue(KisBaseRectsWalkerSP walker);
+
     /**
      * Adds a stroke job to the context. The prerequisites are
      * the same as for addMergeJob()
@@ -139,14 +166,26 @@ public:
      */
     int threadsLimit() const;
 
+    /**
+     * Set the maximum number of merge jobs queued into the local
+     * queue of every thread. Zero disables the local queues. The
+     * same requirements as for setThreadsLimit() apply.
+     */
+    void setLocalQueueSize(int value);
+
     void continueUpdate(const QRect& rc);
+    void reportMergeJobTime(const QRect &rect, int numNodes, qint64 nsecs);
     void doSomeUsefulWork();
     void jobFinished();
 
 protected:
     static bool walkerIntersectsJob(KisBaseRectsWalkerSP walker,
                                     const KisUpdateJobItem* job);
+    static bool walkersIntersect(KisBaseRectsWalkerSP walker,
+                                 KisBaseRectsWalkerSP other);
     qint32 findSpareThread();
+    void takeLocalMergeJob(KisUpdateJobItem *item);
+    void clearLocalQueues();
 
 protected:
     /**
@@ -163,6 +202,14 @@ protected:
     KisLockFreeLodCounter m_lodCounter;
     KisUpdateScheduler *m_scheduler;
 
+    /**
+     * The local queues of the job items are guarded by m_lock. The
+     * total number of the queued jobs is also available without
+     * the lock.
+     */
+    int m_localQueueSize;
+    std::atomic<int> m_numLocalMergeJobs;
+
 private:
 
     friend class KisUpdaterContextTest;
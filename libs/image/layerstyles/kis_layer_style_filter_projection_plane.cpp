@@ -28,6 +28,7 @@
 
 #include "kis_painter.h"
 #include "kis_multiple_projection.h"
+#include "KisMergeTraceRecorder.h"
 
 
 struct KisLayerStyleFilterProjectionPlane::Private
@@ -89,6 +90,8 @@ QRect KisLayerStyleFilterProjectionPlane::recalculate(const QRect& rect, KisNode
         return QRect();
     }
 
+    KisMergeTraceRecorder::NodeScope traceScope("layer style", m_d->sourceLayer, rect, 0, m_d->filter->id());
+
     m_d->projection.clear(rect);
     m_d->filter->processDirectly(m_d->sourceLayer->projection(),
                                  &m_d->projection,
@@ -23,6 +23,11 @@
 #include "kis_async_merger.h"
 
 #include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 #include "kis_image.h"
@@ -32,12 +37,16 @@
 #include "kis_adjustment_layer.h"
 #include "kis_filter_mask.h"
 #include "kis_selection.h"
+#include "kis_image_config.h"
+#include "KisBelowSiblingsProjectionCache.h"
+#include "KisMergeTraceRecorder.h"
 
 #include "filter/kis_filter.h"
 #include "filter/kis_filter_configuration.h"
 #include "filter/kis_filter_registry.h"
 
 #include "../../sdk/tests/testutil.h"
+#include "../../sdk/tests/image_config_override.h"
 
     /*
       +-----------+
@@ -287,5 +296,199 @@ void KisAsyncMergerTest::testSubgraphingWithoutUpdatingParent()
     }
 }
 
+/**
+ * Merges a stack of paint layers with the fused composition
+ * enabled and disabled. The layers are moved by non-tile-aligned
+ * offsets and one of them is semi-transparent, so the run of the
+ * fused layers is broken in the middle.
+ */
+static KisPaintDeviceSP mergeLayerStack(bool useFusedComposition)
+{
+    TestUtil::ImageConfigOverride<bool> fusedOverride(&KisImageConfig::fusedLayersComposition,
+                                                      &KisImageConfig::setFusedLayersComposition,
+                                                      useFusedComposition);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 300, 200, cs, "fused merger test");
+
+    for (int i = 0; i < 6; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("paint%1").arg(i),
+                                                  i == 3 ? 128 : OPACITY_OPAQUE_U8);
+
+        const QColor color = QColor::fromHsv(i * 60, 255, 255, 100 + i * 20);
+        layer->paintDevice()->fill(QRect(10 * i, 7 * i, 150, 120), KoColor(color, cs));
+        layer->paintDevice()->moveTo(17 * i, 13 * i);
+
+        image->addNode(layer, image->rootLayer());
+    }
+
+    KisRefreshSubtreeWalker walker(image->bounds());
+    KisAsyncMerger merger;
+
+    walker.collectRects(image->rootLayer(), image->bounds());
+    merger.startMerge(walker);
+
+    return image->projection();
+}
+
+void KisAsyncMergerTest::testFusedComposition()
+{
+    KisPaintDeviceSP separateResult = mergeLayerStack(false);
+    KisPaintDeviceSP fusedResult = mergeLayerStack(true);
+
+    QCOMPARE(fusedResult->exactBounds(), separateResult->exactBounds());
+    QVERIFY(TestUtil::comparePaintDevicesClever<quint8>(fusedResult, separateResult));
+}
+
+void KisAsyncMergerTest::testBelowSiblingsCache()
+{
+    /**
+     * The mergers of the updater context read the option
+     * on construction, so set it before creating the image
+     */
+    TestUtil::ImageConfigOverride<bool> cacheOverride(&KisImageConfig::cacheBelowSiblingsProjection,
+                                                      &KisImageConfig::setCacheBelowSiblingsProjection,
+                                                      true);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 300, 200, cs, "below siblings cache test");
+
+    KisGroupLayerSP group = new KisGroupLayer(image, "group", OPACITY_OPAQUE_U8);
+    image->addNode(group, image->rootLayer());
+
+    QVector<KisPaintLayerSP> layers;
+
+    for (int i = 0; i < 5; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("paint%1").arg(i), OPACITY_OPAQUE_U8);
+
+        const QColor color = QColor::fromHsv(i * 60, 255, 255, 100 + i * 20);
+        layer->paintDevice()->fill(QRect(10 * i, 7 * i, 150, 120), KoColor(color, cs));
+
+        image->addNode(layer, group);
+        layers << layer;
+    }
+
+    image->initialRefreshGraph();
+
+    KisBelowSiblingsProjectionCache *cache = group->belowSiblingsProjectionCache();
+    QVERIFY(cache->cachedRegion().isEmpty());
+
+    const QRect dirtyRect(40, 30, 50, 40);
+
+    // the first update of the layer fills the cache
+    layers[3]->setDirty(dirtyRect);
+    image->waitForDone();
+    QVERIFY((QRegion(dirtyRect) - cache->cachedRegion()).isEmpty());
+
+    /**
+     * Change the lower layer without notifying the image: the
+     * next update of the upper layer takes the cached composition
+     */
+    KisPaintDeviceSP cachedProjection = new KisPaintDevice(*image->projection());
+    layers[0]->paintDevice()->fill(dirtyRect, KoColor(Qt::black, cs));
+
+    layers[3]->setDirty(dirtyRect);
+    image->waitForDone();
+    QVERIFY(TestUtil::comparePaintDevicesClever<quint8>(image->projection(), cachedProjection));
+
+    // the update of the lower layer drops the cache
+    layers[0]->setDirty(dirtyRect);
+    image->waitForDone();
+    QVERIFY(cache->cachedRegion().isEmpty());
+    QVERIFY(!TestUtil::comparePaintDevicesClever<quint8>(image->projection(), cachedProjection));
+
+    // the cached composition gives the same result as the full one
+    layers[3]->setDirty(dirtyRect);
+    image->waitForDone();
+
+    layers[3]->paintDevice()->fill(dirtyRect, KoColor(QColor(255, 0, 0, 128), cs));
+    layers[3]->setDirty(dirtyRect);
+    image->waitForDone();
+
+    cachedProjection = new KisPaintDevice(*image->projection());
+    image->refreshGraph();
+
+    QVERIFY(cache->cachedRegion().isEmpty());
+    QVERIFY(TestUtil::comparePaintDevicesClever<quint8>(image->projection(), cachedProjection));
+}
+
+void KisAsyncMergerTest::testMergeTrace()
+{
+    KisMergeTraceRecorder *recorder = KisMergeTraceRecorder::instance();
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 300, 200, cs, "merge trace test");
+
+    KisPaintLayerSP paintLayer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    KisPaintLayerSP paintLayer2 = new KisPaintLayer(image, "paint2", OPACITY_OPAQUE_U8);
+    paintLayer1->paintDevice()->fill(QRect(0, 0, 200, 150), KoColor(Qt::red, cs));
+    paintLayer2->paintDevice()->fill(QRect(50, 50, 200, 150), KoColor(Qt::blue, cs));
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value("blur");
+    QVERIFY(filter);
+
+    KisFilterMaskSP blurMask = new KisFilterMask();
+    blurMask->initSelection(paintLayer2);
+    blurMask->setFilter(filter->defaultConfiguration());
+    blurMask->setName("blur");
+
+    image->addNode(paintLayer1, image->rootLayer());
+    image->addNode(paintLayer2, image->rootLayer());
+    image->addNode(blurMask, paintLayer2);
+    image->waitForDone();
+
+    recorder->clear();
+    recorder->setEnabled(true);
+
+    KisMergeWalker walker(image->bounds());
+    KisAsyncMerger merger;
+
+    walker.collectRects(paintLayer2, QRect(60, 60, 40, 30));
+    merger.startMerge(walker);
+
+    recorder->setEnabled(false);
+
+    bool hasLayer1 = false;
+    bool hasLayer2 = false;
+    bool hasMask = false;
+
+    Q_FOREACH (const KisMergeTraceRecorder::NodeStatistics &stats, recorder->statistics()) {
+        QVERIFY(stats.numEvents > 0);
+        QVERIFY(stats.numPixels > 0);
+
+        if (stats.category == "layer" && stats.nodeName == "paint1") {
+            hasLayer1 = true;
+        } else if (stats.category == "layer" && stats.nodeName == "paint2") {
+            hasLayer2 = true;
+        } else if (stats.category == "mask" && stats.nodeName == "blur") {
+            QCOMPARE(stats.nodeType, QString("KisFilterMask"));
+            hasMask = true;
+        }
+    }
+
+    QVERIFY(hasLayer1);
+    QVERIFY(hasLayer2);
+    QVERIFY(hasMask);
+
+    const QString fileName = QString(FILES_OUTPUT_DIR) + QDir::separator() + "merge_trace.json";
+    QVERIFY(recorder->saveTrace(fileName));
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    const QJsonArray events = QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+    QCOMPARE(events.size(), recorder->numEvents());
+
+    Q_FOREACH (const QJsonValue &value, events) {
+        const QJsonObject event = value.toObject();
+        QCOMPARE(event["ph"].toString(), QString("X"));
+        QCOMPARE(event["args"].toObject()["walker"].toString(), QString("update"));
+    }
+
+    QVERIFY(!recorder->summary().isEmpty());
+
+    recorder->clear();
+}
+
 QTEST_MAIN(KisAsyncMergerTest)
 
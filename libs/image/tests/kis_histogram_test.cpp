@@ -22,8 +22,15 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoHistogramProducer.h>
+#include <KoBasicHistogramProducers.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpaceMaths.h>
+#include <KoChannelInfo.h>
+#include <KoColor.h>
 #include "kis_paint_device.h"
 #include "kis_histogram.h"
+#include "KisIncrementalHistogram.h"
+#include "kis_iterator_ng.h"
 #include "kis_paint_layer.h"
 #include "kis_types.h"
 #include "kistest.h"
@@ -46,5 +53,252 @@ void KisHistogramTest::testCreation()
     }
 }
 
+namespace {
+
+void fillRandomPixels(KisPaintDeviceSP dev, const QRect &rc)
+{
+    const KoColorSpace *cs = dev->colorSpace();
+    const bool isFloat = cs->colorDepthId() == Float32BitsColorDepthID;
+    const int numChannels = cs->channelCount();
+
+    qsrand(12345);
+
+    KisSequentialIterator it(dev, rc);
+    while (it.nextPixel()) {
+        if (isFloat) {
+            float *pixel = reinterpret_cast<float*>(it.rawData());
+            for (int i = 0; i < numChannels; i++) {
+                // some of the values are out of the view
+                pixel[i] = (qrand() % 1400) / 1000.0f - 0.2f;
+            }
+        } else {
+            quint8 *pixel = it.rawData();
+            for (quint32 i = 0; i < cs->pixelSize(); i++) {
+                pixel[i] = qrand() & 0xff;
+            }
+        }
+
+        // a lot of transparent pixels, which are skipped by default
+        if (qrand() % 4 == 0) {
+            cs->setOpacity(it.rawData(), OPACITY_TRANSPARENT_U8, 1);
+        }
+    }
+}
+
+/**
+ * Counts the pixels without the producers, the bins of the
+ * channels are in the order of KoColorSpace::channels()
+ */
+QVector<QVector<quint32>> referenceBins(KisPaintDeviceSP dev, const QRect &rc, quint32 *count)
+{
+    const KoColorSpace *cs = dev->colorSpace();
+    QList<KoChannelInfo*> channels = cs->channels();
+
+    QVector<QVector<quint32>> bins(channels.size());
+    for (int i = 0; i < bins.size(); i++) {
+        // two extra bins for the values out of the view
+        bins[i].fill(0, 258);
+    }
+    *count = 0;
+
+    KisSequentialConstIterator it(dev, rc);
+    while (it.nextPixel()) {
+        const quint8 *pixel = it.oldRawData();
+        if (cs->opacityU8(pixel) == OPACITY_TRANSPARENT_U8) continue;
+
+        for (int i = 0; i < channels.size(); i++) {
+            const quint8 *channel = pixel + channels[i]->pos();
+            int bin = 0;
+
+            if (cs->colorDepthId() == Integer8BitsColorDepthID) {
+                bin = *channel;
+            } else if (cs->colorDepthId() == Integer16BitsColorDepthID) {
+                bin = static_cast<quint8>(*reinterpret_cast<const quint16*>(channel) * (255.0 / 65535.0));
+            } else {
+                const float value = *reinterpret_cast<const float*>(channel);
+                bin = value < 0.0f ? 256 : value > 1.0f ? 257 : static_cast<quint8>(value * 255.0f);
+            }
+
+            bins[i][bin]++;
+        }
+        (*count)++;
+    }
+
+    return bins;
+}
+
+void compareBins(const QVector<QVector<quint32>> &reference, quint32 referenceCount,
+                 KoHistogramProducer *producer)
+{
+    QCOMPARE(producer->channels().size(), reference.size());
+    QCOMPARE((quint32)producer->count(), referenceCount);
+
+    for (int i = 0; i < reference.size(); i++) {
+        for (int j = 0; j < 256; j++) {
+            QCOMPARE((quint32)producer->getBinAt(i, j), reference[i][j]);
+        }
+        QCOMPARE((quint32)producer->outOfViewLeft(i), reference[i][256]);
+        QCOMPARE((quint32)producer->outOfViewRight(i), reference[i][257]);
+    }
+}
+
+void compareBins(const QVector<QVector<quint32>> &reference, quint32 referenceCount,
+                 const KisIncrementalHistogram &histogram)
+{
+    QCOMPARE(histogram.channelCount(), reference.size());
+    QCOMPARE(histogram.count(), referenceCount);
+
+    for (int i = 0; i < reference.size(); i++) {
+        for (int j = 0; j < 256; j++) {
+            QCOMPARE(histogram.binAt(i, j), reference[i][j]);
+        }
+        QCOMPARE(histogram.outOfViewLeft(i), reference[i][256]);
+        QCOMPARE(histogram.outOfViewRight(i), reference[i][257]);
+    }
+}
+
+KoHistogramProducer *createProducer(const KoColorSpace *cs)
+{
+    const KoID id("TESTHISTO", "Test Histogram");
+
+    if (cs->colorDepthId() == Integer8BitsColorDepthID) {
+        return new KoBasicU8HistogramProducer(id, cs);
+    } else if (cs->colorDepthId() == Integer16BitsColorDepthID) {
+        return new KoBasicU16HistogramProducer(id, cs);
+    }
+
+    return new KoBasicF32HistogramProducer(id, cs);
+}
+
+}
+
+void KisHistogramTest::testOptimizedProducers_data()
+{
+    QTest::addColumn<QString>("modelId");
+    QTest::addColumn<QString>("depthId");
+
+    QTest::newRow("rgba8") << RGBAColorModelID.id() << Integer8BitsColorDepthID.id();
+    QTest::newRow("rgba16") << RGBAColorModelID.id() << Integer16BitsColorDepthID.id();
+    QTest::newRow("rgba32f") << RGBAColorModelID.id() << Float32BitsColorDepthID.id();
+    QTest::newRow("graya8") << GrayAColorModelID.id() << Integer8BitsColorDepthID.id();
+    QTest::newRow("graya16") << GrayAColorModelID.id() << Integer16BitsColorDepthID.id();
+    QTest::newRow("graya32f") << GrayAColorModelID.id() << Float32BitsColorDepthID.id();
+}
+
+void KisHistogramTest::testOptimizedProducers()
+{
+    QFETCH(QString, modelId);
+    QFETCH(QString, depthId);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(modelId, depthId, QString());
+    QVERIFY(cs);
+
+    // several update patches with partial ones at the edges
+    const QRect rc(13, 7, 1300, 900);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    fillRandomPixels(dev, rc);
+
+    quint32 referenceCount = 0;
+    QVector<QVector<quint32>> reference = referenceBins(dev, rc, &referenceCount);
+
+    // the whole rect in a single thread
+    {
+        QScopedPointer<KoHistogramProducer> producer(createProducer(cs));
+
+        KisSequentialConstIterator it(dev, rc);
+        int numConseqPixels = it.nConseqPixels();
+        while (it.nextPixels(numConseqPixels)) {
+            numConseqPixels = it.nConseqPixels();
+            producer->addRegionToBin(it.oldRawData(), 0, numConseqPixels, cs);
+        }
+
+        compareBins(reference, referenceCount, producer.data());
+    }
+
+    // in parallel with the merged copies of the producer
+    {
+        KoHistogramProducer *producer = createProducer(cs);
+        KisHistogram histogram(dev, rc, producer, LINEAR);
+
+        compareBins(reference, referenceCount, producer);
+    }
+}
+
+void KisHistogramTest::testIncrementalHistogram()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(0, 0, 1000, 700);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    fillRandomPixels(dev, rc);
+
+    KisIncrementalHistogram histogram(dev, rc, createProducer(cs));
+    QVERIFY(histogram.hasDirtyCells());
+
+    histogram.update();
+    QVERIFY(!histogram.hasDirtyCells());
+
+    quint32 referenceCount = 0;
+    QVector<QVector<quint32>> reference = referenceBins(dev, rc, &referenceCount);
+    compareBins(reference, referenceCount, histogram);
+
+    // a change crossing the borders of the cells
+    const QRect dirtyRect(200, 100, 150, 300);
+    dev->fill(dirtyRect, KoColor(Qt::red, cs));
+    histogram.addDirtyRect(dirtyRect);
+
+    // the part out of the bounds is ignored
+    histogram.addDirtyRect(QRect(-100, -100, 50, 50));
+
+    QVERIFY(histogram.hasDirtyCells());
+    histogram.update();
+
+    reference = referenceBins(dev, rc, &referenceCount);
+    compareBins(reference, referenceCount, histogram);
+}
+
+void KisHistogramTest::testIncrementalHistogramSnapshot()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(0, 0, 1000, 700);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    fillRandomPixels(dev, rc);
+
+    KisIncrementalHistogram histogram(dev, rc, createProducer(cs));
+    histogram.update();
+
+    const QRect dirtyRect1(200, 100, 30, 30);
+    dev->fill(dirtyRect1, KoColor(Qt::red, cs));
+    histogram.addDirtyRect(dirtyRect1);
+
+    // the cells are taken at the moment the snapshot is created...
+    const QVector<int> dirtyCells = histogram.takeDirtyCells();
+    QVERIFY(!dirtyCells.isEmpty());
+    QVERIFY(!histogram.hasDirtyCells());
+
+    KisPaintDeviceSP snapshot = new KisPaintDevice(cs);
+    snapshot->makeCloneFrom(dev, rc);
+
+    // ...so a change of the same cell arriving after that...
+    const QRect dirtyRect2(210, 110, 30, 30);
+    dev->fill(dirtyRect2, KoColor(Qt::green, cs));
+    histogram.addDirtyRect(dirtyRect2);
+
+    histogram.update(dirtyCells, snapshot);
+
+    quint32 referenceCount = 0;
+    QVector<QVector<quint32>> reference = referenceBins(snapshot, rc, &referenceCount);
+    compareBins(reference, referenceCount, histogram);
+
+    // ...is not lost, but is left for the next update
+    QVERIFY(histogram.hasDirtyCells());
+    histogram.update();
+    QVERIFY(!histogram.hasDirtyCells());
+
+    reference = referenceBins(dev, rc, &referenceCount);
+    compareBins(reference, referenceCount, histogram);
+}
 
 KISTEST_MAIN(KisHistogramTest)
@@ -27,6 +27,10 @@ class KisHistogramTest : public QObject
 private Q_SLOTS:
 
     void testCreation();
+    void testOptimizedProducers_data();
+    void testOptimizedProducers();
+    void testIncrementalHistogram();
+    void testIncrementalHistogramSnapshot();
 
 };
 
@@ -838,6 +838,64 @@ void KisPaintDeviceTest::testExactBoundsNonTransparent()
     QCOMPARE(dev->nonDefaultPixelArea(), QRect(-1,-1,1002,1002));
 }
 
+KisPaintDeviceSP createWrapAroundPaintDevice(const KoColorSpace *cs);
+
+void KisPaintDeviceTest::testExactBoundsTileCache()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const KoColor white(Qt::white, cs);
+
+    dev->fill(QRect(10,10,10,10), white);
+    QCOMPARE(dev->exactBounds(), QRect(10,10,10,10));
+
+    // the cached rect of the tile should be dropped on write
+    dev->setPixel(25, 12, white);
+    QCOMPARE(dev->exactBounds(), QRect(10,10,16,10));
+
+    dev->clear(QRect(10,10,10,10));
+    QCOMPARE(dev->exactBounds(), QRect(25,12,1,1));
+    QCOMPARE(dev->nonDefaultPixelArea(), QRect(25,12,1,1));
+
+    // the tiles compare themselves against the default pixel
+    const QRect tileRect(0, 0, KisTileData::WIDTH, KisTileData::HEIGHT);
+
+    dev->setDefaultPixel(white);
+    QCOMPARE(dev->nonDefaultPixelArea(), tileRect);
+
+    dev->setDefaultPixel(KoColor(Qt::transparent, cs));
+    QCOMPARE(dev->nonDefaultPixelArea(), QRect(25,12,1,1));
+
+    // a copy of the device starts with its own cache
+    KisPaintDeviceSP copy = new KisPaintDevice(*dev);
+    copy->setPixel(3, 4, white);
+    QCOMPARE(copy->exactBounds(), QRect(3,4,23,9));
+    QCOMPARE(dev->exactBounds(), QRect(25,12,1,1));
+
+    // the cached rects are in the coordinates of the data manager
+    dev->moveTo(13, 7);
+    QCOMPARE(dev->exactBounds(), QRect(38,19,1,1));
+    QCOMPARE(dev->nonDefaultPixelArea(), QRect(38,19,1,1));
+
+    dev->setX(-5);
+    QCOMPARE(dev->exactBounds(), QRect(20,19,1,1));
+
+    // the wrap-around mode shows a part of the data only
+    KisPaintDeviceSP wrapped = createWrapAroundPaintDevice(cs);
+    wrapped->setPixel(3, 3, white);
+    wrapped->setPixel(18, 18, white);
+    QCOMPARE(wrapped->exactBounds(), QRect(3,3,16,16));
+
+    KisPaintDeviceSP clipped = new KisPaintDevice(cs);
+    clipped->setPixel(3, 3, white);
+    clipped->fill(QRect(30,30,5,5), white);
+    QCOMPARE(clipped->exactBounds(), QRect(3,3,32,32));
+
+    clipped->setDefaultBounds(wrapped->defaultBounds());
+    QCOMPARE(clipped->exactBounds(), QRect(3,3,1,1));
+}
+
 KisPaintDeviceSP createWrapAroundPaintDevice(const KoColorSpace *cs)
 {
     struct TestingDefaultBounds : public KisDefaultBoundsBase {
@@ -52,6 +52,7 @@ private Q_SLOTS:
     void testAmortizedExactBounds();
     void testNonDefaultPixelArea();
     void testExactBoundsNonTransparent();
+    void testExactBoundsTileCache();
 
     void testReadBytesWrapAround();
     void testWrappedRandomAccessor();
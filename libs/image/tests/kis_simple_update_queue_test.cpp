@@ -32,9 +32,12 @@
 
 #include "kis_update_job_item.h"
 #include "kis_simple_update_queue.h"
+#include "kis_image_config.h"
+#include "KisUpdateCostModel.h"
 #include "scheduler_utils.h"
 
 #include "lod_override.h"
+#include "image_config_override.h"
 
 
 
@@ -149,6 +152,197 @@ void KisSimpleUpdateQueueTest::testSplit(bool useFullRefresh)
     QVERIFY(checkWalker(walkersList[3], QRect(512,512,488,488)));
 }
 
+void KisSimpleUpdateQueueTest::testSplitLongStrip()
+{
+    QRect imageRect(0,0,2048,1024);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    KisTestableSimpleUpdateQueue queue;
+    KisWalkersList& walkersList = queue.getWalkersList();
+
+    // a short strip is not split
+    queue.addUpdateJob(paintLayer, QRect(0,0,640,100), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), 1);
+    QVERIFY(checkWalker(walkersList[0], QRect(0,0,640,100)));
+
+    walkersList.clear();
+
+    // a long strip is split into patches along its length only
+    queue.addUpdateJob(paintLayer, QRect(100,500,1800,100), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), 4);
+    QVERIFY(checkWalker(walkersList[0], QRect(100,500,412,100)));
+    QVERIFY(checkWalker(walkersList[1], QRect(512,500,512,100)));
+    QVERIFY(checkWalker(walkersList[2], QRect(1024,500,512,100)));
+    QVERIFY(checkWalker(walkersList[3], QRect(1536,500,364,100)));
+}
+
+void KisSimpleUpdateQueueTest::testPriorityRects()
+{
+    KisTestableUpdaterContext context(1);
+
+    QRect imageRect(0,0,200,200);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    QRect dirtyRect1(0,0,50,50);
+    QRect dirtyRect2(150,150,50,50);
+
+    KisTestableSimpleUpdateQueue queue;
+
+    queue.addUpdateJob(paintLayer, dirtyRect1, imageRect, 0);
+    queue.addUpdateJob(paintLayer, dirtyRect2, imageRect, 0);
+
+    // the visible job goes first
+    queue.setPriorityRects({QRect(100,100,100,100)});
+    queue.processQueue(context);
+
+    QVector<KisUpdateJobItem*> jobs = context.getJobs();
+    QVERIFY(checkWalker(jobs[0]->walker(), dirtyRect2));
+    context.clear();
+
+    // nothing is visible, the rest is processed in the usual order
+    queue.processQueue(context);
+
+    jobs = context.getJobs();
+    QVERIFY(checkWalker(jobs[0]->walker(), dirtyRect1));
+    context.clear();
+
+    QVERIFY(queue.isEmpty());
+}
+
+void KisSimpleUpdateQueueTest::testPriorityRectsStarvation()
+{
+    KisTestableUpdaterContext context(1);
+
+    QRect imageRect(0,0,200,200);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    QRect hiddenRect(0,0,50,50);
+    QRect visibleRect(150,150,50,50);
+
+    KisTestableSimpleUpdateQueue queue;
+    queue.setPriorityRects({QRect(100,100,100,100)});
+
+    queue.addUpdateJob(paintLayer, hiddenRect, imageRect, 0);
+
+    /**
+     * A stroke in the viewport keeps adding visible jobs,
+     * the hidden one should still get through at some point
+     */
+    int numVisibleJobs = 0;
+    bool hiddenJobStarted = false;
+
+    for (int i = 0; i < 100 && !hiddenJobStarted; i++) {
+        queue.addUpdateJob(paintLayer, visibleRect, imageRect, 0);
+        queue.processQueue(context);
+
+        QVector<KisUpdateJobItem*> jobs = context.getJobs();
+        if (checkWalker(jobs[0]->walker(), hiddenRect)) {
+            hiddenJobStarted = true;
+        } else {
+            QVERIFY(checkWalker(jobs[0]->walker(), visibleRect));
+            numVisibleJobs++;
+        }
+        context.clear();
+    }
+
+    QVERIFY(hiddenJobStarted);
+    QVERIFY(numVisibleJobs > 0);
+}
+
+void KisSimpleUpdateQueueTest::testCostModel()
+{
+    KisUpdateCostModel model;
+
+    // two rects in the same tile are merged for free
+    {
+        QRect baseRect(10,10,20,20);
+        QVERIFY(model.tryJoinRects(baseRect, QRect(30,10,20,20), 3));
+        QCOMPARE(baseRect, QRect(10,10,40,20));
+    }
+
+    // distant rects are not worth merging
+    {
+        QRect baseRect(10,10,20,20);
+        QVERIFY(!model.tryJoinRects(baseRect, QRect(400,400,20,20), 3));
+        QCOMPARE(baseRect, QRect(10,10,20,20));
+    }
+
+    // the model learns the actual costs
+    for (int i = 0; i < 64; i++) {
+        const QRect rc(0, 0, 64 * (1 + i % 32), 64);
+        const qint64 workload = rc.width() * rc.height();
+
+        model.addSample(rc, 1, 20000 + 3 * workload);
+    }
+
+    QVERIFY(qAbs(model.overhead() - 20000) < 1);
+    QVERIFY(qAbs(model.pixelCost() - 3) < 1e-3);
+    QVERIFY(qAbs(model.estimate(QRect(0,0,128,128), 2) - (20000 + 3 * 128 * 128 * 2)) < 10);
+
+    model.reset();
+    QVERIFY(qAbs(model.pixelCost() - 3) > 0.5);
+}
+
+void KisSimpleUpdateQueueTest::testAdaptiveCoalescing()
+{
+    QRect imageRect(0,0,1024,1024);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    TestUtil::ImageConfigOverride<bool> adaptiveOverride(&KisImageConfig::adaptiveUpdatesCoalescing,
+                                                         &KisImageConfig::setAdaptiveUpdatesCoalescing,
+                                                         true);
+
+    KisTestableSimpleUpdateQueue queue;
+    KisWalkersList& walkersList = queue.getWalkersList();
+
+    // small dabs, two of them are in the same tile
+    queue.addUpdateJob(paintLayer, QRect(10,10,20,20), imageRect, 0);
+    queue.addUpdateJob(paintLayer, QRect(400,400,20,20), imageRect, 0);
+    queue.addUpdateJob(paintLayer, QRect(35,30,20,20), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), 3);
+
+    queue.optimize();
+
+    QCOMPARE(walkersList.size(), 2);
+    QVERIFY(checkWalker(walkersList[0], QRect(10,10,45,40)));
+    QVERIFY(checkWalker(walkersList[1], QRect(400,400,20,20)));
+}
+
 void KisSimpleUpdateQueueTest::testChecksum()
 {
     QRect imageRect(0,0,512,512);
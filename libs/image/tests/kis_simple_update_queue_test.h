@@ -33,6 +33,11 @@ private Q_SLOTS:
     void testJobProcessing();
     void testSplitUpdate();
     void testSplitFullRefresh();
+    void testSplitLongStrip();
+    void testPriorityRects();
+    void testPriorityRectsStarvation();
+    void testCostModel();
+    void testAdaptiveCoalescing();
     void testChecksum();
     void testMixingTypes();
     void testSpontaneousJobsCompression();
@@ -35,6 +35,8 @@
 #include "kis_updater_context.h"
 #include "kis_update_job_item.h"
 #include "kis_simple_update_queue.h"
+#include "kis_merge_walker.h"
+#include "KisUpdateCostModel.h"
 
 #include "../../sdk/tests/testutil.h"
 
@@ -427,5 +429,39 @@ void KisUpdateSchedulerTest::testLodSync()
     image->waitForDone();
 }
 
+void KisUpdateSchedulerTest::testMergeJobCostSamples()
+{
+    KisImageSP image = buildTestingImage();
+    KisNodeSP rootLayer = image->root();
+    KisNodeSP paintLayer1 = rootLayer->firstChild();
+
+    QCOMPARE(paintLayer1->name(), QString("paint1"));
+
+    const QRect dirtyRect(0, 0, 32, 32);
+
+    KisMergeWalker walker(image->bounds());
+    walker.collectRects(paintLayer1, dirtyRect);
+    const int expectedNumNodes = walker.leafStack().size();
+    QVERIFY(expectedNumNodes > 1);
+
+    KisTestableUpdateScheduler scheduler(image.data(), 2);
+    const KisUpdateCostModel &costModel = scheduler.updatesCostModel();
+    QCOMPARE(costModel.numSamples(), 0);
+
+    /**
+     * The rects are far from each other, so they are not coalesced
+     * and every one of them is executed by a separate merge job
+     */
+    for (int i = 0; i < 8; i++) {
+        scheduler.updateProjection(paintLayer1,
+                                   dirtyRect.translated(i * 2 * dirtyRect.width(), 0),
+                                   image->bounds());
+        scheduler.waitForDone();
+    }
+
+    QVERIFY(costModel.numSamples() > 0);
+    QVERIFY(qFuzzyCompare(costModel.meanNumNodes(), qreal(expectedNumNodes)));
+}
+
 QTEST_MAIN(KisUpdateSchedulerTest)
 
@@ -42,6 +42,8 @@ private Q_SLOTS:
     void testTimeMonitor();
 
     void testLodSync();
+
+    void testMergeJobCostSamples();
 };
 
 #endif /* KIS_UPDATE_SCHEDULER_TEST_H */
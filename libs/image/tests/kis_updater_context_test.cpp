@@ -27,6 +27,7 @@
 
 #include "kis_merge_walker.h"
 #include "kis_updater_context.h"
+#include "kis_update_job_item.h"
 #include "kis_image.h"
 
 #include "scheduler_utils.h"
@@ -165,6 +166,85 @@ void KisUpdaterContextTest::testSnapshot()
     }
 }
 
+void KisUpdaterContextTest::testLocalQueues()
+{
+    KisTestableUpdaterContext context(2);
+    context.setLocalQueueSize(1);
+
+    QRect imageRect(0,0,300,100);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    KisBaseRectsWalkerSP walker1 = new KisMergeWalker(imageRect);
+    walker1->collectRects(paintLayer, QRect(0,0,50,100));
+
+    KisBaseRectsWalkerSP walker2 = new KisMergeWalker(imageRect);
+    walker2->collectRects(paintLayer, QRect(100,0,50,100));
+
+    KisBaseRectsWalkerSP walker3 = new KisMergeWalker(imageRect);
+    walker3->collectRects(paintLayer, QRect(200,0,50,100));
+
+    qint32 numMergeJobs = -777;
+    qint32 numStrokeJobs = -777;
+
+    context.lock();
+
+    QVERIFY(!context.hasSpareLocalQueueSlot());
+
+    context.addMergeJob(walker1);
+    context.addMergeJob(walker2);
+
+    QVERIFY(!context.hasSpareThread());
+    QVERIFY(context.hasSpareLocalQueueSlot());
+    QVERIFY(context.isJobAllowed(walker3));
+
+    context.addMergeJobToLocalQueue(walker3);
+
+    context.getJobsSnapshot(numMergeJobs, numStrokeJobs);
+    QCOMPARE(numMergeJobs, 3);
+    QCOMPARE(numStrokeJobs, 0);
+    QVERIFY(context.getContextSnapshotEx() & HasMergeJob);
+
+    // the queued job must block the overlapping ones
+    {
+        KisBaseRectsWalkerSP walker = new KisMergeWalker(imageRect);
+        walker->collectRects(paintLayer, QRect(220,0,50,100));
+        QVERIFY(!context.isJobAllowed(walker));
+    }
+
+    context.unlock();
+
+    QVector<KisUpdateJobItem*> jobs = context.getJobs();
+
+    // the job is queued into the first thread, so the second
+    // thread should steal it when it has nothing to do
+    jobs[1]->testingSetDone();
+    context.takeLocalMergeJob(jobs[1]);
+
+    QCOMPARE(jobs[1]->type(), KisUpdateJobItem::Type::MERGE);
+    QCOMPARE(jobs[1]->changeRect(), walker3->changeRect());
+
+    context.lock();
+    context.getJobsSnapshot(numMergeJobs, numStrokeJobs);
+    QCOMPARE(numMergeJobs, 2);
+    QCOMPARE(numStrokeJobs, 0);
+    context.unlock();
+
+    // nothing is left in the queues
+    jobs[0]->testingSetDone();
+    context.takeLocalMergeJob(jobs[0]);
+    QCOMPARE(jobs[0]->type(), KisUpdateJobItem::Type::WAITING);
+
+    context.clear();
+}
+
 #define NUM_THREADS 10
 #ifdef LIMIT_LONG_TESTS
 #   define NUM_JOBS 60
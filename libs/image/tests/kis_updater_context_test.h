@@ -28,6 +28,7 @@ class KisUpdaterContextTest : public QObject
 private Q_SLOTS:
     void testJobInterference();
     void testSnapshot();
+    void testLocalQueues();
     void stressTestExclusiveJobs();
 };
 
@@ -0,0 +1,467 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTileDataArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include <QDir>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QGlobalStatic>
+
+#include <kis_debug.h>
+#include "kis_image_config.h"
+#include "kis_tile_data_interface.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+const int NUM_SIZE_CLASSES = 4;
+const int classPixelSizes[NUM_SIZE_CLASSES] = {1, 4, 8, 16};
+
+const int MAX_NUMA_NODES = 8;
+
+const qint64 SLAB_SIZE = 4 * 1024 * 1024; // 4 MiB
+const int MIN_BLOCKS_PER_SLAB = 4;
+
+// memory kept in the cache of every thread, per size class
+const qint64 THREAD_CACHE_SIZE = 1024 * 1024; // 1 MiB
+const int MAX_CACHED_BLOCKS = 64;
+
+const int LATENCY_SAMPLING_RATE = 64;
+
+inline int sizeClass(int pixelSize)
+{
+    switch (pixelSize) {
+    case 1:
+        return 0;
+    case 4:
+        return 1;
+    case 8:
+        return 2;
+    case 16:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+int detectNumaNodes()
+{
+    int numNodes = 1;
+
+#ifdef Q_OS_LINUX
+    QDir dir("/sys/devices/system/node");
+    numNodes = dir.entryList(QStringList() << "node*", QDir::Dirs).size();
+#endif
+
+    return qBound(1, numNodes, MAX_NUMA_NODES);
+}
+
+int currentNumaNode()
+{
+#if defined(Q_OS_LINUX) && defined(SYS_getcpu)
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+
+    if (!syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+        return node;
+    }
+#endif
+
+    return 0;
+}
+
+quint8* allocateSlab(qint64 size, int node, bool bindToNode)
+{
+#ifdef Q_OS_UNIX
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        warnTiles << "Failed to allocate a slab for tiles:" << size << "bytes";
+        return nullptr;
+    }
+
+#if defined(Q_OS_LINUX) && defined(SYS_mbind)
+    if (bindToNode) {
+        // MPOL_PREFERRED: take the pages from other nodes
+        // when the requested one is out of memory
+        const int mpolPreferred = 1;
+        unsigned long nodeMask = 1UL << node;
+
+        if (syscall(SYS_mbind, ptr, size, mpolPreferred, &nodeMask, sizeof(nodeMask) * 8, 0)) {
+            dbgTiles << "Failed to bind a slab to NUMA node" << node;
+        }
+    }
+#else
+    Q_UNUSED(node);
+    Q_UNUSED(bindToNode);
+#endif
+
+    return static_cast<quint8*>(ptr);
+#else
+    Q_UNUSED(node);
+    Q_UNUSED(bindToNode);
+
+    return static_cast<quint8*>(std::malloc(size));
+#endif
+}
+
+void freeSlab(quint8 *ptr, qint64 size)
+{
+#ifdef Q_OS_UNIX
+    munmap(ptr, size);
+#else
+    Q_UNUSED(size);
+    std::free(ptr);
+#endif
+}
+
+struct Pool {
+    QMutex lock;
+    QVector<quint8*> freeBlocks;
+    QVector<quint8*> slabs;
+};
+
+bool numaAwareFromConfig()
+{
+    KisImageConfig cfg(true);
+    return cfg.numaAwareTileAllocation();
+}
+
+}
+
+Q_GLOBAL_STATIC_WITH_ARGS(KisTileDataArena, s_instance,
+                          (__TILE_DATA_WIDTH * __TILE_DATA_HEIGHT, numaAwareFromConfig(), true))
+
+
+struct KisTileDataArena::Private
+{
+    int numTilePixels = 0;
+    int numNodes = 1;
+    bool useThreadCaches = false;
+
+    Pool pools[MAX_NUMA_NODES][NUM_SIZE_CLASSES];
+
+    /**
+     * Incremented on every purge(). The thread caches having
+     * an older generation contain invalid pointers.
+     */
+    std::atomic<int> generation {0};
+
+    std::atomic<qint64> allocatedSize {0};
+    std::atomic<qint64> usedSize {0};
+    std::atomic<qint64> numSlabs {0};
+
+    std::atomic<qint64> numAllocations {0};
+    std::atomic<qint64> sampledLatency {0};
+    std::atomic<qint64> numSampledAllocations {0};
+
+    qint64 blockSize(int cls) const {
+        return qint64(classPixelSizes[cls]) * numTilePixels;
+    }
+
+    qint64 slabSize(int cls) const {
+        return qMax(SLAB_SIZE, MIN_BLOCKS_PER_SLAB * blockSize(cls));
+    }
+
+    int cacheCapacity(int cls) const {
+        return qBound(2, int(THREAD_CACHE_SIZE / blockSize(cls)), MAX_CACHED_BLOCKS);
+    }
+
+    int node() const {
+        return numNodes > 1 ? currentNumaNode() % numNodes : 0;
+    }
+
+    int takeBlocks(int node, int cls, quint8 **dst, int numBlocks);
+    void returnBlocks(int node, int cls, quint8 **src, int numBlocks);
+    void addSlab(int node, int cls);
+    void purge();
+
+    void addLatencySample(qint64 nsecs) {
+        sampledLatency.fetch_add(nsecs, std::memory_order_relaxed);
+        numSampledAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+void KisTileDataArena::Private::addSlab(int node, int cls)
+{
+    Pool &pool = pools[node][cls];
+
+    const qint64 size = slabSize(cls);
+    quint8 *slab = allocateSlab(size, node, numNodes > 1);
+    if (!slab) return;
+
+    const qint64 step = blockSize(cls);
+    const int numBlocks = size / step;
+
+    pool.slabs.append(slab);
+    pool.freeBlocks.reserve(pool.freeBlocks.size() + numBlocks);
+
+    // the blocks are popped from the back, so push them
+    // in reverse order to give them out sequentially
+    for (int i = numBlocks - 1; i >= 0; i--) {
+        pool.freeBlocks.append(slab + i * step);
+    }
+
+    allocatedSize.fetch_add(size, std::memory_order_relaxed);
+    numSlabs.fetch_add(1, std::memory_order_relaxed);
+}
+
+int KisTileDataArena::Private::takeBlocks(int node, int cls, quint8 **dst, int numBlocks)
+{
+    Pool &pool = pools[node][cls];
+    QMutexLocker l(&pool.lock);
+
+    if (pool.freeBlocks.size() < numBlocks) {
+        addSlab(node, cls);
+    }
+
+    numBlocks = qMin(numBlocks, pool.freeBlocks.size());
+
+    for (int i = 0; i < numBlocks; i++) {
+        dst[i] = pool.freeBlocks.takeLast();
+    }
+
+    usedSize.fetch_add(numBlocks * blockSize(cls), std::memory_order_relaxed);
+
+    return numBlocks;
+}
+
+void KisTileDataArena::Private::returnBlocks(int node, int cls, quint8 **src, int numBlocks)
+{
+    Pool &pool = pools[node][cls];
+    QMutexLocker l(&pool.lock);
+
+    for (int i = 0; i < numBlocks; i++) {
+        pool.freeBlocks.append(src[i]);
+    }
+
+    usedSize.fetch_sub(numBlocks * blockSize(cls), std::memory_order_relaxed);
+}
+
+void KisTileDataArena::Private::purge()
+{
+    generation.fetch_add(1);
+
+    for (int node = 0; node < numNodes; node++) {
+        for (int cls = 0; cls < NUM_SIZE_CLASSES; cls++) {
+            Pool &pool = pools[node][cls];
+            QMutexLocker l(&pool.lock);
+
+            const qint64 size = slabSize(cls);
+
+            Q_FOREACH (quint8 *slab, pool.slabs) {
+                freeSlab(slab, size);
+            }
+
+            allocatedSize.fetch_sub(pool.slabs.size() * size, std::memory_order_relaxed);
+            numSlabs.fetch_sub(pool.slabs.size(), std::memory_order_relaxed);
+
+            pool.slabs.clear();
+            pool.freeBlocks.clear();
+        }
+    }
+
+    usedSize.store(0);
+}
+
+
+/**
+ * The free blocks kept by a thread. The blocks are returned to
+ * the shared pools in batches, when the cache overflows, and on
+ * the thread exit.
+ */
+struct KisTileDataArena::ThreadCache
+{
+    quint8 *blocks[NUM_SIZE_CLASSES][MAX_CACHED_BLOCKS];
+    int count[NUM_SIZE_CLASSES] = {0, 0, 0, 0};
+
+    KisTileDataArena *arena = nullptr;
+    int generation = -1;
+    int node = 0;
+    int numAllocations = 0;
+
+    static ThreadCache& local() {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+
+    ~ThreadCache() {
+        if (arena && !s_instance.isDestroyed()) {
+            flush();
+        }
+    }
+
+    void attach(KisTileDataArena *_arena) {
+        const int currentGeneration = _arena->m_d->generation.load(std::memory_order_relaxed);
+
+        if (arena != _arena || generation != currentGeneration) {
+            // the blocks of the purged slabs are just dropped
+            std::fill(count, count + NUM_SIZE_CLASSES, 0);
+
+            arena = _arena;
+            generation = currentGeneration;
+            node = arena->m_d->node();
+        }
+    }
+
+    void flush() {
+        if (generation != arena->m_d->generation.load()) return;
+
+        for (int cls = 0; cls < NUM_SIZE_CLASSES; cls++) {
+            if (count[cls]) {
+                arena->m_d->returnBlocks(node, cls, blocks[cls], count[cls]);
+                count[cls] = 0;
+            }
+        }
+    }
+};
+
+KisTileDataArena::KisTileDataArena(int numTilePixels, bool numaAware, bool useThreadCaches)
+    : m_d(new Private)
+{
+    m_d->numTilePixels = numTilePixels;
+    m_d->numNodes = numaAware ? detectNumaNodes() : 1;
+    m_d->useThreadCaches = useThreadCaches;
+}
+
+KisTileDataArena::~KisTileDataArena()
+{
+    m_d->purge();
+}
+
+KisTileDataArena* KisTileDataArena::instance()
+{
+    return s_instance;
+}
+
+bool KisTileDataArena::supportsPixelSize(int pixelSize)
+{
+    return sizeClass(pixelSize) >= 0;
+}
+
+quint8* KisTileDataArena::allocate(int pixelSize)
+{
+    const int cls = sizeClass(pixelSize);
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(cls >= 0, nullptr);
+
+    quint8 *ptr = nullptr;
+
+    if (!m_d->useThreadCaches) {
+        const bool sampleLatency =
+            !(m_d->numAllocations.fetch_add(1, std::memory_order_relaxed) % LATENCY_SAMPLING_RATE);
+
+        QElapsedTimer timer;
+        if (sampleLatency) timer.start();
+
+        m_d->takeBlocks(m_d->node(), cls, &ptr, 1);
+
+        if (sampleLatency) m_d->addLatencySample(timer.nsecsElapsed());
+        return ptr;
+    }
+
+    ThreadCache &cache = ThreadCache::local();
+    cache.attach(this);
+
+    const bool sampleLatency = !(cache.numAllocations++ % LATENCY_SAMPLING_RATE);
+
+    QElapsedTimer timer;
+    if (sampleLatency) timer.start();
+
+    if (!cache.count[cls]) {
+        const int newNode = m_d->node();
+        if (newNode != cache.node) {
+            // the thread has been moved to another node
+            cache.flush();
+            cache.node = newNode;
+        }
+
+        cache.count[cls] = m_d->takeBlocks(cache.node, cls, cache.blocks[cls],
+                                           m_d->cacheCapacity(cls) / 2);
+    }
+
+    if (cache.count[cls]) {
+        ptr = cache.blocks[cls][--cache.count[cls]];
+    }
+
+    if (sampleLatency) m_d->addLatencySample(timer.nsecsElapsed());
+
+    return ptr;
+}
+
+void KisTileDataArena::free(quint8 *ptr, int pixelSize)
+{
+    const int cls = sizeClass(pixelSize);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(cls >= 0);
+
+    if (!m_d->useThreadCaches) {
+        m_d->returnBlocks(m_d->node(), cls, &ptr, 1);
+        return;
+    }
+
+    ThreadCache &cache = ThreadCache::local();
+    cache.attach(this);
+
+    const int capacity = m_d->cacheCapacity(cls);
+
+    if (cache.count[cls] >= capacity) {
+        const int numReturned = capacity / 2;
+        cache.count[cls] -= numReturned;
+        m_d->returnBlocks(cache.node, cls, cache.blocks[cls] + cache.count[cls], numReturned);
+    }
+
+    cache.blocks[cls][cache.count[cls]++] = ptr;
+}
+
+void KisTileDataArena::purge()
+{
+    m_d->purge();
+}
+
+KisTileDataArena::Statistics KisTileDataArena::statistics() const
+{
+    Statistics stats;
+
+    stats.allocatedSize = m_d->allocatedSize.load(std::memory_order_relaxed);
+    stats.usedSize = m_d->usedSize.load(std::memory_order_relaxed);
+    stats.numSlabs = m_d->numSlabs.load(std::memory_order_relaxed);
+
+    const qint64 numSamples = m_d->numSampledAllocations.load(std::memory_order_relaxed);
+    stats.averageAllocationLatency =
+        numSamples ? m_d->sampledLatency.load(std::memory_order_relaxed) / numSamples : 0;
+
+    return stats;
+}
+
+int KisTileDataArena::numNumaNodes() const
+{
+    return m_d->numNodes;
+}
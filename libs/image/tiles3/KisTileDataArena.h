@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_DATA_ARENA_H
+#define __KIS_TILE_DATA_ARENA_H
+
+#include <QtGlobal>
+#include <QScopedPointer>
+
+#include "kritaimage_export.h"
+
+/**
+ * A slab allocator for the pixel buffers of the tiles.
+ *
+ * The buffers are cut out of big slabs, one set of slabs per
+ * supported pixel size (1, 4, 8 and 16 bytes), so the tiles of
+ * one device stay close to each other in memory and the system
+ * allocator does not get fragmented by them.
+ *
+ * Every thread keeps a small cache of free buffers, so the
+ * allocation and deallocation of a buffer usually does not touch
+ * any shared memory. The buffers are moved between the thread
+ * caches and the shared pools in batches.
+ *
+ * When NUMA-aware allocation is enabled (see
+ * KisImageConfig::numaAwareTileAllocation()), there is a separate
+ * set of pools for every NUMA node, and the slabs are bound to the
+ * node of the thread that requested them. This is supported on
+ * Linux only.
+ */
+class KRITAIMAGE_EXPORT KisTileDataArena
+{
+public:
+    struct Statistics
+    {
+        /// memory reserved by the slabs
+        qint64 allocatedSize = 0;
+
+        /// memory given out to the tiles, including
+        /// the buffers kept in the thread caches
+        qint64 usedSize = 0;
+
+        qint64 numSlabs = 0;
+
+        /// an average over a sample of the allocations
+        qint64 averageAllocationLatency = 0; // in nanoseconds
+
+        /// the share of the reserved memory that is not used
+        qreal fragmentation() const {
+            return allocatedSize ? qreal(allocatedSize - usedSize) / allocatedSize : 0.0;
+        }
+    };
+
+public:
+    /**
+     * \p useThreadCaches should be set for the global instance only
+     */
+    KisTileDataArena(int numTilePixels, bool numaAware, bool useThreadCaches);
+    ~KisTileDataArena();
+
+    static KisTileDataArena* instance();
+
+    static bool supportsPixelSize(int pixelSize);
+
+    quint8* allocate(int pixelSize);
+    void free(quint8 *ptr, int pixelSize);
+
+    /**
+     * Returns all the slabs to the system. All the buffers given
+     * out by the arena become invalid, so the caller should copy
+     * them out beforehand. Works the same way as
+     * boost::pool<>::purge_memory().
+     */
+    void purge();
+
+    Statistics statistics() const;
+
+    int numNumaNodes() const;
+
+private:
+    struct ThreadCache;
+    friend struct ThreadCache;
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_TILE_DATA_ARENA_H */
@@ -0,0 +1,200 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisTileDeltaStore.h"
+
+#include <cstring>
+
+#include <kis_debug.h>
+
+#include "kis_tile_data.h"
+#include "kis_image_config.h"
+#include "swap/kis_tile_compressor_2.h"
+
+/**
+ * A delta that doesn't save at least a half of the tile is not
+ * worth the time spent on decoding it. Such tiles are left to
+ * the swapper.
+ */
+#define MAX_DELTA_RATIO 2
+
+namespace {
+
+inline void xorData(const quint8 *src1, const quint8 *src2, quint8 *dst, int size)
+{
+    int i = 0;
+
+    for (; i + int(sizeof(quint64)) <= size; i += sizeof(quint64)) {
+        quint64 a, b;
+        memcpy(&a, src1 + i, sizeof(quint64));
+        memcpy(&b, src2 + i, sizeof(quint64));
+        a ^= b;
+        memcpy(dst + i, &a, sizeof(quint64));
+    }
+
+    for (; i < size; i++) {
+        dst[i] = src1[i] ^ src2[i];
+    }
+}
+
+}
+
+KisTileDeltaStore::KisTileDeltaStore()
+    : m_compressor(0),
+      m_numTiles(0),
+      m_memorySize(0),
+      m_memoryMetric(0)
+{
+    testingRereadConfig();
+}
+
+KisTileDeltaStore::~KisTileDeltaStore()
+{
+    delete m_compressor;
+}
+
+bool KisTileDeltaStore::isEnabled() const
+{
+    return m_enabled;
+}
+
+int KisTileDeltaStore::numTiles() const
+{
+    return m_numTiles;
+}
+
+qint64 KisTileDeltaStore::totalMemorySize() const
+{
+    return m_memorySize;
+}
+
+qint64 KisTileDeltaStore::totalMemoryMetric() const
+{
+    return m_memoryMetric;
+}
+
+void KisTileDeltaStore::prepareBuffers(int dataSize)
+{
+    if (m_xorBuffer.size() < dataSize) {
+        m_xorBuffer.resize(dataSize);
+    }
+
+    if (m_compressionBuffer.size() < dataSize + 1) {
+        m_compressionBuffer.resize(dataSize + 1);
+    }
+}
+
+bool KisTileDeltaStore::tryEncodeTileData(KisTileData *td, KisTileData *base)
+{
+    Q_ASSERT(td->data());
+    Q_ASSERT(base->data());
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(td->pixelSize() == base->pixelSize(), false);
+
+    QMutexLocker locker(&m_lock);
+
+    const int pixelSize = td->pixelSize();
+    const int dataSize = pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    prepareBuffers(dataSize);
+
+    quint8 *xorBuffer = (quint8*)m_xorBuffer.data();
+    xorData(td->data(), base->data(), xorBuffer, dataSize);
+
+    qint32 bytesWritten = 0;
+    m_compressor->compressData(xorBuffer, dataSize, pixelSize,
+                               (quint8*)m_compressionBuffer.data(), bytesWritten);
+
+    if (bytesWritten * MAX_DELTA_RATIO > dataSize) {
+        return false;
+    }
+
+    base->ref();
+    td->setDelta(base, QByteArray(m_compressionBuffer.constData(), bytesWritten));
+    td->releaseMemory();
+
+    m_numTiles++;
+    m_memorySize += bytesWritten;
+    m_memoryMetric += pixelSize;
+
+    return true;
+}
+
+KisTileData* KisTileDeltaStore::decodeTileData(KisTileData *td)
+{
+    Q_ASSERT(!td->data());
+    QMutexLocker locker(&m_lock);
+
+    QByteArray delta;
+    KisTileData *base = td->takeDelta(delta);
+
+    const int pixelSize = td->pixelSize();
+    const int dataSize = pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    td->allocateMemory();
+
+    KIS_SAFE_ASSERT_RECOVER(base && base->data()) {
+        memset(td->data(), 0, dataSize);
+        return base;
+    }
+
+    const bool result =
+        m_compressor->decompressData((quint8*)delta.data(), delta.size(),
+                                     td->data(), dataSize, pixelSize);
+    KIS_SAFE_ASSERT_RECOVER_NOOP(result);
+
+    xorData(td->data(), base->data(), td->data(), dataSize);
+
+    m_numTiles--;
+    m_memorySize -= delta.size();
+    m_memoryMetric -= pixelSize;
+
+    return base;
+}
+
+KisTileData* KisTileDeltaStore::forgetTileData(KisTileData *td)
+{
+    QMutexLocker locker(&m_lock);
+
+    QByteArray delta;
+    KisTileData *base = td->takeDelta(delta);
+
+    if (base) {
+        m_numTiles--;
+        m_memorySize -= delta.size();
+        m_memoryMetric -= td->pixelSize();
+    }
+
+    return base;
+}
+
+void KisTileDeltaStore::testingRereadConfig()
+{
+    QMutexLocker locker(&m_lock);
+
+    KisImageConfig config(true);
+    m_enabled = config.deltaHistoryCompression();
+
+    /**
+     * The deltas are never written to disk, so any codec can be
+     * used. The fastest one is preferred, the tiles are decoded
+     * in the GUI thread on undo.
+     */
+    delete m_compressor;
+    m_compressor = new KisTileCompressor2(KisTileCompressor2::compressionTypeFromName("LZ4"));
+}
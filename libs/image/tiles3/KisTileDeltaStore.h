@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_TILE_DELTA_STORE_H
+#define __KIS_TILE_DELTA_STORE_H
+
+#include "kritaimage_export.h"
+
+#include <QMutex>
+#include <QByteArray>
+
+class KisTileData;
+class KisTileCompressor2;
+
+/**
+ * Keeps the historical tile data objects as compressed differences
+ * against the newer versions of the same tiles.
+ *
+ * When a transaction is committed, the previous version of a changed
+ * tile usually differs from the new one in a few pixels only (the
+ * area covered by a stroke). The store XORs the two versions, so the
+ * unchanged pixels become zeros, and compresses the result with one
+ * of the swap codecs. The full data is restored lazily, when someone
+ * accesses the tile data, e.g. on undo.
+ *
+ * The base of a delta is referenced by the tile data and is shared
+ * by at least one more user (the memento item of the newer version),
+ * so it is never changed in place: any write to it goes through COW.
+ * The base may itself be stored as a delta, swapped out or uniform.
+ * The caller is responsible for loading it before decoding.
+ */
+class KRITAIMAGE_EXPORT KisTileDeltaStore
+{
+public:
+    KisTileDeltaStore();
+    ~KisTileDeltaStore();
+
+    /**
+     * Returns false if the delta compression of the history is
+     * disabled in the config
+     */
+    bool isEnabled() const;
+
+    /**
+     * Returns number of tile data objects stored as deltas
+     */
+    int numTiles() const;
+
+    /**
+     * Returns the size of the compressed deltas in bytes
+     */
+    qint64 totalMemorySize() const;
+
+    /**
+     * Returns the metric of the tiles stored as deltas
+     * in *uncompressed* form
+     */
+    qint64 totalMemoryMetric() const;
+
+    /**
+     * Encodes the data of \p td as a difference against \p base and
+     * frees the memory occupied by td->data(). Fails if the delta
+     * doesn't compress well enough.
+     * LOCKING: the swap lock of \p td should be taken for write and
+     *          the data of \p base should be present and locked
+     *          by the caller
+     */
+    bool tryEncodeTileData(KisTileData *td, KisTileData *base);
+
+    /**
+     * Restores the data of \p td from its delta. Returns the base of
+     * the delta, which is not referenced by \p td anymore. The
+     * caller should deref it when no store locks are held.
+     * LOCKING: the swap lock of \p td should be taken for write and
+     *          the data of the base should be present and locked
+     *          by the caller
+     */
+    KisTileData* decodeTileData(KisTileData *td);
+
+    /**
+     * Forgets the delta of \p td before it is deleted. Returns the
+     * base of the delta, which should be dereffed by the caller the
+     * same way as in decodeTileData()
+     */
+    KisTileData* forgetTileData(KisTileData *td);
+
+    /**
+     * Rereads the settings from the config
+     */
+    void testingRereadConfig();
+
+private:
+    void prepareBuffers(int dataSize);
+
+private:
+    KisTileCompressor2 *m_compressor;
+
+    QByteArray m_xorBuffer;
+    QByteArray m_compressionBuffer;
+
+    QMutex m_lock;
+
+    bool m_enabled;
+    int m_numTiles;
+    qint64 m_memorySize;
+    qint64 m_memoryMetric;
+};
+
+#endif /* __KIS_TILE_DELTA_STORE_H */
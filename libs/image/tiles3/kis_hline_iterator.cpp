@@ -56,7 +56,7 @@ KisHLineIterator2::KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint
     m_tilesCacheSize = m_rightCol - m_leftCol + 1;
     m_tilesCache.resize(m_tilesCacheSize);
 
-    m_tileWidth = m_pixelSize * KisTileData::HEIGHT;
+    m_tileWidth = m_pixelSize * KisTileData::WIDTH;
 
     // let's prealocate first row
     for (quint32 i = 0; i < m_tilesCacheSize; i++){
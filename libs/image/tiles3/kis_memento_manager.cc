@@ -76,7 +76,9 @@
 KisMementoManager::KisMementoManager()
     : m_index(0),
       m_headsHashTable(0),
-      m_registrationBlocked(false)
+      m_registrationBlocked(false),
+      m_historyMemorySize(0),
+      m_numRevisions(0)
 {
     /**
      * Tile change/delete registration is enabled for all
@@ -90,17 +92,38 @@ KisMementoManager::KisMementoManager(const KisMementoManager& rhs)
         m_cancelledRevisions(rhs.m_cancelledRevisions),
         m_headsHashTable(rhs.m_headsHashTable, 0),
         m_currentMemento(rhs.m_currentMemento),
-        m_registrationBlocked(rhs.m_registrationBlocked)
+        m_registrationBlocked(rhs.m_registrationBlocked),
+        m_historyMemorySize(rhs.m_historyMemorySize.load()),
+        m_numRevisions(rhs.m_numRevisions.load())
 {
     Q_ASSERT_X(!m_registrationBlocked,
                "KisMementoManager", "(impossible happened) "
                "The device has been copied while registration was blocked");
+
+    /**
+     * The copied revisions share the tile data with the original
+     * ones, and both managers unmark their deep revisions on
+     * destruction, so the marks should be counted for the copy too
+     */
+    for (int i = 0; i < m_revisions.size(); i++) {
+        if (m_revisions[i].isDeep) {
+            m_revisions[i].isDeep = false;
+            setRevisionDeep(m_revisions[i], true);
+        }
+    }
 }
 
 KisMementoManager::~KisMementoManager()
 {
-    // Nothing to be done here. Happily...
-    // Everything is done by QList and KisSharedPtr...
+    /**
+     * The tile data may be shared with other devices,
+     * so they should not stay marked as deep history
+     */
+    for (int i = 0; i < m_revisions.size(); i++) {
+        setRevisionDeep(m_revisions[i], false);
+    }
+
+    // Everything else is done by QList and KisSharedPtr...
     DEBUG_LOG_SIMPLE_ACTION("died\n");
 }
 
@@ -186,6 +209,9 @@ void KisMementoManager::commit()
     KisMementoItemSP mi;
     KisMementoItemSP parentMI;
     bool newTile;
+    qint64 revisionMemorySize = 0;
+
+    KisTileDataStore *store = KisTileDataStore::instance();
 
     KisMementoItemHashTableIterator iter(&m_index);
     while ((mi = iter.tile())) {
@@ -195,6 +221,26 @@ void KisMementoManager::commit()
         mi->commit();
         revisionList.append(mi);
 
+        /**
+         * The previous revision of the tile may have just become
+         * a part of the history, let it be compacted: stored as a
+         * single pixel or as a delta against the new revision
+         */
+        if (mi->tileData()) {
+            store->checkUniformTileData(mi->tileData());
+        }
+        if (KisTileData *td = parentMI->tileData()) {
+            if (mi->type() == KisMementoItem::CHANGED) {
+                store->compactHistoricalTileData(td, mi->tileData());
+            } else {
+                store->checkUniformTileData(td);
+            }
+
+            if (td->historical()) {
+                revisionMemorySize += td->memoryFootprint();
+            }
+        }
+
         m_headsHashTable.deleteTile(mi->col(), mi->row());
 
         iter.moveCurrentToHashTable(&m_headsHashTable);
@@ -204,15 +250,21 @@ void KisMementoManager::commit()
     KisHistoryItem hItem;
     hItem.itemList = revisionList;
     hItem.memento = m_currentMemento.data();
+    hItem.memorySize = revisionMemorySize;
     m_revisions.append(hItem);
 
+    m_historyMemorySize += revisionMemorySize;
+    m_numRevisions++;
+
+    updateDeepRevisions();
+
     m_currentMemento = 0;
     Q_ASSERT(m_index.isEmpty());
 
     DEBUG_DUMP_MESSAGE("COMMIT_DONE");
 
     // Waking up pooler to prepare copies for us
-    KisTileDataStore::instance()->kickPooler();
+    store->kickPooler();
 }
 
 KisTileSP KisMementoManager::getCommitedTile(qint32 col, qint32 row, bool &existingTile)
@@ -238,6 +290,9 @@ KisMementoSP KisMementoManager::getMemento()
     Q_ASSERT(!namedTransactionInProgress());
 
     // Clear redo() information
+    Q_FOREACH (const KisHistoryItem &item, m_cancelledRevisions) {
+        forgetRevision(item);
+    }
     m_cancelledRevisions.clear();
 
     commit();
@@ -263,6 +318,8 @@ void KisMementoManager::rollback(KisTileHashTable *ht)
     if (! m_revisions.size()) return;
 
     KisHistoryItem changeList = m_revisions.takeLast();
+    setRevisionDeep(changeList, false);
+    updateDeepRevisions();
 
     KisMementoItemSP mi;
     KisMementoItemSP parentMI;
@@ -317,6 +374,12 @@ void KisMementoManager::rollforward(KisTileHashTable *ht)
 
     KisHistoryItem changeList = m_cancelledRevisions.takeFirst();
 
+    /**
+     * The revision is going to be committed once again,
+     * and will be accounted for by commit()
+     */
+    forgetRevision(changeList);
+
     KisMementoItemSP mi;
 
     blockRegistration();
@@ -347,12 +410,21 @@ void KisMementoManager::purgeHistory(KisMementoSP oldestMemento)
 
     for(; revisionIndex > 0; revisionIndex--) {
         resetRevisionHistory(m_revisions.first().itemList);
+        forgetRevision(m_revisions.first());
+        setRevisionDeep(m_revisions.first(), false);
         m_revisions.removeFirst();
     }
 
     Q_ASSERT(m_revisions.first().memento == oldestMemento);
     resetRevisionHistory(m_revisions.first().itemList);
 
+    /**
+     * The parents of the oldest revision are now the default
+     * tiles, so it doesn't keep any history data anymore
+     */
+    m_historyMemorySize -= m_revisions.first().memorySize;
+    m_revisions.first().memorySize = 0;
+
     DEBUG_DUMP_MESSAGE("PURGE_HISTORY");
 }
 
@@ -384,6 +456,54 @@ void KisMementoManager::resetRevisionHistory(KisMementoItemList list)
     }
 }
 
+void KisMementoManager::forgetRevision(const KisHistoryItem &item)
+{
+    m_historyMemorySize -= item.memorySize;
+    m_numRevisions--;
+}
+
+void KisMementoManager::updateDeepRevisions()
+{
+    /**
+     * The revisions deeper than the history swap depth are unlikely
+     * to be undone soon, so their tiles are allowed to be swapped out
+     * in background. Undo brings the revisions closer to the head of
+     * the history again, so the flags must be updated both ways.
+     */
+    const int firstShallowRevision =
+        qMax(0, m_revisions.size() - KisTileDataStore::instance()->historySwapDepth());
+
+    for (int i = m_revisions.size() - 1; i >= 0; i--) {
+        const bool isDeep = i < firstShallowRevision;
+        if (m_revisions[i].isDeep == isDeep && isDeep) break;
+
+        setRevisionDeep(m_revisions[i], isDeep);
+    }
+}
+
+void KisMementoManager::setRevisionDeep(KisHistoryItem &item, bool value)
+{
+    if (item.isDeep == value) return;
+
+    Q_FOREACH (KisMementoItemSP mi, item.itemList) {
+        if (KisTileData *td = mi->tileData()) {
+            td->setDeepHistory(value);
+        }
+    }
+
+    item.isDeep = value;
+}
+
+qint64 KisMementoManager::historyMemorySize() const
+{
+    return m_historyMemorySize;
+}
+
+int KisMementoManager::numRevisions() const
+{
+    return m_numRevisions;
+}
+
 void KisMementoManager::setDefaultTileData(KisTileData *defaultTileData)
 {
     m_headsHashTable.setDefaultTileData(defaultTileData);
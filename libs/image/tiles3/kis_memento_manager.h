@@ -19,6 +19,7 @@
 #ifndef KIS_MEMENTO_MANAGER_
 #define KIS_MEMENTO_MANAGER_
 
+#include <atomic>
 #include <QList>
 
 #include "kis_memento_item.h"
@@ -31,6 +32,18 @@ class KisMemento;
 struct KisHistoryItem {
     KisMemento* memento;
     KisMementoItemList itemList;
+
+    /**
+     * The memory occupied by the previous versions of the
+     * tiles changed in the revision, estimated on commit
+     */
+    qint64 memorySize;
+
+    /**
+     * Whether the tile data of the revision are marked as deep
+     * history, see KisTileData::isDeepHistory()
+     */
+    bool isDeep = false;
 };
 
 typedef QList<KisHistoryItem> KisHistoryList;
@@ -125,9 +138,32 @@ public:
      */
     void purgeHistory(KisMementoSP oldestMemento);
 
+    /**
+     * Returns the memory occupied by the history of the device,
+     * including the undone revisions. The value is estimated on
+     * commit, so it doesn't take into account the tiles that have
+     * been swapped out or loaded back since then.
+     */
+    qint64 historyMemorySize() const;
+
+    /**
+     * Returns the number of revisions stored in the history,
+     * including the undone ones
+     */
+    int numRevisions() const;
+
 protected:
     qint32 findRevisionByMemento(KisMementoSP memento) const;
     void resetRevisionHistory(KisMementoItemList list);
+    void forgetRevision(const KisHistoryItem &item);
+
+    /**
+     * Marks the tile data of the revisions that are older than
+     * KisTileDataStore::historySwapDepth() as deep history and
+     * unmarks the ones that are not that old anymore
+     */
+    void updateDeepRevisions();
+    void setRevisionDeep(KisHistoryItem &item, bool value);
 
 protected:
     /**
@@ -169,6 +205,13 @@ protected:
      * \see rollforward()
      */
     bool m_registrationBlocked;
+
+    /**
+     * The sum of memorySize of all the revisions and their
+     * number, can be read from any thread
+     */
+    std::atomic<qint64> m_historyMemorySize;
+    std::atomic<int> m_numRevisions;
 };
 
 #endif /* KIS_MEMENTO_MANAGER_ */
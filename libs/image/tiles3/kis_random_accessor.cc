@@ -127,10 +127,10 @@ KisRandomAccessor2::KisTileInfo* KisRandomAccessor2::fetchTileData(qint32 col, q
     lockOldTile(kti->oldtile);
     kti->oldData = kti->oldtile->data();
 
-    kti->area_x1 = col * KisTileData::HEIGHT;
-    kti->area_y1 = row * KisTileData::WIDTH;
-    kti->area_x2 = kti->area_x1 + KisTileData::HEIGHT - 1;
-    kti->area_y2 = kti->area_y1 + KisTileData::WIDTH - 1;
+    kti->area_x1 = col * KisTileData::WIDTH;
+    kti->area_y1 = row * KisTileData::HEIGHT;
+    kti->area_x2 = kti->area_x1 + KisTileData::WIDTH - 1;
+    kti->area_y2 = kti->area_y1 + KisTileData::HEIGHT - 1;
 
     return kti;
 }
@@ -150,6 +150,16 @@ qint32 KisRandomAccessor2::rowStride(qint32 x, qint32 y) const
     return m_ktm->rowStride(x - m_offsetX, y - m_offsetY);
 }
 
+bool KisRandomAccessor2::isCurrentTileUniform() const
+{
+    return m_tilesCacheSize && m_tilesCache[0]->tile->tileData()->isUniform();
+}
+
+bool KisRandomAccessor2::isCurrentOldTileUniform() const
+{
+    return m_tilesCacheSize && m_tilesCache[0]->oldtile->tileData()->isUniform();
+}
+
 qint32 KisRandomAccessor2::x() const
 {
     return m_lastX;
@@ -91,6 +91,15 @@ public:
     qint32 x() const override;
     qint32 y() const override;
 
+    /**
+     * Return true if all the pixels of the tile (or the old tile) the
+     * accessor currently points to are known to be equal. Then the
+     * current pixel can be used as a source with zero row stride,
+     * e.g. in KoCompositeOp::composite().
+     */
+    bool isCurrentTileUniform() const;
+    bool isCurrentOldTileUniform() const;
+
 private:
     KisTiledDataManager *m_ktm;
     KisTileInfo** m_tilesCache;
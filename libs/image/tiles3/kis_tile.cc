@@ -35,6 +35,10 @@ void KisTile::init(qint32 col, qint32 row,
     m_extent = QRect(m_col * KisTileData::WIDTH, m_row * KisTileData::HEIGHT,
                      KisTileData::WIDTH, KisTileData::HEIGHT);
 
+    for (int i = 0; i < NumContentTypes; i++) {
+        m_contentRectVersion[i] = -1;
+    }
+
     m_tileData = defaultTileData;
     m_tileData->acquire();
 
@@ -269,11 +273,25 @@ void KisTile::lockForWrite()
 #endif
     }
 
+    /**
+     * The chunk the data is mapped from becomes outdated,
+     * and the data is not known to be uniform anymore
+     */
+    m_tileData->markMappedDataDirty();
+    m_tileData->resetUniform();
+    invalidateContentRects();
+
     DEBUG_LOG_ACTION("lock [W]");
 }
 
 void KisTile::unlockForWrite()
 {
+    /**
+     * Someone might have calculated the content rect while
+     * we were writing, so invalidate it once again
+     */
+    invalidateContentRects();
+
     unblockSwapping();
     DEBUG_LOG_ACTION("unlock [W]");
 
@@ -294,6 +312,26 @@ void KisTile::unlockForRead() const
 #endif
 }
 
+bool KisTile::cachedContentRect(ContentType type, QRect *rect) const
+{
+    QMutexLocker locker(&m_contentRectLock);
+
+    if (m_contentRectVersion[type] != m_contentVersion.loadAcquire()) {
+        return false;
+    }
+
+    *rect = m_contentRect[type];
+    return true;
+}
+
+void KisTile::setCachedContentRect(ContentType type, int version, const QRect &rect)
+{
+    QMutexLocker locker(&m_contentRectLock);
+
+    m_contentRect[type] = rect;
+    m_contentRectVersion[type] = version;
+}
+
 
 #include <stdio.h>
 void KisTile::debugPrintInfo()
@@ -51,6 +51,17 @@ class KisMementoManager;
  */
 class KRITAIMAGE_EXPORT KisTile : public KisShared
 {
+public:
+    /**
+     * The kinds of content bounds the tile can cache,
+     * see cachedContentRect()
+     */
+    enum ContentType {
+        NonDefaultContent = 0,
+        NonTransparentContent,
+        NumContentTypes
+    };
+
 public:
     KisTile(qint32 col, qint32 row,
             KisTileData *defaultTileData, KisMementoManager* mm);
@@ -131,6 +142,30 @@ public:
         return m_tileData;
     }
 
+    /**
+     * The tile keeps a cache of the bounds of its content, one rect
+     * per ContentType. The rects are calculated by the data manager
+     * and are dropped on every write access to the tile.
+     *
+     * The caller should fetch contentVersion() *before* calculating
+     * the rect and pass it to setCachedContentRect(), so that the
+     * writes that happened during the calculation would not be lost.
+     */
+    inline int contentVersion() const {
+        return m_contentVersion.loadAcquire();
+    }
+
+    bool cachedContentRect(ContentType type, QRect *rect) const;
+    void setCachedContentRect(ContentType type, int version, const QRect &rect);
+
+    /**
+     * Drops the cached content rects, e.g. when the default
+     * pixel of the data manager has changed
+     */
+    inline void invalidateContentRects() {
+        m_contentVersion.ref();
+    }
+
 private:
     void init(qint32 col, qint32 row,
               KisTileData *defaultTileData, KisMementoManager* mm);
@@ -174,6 +209,16 @@ private:
      */
     mutable QMutex m_swapBarrierLock;
 
+    /**
+     * Incremented on every write access to the tile.
+     * See cachedContentRect()
+     */
+    QAtomicInt m_contentVersion;
+
+    QRect m_contentRect[NumContentTypes];
+    int m_contentRectVersion[NumContentTypes];
+    mutable QMutex m_contentRectLock;
+
 
 #ifdef DEAD_TILES_SANITY_CHECK
     QAtomicInt m_sanityHasBeenDetached;
@@ -23,48 +23,16 @@
 
 #include <kis_debug.h>
 
-#include <boost/pool/singleton_pool.hpp>
 #include "kis_tile_data_store_iterators.h"
-
-// BPP == bytes per pixel
-#define TILE_SIZE_4BPP (4 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
-#define TILE_SIZE_8BPP (8 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
-
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_4BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 256, 4096> BoostPool4BPP;
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_8BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 128, 2048> BoostPool8BPP;
+#include "KisTileDataArena.h"
 
 const qint32 KisTileData::WIDTH = __TILE_DATA_WIDTH;
 const qint32 KisTileData::HEIGHT = __TILE_DATA_HEIGHT;
 
-SimpleCache KisTileData::m_cache;
-
-SimpleCache::~SimpleCache()
-{
-    clear();
-}
-
-void SimpleCache::clear()
-{
-    QWriteLocker l(&m_cacheLock);
-    quint8 *ptr = 0;
-
-    while (m_4Pool.pop(ptr)) {
-        BoostPool4BPP::free(ptr);
-    }
-
-    while (m_8Pool.pop(ptr)) {
-        BoostPool8BPP::free(ptr);
-    }
-
-    while (m_16Pool.pop(ptr)) {
-        free(ptr);
-    }
-}
-
-
 KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store, bool checkFreeMemory)
     : m_state(NORMAL),
       m_mementoFlag(0),
+      m_deepHistory(0),
       m_age(0),
       m_usersCount(0),
       m_refCount(0),
@@ -77,6 +45,7 @@ KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataSt
     m_data = allocateData(m_pixelSize);
 
     fillWithPixel(defPixel);
+    m_uniform = 1;
 }
 
 
@@ -94,6 +63,7 @@ KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataSt
 KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
     : m_state(NORMAL),
       m_mementoFlag(0),
+      m_deepHistory(0),
       m_age(0),
       m_usersCount(0),
       m_refCount(0),
@@ -106,6 +76,7 @@ KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
     m_data = allocateData(m_pixelSize);
 
     memcpy(m_data, rhs.data(), m_pixelSize * WIDTH * HEIGHT);
+    m_uniform = rhs.isUniform();
 }
 
 
@@ -123,8 +94,29 @@ void KisTileData::fillWithPixel(const quint8 *defPixel)
     }
 }
 
+bool KisTileData::checkUniform()
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(m_data, false);
+
+    /**
+     * The data is uniform iff every byte is equal to the byte
+     * one pixel further, so a single memcmp() is enough
+     */
+    const int dataSize = m_pixelSize * WIDTH * HEIGHT;
+    const bool result = !memcmp(m_data, m_data + m_pixelSize, dataSize - m_pixelSize);
+
+    m_uniform.storeRelease(result);
+    return result;
+}
+
 void KisTileData::releaseMemory()
 {
+    // the mapped data is released by KisSwappedDataStore only
+    KIS_SAFE_ASSERT_RECOVER(!m_mappedData) {
+        m_data = 0;
+        m_mappedData = false;
+    }
+
     if (m_data) {
         freeData(m_data, m_pixelSize);
         m_data = 0;
@@ -148,18 +140,10 @@ quint8* KisTileData::allocateData(const qint32 pixelSize)
 {
     quint8 *ptr = 0;
 
-    if (!m_cache.pop(pixelSize, ptr)) {
-        switch (pixelSize) {
-        case 4:
-            ptr = (quint8*)BoostPool4BPP::malloc();
-            break;
-        case 8:
-            ptr = (quint8*)BoostPool8BPP::malloc();
-            break;
-        default:
-            ptr = (quint8*) malloc(pixelSize * WIDTH * HEIGHT);
-            break;
-        }
+    if (KisTileDataArena::supportsPixelSize(pixelSize)) {
+        ptr = KisTileDataArena::instance()->allocate(pixelSize);
+    } else {
+        ptr = (quint8*) malloc(pixelSize * WIDTH * HEIGHT);
     }
 
     return ptr;
@@ -167,18 +151,10 @@ quint8* KisTileData::allocateData(const qint32 pixelSize)
 
 void KisTileData::freeData(quint8* ptr, const qint32 pixelSize)
 {
-    if (!m_cache.push(pixelSize, ptr)) {
-        switch (pixelSize) {
-        case 4:
-            BoostPool4BPP::free(ptr);
-            break;
-        case 8:
-            BoostPool8BPP::free(ptr);
-            break;
-        default:
-            free(ptr);
-            break;
-        }
+    if (KisTileDataArena::supportsPixelSize(pixelSize)) {
+        KisTileDataArena::instance()->free(ptr, pixelSize);
+    } else {
+        free(ptr);
     }
 }
 
@@ -210,14 +186,14 @@ void KisTileData::releaseInternalPools()
             }
 
             // check if the tile data has actually been pooled
-            if (item->m_pixelSize != 4 &&
-                item->m_pixelSize != 8) {
+            if (!KisTileDataArena::supportsPixelSize(item->m_pixelSize)) {
 
                 continue;
             }
 
-            // check if the tile has been swapped out
-            if (item->m_data) {
+            // check if the tile has been swapped out or
+            // its data is mapped from the swap file
+            if (item->m_data && !item->m_mappedData) {
                 const bool locked = item->m_swapLock.tryLockForWrite();
                 if (!locked) {
                     failedToLock = true;
@@ -233,9 +209,7 @@ void KisTileData::releaseInternalPools()
 
         if (!failedToLock) {
             // purge the pools memory
-            m_cache.clear();
-            BoostPool4BPP::purge_memory();
-            BoostPool8BPP::purge_memory();
+            KisTileDataArena::instance()->purge();
 
             auto it = dataObjects.begin();
             auto chunkIt = memoryChunks.constBegin();
@@ -37,6 +37,8 @@ inline quint8* KisTileData::data() const {
 
 void KisTileData::setData(const quint8 *data) {
     Q_ASSERT(m_data);
+    markMappedDataDirty();
+    resetUniform();
     memcpy(m_data, data, m_pixelSize*WIDTH*HEIGHT);
 }
 
@@ -108,6 +110,75 @@ inline void KisTileData::setSwapChunk(KisChunk chunk) {
     m_swapChunk = chunk;
 }
 
+inline bool KisTileData::isMapped() const {
+    return m_mappedData;
+}
+inline void KisTileData::setMappedData(quint8 *data) {
+    Q_ASSERT(!m_data);
+    m_data = data;
+    m_mappedData = true;
+    m_mappedDataDirty = 0;
+}
+inline quint8* KisTileData::takeMappedData() {
+    Q_ASSERT(m_mappedData);
+    quint8 *data = m_data;
+    m_data = 0;
+    m_mappedData = false;
+    return data;
+}
+
+inline bool KisTileData::isMappedDataDirty() const {
+    return m_mappedDataDirty.loadAcquire();
+}
+inline void KisTileData::markMappedDataDirty() {
+    if (m_mappedData && !m_mappedDataDirty.loadAcquire()) {
+        m_mappedDataDirty.storeRelease(1);
+    }
+}
+
+inline bool KisTileData::isUniform() const {
+    return m_uniform.loadAcquire();
+}
+inline void KisTileData::resetUniform() {
+    if (m_uniform.loadAcquire()) {
+        m_uniform.storeRelease(0);
+    }
+}
+
+inline const quint8* KisTileData::swappedUniformPixel() const {
+    return m_swappedUniformPixel.isEmpty() ? 0 : (const quint8*)m_swappedUniformPixel.constData();
+}
+inline void KisTileData::setSwappedUniformPixel(const quint8 *pixel) {
+    if (pixel) {
+        m_swappedUniformPixel = QByteArray((const char*)pixel, m_pixelSize);
+    } else {
+        m_swappedUniformPixel.clear();
+    }
+    m_compactDataSize.storeRelease(m_swappedUniformPixel.size());
+}
+
+inline KisTileData* KisTileData::deltaBase() const {
+    return m_deltaBase;
+}
+inline void KisTileData::setDelta(KisTileData *base, const QByteArray &delta) {
+    Q_ASSERT(!m_deltaBase);
+    m_deltaBase = base;
+    m_deltaData = delta;
+    m_compactDataSize.storeRelease(m_deltaData.size());
+}
+inline KisTileData* KisTileData::takeDelta(QByteArray &delta) {
+    KisTileData *base = m_deltaBase;
+    delta = m_deltaData;
+    m_deltaBase = 0;
+    m_deltaData.clear();
+    m_compactDataSize.storeRelease(0);
+    return base;
+}
+
+inline qint32 KisTileData::memoryFootprint() const {
+    return m_data ? m_pixelSize * WIDTH * HEIGHT : m_compactDataSize.loadAcquire();
+}
+
 inline bool KisTileData::mementoed() const {
     return m_mementoFlag;
 }
@@ -115,6 +186,13 @@ inline void KisTileData::setMementoed(bool value) {
     m_mementoFlag += value ? 1 : -1;
 }
 
+inline bool KisTileData::isDeepHistory() const {
+    return m_deepHistory > 0;
+}
+inline void KisTileData::setDeepHistory(bool value) {
+    m_deepHistory += value ? 1 : -1;
+}
+
 inline bool KisTileData::historical() const {
     return mementoed() && numUsers() <= 1;
 }
@@ -22,6 +22,9 @@
 
 #include <QReadWriteLock>
 #include <QAtomicInt>
+#include <QByteArray>
+
+#include <config-tile-size.h>
 
 #include "kis_lockless_stack.h"
 #include "swap/kis_chunk_allocator.h"
@@ -32,9 +35,11 @@ class KisTileDataStore;
 /**
  * WARNING: Those definitions for internal use only!
  * Please use KisTileData::WIDTH/HEIGHT instead
+ *
+ * The size is chosen at build time, see KRITA_TILE_SIZE
  */
-#define __TILE_DATA_WIDTH 64
-#define __TILE_DATA_HEIGHT 64
+#define __TILE_DATA_WIDTH KRITA_TILE_SIZE
+#define __TILE_DATA_HEIGHT KRITA_TILE_SIZE
 
 typedef KisLocklessStack<KisTileData*> KisTileDataCache;
 
@@ -43,57 +48,6 @@ typedef KisTileDataList::iterator KisTileDataListIterator;
 typedef KisTileDataList::const_iterator KisTileDataListConstIterator;
 
 
-class SimpleCache
-{
-public:
-    SimpleCache() = default;
-    ~SimpleCache();
-
-    bool push(int pixelSize, quint8 *&ptr)
-    {
-        QReadLocker l(&m_cacheLock);
-        switch (pixelSize) {
-        case 4:
-            m_4Pool.push(ptr);
-            break;
-        case 8:
-            m_8Pool.push(ptr);
-            break;
-        case 16:
-            m_16Pool.push(ptr);
-            break;
-        default:
-            return false;
-        }
-
-        return true;
-    }
-
-    bool pop(int pixelSize, quint8 *&ptr)
-    {
-        QReadLocker l(&m_cacheLock);
-        switch (pixelSize) {
-        case 4:
-            return m_4Pool.pop(ptr);
-        case 8:
-            return m_8Pool.pop(ptr);
-        case 16:
-            return m_16Pool.pop(ptr);
-        default:
-            return false;
-        }
-    }
-
-    void clear();
-
-private:
-    QReadWriteLock m_cacheLock;
-    KisLocklessStack<quint8*> m_4Pool;
-    KisLocklessStack<quint8*> m_8Pool;
-    KisLocklessStack<quint8*> m_16Pool;
-};
-
-
 /**
  * Stores actual tile's data
  */
@@ -165,12 +119,83 @@ public:
     inline KisChunk swapChunk() const;
     inline void setSwapChunk(KisChunk chunk);
 
+    /**
+     * Used by KisSwappedDataStore in "fast swap" mode only.
+     * The data of the tile is mapped directly from the swap
+     * file with a private (copy-on-write) mapping, the swap
+     * chunk is still owned by the tile data.
+     */
+    inline bool isMapped() const;
+    inline void setMappedData(quint8 *data);
+    inline quint8* takeMappedData();
+
+    /**
+     * Shows whether the mapped data has been changed, that is
+     * its chunk in the swap file is outdated. Set by KisTile
+     * on write access.
+     */
+    inline bool isMappedDataDirty() const;
+    inline void markMappedDataDirty();
+
+    /**
+     * Shows whether all the pixels of the tile data are known
+     * to be equal. The flag is set on creation of a filled tile
+     * data and by checkUniform(), and is reset by KisTile on
+     * write access.
+     */
+    inline bool isUniform() const;
+    inline void resetUniform();
+
+    /**
+     * Scans the data and updates the uniform flag. The caller must
+     * ensure nobody writes into the data meanwhile, e.g. by holding
+     * the swap lock.
+     */
+    bool checkUniform();
+
+    /**
+     * Used by KisSwappedDataStore only. A uniform tile data is
+     * swapped out as a single pixel, it doesn't take any space in
+     * the swap file. Null when the data is not swapped out this way.
+     */
+    inline const quint8* swappedUniformPixel() const;
+    inline void setSwappedUniformPixel(const quint8 *pixel);
+
+    /**
+     * Used by KisTileDeltaStore only. A historical tile data may be
+     * stored as a compressed difference against a newer version of
+     * the same tile, its base. The tile data keeps a reference to the
+     * base until it is loaded back. Null when the data is not stored
+     * this way.
+     */
+    inline KisTileData* deltaBase() const;
+    inline void setDelta(KisTileData *base, const QByteArray &delta);
+    inline KisTileData* takeDelta(QByteArray &delta);
+
+    /**
+     * Returns the amount of memory occupied by the tile data in its
+     * current form: the full data, a delta or a single pixel. The
+     * tile data may be swapped in or out concurrently, so the value
+     * is approximate.
+     */
+    inline qint32 memoryFootprint() const;
+
     /**
      * Show whether a tile data is a part of history
      */
     inline bool mementoed() const;
     inline void setMementoed(bool value);
 
+    /**
+     * Shows whether the tile data belongs to a revision that is
+     * older than KisTileDataSwapper::historySwapDepth(). Such tile
+     * data are swapped out long before the memory limits are hit.
+     * The calls to setDeepHistory(true) and setDeepHistory(false)
+     * must be balanced, like the ones of setMementoed().
+     */
+    inline bool isDeepHistory() const;
+    inline void setDeepHistory(bool value);
+
     /**
      * Controlling methods for setting 'age' marks
      */
@@ -213,7 +238,7 @@ public:
     /**
      * Releases internal pools, which keep blobs where the tiles are
      * stored.  The point is that we don't allocate the tiles from
-     * glibc directly, but use pools (implemented via boost) to
+     * glibc directly, but use pools (see KisTileDataArena) to
      * allocate bigger chunks. This method should be called when one
      * knows that we have just free'd quite a lot of memory and we
      * won't need it anymore. E.g. when a document has been closed.
@@ -238,6 +263,7 @@ private:
 private:
     friend class KisTile;
     friend class KisTileDataStore;
+    friend class KisSwappedDataStoreTest;
 
     friend class KisTileDataStoreIterator;
     friend class KisTileDataStoreReverseIterator;
@@ -264,6 +290,25 @@ private:
      */
     KisChunk m_swapChunk;
 
+    /**
+     * Set when m_data points into a private mapping
+     * of m_swapChunk rather than to the pooled memory
+     */
+    bool m_mappedData = false;
+    QAtomicInt m_mappedDataDirty;
+
+    QAtomicInt m_uniform;
+    QByteArray m_swappedUniformPixel;
+
+    KisTileData *m_deltaBase = 0;
+    QByteArray m_deltaData;
+
+    /**
+     * The size of the pixel or the delta the data is stored
+     * as, when it is not present in memory
+     */
+    QAtomicInt m_compactDataSize;
+
 
     /**
      * The flag is set by KisMementoItem to show this
@@ -274,6 +319,12 @@ private:
      */
     qint32 m_mementoFlag;
 
+    /**
+     * The number of deep revisions the tile data belongs to,
+     * set by KisMementoManager, see isDeepHistory()
+     */
+    qint32 m_deepHistory;
+
     /**
      * Counts up time after last access to the tile data.
      * 0 - recently accessed
@@ -317,7 +368,6 @@ private:
     //qint32 m_timeStamp;
 
     KisTileDataStore *m_store;
-    static SimpleCache m_cache;
 
 public:
     static const qint32 WIDTH;
@@ -118,6 +118,8 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
 
     stats.swapSize = m_swappedStore.totalMemoryMetric() * metricCoeff;
 
+    stats.historicalDeltaSize = m_deltaStore.totalMemorySize();
+
     return stats;
 }
 
@@ -189,19 +191,37 @@ void KisTileDataStore::freeTileData(KisTileData *td)
 
     DEBUG_FREE_ACTION(td);
 
+    KisTileData *deltaBase = 0;
+
     m_iteratorLock.lockForRead();
     td->m_swapLock.lockForWrite();
 
     if (!td->data()) {
-        m_swappedStore.forgetTileData(td);
+        if (td->deltaBase()) {
+            deltaBase = m_deltaStore.forgetTileData(td);
+        } else {
+            m_swappedStore.forgetTileData(td);
+        }
     } else {
         unregisterTileDataImp(td);
+
+        if (td->isMapped()) {
+            m_swappedStore.forgetTileData(td);
+        }
     }
 
     td->m_swapLock.unlock();
     m_iteratorLock.unlock();
 
     delete td;
+
+    /**
+     * The base may be deleted here as well,
+     * so deref it when no locks are held
+     */
+    if (deltaBase) {
+        deltaBase->deref();
+    }
 }
 
 void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
@@ -233,17 +253,20 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
          * m_listLock.
          */
 
+        QVector<KisTileData*> releasedBases;
+
         if (!td->data()) {
             td->m_swapLock.lockForWrite();
-
-            m_swappedStore.swapInTileData(td);
-            registerTileDataImp(td);
-
+            swapInTileDataImp(td, releasedBases);
             td->m_swapLock.unlock();
         }
 
         m_iteratorLock.unlock();
 
+        Q_FOREACH (KisTileData *base, releasedBases) {
+            base->deref();
+        }
+
         /**
          * <-- In theory, livelock is possible here...
          */
@@ -275,6 +298,194 @@ bool KisTileDataStore::trySwapTileData(KisTileData *td)
     return result;
 }
 
+bool KisTileDataStore::tryLockForSwapOut(KisTileData *td)
+{
+    /**
+     * This function is called with m_iteratorLock acquired
+     */
+
+    if (!td->m_swapLock.tryLockForWrite()) return false;
+
+    if (!td->data()) {
+        td->m_swapLock.unlock();
+        return false;
+    }
+
+    /**
+     * The tile data may have already been dropped by its last
+     * user and wait for m_iteratorLock in freeTileData(). We
+     * should not resurrect it.
+     */
+    int refCount = 0;
+    do {
+        refCount = td->m_refCount.loadAcquire();
+    } while (refCount > 0 && !td->m_refCount.testAndSetOrdered(refCount, refCount + 1));
+
+    if (!refCount) {
+        td->m_swapLock.unlock();
+        return false;
+    }
+
+    return true;
+}
+
+qint64 KisTileDataStore::commitSwapOut(const QVector<KisTileData*> &tileDataObjects,
+                                       const QVector<QByteArray> &compressedData,
+                                       int timeout)
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(tileDataObjects.size() == compressedData.size());
+
+    qint64 freedMetric = -1;
+
+    /**
+     * The store is locked for write, like in the old iteration-based
+     * swap-out, so the commit never runs concurrently with the tiles
+     * being loaded or the deltas being decoded in swapInTileDataImp().
+     *
+     * We hold the swap locks of the tile data objects, so we
+     * cannot wait for the store's lock infinitely: the pooler
+     * or a loader may hold it while waiting for one of our tiles.
+     * In such a case we just drop the batch.
+     */
+    if (m_iteratorLock.tryLockForWrite(timeout)) {
+        freedMetric = 0;
+
+        for (int i = 0; i < tileDataObjects.size(); i++) {
+            KisTileData *td = tileDataObjects[i];
+            const QByteArray &buffer = compressedData[i];
+
+            unregisterTileDataImp(td);
+
+            /**
+             * The data is not compressed in advance in "fast swap"
+             * mode and for uniform tiles, so let the swapped store
+             * handle it
+             */
+            const bool result = buffer.isEmpty() ?
+                m_swappedStore.trySwapOutTileData(td) :
+                m_swappedStore.trySwapOutCompressedTileData(td, (const quint8*)buffer.constData(), buffer.size());
+
+            if (result) {
+                freedMetric += td->pixelSize();
+            } else {
+                registerTileDataImp(td);
+            }
+        }
+
+        m_iteratorLock.unlock();
+    }
+
+    Q_FOREACH (KisTileData *td, tileDataObjects) {
+        td->m_swapLock.unlock();
+    }
+
+    /**
+     * Dereferencing may cause the tile data to be deleted,
+     * so do it when no locks are held
+     */
+    Q_FOREACH (KisTileData *td, tileDataObjects) {
+        td->deref();
+    }
+
+    return freedMetric;
+}
+
+void KisTileDataStore::checkUniformTileData(KisTileData *td)
+{
+    /**
+     * Most of the tiles are still used by the image and cannot be
+     * compacted anyway, so check it before taking the locks and
+     * scanning the data of the tile
+     */
+    if (!td->historical()) return;
+
+    QReadLocker lock(&m_iteratorLock);
+    if (!td->m_swapLock.tryLockForWrite()) return;
+
+    if (td->historical() && td->data() && (td->isUniform() || td->checkUniform())) {
+        unregisterTileDataImp(td);
+        if (!m_swappedStore.trySwapOutTileData(td)) {
+            registerTileDataImp(td);
+        }
+    }
+
+    td->m_swapLock.unlock();
+}
+
+void KisTileDataStore::swapInTileDataImp(KisTileData *td, QVector<KisTileData*> &releasedBases)
+{
+    /**
+     * This function is called with m_iteratorLock and the swap
+     * lock of the tile data taken for write
+     */
+
+    if (KisTileData *base = td->deltaBase()) {
+        /**
+         * The base may be shared by several deltas and the swapper
+         * may try to swap it out at the same time, so the base is
+         * loaded under its own swap lock, the same way as in
+         * ensureTileDataLoaded(), and is kept locked for read until
+         * the delta is decoded.
+         */
+        base->m_swapLock.lockForRead();
+
+        while (!base->data()) {
+            base->m_swapLock.unlock();
+
+            base->m_swapLock.lockForWrite();
+            if (!base->data()) {
+                swapInTileDataImp(base, releasedBases);
+            }
+            base->m_swapLock.unlock();
+
+            base->m_swapLock.lockForRead();
+        }
+
+        releasedBases.append(m_deltaStore.decodeTileData(td));
+
+        base->m_swapLock.unlock();
+    } else {
+        m_swappedStore.swapInTileData(td);
+    }
+
+    registerTileDataImp(td);
+}
+
+void KisTileDataStore::compactHistoricalTileData(KisTileData *td, KisTileData *base)
+{
+    if (td == base || td->pixelSize() != base->pixelSize()) return;
+
+    QReadLocker lock(&m_iteratorLock);
+    if (!td->m_swapLock.tryLockForWrite()) return;
+
+    if (td->data() && td->historical()) {
+        unregisterTileDataImp(td);
+
+        bool result = false;
+
+        if (td->isUniform() || td->checkUniform()) {
+            result = m_swappedStore.trySwapOutTileData(td);
+        } else if (m_deltaStore.isEnabled() && !td->isMapped() &&
+                   base->m_swapLock.tryLockForRead()) {
+            if (base->data()) {
+                result = m_deltaStore.tryEncodeTileData(td, base);
+            }
+            base->m_swapLock.unlock();
+        }
+
+        if (!result) {
+            registerTileDataImp(td);
+        }
+    }
+
+    td->m_swapLock.unlock();
+}
+
+KisTileDataSwapper::Statistics KisTileDataStore::swapperStatistics() const
+{
+    return m_swapper.statistics();
+}
+
 KisTileDataStoreIterator* KisTileDataStore::beginIteration()
 {
     m_iteratorLock.lockForWrite();
@@ -363,6 +574,8 @@ void KisTileDataStore::testingRereadConfig()
 {
     m_pooler.testingRereadConfig();
     m_swapper.testingRereadConfig();
+    m_swappedStore.testingRereadConfig();
+    m_deltaStore.testingRereadConfig();
     kickPooler();
 }
 
@@ -23,11 +23,13 @@
 #include "kritaimage_export.h"
 
 #include <QReadWriteLock>
+#include <QVector>
 #include "kis_tile_data_interface.h"
 
 #include "kis_tile_data_pooler.h"
 #include "swap/kis_tile_data_swapper.h"
 #include "swap/kis_swapped_data_store.h"
+#include "KisTileDeltaStore.h"
 #include "3rdparty/lock_free_map/concurrent_map.h"
 
 class KisTileDataStoreIterator;
@@ -54,17 +56,19 @@ public:
         qint64 poolSize;
 
         qint64 swapSize;
+
+        qint64 historicalDeltaSize;
     };
 
     MemoryStatistics memoryStatistics();
 
     /**
-     * Returns total number of tiles present: in memory
-     * or in a swap file
+     * Returns total number of tiles present: in memory,
+     * in a swap file or stored as deltas
      */
     inline qint32 numTiles() const
     {
-        return m_numTiles.loadAcquire() + m_swappedStore.numTiles();
+        return m_numTiles.loadAcquire() + m_swappedStore.numTiles() + m_deltaStore.numTiles();
     }
 
     /**
@@ -111,6 +115,15 @@ public:
         m_swapper.kick();
     }
 
+    /**
+     * The number of the most recent revisions whose tiles are not
+     * swapped out early, see KisTileData::isDeepHistory()
+     */
+    inline int historySwapDepth() const
+    {
+        return m_swapper.historySwapDepth();
+    }
+
     /**
      * Try swap out the tile data.
      * It may fail in case the tile is being accessed
@@ -118,6 +131,61 @@ public:
      */
     bool trySwapTileData(KisTileData *td);
 
+    /**
+     * Batched swap-out interface used by KisTileDataSwapper.
+     *
+     * tryLockForSwapOut() should be called while iterating the
+     * store. It tries to take the swap lock of \a td in write mode
+     * and refs the tile data, so it can be neither accessed nor
+     * deleted while the swapper compresses it without holding the
+     * store's lock.
+     *
+     * commitSwapOut() writes the compressed tile data into the swap
+     * file, unlocks and derefs the tile data objects. Returns the
+     * freed metric. If the store cannot be locked in \a timeout ms,
+     * the batch is discarded, the tiles are left in memory and -1
+     * is returned. Empty buffers in \a compressedData mean that the
+     * data has not been compressed in advance ("fast swap" mode or
+     * a uniform tile).
+     */
+    bool tryLockForSwapOut(KisTileData *td);
+    qint64 commitSwapOut(const QVector<KisTileData*> &tileDataObjects,
+                         const QVector<QByteArray> &compressedData,
+                         int timeout);
+
+    /**
+     * Called by KisMementoManager on a transaction commit. Checks
+     * whether the tile data is uniform. If it is and it is a part of
+     * the history only, its memory is released right away, and the
+     * data is stored as a single pixel until the next access.
+     * Does nothing if someone is accessing the tile data.
+     */
+    void checkUniformTileData(KisTileData *td);
+
+    /**
+     * Called by KisMementoManager on a transaction commit for the
+     * previous version of a changed tile, \p td, which has just
+     * become a part of the history. \p base is the new version of
+     * the tile. If \p td is used by the history only, it is stored
+     * as a single pixel or as a compressed difference against
+     * \p base (see KisTileDeltaStore). Does nothing if someone is
+     * accessing any of the tile data objects.
+     */
+    void compactHistoricalTileData(KisTileData *td, KisTileData *base);
+
+    /**
+     * Returns the statistics of the swapper thread
+     */
+    KisTileDataSwapper::Statistics swapperStatistics() const;
+
+    /**
+     * \see KisSwappedDataStore::compressesSwappedData()
+     */
+    inline bool compressesSwappedData() const
+    {
+        return m_swappedStore.compressesSwappedData();
+    }
+
 
     /**
      * WARN: The following three method are only for usage
@@ -148,6 +216,7 @@ private:
 
     inline void registerTileDataImp(KisTileData *td);
     inline void unregisterTileDataImp(KisTileData *td);
+    void swapInTileDataImp(KisTileData *td, QVector<KisTileData*> &releasedBases);
     void freeRegisteredTiles();
 
     friend class DeadlockyThread;
@@ -168,6 +237,7 @@ private:
     friend class KisTileDataStoreTest;
     friend class KisTileDataPoolerTest;
     KisSwappedDataStore m_swappedStore;
+    KisTileDeltaStore m_deltaStore;
 
     /**
      * This metric is used for computing the volume
@@ -145,10 +145,11 @@ private:
     {
         TileTypeSP::ref(&item, item.data());
         TileType *tile = 0;
+        int gcToken = 0;
 
         {
             QReadLocker locker(&m_iteratorLock);
-            m_map.getGC().lockRawPointerAccess();
+            gcToken = m_map.getGC().lockRawPointerAccess();
             tile = m_map.assign(idx, item.data());
         }
 
@@ -159,14 +160,14 @@ private:
             m_numTiles.fetchAndAddRelaxed(1);
         }
 
-        m_map.getGC().unlockRawPointerAccess();
+        m_map.getGC().unlockRawPointerAccess(gcToken);
 
         m_map.getGC().update(m_map.migrationInProcess());
     }
 
     inline bool erase(quint32 idx)
     {
-        m_map.getGC().lockRawPointerAccess();
+        const int gcToken = m_map.getGC().lockRawPointerAccess();
 
         bool wasDeleted = false;
         TileType *tile = m_map.erase(idx);
@@ -179,7 +180,7 @@ private:
             m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
         }
 
-        m_map.getGC().unlockRawPointerAccess();
+        m_map.getGC().unlockRawPointerAccess(gcToken);
 
         m_map.getGC().update(m_map.migrationInProcess());
         return wasDeleted;
@@ -297,9 +298,9 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getE
 {
     quint32 idx = calculateHash(col, row);
 
-    m_map.getGC().lockRawPointerAccess();
+    const int gcToken = m_map.getGC().lockRawPointerAccess();
     TileTypeSP tile = m_map.get(idx);
-    m_map.getGC().unlockRawPointerAccess();
+    m_map.getGC().unlockRawPointerAccess(gcToken);
 
     m_map.getGC().update(m_map.migrationInProcess());
     return tile;
@@ -313,7 +314,7 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
 
     // we are going to assign a raw-pointer tile from the table
     // to a shared pointer...
-    m_map.getGC().lockRawPointerAccess();
+    int gcToken = m_map.getGC().lockRawPointerAccess();
 
     TileTypeSP tile;
 
@@ -322,7 +323,7 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
         if (!mutator.getValue()) {
             // we shouldn't try to aquire **any** lock with
             // raw-pointer lock held
-            m_map.getGC().unlockRawPointerAccess();
+            m_map.getGC().unlockRawPointerAccess(gcToken);
 
             {
                 QReadLocker locker(&m_defaultPixelDataLock);
@@ -337,7 +338,7 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
             m_iteratorLock.lockForRead();
 
             // and now lock raw-pointers again
-            m_map.getGC().lockRawPointerAccess();
+            gcToken = m_map.getGC().lockRawPointerAccess();
 
             item = mutator.exchangeValue(tile.data());
             m_iteratorLock.unlock();
@@ -363,7 +364,7 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
             tile = mutator.getValue();
         }
     }
-    m_map.getGC().unlockRawPointerAccess();
+    m_map.getGC().unlockRawPointerAccess(gcToken);
 
     m_map.getGC().update(m_map.migrationInProcess());
     return tile;
@@ -374,9 +375,9 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getR
 {
     quint32 idx = calculateHash(col, row);
 
-    m_map.getGC().lockRawPointerAccess();
+    const int gcToken = m_map.getGC().lockRawPointerAccess();
     TileTypeSP tile = m_map.get(idx);
-    m_map.getGC().unlockRawPointerAccess();
+    m_map.getGC().unlockRawPointerAccess(gcToken);
 
     existingTile = tile;
 
@@ -419,14 +420,14 @@ void KisTileHashTableTraits2<T>::clear()
         TileType *tile = 0;
 
         while (iter.isValid()) {
-            m_map.getGC().lockRawPointerAccess();
+            const int gcToken = m_map.getGC().lockRawPointerAccess();
             tile = m_map.erase(iter.getKey());
 
             if (tile) {
                 tile->notifyDetachedFromDataManager();
                 m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
             }
-            m_map.getGC().unlockRawPointerAccess();
+            m_map.getGC().unlockRawPointerAccess(gcToken);
 
             iter.next();
         }
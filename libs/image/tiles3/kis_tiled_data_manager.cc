@@ -103,6 +103,18 @@ void KisTiledDataManager::setDefaultPixelImpl(const quint8 *defaultPixel)
     m_mementoManager->setDefaultTileData(td);
 
     memcpy(m_defaultPixel, defaultPixel, pixelSize());
+
+    /**
+     * The tiles compare their content against the default pixel
+     * when calculating the exact bounds, so the cache is outdated
+     */
+    KisTileHashTableIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        tile->invalidateContentRects();
+        iter.next();
+    }
 }
 
 bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
@@ -117,7 +129,11 @@ bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
         retval = store.write(str, strlen(str));
     }
     else {
-        retval = writeTilesHeader(store, m_hashTable->numTiles());
+        const qint32 streamTilesPerTile =
+            (KisTileData::WIDTH / STREAM_TILE_SIZE) *
+            (KisTileData::HEIGHT / STREAM_TILE_SIZE);
+
+        retval = writeTilesHeader(store, m_hashTable->numTiles() * streamTilesPerTile);
     }
 
 
@@ -126,6 +142,7 @@ bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
 
     KisAbstractTileCompressorSP compressor =
         KisTileCompressorFactory::create(CURRENT_VERSION);
+    compressor->setStreamTileSize(STREAM_TILE_SIZE, STREAM_TILE_SIZE);
 
     while ((tile = iter.tile())) {
         retval = compressor->writeTile(tile, store);
@@ -156,6 +173,8 @@ bool KisTiledDataManager::read(QIODevice *stream)
 
     quint32 numTiles;
     qint32 tilesVersion = LEGACY_VERSION;
+    qint32 tileWidth = KisTileData::WIDTH;
+    qint32 tileHeight = KisTileData::HEIGHT;
 
     if (line[0] == 'V') {
         QList<QByteArray> lineItems = line.split(' ');
@@ -165,7 +184,7 @@ bool KisTiledDataManager::read(QIODevice *stream)
 
         tilesVersion = lineItems.takeFirst().toInt();
 
-        if(!processTilesHeader(stream, numTiles))
+        if(!processTilesHeader(stream, numTiles, tileWidth, tileHeight))
             return false;
     }
     else {
@@ -174,6 +193,7 @@ bool KisTiledDataManager::read(QIODevice *stream)
 
     KisAbstractTileCompressorSP compressor =
         KisTileCompressorFactory::create(tilesVersion);
+    compressor->setStreamTileSize(tileWidth, tileHeight);
 
     bool readSuccess = true;
     for (quint32 i = 0; i < numTiles; i++) {
@@ -196,8 +216,8 @@ bool KisTiledDataManager::writeTilesHeader(KisPaintDeviceWriter &store, quint32
                      "PIXELSIZE %4\n"
                      "DATA %5\n")
         .arg(CURRENT_VERSION)
-        .arg(KisTileData::WIDTH)
-        .arg(KisTileData::HEIGHT)
+        .arg(STREAM_TILE_SIZE)
+        .arg(STREAM_TILE_SIZE)
         .arg(pixelSize())
         .arg(numTiles);
 
@@ -214,7 +234,8 @@ bool KisTiledDataManager::writeTilesHeader(KisPaintDeviceWriter &store, quint32
     } while(0)                                                  \
 
 
-bool KisTiledDataManager::processTilesHeader(QIODevice *stream, quint32 &numTiles)
+bool KisTiledDataManager::processTilesHeader(QIODevice *stream, quint32 &numTiles,
+                                             qint32 &tileWidth, qint32 &tileHeight)
 {
     /**
      * We assume that there is only one version of this header
@@ -233,13 +254,19 @@ bool KisTiledDataManager::processTilesHeader(QIODevice *stream, quint32 &numTile
     while(!foundDataMark && stream->canReadLine()) {
         takeOneLine(stream, maxLineLength, keyword, value);
 
+        /**
+         * The tiles of any size can be read, they are just
+         * copied pixel-wise if the size differs from ours
+         */
         if (keyword == "TILEWIDTH") {
-            if(value != KisTileData::WIDTH)
+            if(value <= 0)
                 goto wrongString;
+            tileWidth = value;
         }
         else if (keyword == "TILEHEIGHT") {
-            if(value != KisTileData::HEIGHT)
+            if(value <= 0)
                 goto wrongString;
+            tileHeight = value;
         }
         else if (keyword == "PIXELSIZE") {
             if((quint32)value != pixelSize())
@@ -70,6 +70,13 @@ private:
     static const qint32 LEGACY_VERSION = 1;
     static const qint32 CURRENT_VERSION = 2;
 
+    /**
+     * The size of the tiles written into the files. It does not
+     * depend on KRITA_TILE_SIZE, so the files stay compatible with
+     * the builds using a different tile size.
+     */
+    static const qint32 STREAM_TILE_SIZE = 64;
+
 protected:
     /*FIXME:*/
 public:
@@ -87,6 +94,7 @@ protected:
     friend class KisTiledRandomAccessor;
     friend class KisRandomAccessor2;
     friend class KisStressJob;
+    friend class KisTiledDataManagerTest;
 
 public:
     void setDefaultPixel(const quint8 *defPixel);
@@ -202,6 +210,17 @@ public:
         m_mementoManager->purgeHistory(oldestMemento);
     }
 
+    /**
+     * \see KisMementoManager::historyMemorySize()
+     */
+    qint64 historyMemorySize() const {
+        return m_mementoManager->historyMemorySize();
+    }
+
+    int numHistoryRevisions() const {
+        return m_mementoManager->numRevisions();
+    }
+
     static void releaseInternalPools();
 
 protected:
@@ -228,6 +247,19 @@ public:
 
     QRegion region() const;
 
+    /**
+     * Calculates the bounds of the pixels that are not considered
+     * empty by \p compareOp. The bounds are calculated per tile and
+     * cached in the tiles, so only the tiles that have been written
+     * to since the previous call are scanned. A tile with uniform
+     * data is checked with a single pixel.
+     *
+     * \p type defines the cache slot of the tiles, so the same type
+     * should always be used with the same kind of \p compareOp
+     */
+    template <class ComparePixelOp>
+    QRect calculateExactBounds(KisTile::ContentType type, ComparePixelOp compareOp) const;
+
     void clear(QRect clearRect, quint8 clearValue);
     void clear(QRect clearRect, const quint8 *clearPixel);
     void clear(qint32 x, qint32 y, qint32 w, qint32 h, quint8 clearValue);
@@ -364,7 +396,8 @@ private:
     void setDefaultPixelImpl(const quint8 *defPixel);
 
     bool writeTilesHeader(KisPaintDeviceWriter &store, quint32 numTiles);
-    bool processTilesHeader(QIODevice *stream, quint32 &numTiles);
+    bool processTilesHeader(QIODevice *stream, quint32 &numTiles,
+                            qint32 &tileWidth, qint32 &tileHeight);
 
     qint32 divideRoundDown(qint32 x, const qint32 y) const;
 
@@ -372,6 +405,9 @@ private:
 
     quint8* duplicatePixel(qint32 num, const quint8 *pixel);
 
+    template <class ComparePixelOp>
+    static QRect calculateTileContentRect(KisTileSP tile, ComparePixelOp &compareOp);
+
     template<bool useOldSrcData>
         void bitBltImpl(KisTiledDataManager *srcDM, const QRect &rect);
     template<bool useOldSrcData>
@@ -422,6 +458,82 @@ inline qint32 KisTiledDataManager::yToRow(qint32 y) const
     return divideRoundDown(y, KisTileData::HEIGHT);
 }
 
+template <class ComparePixelOp>
+QRect KisTiledDataManager::calculateExactBounds(KisTile::ContentType type, ComparePixelOp compareOp) const
+{
+    QRect bounds;
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        QRect tileBounds;
+
+        if (!tile->cachedContentRect(type, &tileBounds)) {
+            const int version = tile->contentVersion();
+            tileBounds = calculateTileContentRect(tile, compareOp);
+            tile->setCachedContentRect(type, version, tileBounds);
+        }
+
+        bounds |= tileBounds;
+        iter.next();
+    }
+
+    return bounds;
+}
+
+template <class ComparePixelOp>
+QRect KisTiledDataManager::calculateTileContentRect(KisTileSP tile, ComparePixelOp &compareOp)
+{
+    const qint32 pixelSize = tile->pixelSize();
+    const qint32 rowStride = KisTileData::WIDTH * pixelSize;
+
+    qint32 left = KisTileData::WIDTH;
+    qint32 right = -1;
+    qint32 top = -1;
+    qint32 bottom = -1;
+
+    tile->lockForRead();
+    const quint8 *data = tile->data();
+
+    if (tile->tileData()->isUniform()) {
+        if (!compareOp.isPixelEmpty(data)) {
+            left = 0;
+            right = KisTileData::WIDTH - 1;
+            top = 0;
+            bottom = KisTileData::HEIGHT - 1;
+        }
+    } else {
+        for (qint32 y = 0; y < KisTileData::HEIGHT; y++) {
+            const quint8 *row = data + y * rowStride;
+
+            qint32 x0 = 0;
+            while (x0 < KisTileData::WIDTH && compareOp.isPixelEmpty(row + x0 * pixelSize)) {
+                x0++;
+            }
+            if (x0 == KisTileData::WIDTH) continue;
+
+            // the pixels to the left of 'right' need not be checked
+            qint32 x1 = KisTileData::WIDTH - 1;
+            while (x1 > right && x1 > x0 && compareOp.isPixelEmpty(row + x1 * pixelSize)) {
+                x1--;
+            }
+
+            if (top < 0) top = y;
+            bottom = y;
+            left = qMin(left, x0);
+            right = qMax(right, x1);
+        }
+    }
+
+    tile->unlockForRead();
+
+    if (bottom < 0) return QRect();
+
+    return QRect(left, top, right - left + 1, bottom - top + 1)
+        .translated(tile->extent().topLeft());
+}
+
 // during development the following line helps to check the interface is correct
 // it should be safe to keep it here even during normal compilation
 //#include "kis_datamanager.h"
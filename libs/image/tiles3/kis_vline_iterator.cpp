@@ -55,7 +55,7 @@ KisVLineIterator2::KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint
     m_column = xToCol(m_x);
     m_xInTile = calcXInTile(m_x, m_column);
 
-    m_topInTopmostTile = m_top - m_topRow * KisTileData::WIDTH;
+    m_topInTopmostTile = m_top - m_topRow * KisTileData::HEIGHT;
 
     m_tilesCacheSize = m_bottomRow - m_topRow + 1;
     m_tilesCache.resize(m_tilesCacheSize);
@@ -118,7 +118,7 @@ void KisVLineIterator2::nextColumn()
     m_y = m_top;
     ++m_x;
 
-    if (++m_xInTile < KisTileData::HEIGHT) {
+    if (++m_xInTile < KisTileData::WIDTH) {
         /* do nothing, usual case */
     } else {
         ++m_column;
@@ -19,9 +19,17 @@
 #include "kis_abstract_tile_compressor.h"
 
 KisAbstractTileCompressor::KisAbstractTileCompressor()
+    : m_streamTileWidth(KisTileData::WIDTH),
+      m_streamTileHeight(KisTileData::HEIGHT)
 {
 }
 
 KisAbstractTileCompressor::~KisAbstractTileCompressor()
 {
 }
+
+void KisAbstractTileCompressor::setStreamTileSize(qint32 width, qint32 height)
+{
+    m_streamTileWidth = width;
+    m_streamTileHeight = height;
+}
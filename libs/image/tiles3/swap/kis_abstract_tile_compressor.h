@@ -90,6 +90,14 @@ public:
      */
     virtual qint32 tileDataBufferSize(KisTileData *tileData) = 0;
 
+    /**
+     * Sets the size of the tiles in the stream used by writeTile()
+     * and readTile(). It may differ from the size of the tiles in
+     * memory (see KRITA_TILE_SIZE), then the tiles are split or
+     * merged while streaming. By default the sizes are equal.
+     */
+    void setStreamTileSize(qint32 width, qint32 height);
+
 protected:
     inline qint32 xToCol(KisTiledDataManager *dm, qint32 x) {
         return dm->xToCol(x);
@@ -102,6 +110,24 @@ protected:
     inline qint32 pixelSize(KisTiledDataManager *dm) {
         return dm->pixelSize();
     }
+
+    /**
+     * Writes the data into \p dm bypassing its lock, the caller
+     * (the data manager's loading routine) holds it already
+     */
+    inline void writeBytes(KisTiledDataManager *dm, const quint8 *data,
+                           qint32 x, qint32 y, qint32 width, qint32 height) {
+        dm->writeBytesBody(data, x, y, width, height);
+    }
+
+    inline bool hasNativeStreamTileSize() const {
+        return m_streamTileWidth == KisTileData::WIDTH &&
+            m_streamTileHeight == KisTileData::HEIGHT;
+    }
+
+protected:
+    qint32 m_streamTileWidth;
+    qint32 m_streamTileHeight;
 };
 
 #endif /* __KIS_ABSTRACT_TILE_COMPRESSOR_H */
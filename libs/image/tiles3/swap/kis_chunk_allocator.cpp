@@ -44,13 +44,13 @@ KisChunkAllocator::~KisChunkAllocator()
 {
 }
 
-KisChunk KisChunkAllocator::getChunk(quint64 size)
+KisChunk KisChunkAllocator::getChunk(quint64 size, quint64 alignment)
 {
     KisChunkDataListIterator startPosition = m_iterator;
     START_COUNTING();
 
     forever {
-        if(tryInsertChunk(m_list, m_iterator, size))
+        if(tryInsertChunk(m_list, m_iterator, size, alignment))
             return WRAP_PREVIOUS_CHUNK_DATA(m_iterator);
 
         if(m_iterator == m_list.end())
@@ -64,7 +64,7 @@ KisChunk KisChunkAllocator::getChunk(quint64 size)
     m_iterator = m_list.begin();
 
     forever {
-        if(tryInsertChunk(m_list, m_iterator, size))
+        if(tryInsertChunk(m_list, m_iterator, size, alignment))
             return WRAP_PREVIOUS_CHUNK_DATA(m_iterator);
 
         if(m_iterator == m_list.end() || m_iterator == startPosition)
@@ -78,7 +78,7 @@ KisChunk KisChunkAllocator::getChunk(quint64 size)
     m_iterator = m_list.end();
 
     while ((m_storeSize += m_storeSlabSize) <= m_storeMaxSize) {
-        if(tryInsertChunk(m_list, m_iterator, size))
+        if(tryInsertChunk(m_list, m_iterator, size, alignment))
             return WRAP_PREVIOUS_CHUNK_DATA(m_iterator);
     }
 
@@ -90,7 +90,7 @@ KisChunk KisChunkAllocator::getChunk(quint64 size)
 
 bool KisChunkAllocator::tryInsertChunk(KisChunkDataList &list,
                                        KisChunkDataListIterator &iterator,
-                                       quint64 size)
+                                       quint64 size, quint64 alignment)
 {
     bool result = false;
     quint64 highBound = m_storeSize;
@@ -105,7 +105,14 @@ bool KisChunkAllocator::tryInsertChunk(KisChunkDataList &list,
         shift = 1;
     }
 
-    if(GAP_SIZE(lowBound, highBound) >= size) {
+    if (alignment > 1) {
+        const quint64 begin = (lowBound + shift + alignment - 1) / alignment * alignment;
+
+        if(begin + size <= highBound) {
+            list.insert(iterator, KisChunkData(begin, size));
+            result = true;
+        }
+    } else if(GAP_SIZE(lowBound, highBound) >= size) {
         list.insert(iterator, KisChunkData(lowBound + shift, size));
         result = true;
     }
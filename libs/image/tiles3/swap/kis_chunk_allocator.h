@@ -136,7 +136,13 @@ public:
         return m_list.size();
     }
 
-    KisChunk getChunk(quint64 size);
+    /**
+     * Allocates a chunk of \p size bytes. If \p alignment is
+     * greater than 1, the beginning of the chunk is aligned to it.
+     * It is used for the chunks that are mapped into memory
+     * directly, see KisMemoryWindow::mapChunkPrivate().
+     */
+    KisChunk getChunk(quint64 size, quint64 alignment = 1);
     void freeChunk(KisChunk chunk);
 
     void debugChunks();
@@ -146,7 +152,7 @@ public:
 private:
     bool tryInsertChunk(KisChunkDataList &list,
                         KisChunkDataListIterator &iterator,
-                        quint64 size);
+                        quint64 size, quint64 alignment);
 
 private:
     quint64 m_storeMaxSize;
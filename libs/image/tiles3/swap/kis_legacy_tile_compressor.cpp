@@ -64,6 +64,21 @@ bool KisLegacyTileCompressor::readTile(QIODevice *stream, KisTiledDataManager *d
 
     stream->readLine((char *)headerBuffer, bufferSize);
     sscanf((char *) headerBuffer, "%d,%d,%d,%d", &x, &y, &width, &height);
+    delete[] headerBuffer;
+
+    if (width != KisTileData::WIDTH || height != KisTileData::HEIGHT) {
+        /**
+         * The file has been written by a build with a different
+         * tile size, copy the data pixel-wise
+         */
+        if (width <= 0 || height <= 0) return false;
+
+        QByteArray data = stream->read(pixelSize(dm) * width * height);
+        if (data.size() != pixelSize(dm) * width * height) return false;
+
+        writeBytes(dm, (const quint8*)data.constData(), x, y, width, height);
+        return true;
+    }
 
     qint32 row = yToRow(dm, y);
     qint32 col = xToCol(dm, x);
@@ -77,6 +77,30 @@ quint8* KisMemoryWindow::getWriteChunkPtr(const KisChunkData &writeChunk)
     return m_writeWindowEx.calculatePointer(writeChunk);
 }
 
+quint8* KisMemoryWindow::mapChunkPrivate(const KisChunkData &chunk)
+{
+#ifdef Q_OS_UNIX
+    if (chunk.m_end >= (quint64)m_file.size()) {
+        return nullptr;
+    }
+
+    return m_file.map(chunk.m_begin, chunk.size(), QFileDevice::MapPrivateOption);
+#else
+    /**
+     * On Windows the file cannot be resized while any of its
+     * mappings is alive (see the comment in adjustWindow()),
+     * so we cannot keep the chunks mapped for a long time.
+     */
+    Q_UNUSED(chunk);
+    return nullptr;
+#endif
+}
+
+void KisMemoryWindow::unmapChunk(quint8 *ptr)
+{
+    m_file.unmap(ptr);
+}
+
 bool KisMemoryWindow::adjustWindow(const KisChunkData &requestedChunk,
                                    MappingWindow *adjustingWindow,
                                    MappingWindow *otherWindow)
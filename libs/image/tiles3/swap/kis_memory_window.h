@@ -47,6 +47,17 @@ public:
     quint8* getReadChunkPtr(const KisChunkData &readChunk);
     quint8* getWriteChunkPtr(const KisChunkData &writeChunk);
 
+    /**
+     * Maps the chunk into memory with a private (copy-on-write)
+     * mapping. The memory may be modified, but the changes never
+     * reach the swap file. Returns null if such a mapping is not
+     * possible on the current platform.
+     *
+     * The mapping must be released with unmapChunk()
+     */
+    quint8* mapChunkPrivate(const KisChunkData &chunk);
+    void unmapChunk(quint8 *ptr);
+
 private:
     struct MappingWindow {
         MappingWindow(quint64 _defaultSize)
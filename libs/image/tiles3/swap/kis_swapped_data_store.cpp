@@ -21,12 +21,26 @@
 #include "kis_memory_window.h"
 #include "kis_image_config.h"
 
-#include "kis_tile_compressor_2.h"
+#include "kis_tile_compressor_factory.h"
 
-//#define COMPRESSOR_VERSION 2
+/**
+ * Every mapped tile costs a separate memory mapping, and the number
+ * of mappings per process is limited by the OS (64K on Linux by
+ * default), so only that many tiles are mapped at the same time.
+ * The rest is read from the swap file as usual.
+ */
+#define MAX_MAPPED_TILES 16384
+
+/**
+ * In "fast swap" mode the chunks are aligned to a memory page, so
+ * the mapped tiles do not share the pages with their neighbours
+ */
+#define FAST_SWAP_CHUNK_ALIGNMENT 4096
 
 KisSwappedDataStore::KisSwappedDataStore()
-    : m_memoryMetric(0)
+    : m_memoryMetric(0),
+      m_numMappedTiles(0),
+      m_numUniformTiles(0)
 {
     KisImageConfig config(true);
     const quint64 maxSwapSize = config.maxSwapSize() * MiB;
@@ -36,8 +50,8 @@ KisSwappedDataStore::KisSwappedDataStore()
     m_allocator = new KisChunkAllocator(swapSlabSize, maxSwapSize);
     m_swapSpace = new KisMemoryWindow(config.swapDir(), swapWindowSize);
 
-    // FIXME: use a factory after the patch is committed
-    m_compressor = new KisTileCompressor2();
+    m_compressor = KisTileCompressorFactory::createForSwap();
+    m_fastMode = config.fastSwap();
 }
 
 KisSwappedDataStore::~KisSwappedDataStore()
@@ -52,7 +66,22 @@ quint64 KisSwappedDataStore::numTiles() const
     // We are not acquiring the lock here...
     // Hope QLinkedList will ensure atomic access to it's size...
 
-    return m_allocator->numChunks();
+    return m_allocator->numChunks() - m_numMappedTiles + m_numUniformTiles;
+}
+
+bool KisSwappedDataStore::compressesSwappedData() const
+{
+    return !m_fastMode;
+}
+
+int KisSwappedDataStore::numMappedTiles() const
+{
+    return m_numMappedTiles;
+}
+
+int KisSwappedDataStore::numUniformTiles() const
+{
+    return m_numUniformTiles;
 }
 
 bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
@@ -66,6 +95,26 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
      * So we can modify the tile data freely.
      */
 
+    if (td->isUniform() || td->checkUniform()) {
+        swapOutUniformTileData(td);
+        return true;
+    }
+
+    if (td->isMapped() && !td->isMappedDataDirty()) {
+        /**
+         * The chunk in the swap file is still valid,
+         * so just drop the mapping
+         */
+        releaseMappedData(td);
+        td->releaseMemory();
+        m_memoryMetric += td->pixelSize();
+        return true;
+    }
+
+    if (m_fastMode) {
+        return writeSwapChunk(td, td->data(), td->pixelSize() * KisTileData::WIDTH * KisTileData::HEIGHT);
+    }
+
     const qint32 expectedBufferSize = m_compressor->tileDataBufferSize(td);
     if(m_buffer.size() < expectedBufferSize)
         m_buffer.resize(expectedBufferSize);
@@ -73,13 +122,36 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
     qint32 bytesWritten;
     m_compressor->compressTileData(td, (quint8*) m_buffer.data(), m_buffer.size(), bytesWritten);
 
-    KisChunk chunk = m_allocator->getChunk(bytesWritten);
+    return writeSwapChunk(td, (quint8*) m_buffer.data(), bytesWritten);
+}
+
+bool KisSwappedDataStore::trySwapOutCompressedTileData(KisTileData *td, const quint8 *buffer, qint32 bufferSize)
+{
+    Q_ASSERT(td->data());
+    QMutexLocker locker(&m_lock);
+
+    return writeSwapChunk(td, buffer, bufferSize);
+}
+
+bool KisSwappedDataStore::writeSwapChunk(KisTileData *td, const quint8 *buffer, qint32 bufferSize)
+{
+    KisChunk chunk = m_fastMode ?
+        m_allocator->getChunk(bufferSize, FAST_SWAP_CHUNK_ALIGNMENT) :
+        m_allocator->getChunk(bufferSize);
+
     quint8 *ptr = m_swapSpace->getWriteChunkPtr(chunk);
     if (!ptr) {
         qWarning() << "swap out of tile failed";
         return false;
     }
-    memcpy(ptr, m_buffer.data(), bytesWritten);
+    memcpy(ptr, buffer, bufferSize);
+
+    if (td->isMapped()) {
+        // the old chunk is outdated, the data has been written to a new one
+        KisChunk oldChunk = td->swapChunk();
+        releaseMappedData(td);
+        m_allocator->freeChunk(oldChunk);
+    }
 
     td->releaseMemory();
     td->setSwapChunk(chunk);
@@ -89,6 +161,20 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
     return true;
 }
 
+void KisSwappedDataStore::swapOutUniformTileData(KisTileData *td)
+{
+    if (td->isMapped()) {
+        KisChunk oldChunk = td->swapChunk();
+        releaseMappedData(td);
+        m_allocator->freeChunk(oldChunk);
+        td->setSwapChunk(KisChunk());
+    }
+
+    td->setSwappedUniformPixel(td->data());
+    td->releaseMemory();
+    m_numUniformTiles++;
+}
+
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
 {
     Q_ASSERT(!td->data());
@@ -96,14 +182,49 @@ void KisSwappedDataStore::swapInTileData(KisTileData *td)
 
     // see comment in swapOutTileData()
 
+    if (const quint8 *pixel = td->swappedUniformPixel()) {
+        const int pixelSize = td->pixelSize();
+
+        td->allocateMemory();
+        quint8 *it = td->data();
+        for (int i = 0; i < KisTileData::WIDTH * KisTileData::HEIGHT; i++, it += pixelSize) {
+            memcpy(it, pixel, pixelSize);
+        }
+
+        td->setSwappedUniformPixel(0);
+        m_numUniformTiles--;
+        return;
+    }
+
     KisChunk chunk = td->swapChunk();
 
+    if (m_fastMode && m_numMappedTiles < MAX_MAPPED_TILES) {
+        /**
+         * Zero-copy path: the chunk stays allocated and the tile
+         * uses the mapped memory directly. The writes to it are
+         * copy-on-write on the OS level, they never reach the file.
+         */
+        quint8 *mappedPtr = m_swapSpace->mapChunkPrivate(chunk.data());
+        if (mappedPtr) {
+            td->setMappedData(mappedPtr);
+            m_numMappedTiles++;
+            m_memoryMetric -= td->pixelSize();
+            return;
+        }
+    }
+
     td->allocateMemory();
     td->setSwapChunk(KisChunk());
 
     quint8 *ptr = m_swapSpace->getReadChunkPtr(chunk);
     Q_ASSERT(ptr);
-    m_compressor->decompressTileData(ptr, chunk.size(), td);
+
+    if (m_fastMode) {
+        KIS_SAFE_ASSERT_RECOVER_NOOP(chunk.size() == quint64(td->pixelSize() * KisTileData::WIDTH * KisTileData::HEIGHT));
+        memcpy(td->data(), ptr, chunk.size());
+    } else {
+        m_compressor->decompressTileData(ptr, chunk.size(), td);
+    }
     m_allocator->freeChunk(chunk);
 
     m_memoryMetric -= td->pixelSize();
@@ -113,10 +234,27 @@ void KisSwappedDataStore::forgetTileData(KisTileData *td)
 {
     QMutexLocker locker(&m_lock);
 
+    if (td->swappedUniformPixel()) {
+        td->setSwappedUniformPixel(0);
+        m_numUniformTiles--;
+        return;
+    }
+
+    if (td->isMapped()) {
+        // the data has already been excluded from the metric on mapping
+        releaseMappedData(td);
+    } else {
+        m_memoryMetric -= td->pixelSize();
+    }
+
     m_allocator->freeChunk(td->swapChunk());
     td->setSwapChunk(KisChunk());
+}
 
-    m_memoryMetric -= td->pixelSize();
+void KisSwappedDataStore::releaseMappedData(KisTileData *td)
+{
+    m_swapSpace->unmapChunk(td->takeMappedData());
+    m_numMappedTiles--;
 }
 
 qint64 KisSwappedDataStore::totalMemoryMetric() const
@@ -124,6 +262,22 @@ qint64 KisSwappedDataStore::totalMemoryMetric() const
     return m_memoryMetric;
 }
 
+void KisSwappedDataStore::testingRereadConfig()
+{
+    QMutexLocker locker(&m_lock);
+
+    if (m_allocator->numChunks()) {
+        qWarning() << "KisSwappedDataStore: the swap file is not empty, keeping old swap settings";
+        return;
+    }
+
+    KisImageConfig config(true);
+
+    delete m_compressor;
+    m_compressor = KisTileCompressorFactory::createForSwap();
+    m_fastMode = config.fastSwap();
+}
+
 void KisSwappedDataStore::debugStatistics()
 {
     m_allocator->sanityCheck();
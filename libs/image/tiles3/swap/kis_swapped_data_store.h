@@ -44,12 +44,26 @@ public:
 
     /**
      * Swap out the data stored in the \a td to the swap file
-     * and free memory occupied by td->data().
+     * and free memory occupied by td->data(). Uniform tile data
+     * is swapped out as a single pixel, without touching the file.
      * LOCKING: the lock on the tile data should be taken
      *          by the caller before making a call.
      */
     bool trySwapOutTileData(KisTileData *td);
 
+    /**
+     * Same as trySwapOutTileData(), but the data of \a td has
+     * already been compressed by the caller into \a buffer,
+     * so only a chunk allocation and a copy happen under the
+     * store's lock. Used by the batched swap-out of
+     * KisTileDataSwapper, which compresses tiles in parallel.
+     * The buffer must have been produced by a compressor
+     * of KisTileCompressor2 type.
+     * LOCKING: the lock on the tile data should be taken
+     *          by the caller before making a call.
+     */
+    bool trySwapOutCompressedTileData(KisTileData *td, const quint8 *buffer, qint32 bufferSize);
+
     /**
      * Restore the data of a \a td basing on information
      * stored in the swap file.
@@ -61,10 +75,30 @@ public:
     /**
      * Forget all the information linked with the tile data.
      * This should be done before deleting of the tile data,
-     * whose actual data is swapped-out
+     * whose actual data is swapped-out or mapped from the
+     * swap file
      */
     void forgetTileData(KisTileData *td);
 
+    /**
+     * Returns false if the store works in "fast swap" mode, that
+     * is the tiles are stored uncompressed and the callers should
+     * not waste time on compressing them in advance.
+     */
+    bool compressesSwappedData() const;
+
+    /**
+     * Returns number of tile data objects, whose data is
+     * mapped directly from the swap file
+     */
+    int numMappedTiles() const;
+
+    /**
+     * Returns number of tile data objects, which are uniform
+     * and swapped out as a single pixel
+     */
+    int numUniformTiles() const;
+
     /**
      * Retorns the metric of the total memory stored in the swap
      * in *uncompressed* form!
@@ -76,6 +110,18 @@ public:
      */
     void debugStatistics();
 
+    /**
+     * Rereads the swap mode and the codec from the config. The
+     * format of the chunks depends on them, so the settings are
+     * changed only if the swap file is empty.
+     */
+    void testingRereadConfig();
+
+private:
+    bool writeSwapChunk(KisTileData *td, const quint8 *buffer, qint32 bufferSize);
+    void releaseMappedData(KisTileData *td);
+    void swapOutUniformTileData(KisTileData *td);
+
 private:
     QByteArray m_buffer;
     KisAbstractTileCompressor *m_compressor;
@@ -86,6 +132,10 @@ private:
     QMutex m_lock;
 
     qint64 m_memoryMetric;
+
+    bool m_fastMode;
+    int m_numMappedTiles;
+    int m_numUniformTiles;
 };
 
 #endif /* __KIS_SWAPPED_DATA_STORE_H */
@@ -19,24 +19,127 @@
 #include "kis_tile_compressor_2.h"
 #include "kis_lzf_compression.h"
 #include <QIODevice>
+#include <algorithm>
 #include "kis_paint_device_writer.h"
-#define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
+#include "kis_debug.h"
+
+#include <config-swap-compression.h>
+
+#ifdef HAVE_LZ4
+#include "kis_lz4_compression.h"
+#endif
 
-const QString KisTileCompressor2::m_compressionName = "LZF";
+#ifdef HAVE_ZSTD
+#include "kis_zstd_compression.h"
+#endif
+
+#define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
 
 
-KisTileCompressor2::KisTileCompressor2()
+KisTileCompressor2::KisTileCompressor2(CompressionType compressionType, int compressionLevel)
+    : m_compressionType(isCompressionTypeSupported(compressionType) ? compressionType : LZF),
+      m_compressionLevel(compressionLevel)
 {
-    m_compression = new KisLzfCompression();
+    std::fill(m_compressions, m_compressions + MAX_COMPRESSION_TYPE + 1, nullptr);
 }
 
 KisTileCompressor2::~KisTileCompressor2()
 {
-    delete m_compression;
+    for (int i = 0; i <= MAX_COMPRESSION_TYPE; i++) {
+        delete m_compressions[i];
+    }
+}
+
+KisTileCompressor2::CompressionType KisTileCompressor2::compressionType() const
+{
+    return m_compressionType;
+}
+
+bool KisTileCompressor2::isCompressionTypeSupported(CompressionType type)
+{
+    switch (type) {
+    case LZF:
+        return true;
+    case LZ4:
+#ifdef HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case ZSTD:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+KisTileCompressor2::CompressionType KisTileCompressor2::compressionTypeFromName(const QString &name)
+{
+    CompressionType type = LZF;
+
+    if (name.compare("LZ4", Qt::CaseInsensitive) == 0) {
+        type = LZ4;
+    } else if (name.compare("ZSTD", Qt::CaseInsensitive) == 0) {
+        type = ZSTD;
+    }
+
+    return isCompressionTypeSupported(type) ? type : LZF;
+}
+
+QString KisTileCompressor2::compressionTypeToName(CompressionType type)
+{
+    switch (type) {
+    case LZF:
+        return "LZF";
+    case LZ4:
+        return "LZ4";
+    case ZSTD:
+        return "ZSTD";
+    }
+
+    return "LZF";
+}
+
+KisAbstractCompression* KisTileCompressor2::compressionForType(qint8 type)
+{
+    if (type <= RAW_DATA_FLAG || type > MAX_COMPRESSION_TYPE) return 0;
+
+    KisAbstractCompression *&compression = m_compressions[type];
+
+    if (!compression) {
+        switch (type) {
+        case LZF:
+            compression = new KisLzfCompression();
+            break;
+#ifdef HAVE_LZ4
+        case LZ4:
+            compression = new KisLz4Compression();
+            break;
+#endif
+#ifdef HAVE_ZSTD
+        case ZSTD:
+            compression = new KisZstdCompression(m_compressionLevel);
+            break;
+#endif
+        default:
+            warnTiles << "Compression type" << type << "is not supported by this build of Krita";
+            break;
+        }
+    }
+
+    return compression;
 }
 
 bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
 {
+    if (!hasNativeStreamTileSize()) {
+        return writeSplitTile(tile, store);
+    }
+
     const qint32 tileDataSize = TILE_DATA_SIZE(tile->pixelSize());
     prepareStreamingBuffer(tileDataSize);
 
@@ -47,7 +150,7 @@ bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
                      m_streamingBuffer.size(), bytesWritten);
     tile->unlockForRead();
 
-    QString header = getHeader(tile, bytesWritten);
+    QString header = getHeader(tile->extent().x(), tile->extent().y(), bytesWritten);
     bool retval = true;
     retval = store.write(header.toLatin1());
     if (!retval) {
@@ -60,9 +163,61 @@ bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
     return retval;
 }
 
+/**
+ * Writes the tile as a set of smaller tiles of the stream tile size
+ */
+bool KisTileCompressor2::writeSplitTile(KisTileSP tile, KisPaintDeviceWriter &store)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(KisTileData::WIDTH % m_streamTileWidth == 0 &&
+                                         KisTileData::HEIGHT % m_streamTileHeight == 0, false);
+
+    const qint32 pixelSize = tile->pixelSize();
+    const qint32 streamRowSize = m_streamTileWidth * pixelSize;
+    const qint32 tileRowSize = KisTileData::WIDTH * pixelSize;
+    const qint32 streamTileDataSize = streamRowSize * m_streamTileHeight;
+    const QPoint tileOrigin = tile->extent().topLeft();
+
+    prepareStreamingBuffer(streamTileDataSize);
+    m_streamTileBuffer.resize(streamTileDataSize);
+
+    bool retval = true;
+
+    tile->lockForRead();
+
+    for (qint32 y = 0; retval && y < KisTileData::HEIGHT; y += m_streamTileHeight) {
+        for (qint32 x = 0; retval && x < KisTileData::WIDTH; x += m_streamTileWidth) {
+            const quint8 *srcPtr = tile->data() + y * tileRowSize + x * pixelSize;
+            quint8 *dstPtr = (quint8*)m_streamTileBuffer.data();
+
+            for (qint32 row = 0; row < m_streamTileHeight; row++) {
+                memcpy(dstPtr, srcPtr, streamRowSize);
+                srcPtr += tileRowSize;
+                dstPtr += streamRowSize;
+            }
+
+            qint32 bytesWritten = 0;
+            compressData((const quint8*)m_streamTileBuffer.constData(), streamTileDataSize, pixelSize,
+                         (quint8*)m_streamingBuffer.data(), bytesWritten);
+
+            QString header = getHeader(tileOrigin.x() + x, tileOrigin.y() + y, bytesWritten);
+            retval = store.write(header.toLatin1()) &&
+                store.write(m_streamingBuffer.data(), bytesWritten);
+        }
+    }
+
+    tile->unlockForRead();
+
+    if (!retval) {
+        warnFile << "Failed to write the split tile";
+    }
+
+    return retval;
+}
+
 bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
 {
-    const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize(dm));
+    const qint32 pixelSize = this->pixelSize(dm);
+    const qint32 tileDataSize = pixelSize * m_streamTileWidth * m_streamTileHeight;
     prepareStreamingBuffer(tileDataSize);
 
     QByteArray header = stream->readLine(maxHeaderLength());
@@ -75,15 +230,37 @@ bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
         qint32 dataSize = headerItems.takeFirst().toInt();
 
         Q_ASSERT(headerItems.isEmpty());
-        Q_ASSERT(compressionName == m_compressionName);
+
+        /**
+         * The actual codec is recorded in the data block itself,
+         * so the name is purely informational.
+         */
+        Q_UNUSED(compressionName);
+
+        if (dataSize > m_streamingBuffer.size()) {
+            warnFile << "Tile data block is too big:" << dataSize;
+            return false;
+        }
+
+        stream->read(m_streamingBuffer.data(), dataSize);
+
+        if (!hasNativeStreamTileSize()) {
+            m_streamTileBuffer.resize(tileDataSize);
+
+            bool res = decompressData((quint8*)m_streamingBuffer.data(), dataSize,
+                                      (quint8*)m_streamTileBuffer.data(), tileDataSize, pixelSize);
+            if (res) {
+                writeBytes(dm, (const quint8*)m_streamTileBuffer.constData(),
+                           x, y, m_streamTileWidth, m_streamTileHeight);
+            }
+            return res;
+        }
 
         qint32 row = yToRow(dm, y);
         qint32 col = xToCol(dm, x);
 
         KisTileSP tile = dm->getTile(col, row, true);
 
-        stream->read(m_streamingBuffer.data(), dataSize);
-
         tile->lockForWrite();
         bool res = decompressTileData((quint8*)m_streamingBuffer.data(), dataSize, tile->tileData());
         tile->unlockForWrite();
@@ -103,7 +280,7 @@ void KisTileCompressor2::prepareStreamingBuffer(qint32 tileDataSize)
 
 void KisTileCompressor2::prepareWorkBuffers(qint32 tileDataSize)
 {
-    const qint32 bufferSize = m_compression->outputBufferSize(tileDataSize);
+    const qint32 bufferSize = compressionForType(m_compressionType)->outputBufferSize(tileDataSize);
 
     m_linearizationBuffer.resize(tileDataSize);
     m_compressionBuffer.resize(bufferSize);
@@ -116,27 +293,35 @@ void KisTileCompressor2::compressTileData(KisTileData *tileData,
 {
     const qint32 pixelSize = tileData->pixelSize();
     const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize);
-    qint32 compressedBytes;
 
     Q_UNUSED(bufferSize);
     Q_ASSERT(bufferSize >= tileDataSize + 1);
 
+    compressData(tileData->data(), tileDataSize, pixelSize, buffer, bytesWritten);
+}
+
+void KisTileCompressor2::compressData(const quint8 *data, qint32 tileDataSize, qint32 pixelSize,
+                                      quint8 *buffer, qint32 &bytesWritten)
+{
+    qint32 compressedBytes;
+
     prepareWorkBuffers(tileDataSize);
 
-    KisAbstractCompression::linearizeColors(tileData->data(), (quint8*)m_linearizationBuffer.data(),
+    KisAbstractCompression::linearizeColors(const_cast<quint8*>(data), (quint8*)m_linearizationBuffer.data(),
                                             tileDataSize, pixelSize);
 
-    compressedBytes = m_compression->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
-                                              (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
+    KisAbstractCompression *compression = compressionForType(m_compressionType);
+    compressedBytes = compression->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
+                                            (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
 
-    if(compressedBytes < tileDataSize) {
-        buffer[0] = COMPRESSED_DATA_FLAG;
+    if(compressedBytes > 0 && compressedBytes < tileDataSize) {
+        buffer[0] = m_compressionType;
         memcpy(buffer + 1, m_compressionBuffer.data(), compressedBytes);
         bytesWritten = compressedBytes + 1;
     }
     else {
         buffer[0] = RAW_DATA_FLAG;
-        memcpy(buffer + 1, tileData->data(), tileDataSize);
+        memcpy(buffer + 1, data, tileDataSize);
         bytesWritten = tileDataSize + 1;
     }
 }
@@ -148,22 +333,31 @@ bool KisTileCompressor2::decompressTileData(quint8 *buffer,
     const qint32 pixelSize = tileData->pixelSize();
     const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize);
 
-    if(buffer[0] == COMPRESSED_DATA_FLAG) {
-        prepareWorkBuffers(tileDataSize);
+    return decompressData(buffer, bufferSize, tileData->data(), tileDataSize, pixelSize);
+}
+
+bool KisTileCompressor2::decompressData(quint8 *buffer, qint32 bufferSize,
+                                        quint8 *data, qint32 tileDataSize, qint32 pixelSize)
+{
+    if(buffer[0] != RAW_DATA_FLAG) {
+        KisAbstractCompression *compression = compressionForType(buffer[0]);
+        if (!compression) return false;
+
+        m_linearizationBuffer.resize(tileDataSize);
 
         qint32 bytesWritten;
-        bytesWritten = m_compression->decompress(buffer + 1, bufferSize - 1,
-                                                 (quint8*)m_linearizationBuffer.data(), tileDataSize);
+        bytesWritten = compression->decompress(buffer + 1, bufferSize - 1,
+                                               (quint8*)m_linearizationBuffer.data(), tileDataSize);
         if (bytesWritten == tileDataSize) {
             KisAbstractCompression::delinearizeColors((quint8*)m_linearizationBuffer.data(),
-                                                      tileData->data(),
+                                                      data,
                                                       tileDataSize, pixelSize);
             return true;
         }
         return false;
     }
     else {
-        memcpy(tileData->data(), buffer + 1, tileDataSize);
+        memcpy(data, buffer + 1, tileDataSize);
         return true;
     }
     return false;
@@ -184,12 +378,8 @@ inline qint32 KisTileCompressor2::maxHeaderLength()
     return 3 * QINT32_LENGTH + COMPRESSION_NAME_LENGTH + SEPARATORS_LENGTH;
 }
 
-inline QString KisTileCompressor2::getHeader(KisTileSP tile,
+inline QString KisTileCompressor2::getHeader(qint32 x, qint32 y,
                                              qint32 compressedSize)
 {
-    qint32 x, y;
-    qint32 width, height;
-    tile->extent().getRect(&x, &y, &width, &height);
-
-    return QString("%1,%2,%3,%4\n").arg(x).arg(y).arg(m_compressionName).arg(compressedSize);
+    return QString("%1,%2,%3,%4\n").arg(x).arg(y).arg(compressionTypeToName(m_compressionType)).arg(compressedSize);
 }
@@ -23,10 +23,28 @@
 
 class KisAbstractCompression;
 
+/**
+ * Compresses tiles with one of the supported codecs. The codec used
+ * for compression is recorded in the first byte of every compressed
+ * tile, so the compressor can decompress data written by any codec,
+ * not only by the one it was created with. That is, changing the
+ * codec of the swap file in runtime is safe.
+ */
 class KRITAIMAGE_EXPORT KisTileCompressor2 : public KisAbstractTileCompressor
 {
 public:
-    KisTileCompressor2();
+    /**
+     * The values are written into the swap file and the .kra
+     * files, don't change them!
+     */
+    enum CompressionType {
+        LZF = 1,
+        LZ4 = 2,
+        ZSTD = 3
+    };
+
+public:
+    KisTileCompressor2(CompressionType compressionType = LZF, int compressionLevel = 3);
     ~KisTileCompressor2() override;
 
     bool writeTile(KisTileSP tile, KisPaintDeviceWriter &store) override;
@@ -38,27 +56,64 @@ public:
     bool decompressTileData(quint8 *buffer, qint32 bufferSize, KisTileData *tileData) override;
     qint32 tileDataBufferSize(KisTileData *tileData) override;
 
+    /**
+     * Compress/decompress an arbitrary buffer of pixels in the same
+     * format as the tile data. The \p buffer should be at least
+     * dataSize + 1 bytes long for compression.
+     */
+    void compressData(const quint8 *data, qint32 dataSize, qint32 pixelSize,
+                      quint8 *buffer, qint32 &bytesWritten);
+    bool decompressData(quint8 *buffer, qint32 bufferSize,
+                        quint8 *data, qint32 dataSize, qint32 pixelSize);
+
+    CompressionType compressionType() const;
+
+    /**
+     * Returns true if \p type has been built into Krita
+     */
+    static bool isCompressionTypeSupported(CompressionType type);
+
+    /**
+     * Converts a name of the codec, as written in the config
+     * or in the tile header, into a compression type. If the codec
+     * is unknown or is not supported by the build, LZF is returned.
+     */
+    static CompressionType compressionTypeFromName(const QString &name);
+    static QString compressionTypeToName(CompressionType type);
+
 private:
     /**
      * Quite self describing
      */
     qint32 maxHeaderLength();
 
-    QString getHeader(KisTileSP tile, qint32 compressedSize);
+    QString getHeader(qint32 x, qint32 y, qint32 compressedSize);
+
+    bool writeSplitTile(KisTileSP tile, KisPaintDeviceWriter &store);
 
     void prepareWorkBuffers(qint32 tileDataSize);
     void prepareStreamingBuffer(qint32 tileDataSize);
 
+    KisAbstractCompression* compressionForType(qint8 type);
+
 private:
     static const qint8 RAW_DATA_FLAG = 0;
-    static const qint8 COMPRESSED_DATA_FLAG = 1;
+    static const qint8 MAX_COMPRESSION_TYPE = ZSTD;
 
 private:
     QByteArray m_linearizationBuffer;
     QByteArray m_compressionBuffer;
     QByteArray m_streamingBuffer;
-    KisAbstractCompression *m_compression;
-    static const QString m_compressionName;
+    QByteArray m_streamTileBuffer;
+
+    CompressionType m_compressionType;
+    int m_compressionLevel;
+
+    /**
+     * The codecs are created lazily, when the data
+     * compressed with them is met for the first time
+     */
+    KisAbstractCompression *m_compressions[MAX_COMPRESSION_TYPE + 1];
 };
 
 #endif /* __KIS_TILE_COMPRESSOR_2_H */
@@ -21,6 +21,7 @@
 
 #include "tiles3/swap/kis_legacy_tile_compressor.h"
 #include "tiles3/swap/kis_tile_compressor_2.h"
+#include "kis_image_config.h"
 
 class KRITAIMAGE_EXPORT KisTileCompressorFactory
 {
@@ -39,6 +40,19 @@ public:
         };
     }
 
+    /**
+     * Creates a compressor for the swap file with the codec
+     * selected in KisImageConfig. The codec is recorded in every
+     * swapped chunk, so the swap file may contain tiles compressed
+     * with different codecs.
+     */
+    static KisAbstractTileCompressor* createForSwap() {
+        KisImageConfig config(true);
+        return new KisTileCompressor2(
+            KisTileCompressor2::compressionTypeFromName(config.swapCompression()),
+            config.swapCompressionLevel());
+    }
+
 private:
     KisTileCompressorFactory();
 };
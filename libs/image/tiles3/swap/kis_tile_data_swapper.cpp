@@ -17,9 +17,12 @@
  */
 
 #include <QSemaphore>
+#include <QElapsedTimer>
+#include <QtConcurrent>
 
 #include "tiles3/swap/kis_tile_data_swapper.h"
 #include "tiles3/swap/kis_tile_data_swapper_p.h"
+#include "tiles3/swap/kis_tile_compressor_factory.h"
 #include "tiles3/kis_tile_data.h"
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
@@ -30,6 +33,10 @@
 const qint32 KisTileDataSwapper::TIMEOUT = -1;
 const qint32 KisTileDataSwapper::DELAY = 0.7 * SEC;
 
+const int KisTileDataSwapper::MIN_BATCH_SIZE = 16;
+const int KisTileDataSwapper::MAX_BATCH_SIZE = 1024;
+const int KisTileDataSwapper::COMMIT_TIMEOUT = 50;
+
 //#define DEBUG_SWAPPER
 
 #ifdef DEBUG_SWAPPER
@@ -40,10 +47,62 @@ const qint32 KisTileDataSwapper::DELAY = 0.7 * SEC;
 #define DEBUG_VALUE(value)
 #endif
 
+class HistorySwapStrategy;
 class SoftSwapStrategy;
 class AggressiveSwapStrategy;
 
 
+/**
+ * Compresses a contiguous slice of the batch. Every job owns its
+ * own compressor, because the compressors keep internal buffers.
+ */
+struct CompressionJob
+{
+    CompressionJob() {}
+    CompressionJob(KisAbstractTileCompressor *_compressor,
+                   const QVector<KisTileData*> *_batch,
+                   QVector<QByteArray> *_compressedData,
+                   int _begin, int _end)
+        : compressor(_compressor),
+          batch(_batch),
+          compressedData(_compressedData),
+          begin(_begin),
+          end(_end)
+    {
+    }
+
+    void run() {
+        for (int i = begin; i < end; i++) {
+            KisTileData *td = batch->at(i);
+            QByteArray &buffer = (*compressedData)[i];
+
+            // uniform tiles are swapped out as a single pixel
+            if (td->isUniform() || td->checkUniform()) {
+                buffer.clear();
+                continue;
+            }
+
+            buffer.resize(compressor->tileDataBufferSize(td));
+
+            qint32 bytesWritten = 0;
+            compressor->compressTileData(td, (quint8*)buffer.data(), buffer.size(), bytesWritten);
+            buffer.resize(bytesWritten);
+        }
+    }
+
+    KisAbstractTileCompressor *compressor = 0;
+    const QVector<KisTileData*> *batch = 0;
+    QVector<QByteArray> *compressedData = 0;
+    int begin = 0;
+    int end = 0;
+};
+
+struct CompressionJobWrapper {
+    inline void operator() (CompressionJob &job) {
+        job.run();
+    }
+};
+
 struct Q_DECL_HIDDEN KisTileDataSwapper::Private
 {
 public:
@@ -52,6 +111,22 @@ public:
     KisTileDataStore *store;
     KisStoreLimits limits;
     QMutex cycleLock;
+
+    QVector<KisAbstractTileCompressor*> compressors;
+    int batchSize = MAX_BATCH_SIZE;
+
+    mutable QMutex statisticsLock;
+    Statistics statistics;
+
+    void createCompressors() {
+        qDeleteAll(compressors);
+        compressors.clear();
+
+        const int numCompressors = qBound(1, QThread::idealThreadCount(), 8);
+        for (int i = 0; i < numCompressors; i++) {
+            compressors << KisTileCompressorFactory::createForSwap();
+        }
+    }
 };
 
 KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
@@ -60,10 +135,13 @@ KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
 {
     m_d->shouldExitFlag = 0;
     m_d->store = store;
+    m_d->createCompressors();
+    m_d->statistics.currentBatchSize = m_d->batchSize;
 }
 
 KisTileDataSwapper::~KisTileDataSwapper()
 {
+    qDeleteAll(m_d->compressors);
     delete m_d;
 }
 
@@ -122,10 +200,23 @@ void KisTileDataSwapper::doJob()
     DEBUG_VALUE(m_d->store->numTilesInMemory());
     DEBUG_VALUE(memoryMetric);
 
+    DEBUG_VALUE(m_d->limits.historyLimitThreshold());
     DEBUG_VALUE(m_d->limits.softLimitThreshold());
     DEBUG_VALUE(m_d->limits.hardLimitThreshold());
 
 
+    if(memoryMetric > m_d->limits.historyLimitThreshold()) {
+        qint32 historyFree = memoryMetric - m_d->limits.historyLimit();
+        DEBUG_VALUE(historyFree);
+        DEBUG_ACTION("\t pass-1");
+        const qint64 freedMetric = pass<HistorySwapStrategy>(historyFree);
+        memoryMetric -= freedMetric;
+        DEBUG_VALUE(memoryMetric);
+
+        QMutexLocker l(&m_d->statisticsLock);
+        m_d->statistics.historySwappedOutMetric += freedMetric;
+    }
+
     if(memoryMetric > m_d->limits.softLimitThreshold()) {
         qint32 softFree =  memoryMetric - m_d->limits.softLimit();
         DEBUG_VALUE(softFree);
@@ -144,6 +235,30 @@ void KisTileDataSwapper::doJob()
 }
 
 
+class HistorySwapStrategy
+{
+public:
+    typedef KisTileDataStoreIterator iterator;
+
+    static inline iterator* beginIteration(KisTileDataStore *store) {
+        return store->beginIteration();
+    }
+
+    static inline void endIteration(KisTileDataStore *store, iterator *iter) {
+        store->endIteration(iter);
+    }
+
+    static inline bool isInteresting(KisTileData *td) {
+        // Only the tiles of old revisions, the user is unlikely to undo them
+        return td->historical() && td->isDeepHistory();
+    }
+
+    static inline bool swapOutFirst(KisTileData *td) {
+        Q_UNUSED(td);
+        return true;
+    }
+};
+
 class SoftSwapStrategy
 {
 public:
@@ -192,10 +307,85 @@ public:
 };
 
 
+/**
+ * The swapping is done in a pipelined way to keep the store's lock
+ * held for as short time as possible:
+ *
+ * 1) selection: the store is locked and the victims are chosen. Their
+ *    swap locks are taken, so no one can access them, but all the other
+ *    tiles can be created and accessed freely after that;
+ *
+ * 2) compression: the victims are compressed in parallel on the global
+ *    thread pool, the store is not locked;
+ *
+ * 3) writing: the store is locked again and the compressed data is
+ *    appended to the swap file by KisSwappedDataStore.
+ *
+ * If the store cannot be locked in COMMIT_TIMEOUT ms, the batch
+ * is dropped and the size of the next batch is decreased (back-pressure).
+ */
 template<class strategy>
 qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
 {
     qint64 freedMetric = 0;
+
+    while (freedMetric < needToFreeMetric) {
+        QElapsedTimer timer;
+        timer.start();
+
+        QVector<KisTileData*> batch = selectBatch<strategy>(needToFreeMetric - freedMetric);
+        const qint64 selectionTime = timer.restart();
+
+        if (batch.isEmpty()) break;
+
+        QVector<QByteArray> compressedData;
+        if (m_d->store->compressesSwappedData()) {
+            compressBatch(batch, &compressedData);
+        } else {
+            compressedData.resize(batch.size());
+        }
+        const qint64 compressionTime = timer.restart();
+
+        const qint64 batchMetric = m_d->store->commitSwapOut(batch, compressedData, COMMIT_TIMEOUT);
+        const qint64 writeTime = timer.elapsed();
+
+        const bool rejected = batchMetric < 0;
+
+        if (rejected) {
+            m_d->batchSize = qMax(MIN_BATCH_SIZE, m_d->batchSize / 2);
+        } else {
+            m_d->batchSize = qMin(MAX_BATCH_SIZE, m_d->batchSize * 2);
+            freedMetric += batchMetric;
+        }
+
+        {
+            QMutexLocker l(&m_d->statisticsLock);
+            Statistics &stats = m_d->statistics;
+
+            stats.numBatches++;
+            stats.numTilesSelected += batch.size();
+            stats.numRejectedBatches += rejected;
+            stats.swappedOutMetric += qMax(qint64(0), batchMetric);
+            stats.selectionTime += selectionTime;
+            stats.compressionTime += compressionTime;
+            stats.writeTime += writeTime;
+            stats.currentBatchSize = m_d->batchSize;
+        }
+
+        DEBUG_VALUE(batch.size());
+        DEBUG_VALUE(batchMetric);
+
+        if (batchMetric <= 0) break;
+    }
+
+    return freedMetric;
+}
+
+template<class strategy>
+QVector<KisTileData*> KisTileDataSwapper::selectBatch(qint64 needToFreeMetric)
+{
+    QVector<KisTileData*> batch;
+    qint64 selectedMetric = 0;
     QList<KisTileData*> additionalCandidates;
 
     typename strategy::iterator *iter =
@@ -204,16 +394,17 @@ qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
     KisTileData *item;
 
     while(iter->hasNext()) {
-        item = iter->next();
-
-        if(freedMetric >= needToFreeMetric) break;
+        if(selectedMetric >= needToFreeMetric ||
+           batch.size() >= m_d->batchSize) break;
 
+        item = iter->next();
 
         if(!strategy::isInteresting(item)) continue;
 
         if(strategy::swapOutFirst(item)) {
-            if(iter->trySwapOut(item)) {
-                freedMetric += item->pixelSize();
+            if(m_d->store->tryLockForSwapOut(item)) {
+                batch.append(item);
+                selectedMetric += item->pixelSize();
             }
         }
         else {
@@ -224,19 +415,58 @@ qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
     }
 
     Q_FOREACH (item, additionalCandidates) {
-        if(freedMetric >= needToFreeMetric) break;
+        if(selectedMetric >= needToFreeMetric ||
+           batch.size() >= m_d->batchSize) break;
 
-        if(iter->trySwapOut(item)) {
-            freedMetric += item->pixelSize();
+        if(m_d->store->tryLockForSwapOut(item)) {
+            batch.append(item);
+            selectedMetric += item->pixelSize();
         }
     }
 
     strategy::endIteration(m_d->store, iter);
 
-    return freedMetric;
+    return batch;
+}
+
+void KisTileDataSwapper::compressBatch(const QVector<KisTileData*> &batch,
+                                       QVector<QByteArray> *compressedData)
+{
+    compressedData->resize(batch.size());
+
+    const int numJobs = qBound(1, batch.size() / MIN_BATCH_SIZE, m_d->compressors.size());
+    const int jobSize = batch.size() / numJobs;
+
+    QVector<CompressionJob> jobs;
+    for (int i = 0; i < numJobs; i++) {
+        const int begin = i * jobSize;
+        const int end = i < numJobs - 1 ? begin + jobSize : batch.size();
+
+        jobs << CompressionJob(m_d->compressors[i], &batch, compressedData, begin, end);
+    }
+
+    if (jobs.size() > 1) {
+        CompressionJobWrapper wrapper;
+        QtConcurrent::blockingMap(jobs, wrapper);
+    } else {
+        jobs.first().run();
+    }
+}
+
+KisTileDataSwapper::Statistics KisTileDataSwapper::statistics() const
+{
+    QMutexLocker l(&m_d->statisticsLock);
+    return m_d->statistics;
+}
+
+int KisTileDataSwapper::historySwapDepth() const
+{
+    return m_d->limits.historySwapDepth();
 }
 
 void KisTileDataSwapper::testingRereadConfig()
 {
+    QMutexLocker locker(&m_d->cycleLock);
     m_d->limits = KisStoreLimits();
+    m_d->createCompressors();
 }
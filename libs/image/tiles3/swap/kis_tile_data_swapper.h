@@ -20,6 +20,8 @@
 
 #include <QObject>
 #include <QThread>
+#include <QVector>
+#include <QByteArray>
 
 #include "kritaimage_export.h"
 
@@ -31,6 +33,35 @@ class KRITAIMAGE_EXPORT KisTileDataSwapper : public QThread
 {
     Q_OBJECT
 
+public:
+    /**
+     * Counters of the swap-out pipeline. Times are in
+     * milliseconds and accumulated over all the cycles.
+     */
+    struct Statistics {
+        qint64 numBatches = 0;
+        qint64 numTilesSelected = 0;
+        qint64 swappedOutMetric = 0;
+
+        /**
+         * The part of swappedOutMetric that belongs to
+         * the revisions older than historySwapDepth()
+         */
+        qint64 historySwappedOutMetric = 0;
+
+        /**
+         * The number of batches dropped because the tile data
+         * store was too busy to accept them (back-pressure)
+         */
+        qint64 numRejectedBatches = 0;
+
+        qint64 selectionTime = 0;
+        qint64 compressionTime = 0;
+        qint64 writeTime = 0;
+
+        int currentBatchSize = 0;
+    };
+
 public:
 
     KisTileDataSwapper(KisTileDataStore *store);
@@ -40,6 +71,13 @@ public:
     void terminateSwapper();
     void checkFreeMemory();
 
+    Statistics statistics() const;
+
+    /**
+     * \see KisImageConfig::historySwapDepth()
+     */
+    int historySwapDepth() const;
+
     void testingRereadConfig();
 
 private:
@@ -48,11 +86,17 @@ private:
 
     void doJob();
     template<class strategy> qint64 pass(qint64 needToFreeMetric);
+    template<class strategy> QVector<KisTileData*> selectBatch(qint64 needToFreeMetric);
+    void compressBatch(const QVector<KisTileData*> &batch, QVector<QByteArray> *compressedData);
 
 private:
     static const qint32 TIMEOUT;
     static const qint32 DELAY;
 
+    static const int MIN_BATCH_SIZE;
+    static const int MAX_BATCH_SIZE;
+    static const int COMMIT_TIMEOUT;
+
 private:
     struct Private;
     Private * const m_d;
@@ -51,6 +51,14 @@
   |                        |
   :                        :
   |                        |
+  |= historyLimitThreshold=|  <-- the swapper starts swapping
+  |........................|      out the memento tiles of the
+  |........................|      revisions older than
+  |........................|      historySwapDepth()
+  |=====  historyLimit  ===|  <-- the swapper stops swapping
+  |                        |      out old memento tiles
+  :                        :
+  |                        |
   +------------------------+  <-- 0 MiB
 
  */
@@ -69,6 +77,11 @@ public:
 
         m_softLimitThreshold = qBound(0, MiB_TO_METRIC(config.tilesSoftLimit()), m_hardLimitThreshold);
         m_softLimit = m_softLimitThreshold - m_softLimitThreshold / 8;
+
+        m_historyLimitThreshold = m_softLimitThreshold / 2;
+        m_historyLimit = m_historyLimitThreshold - m_historyLimitThreshold / 8;
+
+        m_historySwapDepth = config.historySwapDepth();
     }
 
     /**
@@ -95,12 +108,30 @@ public:
         return m_softLimit;
     }
 
+    inline qint32 historyLimitThreshold() {
+        return m_historyLimitThreshold;
+    }
+
+    inline qint32 historyLimit() {
+        return m_historyLimit;
+    }
+
+    /**
+     * Not a metric, the number of revisions
+     */
+    inline int historySwapDepth() {
+        return m_historySwapDepth;
+    }
+
 private:
     qint32 m_emergencyThreshold;
     qint32 m_hardLimitThreshold;
     qint32 m_hardLimit;
     qint32 m_softLimitThreshold;
     qint32 m_softLimit;
+    qint32 m_historyLimitThreshold;
+    qint32 m_historyLimit;
+    int m_historySwapDepth;
 };
 
 
@@ -42,6 +42,25 @@ void KisChunkAllocatorTest::testOperations()
     QVERIFY(qFuzzyCompare(allocator.debugFragmentation(), 1./6));
 }
 
+void KisChunkAllocatorTest::testAlignedChunks()
+{
+    const quint64 alignment = 4096;
+    KisChunkAllocator allocator;
+
+    allocator.getChunk(10);
+    KisChunk chunk2 = allocator.getChunk(alignment, alignment);
+    allocator.getChunk(15);
+    KisChunk chunk4 = allocator.getChunk(alignment, alignment);
+
+    QCOMPARE(chunk2.begin() % alignment, 0ULL);
+    QCOMPARE(chunk4.begin() % alignment, 0ULL);
+
+    allocator.freeChunk(chunk2);
+    chunk2 = allocator.getChunk(alignment, alignment);
+    QCOMPARE(chunk2.begin() % alignment, 0ULL);
+
+    allocator.sanityCheck();
+}
 
 #define NUM_TRANSACTIONS 30
 #define NUM_CHUNKS_ALLOC 15000
@@ -25,6 +25,16 @@
 #include "tiles3/swap/kis_lzf_compression.h"
 #include <kis_debug.h>
 
+#include <config-swap-compression.h>
+
+#ifdef HAVE_LZ4
+#include "tiles3/swap/kis_lz4_compression.h"
+#endif
+
+#ifdef HAVE_ZSTD
+#include "tiles3/swap/kis_zstd_compression.h"
+#endif
+
 #define TEST_FILE "tile.png"
 //#define TEST_FILE "hakonepa.png"
 
@@ -221,6 +231,56 @@ void KisCompressionTests::testLzfOverflow()
     delete compression;
 }
 
+void KisCompressionTests::testLz4RoundTrip()
+{
+#ifdef HAVE_LZ4
+    KisAbstractCompression *compression = new KisLz4Compression();
+
+    roundTrip(compression);
+    roundTripTwoPass(compression);
+
+    delete compression;
+#else
+    QSKIP("LZ4 is not available");
+#endif
+}
+
+void KisCompressionTests::testLz4Overflow()
+{
+#ifdef HAVE_LZ4
+    KisAbstractCompression *compression = new KisLz4Compression();
+    testOverflow(compression);
+    delete compression;
+#else
+    QSKIP("LZ4 is not available");
+#endif
+}
+
+void KisCompressionTests::testZstdRoundTrip()
+{
+#ifdef HAVE_ZSTD
+    KisAbstractCompression *compression = new KisZstdCompression();
+
+    roundTrip(compression);
+    roundTripTwoPass(compression);
+
+    delete compression;
+#else
+    QSKIP("Zstd is not available");
+#endif
+}
+
+void KisCompressionTests::testZstdOverflow()
+{
+#ifdef HAVE_ZSTD
+    KisAbstractCompression *compression = new KisZstdCompression();
+    testOverflow(compression);
+    delete compression;
+#else
+    QSKIP("Zstd is not available");
+#endif
+}
+
 void KisCompressionTests::benchmarkMemCpy()
 {
     QImage image(QString(FILES_DATA_DIR) + QDir::separator() + TEST_FILE);
@@ -261,6 +321,49 @@ void KisCompressionTests::benchmarkDecompressionLzfTwoPass()
     benchmarkDecompressionTwoPass(compression);
     delete compression;
 }
+void KisCompressionTests::benchmarkCompressionLz4TwoPass()
+{
+#ifdef HAVE_LZ4
+    KisAbstractCompression *compression = new KisLz4Compression();
+    benchmarkCompressionTwoPass(compression);
+    delete compression;
+#else
+    QSKIP("LZ4 is not available");
+#endif
+}
+
+void KisCompressionTests::benchmarkDecompressionLz4TwoPass()
+{
+#ifdef HAVE_LZ4
+    KisAbstractCompression *compression = new KisLz4Compression();
+    benchmarkDecompressionTwoPass(compression);
+    delete compression;
+#else
+    QSKIP("LZ4 is not available");
+#endif
+}
+
+void KisCompressionTests::benchmarkCompressionZstdTwoPass()
+{
+#ifdef HAVE_ZSTD
+    KisAbstractCompression *compression = new KisZstdCompression();
+    benchmarkCompressionTwoPass(compression);
+    delete compression;
+#else
+    QSKIP("Zstd is not available");
+#endif
+}
+
+void KisCompressionTests::benchmarkDecompressionZstdTwoPass()
+{
+#ifdef HAVE_ZSTD
+    KisAbstractCompression *compression = new KisZstdCompression();
+    benchmarkDecompressionTwoPass(compression);
+    delete compression;
+#else
+    QSKIP("Zstd is not available");
+#endif
+}
 
 QTEST_MAIN(KisCompressionTests)
 
@@ -26,6 +26,7 @@
 #include "tiles_test_utils.h"
 #include "tiles3/kis_tiled_data_manager.h"
 #include "tiles3/kis_tile_data_store.h"
+#include "tiles3/kis_tile_data.h"
 #include <kis_debug.h>
 #include "config-limit-long-tests.h"
 
@@ -218,4 +219,116 @@ void KisLowMemoryTests::hangingTilesTest()
     dstTile = 0;
 }
 
+class DeltaDecodingThread : public QRunnable
+{
+public:
+    DeltaDecodingThread(KisTileData *td, const QByteArray &expectedData, QAtomicInt &numErrors)
+        : m_td(td),
+          m_expectedData(expectedData),
+          m_numErrors(numErrors)
+    {
+    }
+
+    void run() override {
+        m_td->blockSwapping();
+        if (memcmp(m_td->data(), m_expectedData.constData(), m_expectedData.size())) {
+            m_numErrors.ref();
+        }
+        m_td->unblockSwapping();
+    }
+
+private:
+    KisTileData *m_td;
+    QByteArray m_expectedData;
+    QAtomicInt &m_numErrors;
+};
+
+void KisLowMemoryTests::decodeDeltasWithSharedBase()
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+
+    if (!store->m_deltaStore.isEnabled()) {
+        QSKIP("Delta history compression is disabled");
+    }
+
+    const int NUM_DELTAS = 8;
+    const int dataSize = KisTileData::WIDTH * KisTileData::HEIGHT;
+
+#ifdef LIMIT_LONG_TESTS
+    const int NUM_CYCLES = 100;
+#else
+    const int NUM_CYCLES = 1000;
+#endif
+
+    const int numDeltaTiles = store->m_deltaStore.numTiles();
+
+    quint8 defaultPixel = 0;
+    QAtomicInt numErrors;
+    int numEncodedDeltas = 0;
+
+    for (int j = 0; j < NUM_CYCLES; j++) {
+        KisTileData *base = store->createDefaultTileData(1, &defaultPixel);
+        base->ref();
+
+        QByteArray baseData(dataSize, 0);
+        for (int i = 0; i < dataSize; i++) {
+            baseData[i] = i % 251;
+        }
+
+        base->blockSwapping();
+        base->setData((const quint8*)baseData.constData());
+        base->unblockSwapping();
+
+        /**
+         * The base is a part of the history as well,
+         * so the swapper is free to swap it out
+         */
+        base->setMementoed(true);
+
+        QVector<KisTileData*> deltas;
+        QVector<QByteArray> expectedData;
+
+        for (int i = 0; i < NUM_DELTAS; i++) {
+            KisTileData *td = base->clone();
+            td->ref();
+
+            QByteArray data = baseData;
+            data[i * KisTileData::WIDTH] = 255 - i;
+            expectedData.append(data);
+
+            td->blockSwapping();
+            td->setData((const quint8*)data.constData());
+            td->unblockSwapping();
+
+            td->setMementoed(true);
+            store->compactHistoricalTileData(td, base);
+
+            if (td->deltaBase()) {
+                numEncodedDeltas++;
+            }
+
+            deltas.append(td);
+        }
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(NUM_DELTAS);
+
+        for (int i = 0; i < NUM_DELTAS; i++) {
+            pool.start(new DeltaDecodingThread(deltas[i], expectedData[i], numErrors));
+        }
+
+        store->debugSwapAll();
+        pool.waitForDone();
+
+        Q_FOREACH (KisTileData *td, deltas) {
+            td->deref();
+        }
+        base->deref();
+    }
+
+    QVERIFY(numEncodedDeltas > 0);
+    QCOMPARE(int(numErrors), 0);
+    QCOMPARE(store->m_deltaStore.numTiles(), numDeltaTiles);
+}
+
 QTEST_MAIN(KisLowMemoryTests)
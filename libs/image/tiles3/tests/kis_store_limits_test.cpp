@@ -39,6 +39,9 @@ void KisStoreLimitsTest::testLimits()
     int softLimitThreshold = qBound(0, MiB_TO_METRIC(config.tilesSoftLimit()), hardLimitThreshold);
     int softLimit = softLimitThreshold - softLimitThreshold / 8;
 
+    int historyLimitThreshold = softLimitThreshold / 2;
+    int historyLimit = historyLimitThreshold - historyLimitThreshold / 8;
+
     KisStoreLimits limits;
 
     QCOMPARE(limits.emergencyThreshold(), emergencyThreshold);
@@ -46,6 +49,9 @@ void KisStoreLimitsTest::testLimits()
     QCOMPARE(limits.hardLimit(), hardLimit);
     QCOMPARE(limits.softLimitThreshold(), softLimitThreshold);
     QCOMPARE(limits.softLimit(), softLimit);
+    QCOMPARE(limits.historyLimitThreshold(), historyLimitThreshold);
+    QCOMPARE(limits.historyLimit(), historyLimit);
+    QCOMPARE(limits.historySwapDepth(), config.historySwapDepth());
 }
 
 QTEST_MAIN(KisStoreLimitsTest)
@@ -131,5 +131,74 @@ void KisSwappedDataStoreTest::testRandomAccess()
         delete tileDataList[i];
 }
 
+void KisSwappedDataStoreTest::testUniformTileData()
+{
+    const qint32 pixelSize = 4;
+    const quint8 defaultPixel[pixelSize] = {10, 20, 30, 40};
+    const qint32 dataSize = pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    KisImageConfig config(false);
+    config.setMaxSwapSize(4);
+    config.setSwapSlabSize(1);
+    config.setSwapWindowSize(1);
+
+    KisSwappedDataStore store;
+
+    KisTileData *uniformTD = new KisTileData(pixelSize, defaultPixel, KisTileDataStore::instance());
+    KisTileData *noisyTD = new KisTileData(pixelSize, defaultPixel, KisTileDataStore::instance());
+
+    QVERIFY(uniformTD->isUniform());
+    QVERIFY(noisyTD->isUniform());
+
+    QByteArray noisyData(dataSize, 0);
+    for (int i = 0; i < dataSize; i++) {
+        noisyData[i] = i % 251;
+    }
+    noisyTD->setData((const quint8*)noisyData.constData());
+    QVERIFY(!noisyTD->isUniform());
+    QVERIFY(!noisyTD->checkUniform());
+
+    // the swapped data store expects the swap locks to be taken by the caller
+    uniformTD->m_swapLock.lockForWrite();
+    noisyTD->m_swapLock.lockForWrite();
+
+    QVERIFY(store.trySwapOutTileData(uniformTD));
+    QVERIFY(store.trySwapOutTileData(noisyTD));
+
+    QVERIFY(!uniformTD->data());
+    QVERIFY(uniformTD->swappedUniformPixel());
+    QCOMPARE(store.numUniformTiles(), 1);
+    QCOMPARE(store.numTiles(), 2ULL);
+
+    // only the noisy tile takes space in the swap
+    QCOMPARE(store.totalMemoryMetric(), qint64(pixelSize));
+
+    store.swapInTileData(uniformTD);
+    store.swapInTileData(noisyTD);
+
+    noisyTD->m_swapLock.unlock();
+    uniformTD->m_swapLock.unlock();
+
+    QCOMPARE(store.numUniformTiles(), 0);
+    QCOMPARE(store.numTiles(), 0ULL);
+    QVERIFY(!uniformTD->swappedUniformPixel());
+
+    for (int i = 0; i < KisTileData::WIDTH * KisTileData::HEIGHT; i++) {
+        QVERIFY(!memcmp(uniformTD->data() + i * pixelSize, defaultPixel, pixelSize));
+    }
+    QVERIFY(!memcmp(noisyTD->data(), noisyData.constData(), dataSize));
+
+    // forgetting the tile swapped out as a pixel
+    uniformTD->m_swapLock.lockForWrite();
+    QVERIFY(store.trySwapOutTileData(uniformTD));
+    QCOMPARE(store.numUniformTiles(), 1);
+    store.forgetTileData(uniformTD);
+    uniformTD->m_swapLock.unlock();
+    QCOMPARE(store.numUniformTiles(), 0);
+
+    delete uniformTD;
+    delete noisyTD;
+}
+
 QTEST_MAIN(KisSwappedDataStoreTest)
 
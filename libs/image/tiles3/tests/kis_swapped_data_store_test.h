@@ -33,6 +33,7 @@ private:
 private Q_SLOTS:
     void testRoundTrip();
     void testRandomAccess();
+    void testUniformTileData();
 
 };
 
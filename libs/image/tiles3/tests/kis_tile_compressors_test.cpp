@@ -179,6 +179,109 @@ void KisTileCompressorsTest::testLowLevelRoundTripIncompressible2()
     delete compressor;
 }
 
+void KisTileCompressorsTest::testLowLevelRoundTripLz4()
+{
+    KisAbstractTileCompressor *compressor = new KisTileCompressor2(KisTileCompressor2::LZ4);
+    doLowLevelRoundTrip(compressor);
+    doLowLevelRoundTripIncompressible(compressor);
+    delete compressor;
+}
+
+void KisTileCompressorsTest::testLowLevelRoundTripZstd()
+{
+    KisAbstractTileCompressor *compressor = new KisTileCompressor2(KisTileCompressor2::ZSTD, 9);
+    doLowLevelRoundTrip(compressor);
+    doLowLevelRoundTripIncompressible(compressor);
+    delete compressor;
+}
+
+void KisTileCompressorsTest::testMixedCompressionTypes()
+{
+    const qint32 pixelSize = 1;
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    KisTiledDataManager dm(pixelSize, &oddPixel1);
+    KisTileSP tile = dm.getTile(0, 0, true);
+    tile->lockForWrite();
+
+    KisTileData *td = tile->tileData();
+
+    QList<KisTileCompressor2::CompressionType> types;
+    types << KisTileCompressor2::LZF << KisTileCompressor2::LZ4 << KisTileCompressor2::ZSTD;
+
+    /**
+     * Data written by any of the codecs should be readable
+     * by a compressor configured to use any other codec
+     */
+    Q_FOREACH (KisTileCompressor2::CompressionType writeType, types) {
+        KisTileCompressor2 writer(writeType);
+
+        qint32 bufferSize = writer.tileDataBufferSize(td);
+        quint8 *buffer = new quint8[bufferSize];
+        qint32 bytesWritten;
+
+        memset(td->data(), oddPixel1, TILESIZE);
+        writer.compressTileData(td, buffer, bufferSize, bytesWritten);
+
+        Q_FOREACH (KisTileCompressor2::CompressionType readType, types) {
+            KisTileCompressor2 reader(readType);
+
+            memset(td->data(), oddPixel2, TILESIZE);
+            QVERIFY(reader.decompressTileData(buffer, bytesWritten, td));
+            QVERIFY(memoryIsFilled(oddPixel1, td->data(), TILESIZE));
+        }
+
+        delete[] buffer;
+    }
+
+    tile->unlock();
+}
+
+void KisTileCompressorsTest::testSplitTileRoundTrip()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    const qint32 streamTileSize = KisTileData::WIDTH / 2;
+    const qint32 tileDataSize = KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    /**
+     * Make the stream tiles differ from each other, so
+     * the test catches misplaced tiles as well
+     */
+    dm.clear(KisTileData::WIDTH, KisTileData::HEIGHT,
+             KisTileData::WIDTH, KisTileData::HEIGHT, &oddPixel1);
+    dm.clear(KisTileData::WIDTH + streamTileSize, KisTileData::HEIGHT,
+             streamTileSize, streamTileSize, &oddPixel2);
+
+    KisTileSP tile11 = dm.getTile(1, 1, false);
+    QByteArray referenceData((const char*)tile11->data(), tileDataSize);
+
+    KisTileCompressor2 compressor;
+    compressor.setStreamTileSize(streamTileSize, streamTileSize);
+
+    KoStoreFake fakeStore;
+    KisFakePaintDeviceWriter writer(&fakeStore);
+
+    QVERIFY(compressor.writeTile(tile11, writer));
+    tile11 = 0;
+
+    fakeStore.startReading();
+
+    dm.clear();
+
+    for (int i = 0; i < 4; i++) {
+        QVERIFY(compressor.readTile(fakeStore.device(), &dm));
+    }
+
+    tile11 = dm.getTile(1, 1, false);
+    QVERIFY(!memcmp(referenceData.constData(), tile11->data(), tileDataSize));
+    tile11 = 0;
+}
 
 QTEST_MAIN(KisTileCompressorsTest)
 
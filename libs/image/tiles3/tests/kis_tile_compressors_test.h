@@ -38,6 +38,12 @@ private Q_SLOTS:
     void testRoundTrip2();
     void testLowLevelRoundTrip2();
     void testLowLevelRoundTripIncompressible2();
+
+    void testLowLevelRoundTripLz4();
+    void testLowLevelRoundTripZstd();
+    void testMixedCompressionTypes();
+
+    void testSplitTileRoundTrip();
 };
 
 #endif /* KIS_TILE_COMPRESSORS_TEST_H */
@@ -0,0 +1,164 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "kis_tile_data_arena_test.h"
+#include <QTest>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../KisTileDataArena.h"
+
+const int NUM_TILE_PIXELS = 64 * 64;
+
+
+void KisTileDataArenaTest::testAllocateFree_data()
+{
+    QTest::addColumn<int>("pixelSize");
+
+    QTest::newRow("1 byte") << 1;
+    QTest::newRow("4 bytes") << 4;
+    QTest::newRow("8 bytes") << 8;
+    QTest::newRow("16 bytes") << 16;
+}
+
+void KisTileDataArenaTest::testAllocateFree()
+{
+    QFETCH(int, pixelSize);
+
+    const int numBlocks = 1000;
+    const int blockSize = pixelSize * NUM_TILE_PIXELS;
+
+    KisTileDataArena arena(NUM_TILE_PIXELS, false, false);
+    QVERIFY(KisTileDataArena::supportsPixelSize(pixelSize));
+
+    QVector<quint8*> blocks;
+
+    for (int i = 0; i < numBlocks; i++) {
+        quint8 *ptr = arena.allocate(pixelSize);
+        QVERIFY(ptr);
+
+        memset(ptr, i & 0xFF, blockSize);
+        blocks << ptr;
+    }
+
+    // check that the blocks do not overlap
+    for (int i = 0; i < numBlocks; i++) {
+        QCOMPARE(int(blocks[i][0]), i & 0xFF);
+        QCOMPARE(int(blocks[i][blockSize - 1]), i & 0xFF);
+    }
+
+    KisTileDataArena::Statistics stats = arena.statistics();
+    QCOMPARE(stats.usedSize, qint64(numBlocks) * blockSize);
+    QVERIFY(stats.allocatedSize >= stats.usedSize);
+    QVERIFY(stats.numSlabs > 0);
+
+    Q_FOREACH (quint8 *ptr, blocks) {
+        arena.free(ptr, pixelSize);
+    }
+
+    stats = arena.statistics();
+    QCOMPARE(stats.usedSize, 0LL);
+    QVERIFY(qFuzzyCompare(stats.fragmentation(), 1.0));
+
+    // the freed blocks are reused
+    const qint64 allocatedSize = stats.allocatedSize;
+    quint8 *ptr = arena.allocate(pixelSize);
+    QVERIFY(blocks.contains(ptr));
+    QCOMPARE(arena.statistics().allocatedSize, allocatedSize);
+    arena.free(ptr, pixelSize);
+}
+
+void KisTileDataArenaTest::testPurge()
+{
+    KisTileDataArena arena(NUM_TILE_PIXELS, false, false);
+
+    QVERIFY(!KisTileDataArena::supportsPixelSize(3));
+
+    quint8 *ptr = arena.allocate(4);
+    QVERIFY(ptr);
+    QVERIFY(arena.statistics().allocatedSize > 0);
+
+    arena.purge();
+
+    KisTileDataArena::Statistics stats = arena.statistics();
+    QCOMPARE(stats.allocatedSize, 0LL);
+    QCOMPARE(stats.usedSize, 0LL);
+    QCOMPARE(stats.numSlabs, 0LL);
+
+    ptr = arena.allocate(4);
+    QVERIFY(ptr);
+    arena.free(ptr, 4);
+}
+
+void KisTileDataArenaTest::testThreadCaches()
+{
+    KisTileDataArena *arena = KisTileDataArena::instance();
+    const qint64 usedSizeBefore = arena->statistics().usedSize;
+
+    const int numThreads = 8;
+    const int numBlocks = 500;
+
+    // the blocks overwritten by other threads
+    std::atomic<int> numCorruptedBlocks(0);
+
+    auto worker = [arena, numBlocks, &numCorruptedBlocks] (int threadIndex) {
+        QVector<quint8*> blocks;
+
+        auto freeBlock = [arena, threadIndex, &numCorruptedBlocks] (quint8 *ptr) {
+            if (ptr[0] != threadIndex) {
+                numCorruptedBlocks++;
+            }
+            arena->free(ptr, 4);
+        };
+
+        for (int i = 0; i < numBlocks; i++) {
+            quint8 *ptr = arena->allocate(4);
+            ptr[0] = threadIndex;
+            blocks << ptr;
+
+            // keep a half of the blocks to make the caches
+            // exchange the blocks with the shared pools
+            if (i & 0x1) {
+                freeBlock(blocks.takeFirst());
+            }
+        }
+
+        Q_FOREACH (quint8 *ptr, blocks) {
+            freeBlock(ptr);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(worker, i);
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    QCOMPARE(numCorruptedBlocks.load(), 0);
+
+    // the caches are returned to the pools on the thread exit
+    QCOMPARE(arena->statistics().usedSize, usedSizeBefore);
+}
+
+QTEST_MAIN(KisTileDataArenaTest)
@@ -542,6 +542,166 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
 
 //#include <valgrind/callgrind.h>
 
+
+void KisTiledDataManagerTest::testDeltaHistory()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 strokePixel = 255;
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+
+    QRect rect(0,0,256,256);
+    QRect strokeRect(100,100,20,20);
+
+    const int bufferSize = rect.width() * rect.height();
+    QByteArray original(bufferSize, 0);
+    QByteArray buffer(bufferSize, 0);
+
+    for (int i = 0; i < bufferSize; i++) {
+        original[i] = i % 251;
+    }
+
+    const int numDeltaTiles = store->m_deltaStore.numTiles();
+
+    KisMementoSP memento1 = dm.getMemento();
+    dm.writeBytes((const quint8*)original.constData(), rect.x(), rect.y(), rect.width(), rect.height());
+    dm.commit();
+
+    KisMementoSP memento2 = dm.getMemento();
+    dm.clear(strokeRect, &strokePixel);
+    dm.commit();
+
+    /**
+     * The stroke changes a single tile, its previous
+     * version is stored as a delta now
+     */
+    QCOMPARE(store->m_deltaStore.numTiles(), numDeltaTiles + 1);
+    QCOMPARE(dm.numHistoryRevisions(), 2);
+    QVERIFY(dm.historyMemorySize() > 0);
+    QVERIFY(dm.historyMemorySize() < KisTileData::WIDTH * KisTileData::HEIGHT / 2);
+
+    dm.rollback(memento2);
+
+    dm.readBytes((quint8*)buffer.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(buffer == original);
+    QCOMPARE(store->m_deltaStore.numTiles(), numDeltaTiles);
+
+    dm.rollforward(memento2);
+
+    dm.readBytes((quint8*)buffer.data(), rect.x(), rect.y(), rect.width(), rect.height());
+
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        for (int x = rect.left(); x <= rect.right(); x++) {
+            const int i = y * rect.width() + x;
+            const quint8 expected = strokeRect.contains(x, y) ? strokePixel : quint8(original[i]);
+            QCOMPARE(quint8(buffer[i]), expected);
+        }
+    }
+}
+
+void KisTiledDataManagerTest::testDeepHistory()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    const int historySwapDepth = KisTileDataStore::instance()->historySwapDepth();
+    if (historySwapDepth < 1) {
+        QSKIP("The history swap depth is disabled in the config");
+    }
+
+    quint8 oddPixel = 128;
+
+    // the first revision changes tile (0,0), all the others change tile (1,1)
+    KisMementoSP firstMemento = dm.getMemento();
+    dm.clear(0, 0, 64, 64, &oddPixel);
+    dm.commit();
+
+    KisTileData *td = dm.getTile(0, 0, false)->tileData();
+
+    QVector<KisMementoSP> mementos;
+
+    for (int i = 0; i < historySwapDepth; i++) {
+        QVERIFY(!td->isDeepHistory());
+
+        oddPixel++;
+        mementos << dm.getMemento();
+        dm.clear(64, 64, 64, 64, &oddPixel);
+        dm.commit();
+    }
+
+    // the first revision is historySwapDepth revisions deep now
+    QVERIFY(td->isDeepHistory());
+
+    // undo brings it back above the threshold...
+    dm.rollback(mementos.last());
+    QVERIFY(!td->isDeepHistory());
+
+    // ...and redo moves it down again
+    dm.rollforward(mementos.last());
+    QVERIFY(td->isDeepHistory());
+
+    // purging the revision removes the tile data from the history
+    dm.purgeHistory(mementos.first());
+    QVERIFY(!td->isDeepHistory());
+
+    Q_UNUSED(firstMemento);
+}
+
+void KisTiledDataManagerTest::testDeepHistoryCopy()
+{
+    quint8 defaultPixel = 0;
+    QScopedPointer<KisTiledDataManager> dm(new KisTiledDataManager(1, &defaultPixel));
+
+    const int historySwapDepth = KisTileDataStore::instance()->historySwapDepth();
+    if (historySwapDepth < 1) {
+        QSKIP("The history swap depth is disabled in the config");
+    }
+
+    quint8 oddPixel = 128;
+
+    KisMementoSP firstMemento = dm->getMemento();
+    dm->clear(0, 0, 64, 64, &oddPixel);
+    dm->commit();
+
+    // keeps the tile data alive after both of the managers are gone
+    KisTileSP tile = dm->getTile(0, 0, false);
+    KisTileData *td = tile->tileData();
+
+    for (int i = 0; i < historySwapDepth; i++) {
+        oddPixel++;
+        KisMementoSP memento = dm->getMemento();
+        dm->clear(64, 64, 64, 64, &oddPixel);
+        dm->commit();
+    }
+
+    QVERIFY(td->isDeepHistory());
+
+    QScopedPointer<KisMementoManager> copy(new KisMementoManager(*dm->m_mementoManager));
+    QVERIFY(td->isDeepHistory());
+
+    // the original still keeps the revision deep
+    copy.reset();
+    QVERIFY(td->isDeepHistory());
+
+    copy.reset(new KisMementoManager(*dm->m_mementoManager));
+
+    // ...and so does the copy
+    dm.reset();
+    QVERIFY(td->isDeepHistory());
+
+    copy.reset();
+    QVERIFY(!td->isDeepHistory());
+
+    // the counter must not go below zero
+    td->setDeepHistory(true);
+    QVERIFY(td->isDeepHistory());
+    td->setDeepHistory(false);
+
+    Q_UNUSED(firstMemento);
+}
+
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
 {
     quint8 defaultPixel = 0;
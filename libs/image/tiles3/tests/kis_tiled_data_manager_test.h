@@ -52,6 +52,9 @@ private Q_SLOTS:
     void testTransactions();
     void testPurgeHistory();
     void testUndoSetDefaultPixel();
+    void testDeltaHistory();
+    void testDeepHistory();
+    void testDeepHistoryCopy();
 
     void benchmarkReadOnlyTileLazy();
     void benchmarkSharedPointers();
@@ -15,7 +15,6 @@
  *  along with this program; if not, write to the Free Software
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
-
 #include "KoBasicHistogramProducers.h"
 
 #include <QString>
@@ -29,15 +28,148 @@
 // #include "Ko_global.h"
 #include "KoIntegerMaths.h"
 #include "KoChannelInfo.h"
+#include "KoColorModelStandardIds.h"
+#include "KoColorSpaceMaths.h"
+#include "KoScratchBuffer.h"
+#include "kis_assert.h"
 
 static const KoColorSpace* m_labCs = 0;
 
+namespace {
+
+/**
+ * Every bank has two extra bins for the values that are
+ * out of the view on the left and on the right
+ */
+const int BANK_OUT_LEFT = 256;
+const int BANK_OUT_RIGHT = 257;
+const int BANK_SIZE = 258;
+const int NUM_BANKS = 4;
+const quint32 CHUNK_SIZE = 256;
+
+struct U8BinMapper {
+    inline int operator()(quint8 value) const {
+        return value;
+    }
+};
+
+struct U16BinMapper {
+    U16BinMapper(qreal viewFrom, qreal viewWidth)
+        : from(static_cast<quint16>(viewFrom * UINT16_MAX))
+    {
+        const quint16 width = static_cast<quint16>(viewWidth * UINT16_MAX + 0.5); // We include the end
+        to = from + width;
+        factor = 255.0 / width;
+    }
+
+    inline int operator()(quint16 value) const {
+        // the bin is calculated unconditionally to keep the loop branchless
+        const int bin = qBound(0.0, (value - from) * factor, 255.0);
+
+        return value > to ? BANK_OUT_RIGHT :
+               value < from ? BANK_OUT_LEFT : bin;
+    }
+
+    int from;
+    int to;
+    qreal factor;
+};
+
+struct F32BinMapper {
+    F32BinMapper(qreal viewFrom, qreal viewWidth)
+        : from(static_cast<float>(viewFrom)),
+          to(static_cast<float>(viewFrom + viewWidth)),
+          factor(255.0f / static_cast<float>(viewWidth))
+    {
+    }
+
+    inline int operator()(float value) const {
+        const int bin = qBound(0.0f, (value - from) * factor, 255.0f);
+
+        return value > to ? BANK_OUT_RIGHT :
+               value < from ? BANK_OUT_LEFT : bin;
+    }
+
+    float from;
+    float to;
+    float factor;
+};
+
+/**
+ * Counts the pixels of an RGBA or GrayA color space into the banks.
+ * The bin indexes of a chunk of pixels are calculated in a separate
+ * loop, which has no dependencies between the iterations and is
+ * vectorized by the compiler. Returns the number of counted pixels.
+ */
+template <typename channel_type, int channels_nb, class BinMapper>
+qint32 accumulateBanksImpl(const quint8 *pixels, const quint8 *selectionMask, quint32 nPixels,
+                           bool skipTransparent, bool skipUnselected,
+                           const BinMapper &mapper, quint32 *banks)
+{
+    const int alpha_pos = channels_nb - 1;
+    const int bankStride = channels_nb * BANK_SIZE;
+
+    const channel_type *src = reinterpret_cast<const channel_type*>(pixels);
+    quint16 indexes[CHUNK_SIZE * channels_nb];
+    qint32 count = 0;
+
+    if (!skipUnselected) {
+        selectionMask = 0;
+    }
+
+    while (nPixels > 0) {
+        const quint32 chunkSize = qMin(nPixels, CHUNK_SIZE);
+
+        for (quint32 i = 0; i < chunkSize * channels_nb; i++) {
+            indexes[i] = mapper(src[i]);
+        }
+
+        for (quint32 i = 0; i < chunkSize; i++) {
+            if ((skipTransparent &&
+                 KoColorSpaceMaths<channel_type, quint8>::scaleToA(src[i * channels_nb + alpha_pos]) == OPACITY_TRANSPARENT_U8) ||
+                (selectionMask && selectionMask[i] == 0)) {
+
+                continue;
+            }
+
+            quint32 *bank = banks + (i & (NUM_BANKS - 1)) * bankStride;
+            const quint16 *index = indexes + i * channels_nb;
+
+            for (int ch = 0; ch < channels_nb; ch++) {
+                bank[ch * BANK_SIZE + index[ch]]++;
+            }
+            count++;
+        }
+
+        src += chunkSize * channels_nb;
+        if (selectionMask) {
+            selectionMask += chunkSize;
+        }
+        nPixels -= chunkSize;
+    }
+
+    return count;
+}
+
+template <typename channel_type, class BinMapper>
+qint32 accumulateBanks(int channelCount,
+                       const quint8 *pixels, const quint8 *selectionMask, quint32 nPixels,
+                       bool skipTransparent, bool skipUnselected,
+                       const BinMapper &mapper, quint32 *banks)
+{
+    return channelCount == 4 ?
+        accumulateBanksImpl<channel_type, 4>(pixels, selectionMask, nPixels, skipTransparent, skipUnselected, mapper, banks) :
+        accumulateBanksImpl<channel_type, 2>(pixels, selectionMask, nPixels, skipTransparent, skipUnselected, mapper, banks);
+}
+
+}
 
 KoBasicHistogramProducer::KoBasicHistogramProducer(const KoID& id, int channelCount, int nrOfBins)
     : m_channels(channelCount)
     , m_nrOfBins(nrOfBins)
     , m_colorSpace(0)
     , m_id(id)
+    , m_banksDirty(false)
 {
     m_bins.resize(m_channels);
     for (int i = 0; i < m_channels; i++)
@@ -52,7 +184,8 @@ KoBasicHistogramProducer::KoBasicHistogramProducer(const KoID& id, int channelCo
 KoBasicHistogramProducer::KoBasicHistogramProducer(const KoID& id, int nrOfBins, const KoColorSpace *cs)
     : m_nrOfBins(nrOfBins),
       m_colorSpace(cs),
-      m_id(id)
+      m_id(id),
+      m_banksDirty(false)
 {
     Q_ASSERT(cs);
     m_channels = cs->channelCount();
@@ -78,6 +211,31 @@ void KoBasicHistogramProducer::clear()
         m_outRight[i] = 0;
         m_outLeft[i] = 0;
     }
+
+    if (m_banksDirty) {
+        m_banks.fill(0);
+        m_banksDirty = false;
+    }
+}
+
+void KoBasicHistogramProducer::addBinsFrom(KoHistogramProducer *other)
+{
+    KoBasicHistogramProducer *rhs = dynamic_cast<KoBasicHistogramProducer*>(other);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(rhs);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(rhs->m_channels == m_channels);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(rhs->m_nrOfBins == m_nrOfBins);
+
+    flushBanks();
+    rhs->flushBanks();
+
+    for (int i = 0; i < m_channels; i++) {
+        for (int j = 0; j < m_nrOfBins; j++) {
+            m_bins[i][j] += rhs->m_bins[i][j];
+        }
+        m_outRight[i] += rhs->m_outRight[i];
+        m_outLeft[i] += rhs->m_outLeft[i];
+    }
+    m_count += rhs->m_count;
 }
 
 void KoBasicHistogramProducer::makeExternalToInternal()
@@ -100,11 +258,74 @@ void KoBasicHistogramProducer::makeExternalToInternal()
     }
 }
 
+KoHistogramProducer *KoBasicHistogramProducer::setUpEmptyCopy(KoBasicHistogramProducer *copy) const
+{
+    copy->setView(m_from, m_width);
+    copy->setSkipTransparent(m_skipTransparent);
+    copy->setSkipUnselected(m_skipUnselected);
+    return copy;
+}
+
+int KoBasicHistogramProducer::optimizedChannelCount(const KoID &depthId) const
+{
+    if (!m_colorSpace || m_nrOfBins != 256 ||
+        m_colorSpace->colorDepthId() != depthId) {
+
+        return 0;
+    }
+
+    if (m_colorSpace->colorModelId() == RGBAColorModelID) {
+        return 4;
+    } else if (m_colorSpace->colorModelId() == GrayAColorModelID) {
+        return 2;
+    }
+
+    return 0;
+}
+
+quint32 *KoBasicHistogramProducer::banksForWriting()
+{
+    if (m_banks.isEmpty()) {
+        m_banks.fill(0, NUM_BANKS * m_channels * BANK_SIZE);
+    }
+
+    m_banksDirty = true;
+    return m_banks.data();
+}
+
+void KoBasicHistogramProducer::flushBanks()
+{
+    if (!m_banksDirty) return;
+
+    const quint32 *bank = m_banks.constData();
+
+    for (int b = 0; b < NUM_BANKS; b++) {
+        for (int i = 0; i < m_channels; i++) {
+            for (int j = 0; j < m_nrOfBins; j++) {
+                m_bins[i][j] += bank[j];
+            }
+            m_outLeft[i] += bank[BANK_OUT_LEFT];
+            m_outRight[i] += bank[BANK_OUT_RIGHT];
+
+            bank += BANK_SIZE;
+        }
+    }
+
+    m_banks.fill(0);
+    m_banksDirty = false;
+}
+
 // ------------ U8 ---------------------
 
 KoBasicU8HistogramProducer::KoBasicU8HistogramProducer(const KoID& id, const KoColorSpace *cs)
     : KoBasicHistogramProducer(id, 256, cs)
 {
+    m_optimizedChannelCount = optimizedChannelCount(Integer8BitsColorDepthID);
+}
+
+KoHistogramProducer *KoBasicU8HistogramProducer::createEmptyCopy() const
+{
+    return setUpEmptyCopy(new KoBasicU8HistogramProducer(m_id, m_colorSpace));
 }
 
 QString KoBasicU8HistogramProducer::positionToString(qreal pos) const
@@ -115,13 +336,28 @@ QString KoBasicU8HistogramProducer::positionToString(qreal pos) const
 void KoBasicU8HistogramProducer::addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *cs)
 {
     quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
+    const bool needsConversion = *cs != *m_colorSpace;
+
+    KoScratchBuffer buffer(needsConversion ? nPixels * dstPixelSize : 0);
+    const quint8 *dstPixels = pixels;
+
+    if (needsConversion) {
+        cs->convertPixelsTo(pixels, buffer.data(), m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
+        dstPixels = buffer.data();
+    }
+
+    if (m_optimizedChannelCount) {
+        m_count += accumulateBanks<quint8>(m_optimizedChannelCount,
+                                           dstPixels, selectionMask, nPixels,
+                                           m_skipTransparent, m_skipUnselected,
+                                           U8BinMapper(), banksForWriting());
+        return;
+    }
 
     if (selectionMask) {
-        quint8 *dst = dstPixels;
+        const quint8 *dst = dstPixels;
         while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
+            if (!((m_skipUnselected && *selectionMask == 0) || (m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8))) {
 
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     m_bins[i][m_colorSpace->scaleToU8(dst,i)]++;
@@ -133,9 +369,9 @@ void KoBasicU8HistogramProducer::addRegionToBin(const quint8 * pixels, const qui
             nPixels--;
         }
     } else {
-        quint8 *dst = dstPixels;
+        const quint8 *dst = dstPixels;
         while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
+            if (!(m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8)) {
 
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     m_bins[i][m_colorSpace->scaleToU8(dst,i)]++;
@@ -153,6 +389,12 @@ void KoBasicU8HistogramProducer::addRegionToBin(const quint8 * pixels, const qui
 KoBasicU16HistogramProducer::KoBasicU16HistogramProducer(const KoID& id, const KoColorSpace *cs)
     : KoBasicHistogramProducer(id, 256, cs)
 {
+    m_optimizedChannelCount = optimizedChannelCount(Integer16BitsColorDepthID);
+}
+
+KoHistogramProducer *KoBasicU16HistogramProducer::createEmptyCopy() const
+{
+    return setUpEmptyCopy(new KoBasicU16HistogramProducer(m_id, m_colorSpace));
 }
 
 QString KoBasicU16HistogramProducer::positionToString(qreal pos) const
@@ -167,21 +409,36 @@ qreal KoBasicU16HistogramProducer::maximalZoom() const
 
 void KoBasicU16HistogramProducer::addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *cs)
 {
+    quint32 dstPixelSize = m_colorSpace->pixelSize();
+    const bool needsConversion = *cs != *m_colorSpace;
+
+    KoScratchBuffer buffer(needsConversion ? nPixels * dstPixelSize : 0);
+    const quint8 *dst = pixels;
+
+    if (needsConversion) {
+        cs->convertPixelsTo(pixels, buffer.data(), m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
+        dst = buffer.data();
+    }
+
+    if (m_optimizedChannelCount) {
+        m_count += accumulateBanks<quint16>(m_optimizedChannelCount,
+                                            dst, selectionMask, nPixels,
+                                            m_skipTransparent, m_skipUnselected,
+                                            U16BinMapper(m_from, m_width), banksForWriting());
+        return;
+    }
+
     // The view
     quint16 from = static_cast<quint16>(m_from * UINT16_MAX);
     quint16 width = static_cast<quint16>(m_width * UINT16_MAX + 0.5); // We include the end
     quint16 to = from + width;
     qreal factor = 255.0 / width;
 
-    quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
-    quint8 *dst = dstPixels;
     QVector<float> channels(m_colorSpace->channelCount());
 
     if (selectionMask) {
         while (nPixels > 0) {
-            if (!((m_skipUnselected && *selectionMask == 0) || (m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8))) {
+            if (!((m_skipUnselected && *selectionMask == 0) || (m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8))) {
                 m_colorSpace->normalisedChannelsValue(dst,channels);
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     quint16 value = channels[i]*UINT16_MAX;
@@ -200,7 +457,7 @@ void KoBasicU16HistogramProducer::addRegionToBin(const quint8 * pixels, const qu
         }
     } else {
         while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
+            if (!(m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8)) {
                 m_colorSpace->normalisedChannelsValue(dst,channels);
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     quint16 value = channels[i]*UINT16_MAX;
@@ -224,6 +481,12 @@ void KoBasicU16HistogramProducer::addRegionToBin(const quint8 * pixels, const qu
 KoBasicF32HistogramProducer::KoBasicF32HistogramProducer(const KoID& id, const KoColorSpace *cs)
     : KoBasicHistogramProducer(id, 256, cs)
 {
+    m_optimizedChannelCount = optimizedChannelCount(Float32BitsColorDepthID);
+}
+
+KoHistogramProducer *KoBasicF32HistogramProducer::createEmptyCopy() const
+{
+    return setUpEmptyCopy(new KoBasicF32HistogramProducer(m_id, m_colorSpace));
 }
 
 QString KoBasicF32HistogramProducer::positionToString(qreal pos) const
@@ -239,21 +502,36 @@ qreal KoBasicF32HistogramProducer::maximalZoom() const
 
 void KoBasicF32HistogramProducer::addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *cs)
 {
+    quint32 dstPixelSize = m_colorSpace->pixelSize();
+    const bool needsConversion = *cs != *m_colorSpace;
+
+    KoScratchBuffer buffer(needsConversion ? nPixels * dstPixelSize : 0);
+    const quint8 *dst = pixels;
+
+    if (needsConversion) {
+        cs->convertPixelsTo(pixels, buffer.data(), m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
+        dst = buffer.data();
+    }
+
+    if (m_optimizedChannelCount) {
+        m_count += accumulateBanks<float>(m_optimizedChannelCount,
+                                          dst, selectionMask, nPixels,
+                                          m_skipTransparent, m_skipUnselected,
+                                          F32BinMapper(m_from, m_width), banksForWriting());
+        return;
+    }
+
     // The view
     float from = static_cast<float>(m_from);
     float width = static_cast<float>(m_width);
     float to = from + width;
     float factor = 255.0 / width;
 
-    quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
-    quint8 *dst = dstPixels;
     QVector<float> channels(m_colorSpace->channelCount());
 
     if (selectionMask) {
         while (nPixels > 0) {
-            if (!((m_skipUnselected && *selectionMask == 0) || (m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8))) {
+            if (!((m_skipUnselected && *selectionMask == 0) || (m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8))) {
                 m_colorSpace->normalisedChannelsValue(dst,channels);
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     float value = channels[i];
@@ -273,7 +551,7 @@ void KoBasicF32HistogramProducer::addRegionToBin(const quint8 * pixels, const qu
         }
     } else {
         while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
+            if (!(m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8)) {
                 m_colorSpace->normalisedChannelsValue(dst,channels);
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     float value = channels[i];
@@ -301,6 +579,11 @@ KoBasicF16HalfHistogramProducer::KoBasicF16HalfHistogramProducer(const KoID& id,
 {
 }
 
+KoHistogramProducer *KoBasicF16HalfHistogramProducer::createEmptyCopy() const
+{
+    return setUpEmptyCopy(new KoBasicF16HalfHistogramProducer(m_id, m_colorSpace));
+}
+
 QString KoBasicF16HalfHistogramProducer::positionToString(qreal pos) const
 {
     return QString("%1").arg(static_cast<float>(pos)); // XXX I doubt this is correct!
@@ -321,14 +604,14 @@ void KoBasicF16HalfHistogramProducer::addRegionToBin(const quint8 * pixels, cons
     float factor = 255.0 / width;
 
     quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
-    quint8 *dst = dstPixels;
+    KoScratchBuffer dstPixels(nPixels * dstPixelSize);
+    cs->convertPixelsTo(pixels, dstPixels.data(), m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
+    quint8 *dst = dstPixels.data();
     QVector<float> channels(m_colorSpace->channelCount());
 
     if (selectionMask) {
         while (nPixels > 0) {
-            if (!((m_skipUnselected  && *selectionMask == 0) || (m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8))) {
+            if (!((m_skipUnselected  && *selectionMask == 0) || (m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8))) {
                 m_colorSpace->normalisedChannelsValue(dst,channels);
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     float value = channels[i];
@@ -347,7 +630,7 @@ void KoBasicF16HalfHistogramProducer::addRegionToBin(const quint8 * pixels, cons
         }
     } else {
         while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
+            if (!(m_skipTransparent && m_colorSpace->opacityU8(dst) == OPACITY_TRANSPARENT_U8)) {
                 m_colorSpace->normalisedChannelsValue(dst,channels);
                 for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
                     float value = channels[i];
@@ -378,6 +661,11 @@ KoGenericRGBHistogramProducer::KoGenericRGBHistogramProducer()
     m_channelsList.append(new KoChannelInfo(i18n("B"), 2, 2, KoChannelInfo::COLOR, KoChannelInfo::UINT8, 1, QColor(0, 0, 255)));
 }
 
+KoHistogramProducer *KoGenericRGBHistogramProducer::createEmptyCopy() const
+{
+    return setUpEmptyCopy(new KoGenericRGBHistogramProducer());
+}
+
 QList<KoChannelInfo *> KoGenericRGBHistogramProducer::channels()
 {
     return m_channelsList;
@@ -462,6 +750,11 @@ KoGenericLabHistogramProducer::~KoGenericLabHistogramProducer()
     delete m_channelsList[2];
 }
 
+KoHistogramProducer *KoGenericLabHistogramProducer::createEmptyCopy() const
+{
+    return setUpEmptyCopy(new KoGenericLabHistogramProducer());
+}
+
 QList<KoChannelInfo *> KoGenericLabHistogramProducer::channels()
 {
     return m_channelsList;
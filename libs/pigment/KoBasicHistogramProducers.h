@@ -39,6 +39,8 @@ public:
 
     void clear() override;
 
+    void addBinsFrom(KoHistogramProducer *other) override;
+
     void setView(qreal from, qreal size) override {
         m_from = from; m_width = size;
     }
@@ -64,14 +66,17 @@ public:
     }
 
     qint32 getBinAt(int channel, int position) override {
+        flushBanks();
         return m_bins.at(externalToInternal(channel)).at(position);
     }
 
     qint32 outOfViewLeft(int channel) override {
+        flushBanks();
         return m_outLeft.at(externalToInternal(channel));
     }
 
     qint32 outOfViewRight(int channel) override {
+        flushBanks();
         return m_outRight.at(externalToInternal(channel));
     }
 
@@ -90,6 +95,27 @@ protected:
     }
     // not virtual since that is useless: we call it from constructor
     void makeExternalToInternal();
+
+    /// Copies the view and the skipping options into a freshly created \p copy
+    KoHistogramProducer *setUpEmptyCopy(KoBasicHistogramProducer *copy) const;
+
+    /**
+     * The optimized producers are used for RGBA and GrayA color spaces
+     * with the channel type of the producer, which is defined by \p depthId.
+     * Returns the number of channels for such color spaces and 0 for all
+     * the others.
+     */
+    int optimizedChannelCount(const KoID &depthId) const;
+
+    /**
+     * The optimized producers count the pixels into several interleaved
+     * banks of bins, so that the pixels of the same color do not wait for
+     * each other's increments. The banks are added to m_bins lazily by
+     * flushBanks().
+     */
+    quint32 *banksForWriting();
+    void flushBanks();
+
     typedef QVector<quint32> vBins;
     QVector<vBins> m_bins;
     vBins m_outLeft, m_outRight;
@@ -99,6 +125,8 @@ protected:
     const KoColorSpace *m_colorSpace;
     KoID m_id;
     QVector<qint32> m_external;
+    QVector<quint32> m_banks;
+    bool m_banksDirty;
 };
 
 class KRITAPIGMENT_EXPORT KoBasicU8HistogramProducer : public KoBasicHistogramProducer
@@ -106,11 +134,14 @@ class KRITAPIGMENT_EXPORT KoBasicU8HistogramProducer : public KoBasicHistogramPr
 public:
     KoBasicU8HistogramProducer(const KoID& id, const KoColorSpace *colorSpace);
     ~KoBasicU8HistogramProducer() override {}
+    KoHistogramProducer *createEmptyCopy() const override;
     void addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *colorSpace) override;
     QString positionToString(qreal pos) const override;
     qreal maximalZoom() const override {
         return 1.0;
     }
+private:
+    int m_optimizedChannelCount;
 };
 
 class KRITAPIGMENT_EXPORT KoBasicU16HistogramProducer : public KoBasicHistogramProducer
@@ -118,9 +149,12 @@ class KRITAPIGMENT_EXPORT KoBasicU16HistogramProducer : public KoBasicHistogramP
 public:
     KoBasicU16HistogramProducer(const KoID& id, const KoColorSpace *colorSpace);
     ~KoBasicU16HistogramProducer() override {}
+    KoHistogramProducer *createEmptyCopy() const override;
     void addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *colorSpace) override;
     QString positionToString(qreal pos) const override;
     qreal maximalZoom() const override;
+private:
+    int m_optimizedChannelCount;
 };
 
 class KRITAPIGMENT_EXPORT KoBasicF32HistogramProducer : public KoBasicHistogramProducer
@@ -128,9 +162,12 @@ class KRITAPIGMENT_EXPORT KoBasicF32HistogramProducer : public KoBasicHistogramP
 public:
     KoBasicF32HistogramProducer(const KoID& id, const KoColorSpace *colorSpace);
     ~KoBasicF32HistogramProducer() override {}
+    KoHistogramProducer *createEmptyCopy() const override;
     void addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *colorSpace) override;
     QString positionToString(qreal pos) const override;
     qreal maximalZoom() const override;
+private:
+    int m_optimizedChannelCount;
 };
 
 
@@ -140,6 +177,7 @@ class KRITAPIGMENT_EXPORT KoBasicF16HalfHistogramProducer : public KoBasicHistog
 public:
     KoBasicF16HalfHistogramProducer(const KoID& id, const KoColorSpace *colorSpace);
     ~KoBasicF16HalfHistogramProducer() override {}
+    KoHistogramProducer *createEmptyCopy() const override;
     void addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *colorSpace) override;
     QString positionToString(qreal pos) const override;
     qreal maximalZoom() const override;
@@ -193,6 +231,7 @@ class KRITAPIGMENT_EXPORT KoGenericRGBHistogramProducer : public KoBasicHistogra
 public:
     KoGenericRGBHistogramProducer();
     ~KoGenericRGBHistogramProducer() override {}
+    KoHistogramProducer *createEmptyCopy() const override;
     void addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *colorSpace) override;
     QString positionToString(qreal pos) const override;
     qreal maximalZoom() const override;
@@ -234,6 +273,7 @@ class  KRITAPIGMENT_EXPORT KoGenericLabHistogramProducer : public KoBasicHistogr
 public:
     KoGenericLabHistogramProducer();
     ~KoGenericLabHistogramProducer() override;
+    KoHistogramProducer *createEmptyCopy() const override;
     void addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *colorSpace) override;
     QString positionToString(qreal pos) const override;
     qreal maximalZoom() const override;
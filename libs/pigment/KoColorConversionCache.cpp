@@ -22,6 +22,7 @@
 #include <QHash>
 #include <QList>
 #include <QMutex>
+#include <QAtomicInt>
 #include <QThreadStorage>
 
 #include <KoColorSpace.h>
@@ -40,7 +41,10 @@ struct KoColorConversionCacheKey {
     }
 
     bool operator==(const KoColorConversionCacheKey& rhs) const {
-        return (*src == *(rhs.src)) && (*dst == *(rhs.dst))
+        // comparing the pointers first avoids comparing the profiles
+        // in the most common case
+        return (src == rhs.src || *src == *(rhs.src))
+                && (dst == rhs.dst || *dst == *(rhs.dst))
                 && (renderingIntent == rhs.renderingIntent)
                 && (conversionFlags == rhs.conversionFlags);
     }
@@ -67,20 +71,79 @@ struct KoColorConversionCache::CachedTransformation {
     }
 
     bool available() {
-        return use == 0;
+        return use.loadAcquire() == 0;
     }
 
     KoColorConversionTransformation* transfo;
-    int use;
+    QAtomicInt use;
 };
 
 typedef QPair<KoColorConversionCacheKey, KoCachedColorConversionTransformation> FastPathCacheItem;
 
+namespace {
+
+/**
+ * The last few transformations used by a thread. The thread owns
+ * every transformation stored here (its use counter is non-zero),
+ * so the other threads create their own copies of it, and this
+ * thread can use it without any locking.
+ */
+struct ThreadLocalCache {
+    ThreadLocalCache(int _generation)
+        : generation(_generation)
+    {
+    }
+
+    ~ThreadLocalCache() {
+        clear();
+    }
+
+    void clear() {
+        qDeleteAll(items);
+        items.clear();
+    }
+
+    int generation;
+    QList<FastPathCacheItem*> items; // the most recently used first
+};
+
+/**
+ * A part of the global cache with its own lock. The transformations
+ * are distributed among the shards by the hash of the key, so the
+ * threads converting between different color spaces do not wait for
+ * each other.
+ */
+struct CacheShard {
+    QMultiHash< KoColorConversionCacheKey, KoColorConversionCache::CachedTransformation*> cache;
+
+    /**
+     * The transformations of the destroyed color spaces that are
+     * still referenced by the thread-local caches of other threads
+     */
+    QList<KoColorConversionCache::CachedTransformation*> orphans;
+
+    QMutex mutex;
+};
+
+}
+
 struct KoColorConversionCache::Private {
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*> cache;
-    QMutex cacheMutex;
+    static const int numShards = 16;
+    static const int threadLocalCacheSize = 4;
+
+    CacheShard shards[numShards];
+
+    /**
+     * Incremented every time a color space is destroyed to
+     * invalidate the thread-local caches
+     */
+    QAtomicInt generation;
 
-    QThreadStorage<FastPathCacheItem*> fastStorage;
+    QThreadStorage<ThreadLocalCache*> fastStorage;
+
+    CacheShard& shardForKey(const KoColorConversionCacheKey &key) {
+        return shards[qHash(key) % numShards];
+    }
 };
 
 
@@ -90,8 +153,12 @@ KoColorConversionCache::KoColorConversionCache() : d(new Private)
 
 KoColorConversionCache::~KoColorConversionCache()
 {
-    Q_FOREACH (CachedTransformation* transfo, d->cache) {
-        delete transfo;
+    // release the transformations used by the current thread
+    d->fastStorage.setLocalData(0);
+
+    for (int i = 0; i < Private::numShards; i++) {
+        qDeleteAll(d->shards[i].cache);
+        qDeleteAll(d->shards[i].orphans);
     }
     delete d;
 }
@@ -103,20 +170,33 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
 {
     KoColorConversionCacheKey key(src, dst, _renderingIntent, _conversionFlags);
 
-    FastPathCacheItem *cacheItem =
-        d->fastStorage.localData();
+    const int generation = d->generation.loadAcquire();
+    ThreadLocalCache *localCache = d->fastStorage.localData();
+
+    if (!localCache) {
+        localCache = new ThreadLocalCache(generation);
+        d->fastStorage.setLocalData(localCache);
+    } else if (localCache->generation != generation) {
+        localCache->clear();
+        localCache->generation = generation;
+    }
 
-    if (cacheItem) {
-        if (cacheItem->first == key) {
-            return cacheItem->second;
+    for (int i = 0; i < localCache->items.size(); i++) {
+        if (localCache->items[i]->first == key) {
+            if (i > 0) {
+                localCache->items.move(i, 0);
+            }
+            return localCache->items.first()->second;
         }
     }
 
-    cacheItem = 0;
+    FastPathCacheItem *cacheItem = 0;
+    CacheShard &shard = d->shardForKey(key);
 
-    QMutexLocker lock(&d->cacheMutex);
-    QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
-    if (cachedTransfos.size() != 0) {
+    {
+        QMutexLocker lock(&shard.mutex);
+
+        QList< CachedTransformation* > cachedTransfos = shard.cache.values(key);
         Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
             if (ct->available()) {
                 ct->transfo->setSrcColorSpace(src);
@@ -127,30 +207,57 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
             }
         }
     }
+
     if (!cacheItem) {
+        /**
+         * Creation of a transformation may take a while, so
+         * do it without holding the lock. The handle is created
+         * before the transformation is published, so no other
+         * thread can take it.
+         */
         KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
         CachedTransformation* ct = new CachedTransformation(transfo);
-        d->cache.insert(key, ct);
         cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
+
+        QMutexLocker lock(&shard.mutex);
+        shard.cache.insert(key, ct);
+    }
+
+    localCache->items.prepend(cacheItem);
+    if (localCache->items.size() > Private::threadLocalCacheSize) {
+        delete localCache->items.takeLast();
     }
 
-    d->fastStorage.setLocalData(cacheItem);
     return cacheItem->second;
 }
 
 void KoColorConversionCache::colorSpaceIsDestroyed(const KoColorSpace* cs)
 {
+    d->generation.ref();
     d->fastStorage.setLocalData(0);
 
-    QMutexLocker lock(&d->cacheMutex);
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = d->cache.end();
-    for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = d->cache.begin(); it != endIt;) {
-        if (it.key().src == cs || it.key().dst == cs) {
-            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
-            delete it.value();
-            it = d->cache.erase(it);
-        } else {
-            ++it;
+    for (int i = 0; i < Private::numShards; i++) {
+        CacheShard &shard = d->shards[i];
+
+        QMutexLocker lock(&shard.mutex);
+        QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = shard.cache.end();
+        for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = shard.cache.begin(); it != endIt;) {
+            if (it.key().src == cs || it.key().dst == cs) {
+                /**
+                 * The transformation can still be referenced by
+                 * a thread-local cache of another thread. That thread
+                 * will drop it on the next access, so the object should
+                 * stay alive till the cache is destroyed.
+                 */
+                if (it.value()->available()) {
+                    delete it.value();
+                } else {
+                    shard.orphans.append(it.value());
+                }
+                it = shard.cache.erase(it);
+            } else {
+                ++it;
+            }
         }
     }
 }
@@ -168,18 +275,19 @@ KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoC
     Q_ASSERT(transfo->available());
     d->cache = cache;
     d->transfo = transfo;
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs) : d(new Private(*rhs.d))
 {
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::~KoCachedColorConversionTransformation()
 {
-    d->transfo->use--;
-    Q_ASSERT(d->transfo->use >= 0);
+    const int use = d->transfo->use.fetchAndAddOrdered(-1);
+    Q_ASSERT(use > 0);
+    Q_UNUSED(use);
     delete d;
 }
 
@@ -0,0 +1,360 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoColorConversionLut.h"
+
+#include <limits>
+
+#include <QVector>
+
+#include "KoColorSpace.h"
+#include "KoChannelInfo.h"
+#include "KoColorConversionTransformation.h"
+#include "kis_assert.h"
+
+namespace {
+
+template <typename T>
+struct LutChannelTraits
+{
+    static const bool isInteger = true;
+    static float unitValue() { return std::numeric_limits<T>::max(); }
+};
+
+template <>
+struct LutChannelTraits<float>
+{
+    static const bool isInteger = false;
+    static float unitValue() { return 1.0f; }
+};
+
+template <typename T>
+inline T lutStoreChannel(float value)
+{
+    const float unit = LutChannelTraits<T>::unitValue();
+    return T(qBound(0.0f, value, unit) + 0.5f);
+}
+
+template <>
+inline float lutStoreChannel<float>(float value)
+{
+    return value;
+}
+
+bool uniformChannelType(const KoColorSpace *cs, KoChannelInfo::enumChannelValueType *type)
+{
+    const QList<KoChannelInfo*> channels = cs->channels();
+    if (channels.isEmpty()) return false;
+
+    *type = channels.first()->channelValueType();
+    Q_FOREACH (const KoChannelInfo *channel, channels) {
+        if (channel->channelValueType() != *type) return false;
+    }
+
+    return true;
+}
+
+}
+
+struct KoColorConversionLut::Private
+{
+    typedef void (*EvaluateFunc)(const Private *d, const quint8 *src, quint8 *dst, qint32 numPixels);
+
+    int gridSize = 0;
+    int numDstChannels = 0;
+
+    /**
+     * Every node stores numDstChannels values padded to a multiple of
+     * four floats, so the interpolation loop has a constant trip count
+     * and is turned into SIMD instructions by the compiler.
+     */
+    QVector<float> nodes;
+
+    EvaluateFunc evaluate = 0;
+
+    template <typename SrcChannel>
+    void fillGrid(quint8 *pixels) const;
+
+    template <typename DstChannel, int stride>
+    void readNodes(const quint8 *pixels);
+
+    template <typename SrcChannel, typename DstChannel, int stride>
+    static void evaluateImpl(const Private *d, const quint8 *src, quint8 *dst, qint32 numPixels);
+
+    template <typename SrcChannel, int stride>
+    EvaluateFunc selectEvaluate(KoChannelInfo::enumChannelValueType dstType);
+};
+
+template <typename SrcChannel>
+void KoColorConversionLut::Private::fillGrid(quint8 *pixels) const
+{
+    const float unit = LutChannelTraits<SrcChannel>::unitValue();
+    const float step = unit / (gridSize - 1);
+
+    SrcChannel *it = reinterpret_cast<SrcChannel*>(pixels);
+
+    for (int i = 0; i < gridSize; i++) {
+        for (int j = 0; j < gridSize; j++) {
+            for (int k = 0; k < gridSize; k++) {
+                it[0] = SrcChannel(i * step + 0.5f);
+                it[1] = SrcChannel(j * step + 0.5f);
+                it[2] = SrcChannel(k * step + 0.5f);
+                it[3] = SrcChannel(unit);
+                it += 4;
+            }
+        }
+    }
+}
+
+template <typename DstChannel, int stride>
+void KoColorConversionLut::Private::readNodes(const quint8 *pixels)
+{
+    const int numNodes = gridSize * gridSize * gridSize;
+    nodes.fill(0.0f, numNodes * stride);
+
+    const DstChannel *it = reinterpret_cast<const DstChannel*>(pixels);
+    float *node = nodes.data();
+
+    for (int i = 0; i < numNodes; i++) {
+        for (int c = 0; c < numDstChannels; c++) {
+            node[c] = it[c];
+        }
+        it += numDstChannels;
+        node += stride;
+    }
+}
+
+template <typename SrcChannel, typename DstChannel, int stride>
+void KoColorConversionLut::Private::evaluateImpl(const Private *d, const quint8 *src, quint8 *dst, qint32 numPixels)
+{
+    const int g = d->gridSize;
+    const int maxCell = g - 2;
+    const float scale = float(g - 1) / LutChannelTraits<SrcChannel>::unitValue();
+
+    const int dx = g * g * stride;
+    const int dy = g * stride;
+    const int dz = stride;
+
+    const float *nodes = d->nodes.constData();
+    const int numDstChannels = d->numDstChannels;
+
+    const SrcChannel *srcIt = reinterpret_cast<const SrcChannel*>(src);
+    DstChannel *dstIt = reinterpret_cast<DstChannel*>(dst);
+
+    for (qint32 i = 0; i < numPixels; i++) {
+        const float x = srcIt[0] * scale;
+        const float y = srcIt[1] * scale;
+        const float z = srcIt[2] * scale;
+
+        const int ix = qMin(int(x), maxCell);
+        const int iy = qMin(int(y), maxCell);
+        const int iz = qMin(int(z), maxCell);
+
+        const float fx = x - ix;
+        const float fy = y - iy;
+        const float fz = z - iz;
+
+        /**
+         * Sort the fractions to find the tetrahedron of the cell the
+         * point belongs to. The path c000 -> v1 -> v2 -> c111 goes
+         * along the axes in the order of decreasing fractions.
+         */
+        float a, b, c;
+        int offsetA, offsetB;
+
+        if (fx >= fy) {
+            if (fy >= fz) {
+                a = fx; offsetA = dx; b = fy; offsetB = dy; c = fz;
+            } else if (fx >= fz) {
+                a = fx; offsetA = dx; b = fz; offsetB = dz; c = fy;
+            } else {
+                a = fz; offsetA = dz; b = fx; offsetB = dx; c = fy;
+            }
+        } else {
+            if (fx >= fz) {
+                a = fy; offsetA = dy; b = fx; offsetB = dx; c = fz;
+            } else if (fy >= fz) {
+                a = fy; offsetA = dy; b = fz; offsetB = dz; c = fx;
+            } else {
+                a = fz; offsetA = dz; b = fy; offsetB = dy; c = fx;
+            }
+        }
+
+        const float *c000 = nodes + ix * dx + iy * dy + iz * dz;
+        const float *v1 = c000 + offsetA;
+        const float *v2 = v1 + offsetB;
+        const float *c111 = c000 + dx + dy + dz;
+
+        const float w0 = 1.0f - a;
+        const float w1 = a - b;
+        const float w2 = b - c;
+        const float w3 = c;
+
+        float result[stride];
+        for (int ch = 0; ch < stride; ch++) {
+            result[ch] = w0 * c000[ch] + w1 * v1[ch] + w2 * v2[ch] + w3 * c111[ch];
+        }
+
+        for (int ch = 0; ch < numDstChannels; ch++) {
+            dstIt[ch] = lutStoreChannel<DstChannel>(result[ch]);
+        }
+
+        srcIt += 4;
+        dstIt += numDstChannels;
+    }
+}
+
+template <typename SrcChannel, int stride>
+KoColorConversionLut::Private::EvaluateFunc
+KoColorConversionLut::Private::selectEvaluate(KoChannelInfo::enumChannelValueType dstType)
+{
+    switch (dstType) {
+    case KoChannelInfo::UINT8:
+        return &Private::evaluateImpl<SrcChannel, quint8, stride>;
+    case KoChannelInfo::UINT16:
+        return &Private::evaluateImpl<SrcChannel, quint16, stride>;
+    case KoChannelInfo::FLOAT32:
+        return &Private::evaluateImpl<SrcChannel, float, stride>;
+    default:
+        return 0;
+    }
+}
+
+KoColorConversionLut::KoColorConversionLut(const KoColorConversionTransformation *exactTransform, int gridSize)
+    : m_d(new Private)
+{
+    const KoColorSpace *srcCs = exactTransform->srcColorSpace();
+    const KoColorSpace *dstCs = exactTransform->dstColorSpace();
+    KIS_ASSERT(isSupported(srcCs, dstCs));
+
+    KoChannelInfo::enumChannelValueType srcType;
+    KoChannelInfo::enumChannelValueType dstType;
+    uniformChannelType(srcCs, &srcType);
+    uniformChannelType(dstCs, &dstType);
+
+    m_d->gridSize = qBound(minGridSize(), gridSize, maxGridSize());
+    m_d->numDstChannels = dstCs->channelCount();
+
+    const bool wideNodes = m_d->numDstChannels > 4;
+    const int numNodes = m_d->gridSize * m_d->gridSize * m_d->gridSize;
+
+    QVector<quint8> srcPixels(numNodes * srcCs->pixelSize());
+    QVector<quint8> dstPixels(numNodes * dstCs->pixelSize());
+
+    if (srcType == KoChannelInfo::UINT8) {
+        m_d->fillGrid<quint8>(srcPixels.data());
+        m_d->evaluate = wideNodes ?
+            m_d->selectEvaluate<quint8, 8>(dstType) :
+            m_d->selectEvaluate<quint8, 4>(dstType);
+    } else {
+        m_d->fillGrid<quint16>(srcPixels.data());
+        m_d->evaluate = wideNodes ?
+            m_d->selectEvaluate<quint16, 8>(dstType) :
+            m_d->selectEvaluate<quint16, 4>(dstType);
+    }
+
+    exactTransform->transform(srcPixels.constData(), dstPixels.data(), numNodes);
+
+    switch (dstType) {
+    case KoChannelInfo::UINT8:
+        wideNodes ?
+            m_d->readNodes<quint8, 8>(dstPixels.constData()) :
+            m_d->readNodes<quint8, 4>(dstPixels.constData());
+        break;
+    case KoChannelInfo::UINT16:
+        wideNodes ?
+            m_d->readNodes<quint16, 8>(dstPixels.constData()) :
+            m_d->readNodes<quint16, 4>(dstPixels.constData());
+        break;
+    default:
+        wideNodes ?
+            m_d->readNodes<float, 8>(dstPixels.constData()) :
+            m_d->readNodes<float, 4>(dstPixels.constData());
+        break;
+    }
+}
+
+KoColorConversionLut::~KoColorConversionLut()
+{
+}
+
+bool KoColorConversionLut::isSupported(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace)
+{
+    KoChannelInfo::enumChannelValueType srcType;
+    KoChannelInfo::enumChannelValueType dstType;
+
+    if (!uniformChannelType(srcColorSpace, &srcType) ||
+        !uniformChannelType(dstColorSpace, &dstType)) {
+
+        return false;
+    }
+
+    if (srcType != KoChannelInfo::UINT8 && srcType != KoChannelInfo::UINT16) {
+        return false;
+    }
+
+    if (srcColorSpace->channelCount() != 4 ||
+        srcColorSpace->colorChannelCount() != 3) {
+
+        return false;
+    }
+
+    const QList<KoChannelInfo*> srcChannels = srcColorSpace->channels();
+    Q_FOREACH (const KoChannelInfo *channel, srcChannels) {
+        if (channel->channelType() == KoChannelInfo::ALPHA &&
+            channel->pos() != 3 * channel->size()) {
+
+            return false;
+        }
+    }
+
+    if (dstType != KoChannelInfo::UINT8 &&
+        dstType != KoChannelInfo::UINT16 &&
+        dstType != KoChannelInfo::FLOAT32) {
+
+        return false;
+    }
+
+    return dstColorSpace->channelCount() <= 8;
+}
+
+int KoColorConversionLut::minGridSize()
+{
+    return 2;
+}
+
+int KoColorConversionLut::maxGridSize()
+{
+    return 65;
+}
+
+int KoColorConversionLut::defaultGridSize()
+{
+    return 33;
+}
+
+int KoColorConversionLut::gridSize() const
+{
+    return m_d->gridSize;
+}
+
+void KoColorConversionLut::transform(const quint8 *src, quint8 *dst, qint32 numPixels) const
+{
+    m_d->evaluate(m_d.data(), src, dst, numPixels);
+}
@@ -0,0 +1,82 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOCOLORCONVERSIONLUT_H
+#define KOCOLORCONVERSIONLUT_H
+
+#include <QScopedPointer>
+
+#include "kritapigment_export.h"
+
+class KoColorSpace;
+class KoColorConversionTransformation;
+
+/**
+ * A color conversion baked into a 3D lookup table.
+ *
+ * The table is built by running an exact transformation over a regular
+ * gridSize^3 grid of source pixels. Conversion of a pixel then costs one
+ * tetrahedral interpolation between four grid nodes, which is much cheaper
+ * than evaluating an ICC pipeline and stays within a fraction of deltaE
+ * for smooth transformations.
+ *
+ * Only sources with three integer color channels followed by alpha (RGBA,
+ * LabA, XYZA, YCbCrA in U8 or U16) can be indexed by the table. The
+ * destination can be any U8, U16 or F32 color space of at most 8 channels.
+ * Use isSupported() to check the pair before creating the table.
+ *
+ * The table does not take care of the alpha channel of the destination
+ * pixel, the caller should copy it from the source (like it is done in
+ * the ICC transformations).
+ *
+ * The object is immutable after construction, so transform() can be
+ * called from several threads at the same time.
+ */
+class KRITAPIGMENT_EXPORT KoColorConversionLut
+{
+public:
+    /**
+     * \p exactTransform is used only during the construction. \p gridSize
+     * is clamped into [minGridSize(), maxGridSize()]
+     */
+    KoColorConversionLut(const KoColorConversionTransformation *exactTransform, int gridSize);
+    ~KoColorConversionLut();
+
+    static bool isSupported(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace);
+
+    static int minGridSize();
+    static int maxGridSize();
+    static int defaultGridSize();
+
+    int gridSize() const;
+
+    /**
+     * Converts \p numPixels pixels from \p src into \p dst. The alpha
+     * channel of \p dst is left undefined.
+     */
+    void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const;
+
+private:
+    Q_DISABLE_COPY(KoColorConversionLut)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KOCOLORCONVERSIONLUT_H
@@ -19,6 +19,8 @@
 
 #include "KoColorConversionTransformation.h"
 
+#include <QRect>
+
 #include "KoColorSpace.h"
 
 struct Q_DECL_HIDDEN KoColorConversionTransformation::Private {
@@ -68,6 +70,11 @@ KoColorConversionTransformation::ConversionFlags KoColorConversionTransformation
     return d->conversionFlags;
 }
 
+void KoColorConversionTransformation::transformRect(const quint8 *src, quint8 *dst, const QRect &rect) const
+{
+    transform(src, dst, rect.width() * rect.height());
+}
+
 void KoColorConversionTransformation::transformInPlace(const quint8 *src, quint8 *dst, qint32 nPixels) const
 {
     if (src != dst) {
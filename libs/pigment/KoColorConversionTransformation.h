@@ -24,6 +24,7 @@
 
 #include "kritapigment_export.h"
 
+class QRect;
 class KoColorSpace;
 class KoColorConversionCache;
 
@@ -58,7 +59,10 @@ public:
         BlackpointCompensation  = 0x2000,
         NoWhiteOnWhiteFixup     = 0x0004,    // Don't fix scum dot
         HighQuality             = 0x0400,    // Use more memory to give better accuracy
-        LowQuality              = 0x0800    // Use less memory to minimize resources
+        LowQuality              = 0x0800,    // Use less memory to minimize resources
+        LutInterpolation        = 0x40000000, // Krita-specific: bake the transformation into a 3D LUT, see KoColorConversionLut
+        OrderedDithering        = 0x20000000, // Krita-specific: dither when reducing the bit depth to 8 bits, see KoDitherMatrix
+        BlueNoiseDithering      = 0x10000000  // Krita-specific: same as OrderedDithering, but uses a blue noise matrix
     };
     Q_DECLARE_FLAGS(ConversionFlags, ConversionFlag)
 
@@ -122,6 +126,16 @@ public:
      */
     void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const override = 0;
 
+    /**
+     * Perform the color conversion of a rectangular block of pixels of
+     * the image. \p src and \p dst contain rect.height() rows of
+     * rect.width() pixels each, packed without gaps. The transformations
+     * that depend on the position of the pixel (e.g. dithering ones) use
+     * \p rect to align their patterns to the image. The default
+     * implementation just calls transform().
+     */
+    virtual void transformRect(const quint8 *src, quint8 *dst, const QRect &rect) const;
+
     /**
      * perform the color conversion between two or one buffer. This is a convenience
      * function that allows doing the conversion in-place
@@ -37,12 +37,13 @@
 #include "KoConvolutionOp.h"
 #include "KoCompositeOpRegistry.h"
 #include "KoColorSpaceEngine.h"
+#include "KoScratchBuffer.h"
 
-#include <QThreadStorage>
 #include <QByteArray>
 #include <QBitArray>
 #include <QPolygonF>
 #include <QPointF>
+#include <QRect>
 
 #include <math.h>
 
@@ -432,6 +433,26 @@ bool KoColorSpace::convertPixelsTo(const quint8 * src,
     return true;
 }
 
+bool KoColorSpace::convertPixelsTo(const quint8 * src,
+                                   quint8 * dst,
+                                   const KoColorSpace * dstColorSpace,
+                                   const QRect &rect,
+                                   KoColorConversionTransformation::Intent renderingIntent,
+                                   KoColorConversionTransformation::ConversionFlags conversionFlags) const
+{
+    const KoColorConversionTransformation::ConversionFlags ditheringFlags =
+        KoColorConversionTransformation::OrderedDithering |
+        KoColorConversionTransformation::BlueNoiseDithering;
+
+    if (!(conversionFlags & ditheringFlags) || *this == *dstColorSpace) {
+        return convertPixelsTo(src, dst, dstColorSpace, rect.width() * rect.height(), renderingIntent, conversionFlags);
+    }
+
+    KoCachedColorConversionTransformation cct = KoColorSpaceRegistry::instance()->colorConversionCache()->cachedConverter(this, dstColorSpace, renderingIntent, conversionFlags);
+    cct.transformation()->transformRect(src, dst, rect);
+    return true;
+}
+
 KoColorConversionTransformation * KoColorSpace::createProofingTransform(const KoColorSpace *dstColorSpace, const KoColorSpace *proofingSpace, KoColorConversionTransformation::Intent renderingIntent, KoColorConversionTransformation::Intent proofingIntent, KoColorConversionTransformation::ConversionFlags conversionFlags, quint8 *gamutWarning, double adaptationState) const
 {
     if (!d->iccEngine) {
@@ -467,8 +488,8 @@ void KoColorSpace::bitBlt(const KoColorSpace* srcSpace, const KoCompositeOp::Par
                 srcSpace->hasCompositeOp(op->id())) {
 
             quint32           conversionDstBufferStride = params.cols * srcSpace->pixelSize();
-            QVector<quint8> * conversionDstCache        = threadLocalConversionCache(params.rows * conversionDstBufferStride);
-            quint8*           conversionDstData         = conversionDstCache->data();
+            KoScratchBuffer   conversionDstCache(params.rows * conversionDstBufferStride);
+            quint8*           conversionDstData         = conversionDstCache.data();
 
             for(qint32 row=0; row<params.rows; row++) {
                 convertPixelsTo(params.dstRowStart + row * params.dstRowStride,
@@ -492,8 +513,8 @@ void KoColorSpace::bitBlt(const KoColorSpace* srcSpace, const KoCompositeOp::Par
 
         } else {
             quint32           conversionBufferStride = params.cols * pixelSize();
-            QVector<quint8> * conversionCache        = threadLocalConversionCache(params.rows * conversionBufferStride);
-            quint8*           conversionData         = conversionCache->data();
+            KoScratchBuffer   conversionCache(params.rows * conversionBufferStride);
+            quint8*           conversionData         = conversionCache.data();
 
             for(qint32 row=0; row<params.rows; row++) {
                 srcSpace->convertPixelsTo(params.srcRowStart + row * params.srcRowStride,
@@ -513,20 +534,6 @@ void KoColorSpace::bitBlt(const KoColorSpace* srcSpace, const KoCompositeOp::Par
 }
 
 
-QVector<quint8> * KoColorSpace::threadLocalConversionCache(quint32 size) const
-{
-    QVector<quint8> * ba = 0;
-    if (!d->conversionCache.hasLocalData()) {
-        ba = new QVector<quint8>(size, '0');
-        d->conversionCache.setLocalData(ba);
-    } else {
-        ba = d->conversionCache.localData();
-        if ((quint8)ba->size() < size)
-            ba->resize(size);
-    }
-    return ba;
-}
-
 KoColorTransformation* KoColorSpace::createColorTransformation(const QString & id, const QHash<QString, QVariant> & parameters) const
 {
     KoColorTransformationFactory* factory = KoColorTransformationFactoryRegistry::instance()->get(id);
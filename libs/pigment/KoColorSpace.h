@@ -363,9 +363,10 @@ public:
      *
      * Returns false if the conversion failed, true if it succeeded
      *
-     * This function is not thread-safe. If you want to apply multiple conversion
-     * in different threads at the same time, you need to create one color converter
-     * per-thread using createColorConverter.
+     * This function is thread-safe: the conversion cache gives every thread
+     * its own copy of the transformation. Still, if you convert a lot of small
+     * chunks in a loop, it is cheaper to create a color converter once using
+     * createColorConverter.
      */
     virtual bool convertPixelsTo(const quint8 * src,
                                  quint8 * dst, const KoColorSpace * dstColorSpace,
@@ -373,6 +374,20 @@ public:
                                  KoColorConversionTransformation::Intent renderingIntent,
                                  KoColorConversionTransformation::ConversionFlags conversionFlags) const;
 
+    /**
+     * Convert a rectangular block of pixels of the image to the specified
+     * color space. \p src and \p dst contain rect.height() rows of
+     * rect.width() pixels each, packed without gaps. The position of
+     * \p rect is used to align the dithering pattern to the image when
+     * \p conversionFlags request dithering, otherwise the call is
+     * equivalent to the linear version above.
+     */
+    bool convertPixelsTo(const quint8 * src,
+                         quint8 * dst, const KoColorSpace * dstColorSpace,
+                         const QRect &rect,
+                         KoColorConversionTransformation::Intent renderingIntent,
+                         KoColorConversionTransformation::ConversionFlags conversionFlags) const;
+
     virtual KoColorConversionTransformation *createProofingTransform(const KoColorSpace * dstColorSpace,
                                                              const KoColorSpace * proofingSpace,
                                                              KoColorConversionTransformation::Intent renderingIntent,
@@ -589,12 +604,6 @@ protected:
     const KoColorConversionTransformation* toRgbA16Converter() const;
     const KoColorConversionTransformation* fromRgbA16Converter() const;
 
-    /**
-     * Returns the thread-local conversion cache. If it doesn't exist
-     * yet, it is created. If it is currently too small, it is resized.
-     */
-    QVector<quint8> * threadLocalConversionCache(quint32 size) const;
-
     /**
      * This function defines the behavior of the bitBlt function
      * when the composition of pixels in different colorspaces is
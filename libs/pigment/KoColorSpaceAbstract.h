@@ -30,9 +30,7 @@
 #include <KoColorSpaceRegistry.h>
 #include "KoFallBackColorTransformation.h"
 #include "KoLabDarkenColorTransformation.h"
-#include "KoMixColorsOpImpl.h"
-
-#include "KoConvolutionOpImpl.h"
+#include "KoOptimizedPixelOpsSelector.h"
 #include "KoInvertColorTransformation.h"
 
 /**
@@ -53,7 +51,9 @@ public:
 
 public:
     KoColorSpaceAbstract(const QString &id, const QString &name) :
-        KoColorSpace(id, name, new KoMixColorsOpImpl< _CSTrait>(), new KoConvolutionOpImpl< _CSTrait>()) {
+        KoColorSpace(id, name,
+                     KoOptimizedPixelOpsSelector<_CSTrait>::createMixColorsOp(),
+                     KoOptimizedPixelOpsSelector<_CSTrait>::createConvolutionOp()) {
     }
 
     quint32 colorChannelCount() const override {
@@ -146,6 +146,8 @@ public:
         return new KoFallBackColorTransformation(this, KoColorSpaceRegistry::instance()->lab16(""), new KoLabDarkenColorTransformation<quint16>(shade, compensate, compensation, KoColorSpaceRegistry::instance()->lab16("")));
     }
 
+    using KoColorSpace::convertPixelsTo;
+
     bool convertPixelsTo(const quint8 *src,
                                  quint8 *dst, const KoColorSpace *dstColorSpace,
                                  quint32 numPixels,
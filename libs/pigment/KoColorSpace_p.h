@@ -23,7 +23,6 @@
 #include "KoColorSpace.h"
 #include "KoColorSpaceEngine.h"
 #include "KoColorConversionTransformation.h"
-#include <QThreadStorage>
 #include <QPolygonF>
 
 struct Q_DECL_HIDDEN KoColorSpace::Private {
@@ -35,7 +34,6 @@ struct Q_DECL_HIDDEN KoColorSpace::Private {
     QList<KoChannelInfo *> channels;
     KoMixColorsOp* mixColorsOp;
     KoConvolutionOp* convolutionOp;
-    QThreadStorage< QVector<quint8>* > conversionCache;
 
     mutable KoColorConversionTransformation* transfoToRGBA16;
     mutable KoColorConversionTransformation* transfoFromRGBA16;
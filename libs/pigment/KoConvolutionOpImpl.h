@@ -98,6 +98,23 @@ public:
             }
         }
 
+        writeConvolutionResult(totals, totalWeight, totalWeightTransparent, dst, factor, offset, channelFlags);
+    }
+
+    /**
+     * Writes the result of the convolution into \p dst. \p totals
+     * contain sums of the channels of non-transparent pixels multiplied
+     * by their weights. See convolveColors() for the description of
+     * the three cases.
+     *
+     * The method is shared with the vectorized implementation of the
+     * op, so that both of them handle transparent pixels the same way.
+     */
+    static void writeConvolutionResult(const qreal *totals,
+                                       qreal totalWeight, qreal totalWeightTransparent,
+                                       quint8 *dst, qreal factor, qreal offset,
+                                       const QBitArray & channelFlags) {
+
         typename _CSTrait::channels_type* dstColor = _CSTrait::nativeArray(dst);
 
         bool allChannels = channelFlags.isEmpty();
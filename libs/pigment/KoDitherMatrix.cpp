@@ -0,0 +1,232 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoDitherMatrix.h"
+
+#include <cmath>
+#include <random>
+
+namespace {
+
+/**
+ * Returns the ranks of the recursive Bayer matrix. The rank of a pixel
+ * is built by interleaving the bits of (x ^ y) and y in reverse order.
+ */
+QVector<int> generateOrderedRanks(int size)
+{
+    int numBits = 0;
+    while ((1 << numBits) < size) numBits++;
+
+    QVector<int> ranks(size * size);
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int rank = 0;
+
+            for (int bit = 0; bit < numBits; bit++) {
+                const int shift = 2 * (numBits - 1 - bit);
+                rank |= (((x ^ y) >> bit) & 1) << (shift + 1);
+                rank |= ((y >> bit) & 1) << shift;
+            }
+
+            ranks[y * size + x] = rank;
+        }
+    }
+
+    return ranks;
+}
+
+/**
+ * Helper for the void-and-cluster method. Keeps a binary pattern on a
+ * torus and the "energy" of every pixel, that is the sum of the Gaussian
+ * kernel centered at all the set pixels.
+ */
+class VoidAndClusterPattern
+{
+public:
+    VoidAndClusterPattern(int size, float sigma)
+        : m_size(size),
+          m_pixels(size * size, false),
+          m_energy(size * size, 0.0f),
+          m_kernel(size * size)
+    {
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                const int dx = qMin(x, size - x);
+                const int dy = qMin(y, size - y);
+                m_kernel[y * size + x] = std::exp(-float(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+            }
+        }
+    }
+
+    bool isSet(int index) const {
+        return m_pixels[index];
+    }
+
+    void set(int index, bool value) {
+        if (m_pixels[index] == value) return;
+
+        m_pixels[index] = value;
+
+        const float sign = value ? 1.0f : -1.0f;
+        const int mask = m_size - 1;
+        const int px = index % m_size;
+        const int py = index / m_size;
+
+        for (int y = 0; y < m_size; y++) {
+            const float *kernelRow = m_kernel.constData() + ((y - py) & mask) * m_size;
+            float *energyRow = m_energy.data() + y * m_size;
+
+            for (int x = 0; x < m_size; x++) {
+                energyRow[x] += sign * kernelRow[(x - px) & mask];
+            }
+        }
+    }
+
+    /**
+     * The set pixel with the highest energy
+     */
+    int tightestCluster() const {
+        int result = -1;
+
+        for (int i = 0; i < m_pixels.size(); i++) {
+            if (m_pixels[i] && (result < 0 || m_energy[i] > m_energy[result])) {
+                result = i;
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * The unset pixel with the lowest energy
+     */
+    int largestVoid() const {
+        int result = -1;
+
+        for (int i = 0; i < m_pixels.size(); i++) {
+            if (!m_pixels[i] && (result < 0 || m_energy[i] < m_energy[result])) {
+                result = i;
+            }
+        }
+
+        return result;
+    }
+
+private:
+    int m_size;
+    QVector<bool> m_pixels;
+    QVector<float> m_energy;
+    QVector<float> m_kernel;
+};
+
+/**
+ * Generates the ranks of a blue noise matrix using the void-and-cluster
+ * method by Robert Ulichney. The last phase of the original algorithm
+ * (filling the majority pixels) is replaced with the continued filling
+ * of the largest voids, which gives visually identical results.
+ */
+QVector<int> generateBlueNoiseRanks(int size)
+{
+    const int numPixels = size * size;
+    const int numInitialPixels = numPixels / 10;
+
+    VoidAndClusterPattern pattern(size, 1.5f);
+
+    // the seed is fixed to get the same matrix on every run
+    std::minstd_rand generator(1);
+    std::uniform_int_distribution<int> distribution(0, numPixels - 1);
+
+    for (int i = 0; i < numInitialPixels;) {
+        const int index = distribution(generator);
+        if (!pattern.isSet(index)) {
+            pattern.set(index, true);
+            i++;
+        }
+    }
+
+    // move the pixels from the tightest clusters into the largest
+    // voids until the pattern becomes homogeneous
+    for (int i = 0; i < numPixels; i++) {
+        const int cluster = pattern.tightestCluster();
+        pattern.set(cluster, false);
+
+        const int voidIndex = pattern.largestVoid();
+        pattern.set(voidIndex, true);
+
+        if (voidIndex == cluster) break;
+    }
+
+    QVector<int> ranks(numPixels);
+
+    {
+        VoidAndClusterPattern prototype = pattern;
+
+        for (int rank = numInitialPixels - 1; rank >= 0; rank--) {
+            const int cluster = prototype.tightestCluster();
+            prototype.set(cluster, false);
+            ranks[cluster] = rank;
+        }
+    }
+
+    for (int rank = numInitialPixels; rank < numPixels; rank++) {
+        const int voidIndex = pattern.largestVoid();
+        pattern.set(voidIndex, true);
+        ranks[voidIndex] = rank;
+    }
+
+    return ranks;
+}
+
+}
+
+KoDitherMatrix::KoDitherMatrix(Type type)
+    : m_type(type)
+{
+    const int numPixels = size() * size();
+
+    const QVector<int> ranks =
+        type == Ordered ? generateOrderedRanks(size()) : generateBlueNoiseRanks(size());
+
+    m_thresholds.resize(2 * numPixels);
+
+    for (int y = 0; y < size(); y++) {
+        float *row = m_thresholds.data() + y * 2 * size();
+
+        for (int x = 0; x < size(); x++) {
+            row[x] = row[x + size()] = (ranks[y * size() + x] + 0.5f) / numPixels;
+        }
+    }
+}
+
+const KoDitherMatrix* KoDitherMatrix::instance(Type type)
+{
+    if (type == BlueNoise) {
+        static const KoDitherMatrix blueNoise(BlueNoise);
+        return &blueNoise;
+    }
+
+    static const KoDitherMatrix ordered(Ordered);
+    return &ordered;
+}
+
+KoDitherMatrix::Type KoDitherMatrix::type() const
+{
+    return m_type;
+}
@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KODITHERMATRIX_H
+#define KODITHERMATRIX_H
+
+#include <QVector>
+
+#include "kritapigment_export.h"
+
+/**
+ * A square tileable matrix of dithering thresholds used for reducing
+ * the bit depth of the pixels (see KoDitherOp).
+ *
+ * Every threshold lies in (0, 1) and all the thresholds of the matrix
+ * are distributed uniformly, so adding them to the scaled channel
+ * values before truncation keeps the average color of every region
+ * of the image.
+ *
+ * Two kinds of matrices are available:
+ *
+ * - Ordered: the classic recursive Bayer matrix. It is cheap and
+ *   regular, but has a visible cross-hatch pattern.
+ *
+ * - BlueNoise: a matrix generated with the void-and-cluster method.
+ *   Its pattern has no low-frequency components, so it is almost
+ *   invisible at normal viewing distances.
+ *
+ * The matrices are shared and immutable, so they can be used from
+ * several threads at the same time.
+ */
+class KRITAPIGMENT_EXPORT KoDitherMatrix
+{
+public:
+    enum Type {
+        Ordered,
+        BlueNoise
+    };
+
+    static const KoDitherMatrix* instance(Type type);
+
+    /**
+     * The matrix covers size() x size() pixels and is tiled over
+     * the image. The size is a power of two.
+     */
+    static int size() {
+        return 64;
+    }
+
+    Type type() const;
+
+    /**
+     * Returns the thresholds of the row (\p y % size()) of the matrix.
+     * The row is stored twice, so any run of up to size() thresholds
+     * starting at (x % size()) can be read without wrapping around.
+     */
+    inline const float* row(int y) const {
+        return m_thresholds.constData() + (y & (size() - 1)) * 2 * size();
+    }
+
+    /**
+     * Returns the threshold for the pixel (\p x, \p y)
+     */
+    inline float threshold(int x, int y) const {
+        return row(y)[x & (size() - 1)];
+    }
+
+private:
+    KoDitherMatrix(Type type);
+
+private:
+    Q_DISABLE_COPY(KoDitherMatrix)
+
+    Type m_type;
+    QVector<float> m_thresholds;
+};
+
+#endif // KODITHERMATRIX_H
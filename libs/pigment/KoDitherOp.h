@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KODITHEROP_H
+#define KODITHEROP_H
+
+#include <QtGlobal>
+
+/**
+ * Reduces the bit depth of the pixels applying a dithering matrix
+ * (see KoDitherMatrix). The source and the destination have the same
+ * color model and profile, only the channel type differs, e.g. RGBA U16
+ * is converted into RGBA U8.
+ *
+ * The color channels are dithered, the alpha channel is just rounded.
+ *
+ * Use KoOptimizedDitherOpFactory to create an op for a pair of channel
+ * types.
+ */
+class KoDitherOp
+{
+public:
+    virtual ~KoDitherOp() { }
+
+    /**
+     * Converts \p columns pixels of a row of the image from \p src into
+     * \p dst. \p x and \p y are the coordinates of the first pixel in
+     * the image, they define the position in the dithering matrix.
+     */
+    virtual void dither(const quint8 *src, quint8 *dst, int columns, int x, int y) const = 0;
+};
+
+#endif // KODITHEROP_H
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KODITHEROPIMPL_H
+#define KODITHEROPIMPL_H
+
+#include <cmath>
+
+#include "KoDitherOp.h"
+#include "KoDitherMatrix.h"
+#include "KoColorSpaceMaths.h"
+
+/**
+ * Converts a channel value, scaled into the range of the destination
+ * channel type, adding the dithering threshold before truncation.
+ */
+template<typename dst_channels_type>
+inline dst_channels_type koDitherChannel(float value, float threshold)
+{
+    const float maxValue = KoColorSpaceMathsTraits<dst_channels_type>::unitValue;
+    return dst_channels_type(qBound(0.0f, std::floor(value + threshold), maxValue));
+}
+
+/**
+ * The generic (scalar) version of KoDitherOp.
+ *
+ * \p swapRedBlue should be set when the source and the destination
+ * store the red and blue channels in different order, e.g. for RGBA F32
+ * (RGBA order) into RGBA U8 (BGRA order).
+ */
+template<class _SrcCSTraits, class _DstCSTraits, bool swapRedBlue>
+class KoDitherOpImpl : public KoDitherOp
+{
+    typedef typename _SrcCSTraits::channels_type src_channels_type;
+    typedef typename _DstCSTraits::channels_type dst_channels_type;
+
+    static_assert(int(_SrcCSTraits::channels_nb) == int(_DstCSTraits::channels_nb) &&
+                  _SrcCSTraits::alpha_pos == _DstCSTraits::alpha_pos,
+                  "KoDitherOpImpl converts only between color spaces of the same layout");
+
+    static_assert(!swapRedBlue || _SrcCSTraits::channels_nb >= 3,
+                  "only RGB color spaces can swap the red and blue channels");
+
+public:
+    KoDitherOpImpl(const KoDitherMatrix *matrix)
+        : m_matrix(matrix)
+    {
+    }
+
+    void dither(const quint8 *srcU8, quint8 *dstU8, int columns, int x, int y) const override {
+        const src_channels_type *src = _SrcCSTraits::nativeArray(srcU8);
+        dst_channels_type *dst = _DstCSTraits::nativeArray(dstU8);
+
+        const float *thresholds = m_matrix->row(y);
+        const int mask = KoDitherMatrix::size() - 1;
+
+        const float scale =
+            float(KoColorSpaceMathsTraits<dst_channels_type>::unitValue) /
+            float(KoColorSpaceMathsTraits<src_channels_type>::unitValue);
+
+        for (int i = 0; i < columns; i++) {
+            const float threshold = thresholds[(x + i) & mask];
+
+            for (int channel = 0; channel < int(_DstCSTraits::channels_nb); channel++) {
+                const int srcChannel =
+                    swapRedBlue && (channel == 0 || channel == 2) ? 2 - channel : channel;
+
+                const float value = float(src[srcChannel]) * scale;
+
+                dst[channel] = channel == _DstCSTraits::alpha_pos ?
+                    koDitherChannel<dst_channels_type>(value, 0.5f) :
+                    koDitherChannel<dst_channels_type>(value, threshold);
+            }
+
+            src += _SrcCSTraits::channels_nb;
+            dst += _DstCSTraits::channels_nb;
+        }
+    }
+
+private:
+    const KoDitherMatrix *m_matrix;
+};
+
+#endif // KODITHEROPIMPL_H
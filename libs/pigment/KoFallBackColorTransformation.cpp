@@ -24,6 +24,7 @@
 #include "KoColorTransformation.h"
 #include "KoColorConversionCache.h"
 #include "KoColorSpaceRegistry.h"
+#include "KoScratchBuffer.h"
 
 #include "DebugPigment.h"
 
@@ -34,8 +35,6 @@ struct Q_DECL_HIDDEN KoFallBackColorTransformation::Private {
     const KoColorConversionTransformation* csToFallBack;
     const KoColorConversionTransformation* fallBackToCs;
     KoColorTransformation* colorTransformation;
-    mutable quint8* buff;
-    mutable qint32 buffSize;
 };
 
 KoFallBackColorTransformation::KoFallBackColorTransformation(const KoColorSpace* _cs, const KoColorSpace* _fallBackCS, KoColorTransformation* _transfo) : d(new Private)
@@ -46,8 +45,6 @@ KoFallBackColorTransformation::KoFallBackColorTransformation(const KoColorSpace*
     d->fallBackToCsCache = new KoCachedColorConversionTransformation(KoColorSpaceRegistry::instance()->colorConversionCache()->cachedConverter(_fallBackCS, _cs, KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags()));
     d->fallBackToCs = d->fallBackToCsCache->transformation();
     d->colorTransformation = _transfo;
-    d->buff = 0;
-    d->buffSize = 0;
 }
 
 KoFallBackColorTransformation::KoFallBackColorTransformation(KoColorConversionTransformation* _csToFallBack, KoColorConversionTransformation* _fallBackToCs, KoColorTransformation* _transfo) : d(new Private)
@@ -60,8 +57,6 @@ KoFallBackColorTransformation::KoFallBackColorTransformation(KoColorConversionTr
     d->csToFallBackCache = 0;
     d->fallBackToCsCache = 0;
     d->colorTransformation = _transfo;
-    d->buff = 0;
-    d->buffSize = 0;
 }
 
 KoFallBackColorTransformation::~KoFallBackColorTransformation()
@@ -77,20 +72,16 @@ KoFallBackColorTransformation::~KoFallBackColorTransformation()
         delete d->fallBackToCs;
     }
     delete d->colorTransformation;
-    delete[] d->buff;
     delete d;
 }
 
 void KoFallBackColorTransformation::transform(const quint8 *src, quint8 *dst, qint32 nPixels) const
 {
-    if (d->buffSize < nPixels) { // Expand the buffer if needed
-        d->buffSize = nPixels;
-        delete[] d->buff;
-        d->buff = new quint8[ d->buffSize * d->fallBackColorSpace->pixelSize()];
-    }
-    d->csToFallBack->transform(src, d->buff, nPixels);
-    d->colorTransformation->transform(d->buff, d->buff, nPixels);
-    d->fallBackToCs->transform(d->buff, dst, nPixels);
+    KoScratchBuffer buff(nPixels * d->fallBackColorSpace->pixelSize());
+
+    d->csToFallBack->transform(src, buff.data(), nPixels);
+    d->colorTransformation->transform(buff.data(), buff.data(), nPixels);
+    d->fallBackToCs->transform(buff.data(), dst, nPixels);
 }
 
 QList<QString> KoFallBackColorTransformation::parameters() const
@@ -70,6 +70,25 @@ public:
      */
     virtual void addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace* colorSpace) = 0;
 
+    /**
+     * Creates a producer with the same view and settings, but with empty
+     * bins. It is used for accumulating a big region in several threads,
+     * each of them adding the pixels to its own copy.
+     *
+     * @return null if the producer cannot be copied
+     */
+    virtual KoHistogramProducer *createEmptyCopy() const {
+        return 0;
+    }
+
+    /**
+     * Adds the bins of \p other, which must have been created with
+     * createEmptyCopy() of this producer, to the bins of this producer
+     */
+    virtual void addBinsFrom(KoHistogramProducer *other) {
+        Q_UNUSED(other);
+    }
+
     // Methods to set what exactly is being added to the bins
     virtual void setView(qreal from, qreal width) = 0;
     virtual void setSkipTransparent(bool set) {
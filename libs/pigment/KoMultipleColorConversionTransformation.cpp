@@ -20,8 +20,10 @@
 #include "KoMultipleColorConversionTransformation.h"
 
 #include <QList>
+#include <QRect>
 
 #include <KoColorSpace.h>
+#include "KoScratchBuffer.h"
 
 struct Q_DECL_HIDDEN KoMultipleColorConversionTransformation::Private {
     QList<KoColorConversionTransformation*> transfos;
@@ -48,14 +50,15 @@ void KoMultipleColorConversionTransformation::appendTransfo(KoColorConversionTra
     d->maxPixelSize = qMax(d->maxPixelSize, transfo->srcColorSpace()->pixelSize());
     d->maxPixelSize = qMax(d->maxPixelSize, transfo->dstColorSpace()->pixelSize());
 }
-void KoMultipleColorConversionTransformation::transform(const quint8 *src, quint8 *dst, qint32 nPixels) const
+template <class LastStepFunction>
+void KoMultipleColorConversionTransformation::transformImpl(const quint8 *src, quint8 *dst, qint32 nPixels, LastStepFunction lastStep) const
 {
     Q_ASSERT(d->transfos.size() > 1); // Be sure to have a more than one transformation
-    quint8 *buff1 = new quint8[d->maxPixelSize*nPixels];
-    quint8 *buff2 = 0;
-    if (d->transfos.size() > 2) {
-        buff2 = new quint8[d->maxPixelSize*nPixels]; // a second buffer is needed
-    }
+    KoScratchBuffer scratch1(d->maxPixelSize * nPixels);
+    KoScratchBuffer scratch2(d->transfos.size() > 2 ? d->maxPixelSize * nPixels : 0); // a second buffer is needed
+
+    quint8 *buff1 = scratch1.data();
+    quint8 *buff2 = scratch2.data();
     d->transfos.first()->transform(src, buff1, nPixels);
     int lastIndex = d->transfos.size() - 2;
     for (int i = 1; i <= lastIndex; i++) {
@@ -64,7 +67,23 @@ void KoMultipleColorConversionTransformation::transform(const quint8 *src, quint
         buff1 = buff2;
         buff2 = tmp;
     }
-    d->transfos.last()->transform(buff1, dst, nPixels);
-    delete [] buff2;
-    delete [] buff1;
+    lastStep(d->transfos.last(), buff1, dst);
+}
+
+void KoMultipleColorConversionTransformation::transform(const quint8 *src, quint8 *dst, qint32 nPixels) const
+{
+    transformImpl(src, dst, nPixels,
+                  [nPixels] (const KoColorConversionTransformation *transfo, const quint8 *from, quint8 *to) {
+                      transfo->transform(from, to, nPixels);
+                  });
+}
+
+void KoMultipleColorConversionTransformation::transformRect(const quint8 *src, quint8 *dst, const QRect &rect) const
+{
+    // only the last step can reduce the bit depth of the final result,
+    // so it is the only one that needs to know the position of the pixels
+    transformImpl(src, dst, rect.width() * rect.height(),
+                  [&rect] (const KoColorConversionTransformation *transfo, const quint8 *from, quint8 *to) {
+                      transfo->transformRect(from, to, rect);
+                  });
 }
@@ -50,6 +50,10 @@ public:
      */
     void appendTransfo(KoColorConversionTransformation* transfo);
     void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const override;
+    void transformRect(const quint8 *src, quint8 *dst, const QRect &rect) const override;
+private:
+    template <class LastStepFunction>
+    void transformImpl(const quint8 *src, quint8 *dst, qint32 nPixels, LastStepFunction lastStep) const;
 private:
     struct Private;
     Private* const d;
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDPIXELOPSSELECTOR_H
+#define KOOPTIMIZEDPIXELOPSSELECTOR_H
+
+#include "KoColorSpaceTraits.h"
+#include "KoMixColorsOpImpl.h"
+#include "KoConvolutionOpImpl.h"
+#include "compositeops/KoOptimizedPixelOpsFactory.h"
+
+/**
+ * Selects the implementation of KoMixColorsOp and KoConvolutionOp
+ * for a color space: RGBA U8, U16 and F32 get vectorized versions,
+ * all the other color spaces use the generic scalar ones.
+ */
+template<class Traits>
+struct KoOptimizedPixelOpsSelector
+{
+    static KoMixColorsOp* createMixColorsOp() {
+        return new KoMixColorsOpImpl<Traits>();
+    }
+
+    static KoConvolutionOp* createConvolutionOp() {
+        return new KoConvolutionOpImpl<Traits>();
+    }
+};
+
+template<>
+struct KoOptimizedPixelOpsSelector<KoBgrU8Traits>
+{
+    static KoMixColorsOp* createMixColorsOp() {
+        return KoOptimizedPixelOpsFactory::createMixColorsOpU8();
+    }
+
+    static KoConvolutionOp* createConvolutionOp() {
+        return KoOptimizedPixelOpsFactory::createConvolutionOpU8();
+    }
+};
+
+template<>
+struct KoOptimizedPixelOpsSelector<KoBgrU16Traits>
+{
+    static KoMixColorsOp* createMixColorsOp() {
+        return KoOptimizedPixelOpsFactory::createMixColorsOpU16();
+    }
+
+    static KoConvolutionOp* createConvolutionOp() {
+        return KoOptimizedPixelOpsFactory::createConvolutionOpU16();
+    }
+};
+
+template<>
+struct KoOptimizedPixelOpsSelector<KoRgbF32Traits>
+{
+    static KoMixColorsOp* createMixColorsOp() {
+        return KoOptimizedPixelOpsFactory::createMixColorsOpF32();
+    }
+
+    static KoConvolutionOp* createConvolutionOp() {
+        return KoOptimizedPixelOpsFactory::createConvolutionOpF32();
+    }
+};
+
+#endif /* KOOPTIMIZEDPIXELOPSSELECTOR_H */
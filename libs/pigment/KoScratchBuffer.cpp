@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoScratchBuffer.h"
+
+#include <atomic>
+#include <vector>
+
+namespace {
+
+std::atomic<qint64> s_poolGrowthCount(0);
+
+struct Block {
+    quint8 *data = nullptr;
+    size_t capacity = 0;
+};
+
+/**
+ * The blocks of one thread, one block per nesting level. A block only
+ * grows, so after a few conversions it fits all the requests of its
+ * level. The blocks bigger than KoScratchBuffer::maxRetainedSize are
+ * freed on release.
+ */
+struct ThreadPool {
+    static const int initialNumLevels = 8;
+    static const size_t alignment = 64;
+    static const size_t granularity = 4096;
+
+    std::vector<Block> blocks;
+    int depth = 0;
+
+    ThreadPool() {
+        blocks.reserve(initialNumLevels);
+        s_poolGrowthCount++;
+    }
+
+    ~ThreadPool() {
+        for (const Block &block : blocks) {
+            qFreeAligned(block.data);
+        }
+    }
+
+    static ThreadPool& local() {
+        static thread_local ThreadPool pool;
+        return pool;
+    }
+
+    quint8* acquire(size_t size) {
+        if (depth == int(blocks.size())) {
+            if (blocks.size() == blocks.capacity()) {
+                s_poolGrowthCount++;
+            }
+            blocks.emplace_back();
+        }
+
+        Block &block = blocks[depth++];
+
+        if (block.capacity < size) {
+            // grow geometrically to avoid a series of reallocations
+            // when the requested size grows slowly, but don't let the
+            // growth alone push the block over the retained limit
+            const size_t capacity = qMax(size, qMin(2 * block.capacity, KoScratchBuffer::maxRetainedSize));
+
+            qFreeAligned(block.data);
+            block.capacity = (capacity + granularity - 1) / granularity * granularity;
+            block.data = static_cast<quint8*>(qMallocAligned(block.capacity, alignment));
+            Q_CHECK_PTR(block.data);
+
+            s_poolGrowthCount++;
+        }
+
+        return block.data;
+    }
+
+    void release() {
+        Q_ASSERT(depth > 0);
+        depth--;
+
+        Block &block = blocks[depth];
+
+        if (block.capacity > KoScratchBuffer::maxRetainedSize) {
+            qFreeAligned(block.data);
+            block = Block();
+        }
+    }
+};
+
+}
+
+KoScratchBuffer::KoScratchBuffer(size_t size)
+    : m_data(ThreadPool::local().acquire(size))
+{
+}
+
+KoScratchBuffer::~KoScratchBuffer()
+{
+    ThreadPool::local().release();
+}
+
+qint64 KoScratchBuffer::poolGrowthCount()
+{
+    return s_poolGrowthCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOSCRATCHBUFFER_H
+#define KOSCRATCHBUFFER_H
+
+#include <QtGlobal>
+
+#include "kritapigment_export.h"
+
+/**
+ * A temporary buffer for the color conversion and composition helpers.
+ *
+ * The memory is taken from a pool owned by the current thread and is
+ * returned there by the destructor, so in a steady state creating a
+ * buffer does not call the system allocator at all. The pool keeps a
+ * growable block per nesting level, so the buffers can be nested (e.g.
+ * a multi-step conversion called from KoColorSpace::bitBlt()), but they
+ * must be destroyed in the reverse order of creation. It is guaranteed
+ * when they are created on the stack, which is the only supported way
+ * of using them.
+ *
+ * The buffers are aligned to 64 bytes, their content is undefined. The
+ * pool keeps the blocks till the thread exits, except the blocks bigger
+ * than maxRetainedSize, which are freed when the buffer is destroyed, so
+ * a single huge request doesn't pin the memory for the life of the thread.
+ */
+class KRITAPIGMENT_EXPORT KoScratchBuffer
+{
+public:
+    static const size_t maxRetainedSize = 4 * 1024 * 1024;
+
+public:
+    explicit KoScratchBuffer(size_t size);
+    ~KoScratchBuffer();
+
+    inline quint8* data() const {
+        return m_data;
+    }
+
+    template<typename T>
+    inline T* dataAs() const {
+        return reinterpret_cast<T*>(m_data);
+    }
+
+    /**
+     * Returns the number of times the pools of all the threads have
+     * grown, i.e. requested memory from the system allocator. Only the
+     * memory of the pools is counted, the allocations done by the code
+     * using the buffers are not visible here.
+     */
+    static qint64 poolGrowthCount();
+
+private:
+    Q_DISABLE_COPY(KoScratchBuffer)
+
+    quint8 *m_data;
+};
+
+#endif // KOSCRATCHBUFFER_H
@@ -19,11 +19,180 @@
 #include "KoColorSpacesBenchmark.h"
 
 #include <QTest>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QRect>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
+#include <KoColorConversionTransformation.h>
+#include <KoColorConversionLut.h>
+#include <KoColorModelStandardIds.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <new>
 
 #define NB_PIXELS 1000000
 
+#ifdef __GLIBC__
+
+/**
+ * Counts the heap allocations of the measured thread, including the
+ * ones made by lcms, Qt containers and operator new. The allocator
+ * functions of the benchmark executable take precedence over the ones
+ * of libc in all the loaded libraries, and they forward the calls to
+ * glibc. The allocations of the other threads (e.g. the ones started
+ * by Qt or the test harness) are not counted.
+ */
+#define HAVE_ALLOCATION_COUNTER
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void *ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+std::atomic<qint64> s_numAllocations(0);
+thread_local bool s_countAllocations = false;
+
+inline void countAllocation()
+{
+    if (s_countAllocations) {
+        s_numAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Counts the allocations of the current thread while the object exists
+ */
+struct AllocationCounter
+{
+    AllocationCounter() : m_start(s_numAllocations.load()) {
+        s_countAllocations = true;
+    }
+
+    ~AllocationCounter() {
+        s_countAllocations = false;
+    }
+
+    qint64 numAllocations() const {
+        return s_numAllocations.load() - m_start;
+    }
+
+private:
+    qint64 m_start;
+};
+
+}
+
+extern "C" void* malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void *ptr, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (!alignment || (alignment & (alignment - 1)) || alignment % sizeof(void*)) {
+        return EINVAL;
+    }
+
+    countAllocation();
+    void *ptr = __libc_memalign(alignment, size);
+    if (!ptr) return ENOMEM;
+
+    *memptr = ptr;
+    return 0;
+}
+
+/**
+ * libstdc++ implements operator new on top of malloc(), but other
+ * runtimes may not, so the operators are replaced explicitly. The
+ * memory is released by the default operator delete with free().
+ */
+void* operator new(size_t size)
+{
+    countAllocation();
+    void *ptr = __libc_malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    countAllocation();
+    return __libc_malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+#ifdef __cpp_aligned_new
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    countAllocation();
+    void *ptr = __libc_memalign(static_cast<size_t>(alignment), size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    countAllocation();
+    return __libc_memalign(static_cast<size_t>(alignment), size ? size : 1);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return operator new(size, alignment, std::nothrow);
+}
+
+#endif /* __cpp_aligned_new */
+
+#endif /* __GLIBC__ */
+
 void KoColorSpacesBenchmark::createRowsColumns()
 {
     QTest::addColumn<QString>("modelID");
@@ -146,4 +315,418 @@ void KoColorSpacesBenchmark::benchmarkSetAlpha2IndividualCall()
     END_BENCHMARK
 }
 
+namespace {
+
+/**
+ * Converts every \p step'th chunk of the source starting from
+ * \p first. Every chunk is converted separately to make the
+ * conversion cache be accessed as often as it is accessed in
+ * a tiled image.
+ */
+struct ConversionJob : public QRunnable
+{
+    ConversionJob(const KoColorSpace *_srcCs, const KoColorSpace *_dstCs,
+                  const quint8 *_src, quint8 *_dst,
+                  int _first, int _step, int _numChunks, int _chunkSize)
+        : srcCs(_srcCs), dstCs(_dstCs),
+          src(_src), dst(_dst),
+          first(_first), step(_step), numChunks(_numChunks), chunkSize(_chunkSize)
+    {
+    }
+
+    void run() override {
+        const int srcPixelSize = srcCs->pixelSize();
+        const int dstPixelSize = dstCs->pixelSize();
+
+        for (int i = first; i < numChunks; i += step) {
+            srcCs->convertPixelsTo(src + i * chunkSize * srcPixelSize,
+                                   dst + i * chunkSize * dstPixelSize,
+                                   dstCs, chunkSize,
+                                   KoColorConversionTransformation::internalRenderingIntent(),
+                                   KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+
+    const KoColorSpace *srcCs;
+    const KoColorSpace *dstCs;
+    const quint8 *src;
+    quint8 *dst;
+    int first;
+    int step;
+    int numChunks;
+    int chunkSize;
+};
+
+}
+
+void KoColorSpacesBenchmark::benchmarkConversionThreads_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    const int maxThreads = qMax(1, QThread::idealThreadCount());
+
+    for (int i = 1; i < maxThreads; i *= 2) {
+        QTest::newRow(QString("%1 threads").arg(i).toLatin1()) << i;
+    }
+    QTest::newRow(QString("%1 threads").arg(maxThreads).toLatin1()) << maxThreads;
+}
+
+void KoColorSpacesBenchmark::benchmarkConversionThreads()
+{
+    QFETCH(int, numThreads);
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->rgb16();
+
+    const int chunkSize = 64 * 64; // a tile
+    const int numChunks = 4 * NB_PIXELS / chunkSize;
+
+    QVector<quint8> src(numChunks * chunkSize * srcCs->pixelSize());
+    QVector<quint8> dst(numChunks * chunkSize * dstCs->pixelSize());
+
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = i & 0xFF;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QBENCHMARK {
+        for (int i = 0; i < numThreads; i++) {
+            pool.start(new ConversionJob(srcCs, dstCs,
+                                         src.constData(), dst.data(),
+                                         i, numThreads, numChunks, chunkSize));
+        }
+        pool.waitForDone();
+    }
+}
+
+void KoColorSpacesBenchmark::createLutRowsColumns()
+{
+    QTest::addColumn<QString>("srcModelID");
+    QTest::addColumn<QString>("srcDepthID");
+    QTest::addColumn<QString>("dstModelID");
+    QTest::addColumn<QString>("dstDepthID");
+    QTest::addColumn<int>("gridSize");
+
+    struct Pair {
+        const char *name;
+        KoID srcModel;
+        KoID srcDepth;
+        KoID dstModel;
+        KoID dstDepth;
+    };
+
+    const Pair pairs[] = {
+        {"rgb8-cmyk16", RGBAColorModelID, Integer8BitsColorDepthID, CMYKAColorModelID, Integer16BitsColorDepthID},
+        {"rgb16-cmyk16", RGBAColorModelID, Integer16BitsColorDepthID, CMYKAColorModelID, Integer16BitsColorDepthID},
+        {"rgb16-cmykf32", RGBAColorModelID, Integer16BitsColorDepthID, CMYKAColorModelID, Float32BitsColorDepthID},
+        {"rgb8-lab16", RGBAColorModelID, Integer8BitsColorDepthID, LABAColorModelID, Integer16BitsColorDepthID},
+        {"lab16-rgb8", LABAColorModelID, Integer16BitsColorDepthID, RGBAColorModelID, Integer8BitsColorDepthID}
+    };
+
+    // grid size 0 means the exact conversion
+    const int gridSizes[] = {0, 17, 33, 65};
+
+    for (const Pair &pair : pairs) {
+        for (int gridSize : gridSizes) {
+            const QString name = gridSize ?
+                QString("%1, lut %2").arg(pair.name).arg(gridSize) :
+                QString("%1, exact").arg(pair.name);
+
+            QTest::newRow(name.toLatin1())
+                << pair.srcModel.id() << pair.srcDepth.id()
+                << pair.dstModel.id() << pair.dstDepth.id()
+                << gridSize;
+        }
+    }
+}
+
+#define START_LUT_BENCHMARK \
+    QFETCH(QString, srcModelID); \
+    QFETCH(QString, srcDepthID); \
+    QFETCH(QString, dstModelID); \
+    QFETCH(QString, dstDepthID); \
+    QFETCH(int, gridSize); \
+    \
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->colorSpace(srcModelID, srcDepthID, 0); \
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->colorSpace(dstModelID, dstDepthID, 0); \
+    QVERIFY(srcCs); \
+    QVERIFY(dstCs); \
+    \
+    if (!KoColorConversionLut::isSupported(srcCs, dstCs)) { \
+        QSKIP("The color space pair cannot be converted with a LUT"); \
+    } \
+    \
+    QScopedPointer<KoColorConversionTransformation> exact( \
+        srcCs->createColorConverter(dstCs, \
+                                    KoColorConversionTransformation::internalRenderingIntent(), \
+                                    KoColorConversionTransformation::internalConversionFlags())); \
+    QScopedPointer<KoColorConversionLut> lut( \
+        gridSize ? new KoColorConversionLut(exact.data(), gridSize) : 0); \
+    \
+    QVector<quint8> src(NB_PIXELS * srcCs->pixelSize()); \
+    QVector<quint8> dst(NB_PIXELS * dstCs->pixelSize()); \
+    quint32 seed = 1; \
+    for (int i = 0; i < src.size(); i++) { \
+        seed = seed * 1103515245 + 12345; \
+        src[i] = seed >> 24; \
+    }
+
+void KoColorSpacesBenchmark::benchmarkLutConversion_data()
+{
+    createLutRowsColumns();
+}
+
+void KoColorSpacesBenchmark::benchmarkLutConversion()
+{
+    START_LUT_BENCHMARK
+
+    QBENCHMARK {
+        if (lut) {
+            lut->transform(src.constData(), dst.data(), NB_PIXELS);
+        } else {
+            exact->transform(src.constData(), dst.data(), NB_PIXELS);
+        }
+    }
+}
+
+void KoColorSpacesBenchmark::benchmarkLutConversionAccuracy_data()
+{
+    createLutRowsColumns();
+}
+
+/**
+ * Reports the error of the LUT conversion against the exact one. The
+ * results of both conversions are converted into Lab and compared with
+ * the CIE76 formula. The report is written into the debug output, the
+ * benchmark itself measures conversion into the destination and into Lab.
+ */
+void KoColorSpacesBenchmark::benchmarkLutConversionAccuracy()
+{
+    START_LUT_BENCHMARK
+
+    if (!lut) {
+        QSKIP("The exact conversion has no error");
+    }
+
+    QVector<quint8> exactDst(dst.size());
+    exact->transform(src.constData(), exactDst.data(), NB_PIXELS);
+
+    QVector<quint16> exactLab(NB_PIXELS * 4);
+    QVector<quint16> lutLab(NB_PIXELS * 4);
+
+    QBENCHMARK_ONCE {
+        lut->transform(src.constData(), dst.data(), NB_PIXELS);
+    }
+
+    // alpha is not handled by the LUT, so copy it from the exact result
+    for (int i = 0; i < NB_PIXELS; i++) {
+        const int offset = i * dstCs->pixelSize();
+        dstCs->setOpacity(dst.data() + offset, dstCs->opacityU8(exactDst.constData() + offset), 1);
+    }
+
+    dstCs->toLabA16(exactDst.constData(), reinterpret_cast<quint8*>(exactLab.data()), NB_PIXELS);
+    dstCs->toLabA16(dst.constData(), reinterpret_cast<quint8*>(lutLab.data()), NB_PIXELS);
+
+    qreal maxDeltaE = 0.0;
+    qreal sumDeltaE = 0.0;
+
+    for (int i = 0; i < NB_PIXELS; i++) {
+        const quint16 *p1 = exactLab.constData() + 4 * i;
+        const quint16 *p2 = lutLab.constData() + 4 * i;
+
+        const qreal dL = (qreal(p1[0]) - p2[0]) * 100.0 / 65535.0;
+        const qreal da = (qreal(p1[1]) - p2[1]) / 257.0;
+        const qreal db = (qreal(p1[2]) - p2[2]) / 257.0;
+
+        const qreal deltaE = std::sqrt(dL * dL + da * da + db * db);
+
+        maxDeltaE = qMax(maxDeltaE, deltaE);
+        sumDeltaE += deltaE;
+    }
+
+    qDebug() << "LUT accuracy:" << QTest::currentDataTag()
+             << "max deltaE" << maxDeltaE
+             << "mean deltaE" << sumDeltaE / NB_PIXELS;
+}
+
+void KoColorSpacesBenchmark::benchmarkDitheredConversion_data()
+{
+    QTest::addColumn<QString>("modelID");
+    QTest::addColumn<QString>("depthID");
+    QTest::addColumn<int>("ditherFlag");
+
+    const KoID models[] = {RGBAColorModelID, GrayAColorModelID};
+    const KoID depths[] = {Integer16BitsColorDepthID, Float32BitsColorDepthID};
+
+    for (const KoID &model : models) {
+        for (const KoID &depth : depths) {
+            const QString name = QString("%1%2").arg(model.id()).arg(depth.id());
+
+            QTest::newRow(QString("%1, exact").arg(name).toLatin1())
+                << model.id() << depth.id() << 0;
+            QTest::newRow(QString("%1, ordered").arg(name).toLatin1())
+                << model.id() << depth.id() << int(KoColorConversionTransformation::OrderedDithering);
+            QTest::newRow(QString("%1, blue noise").arg(name).toLatin1())
+                << model.id() << depth.id() << int(KoColorConversionTransformation::BlueNoiseDithering);
+        }
+    }
+}
+
+/**
+ * Converts a smooth gradient of a high bit depth color space into
+ * 8 bits. The "exact" rows measure the conversion without dithering.
+ */
+void KoColorSpacesBenchmark::benchmarkDitheredConversion()
+{
+    QFETCH(QString, modelID);
+    QFETCH(QString, depthID);
+    QFETCH(int, ditherFlag);
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->colorSpace(modelID, depthID, 0);
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->colorSpace(modelID, Integer8BitsColorDepthID.id(), 0);
+    QVERIFY(srcCs);
+    QVERIFY(dstCs);
+
+    const QRect rect(0, 0, 1000, NB_PIXELS / 1000);
+
+    QVector<quint8> src(NB_PIXELS * srcCs->pixelSize());
+    QVector<quint8> dst(NB_PIXELS * dstCs->pixelSize());
+
+    QVector<float> channels(srcCs->channelCount(), 1.0f);
+    for (int i = 0; i < NB_PIXELS; i++) {
+        for (int channel = 0; channel < int(srcCs->colorChannelCount()); channel++) {
+            channels[channel] = float(i % rect.width() + channel * 100) / (rect.width() + 300);
+        }
+        srcCs->fromNormalisedChannelsValue(src.data() + i * srcCs->pixelSize(), channels);
+    }
+
+    const KoColorConversionTransformation::ConversionFlags flags =
+        KoColorConversionTransformation::internalConversionFlags() |
+        KoColorConversionTransformation::ConversionFlags(ditherFlag);
+
+    QBENCHMARK {
+        srcCs->convertPixelsTo(src.constData(), dst.data(), dstCs, rect,
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               flags);
+    }
+}
+
+void KoColorSpacesBenchmark::benchmarkConversionAllocations_data()
+{
+    QTest::addColumn<QString>("srcModelID");
+    QTest::addColumn<QString>("srcDepthID");
+    QTest::addColumn<QString>("dstModelID");
+    QTest::addColumn<QString>("dstDepthID");
+    QTest::addColumn<bool>("useBitBlt");
+
+    struct Pair {
+        const char *name;
+        KoID srcModel;
+        KoID srcDepth;
+        KoID dstModel;
+        KoID dstDepth;
+    };
+
+    const Pair pairs[] = {
+        {"rgb8-rgb16", RGBAColorModelID, Integer8BitsColorDepthID, RGBAColorModelID, Integer16BitsColorDepthID},
+        {"rgb8-lab16", RGBAColorModelID, Integer8BitsColorDepthID, LABAColorModelID, Integer16BitsColorDepthID},
+        {"rgb16-cmyk8", RGBAColorModelID, Integer16BitsColorDepthID, CMYKAColorModelID, Integer8BitsColorDepthID},
+        {"gray8-rgbf32", GrayAColorModelID, Integer8BitsColorDepthID, RGBAColorModelID, Float32BitsColorDepthID},
+        {"alpha8-lab16", AlphaColorModelID, Integer8BitsColorDepthID, LABAColorModelID, Integer16BitsColorDepthID}
+    };
+
+    for (const Pair &pair : pairs) {
+        QTest::newRow(QString("%1, convert").arg(pair.name).toLatin1())
+            << pair.srcModel.id() << pair.srcDepth.id()
+            << pair.dstModel.id() << pair.dstDepth.id()
+            << false;
+        QTest::newRow(QString("%1, bitBlt").arg(pair.name).toLatin1())
+            << pair.srcModel.id() << pair.srcDepth.id()
+            << pair.dstModel.id() << pair.dstDepth.id()
+            << true;
+    }
+}
+
+/**
+ * Converts (or composites) the image tile by tile and checks that the
+ * conversion does not allocate any memory once the conversion cache
+ * and the scratch buffers are warmed up. The conversion is done in a
+ * single thread, so that no new thread (with empty pools) appears
+ * during the measurement. The allocations are counted outside of
+ * QBENCHMARK, since the benchmark harness allocates memory itself.
+ */
+void KoColorSpacesBenchmark::benchmarkConversionAllocations()
+{
+    QFETCH(QString, srcModelID);
+    QFETCH(QString, srcDepthID);
+    QFETCH(QString, dstModelID);
+    QFETCH(QString, dstDepthID);
+    QFETCH(bool, useBitBlt);
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->colorSpace(srcModelID, srcDepthID, 0);
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->colorSpace(dstModelID, dstDepthID, 0);
+
+    if (!srcCs || !dstCs) {
+        QSKIP("The color space is not available");
+    }
+
+    const int tileSize = 64;
+    const int numTiles = NB_PIXELS / (tileSize * tileSize);
+
+    QVector<quint8> src(tileSize * tileSize * srcCs->pixelSize());
+    QVector<quint8> dst(tileSize * tileSize * dstCs->pixelSize());
+
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = i & 0xFF;
+    }
+
+    const KoCompositeOp *op = dstCs->compositeOp(COMPOSITE_OVER);
+
+    KoCompositeOp::ParameterInfo params;
+    params.dstRowStart = dst.data();
+    params.dstRowStride = tileSize * dstCs->pixelSize();
+    params.srcRowStart = src.constData();
+    params.srcRowStride = tileSize * srcCs->pixelSize();
+    params.rows = tileSize;
+    params.cols = tileSize;
+
+    auto processTiles = [&] () {
+        for (int i = 0; i < numTiles; i++) {
+            if (useBitBlt) {
+                dstCs->bitBlt(srcCs, params, op,
+                              KoColorConversionTransformation::internalRenderingIntent(),
+                              KoColorConversionTransformation::internalConversionFlags());
+            } else {
+                srcCs->convertPixelsTo(src.constData(), dst.data(), dstCs, tileSize * tileSize,
+                                       KoColorConversionTransformation::internalRenderingIntent(),
+                                       KoColorConversionTransformation::internalConversionFlags());
+            }
+        }
+    };
+
+    // warm up the conversion cache and the scratch buffers
+    processTiles();
+
+#ifdef HAVE_ALLOCATION_COUNTER
+    qint64 numAllocations = 0;
+    {
+        AllocationCounter counter;
+        processTiles();
+        numAllocations = counter.numAllocations();
+    }
+#endif
+
+    QBENCHMARK {
+        processTiles();
+    }
+
+#ifdef HAVE_ALLOCATION_COUNTER
+    QCOMPARE(numAllocations, qint64(0));
+#else
+    QSKIP("The allocations can be counted on glibc only");
+#endif
+}
+
 QTEST_MAIN(KoColorSpacesBenchmark)
@@ -26,6 +26,7 @@ class KoColorSpacesBenchmark : public QObject
     Q_OBJECT
 private:
     void createRowsColumns();
+    void createLutRowsColumns();
 private Q_SLOTS:
     void benchmarkAlpha_data();
     void benchmarkAlpha();
@@ -39,6 +40,16 @@ private Q_SLOTS:
     void benchmarkSetAlphaIndividualCall();
     void benchmarkSetAlpha2IndividualCall_data();
     void benchmarkSetAlpha2IndividualCall();
+    void benchmarkConversionThreads_data();
+    void benchmarkConversionThreads();
+    void benchmarkLutConversion_data();
+    void benchmarkLutConversion();
+    void benchmarkLutConversionAccuracy_data();
+    void benchmarkLutConversionAccuracy();
+    void benchmarkDitheredConversion_data();
+    void benchmarkDitheredConversion();
+    void benchmarkConversionAllocations_data();
+    void benchmarkConversionAllocations();
 };
 
 #endif
@@ -20,10 +20,13 @@
 
 #include "../compositeops/KoCompositeOpAlphaDarken.h"
 #include "../compositeops/KoCompositeOpOver.h"
+#include "../compositeops/KoAlphaDarkenParamsWrapper.h"
 #include <KoOptimizedCompositeOpFactory.h>
 
 #include <KoColorSpaceTraits.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorSpace.h>
+#include <KoCompositeOp.h>
 
 #include <QTest>
 
@@ -39,11 +42,11 @@ const int TILES_IN_WIDTH = IMG_WIDTH / TILE_WIDTH;
 const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
 
 
-#define COMPOSITE_BENCHMARK \
+#define COMPOSITE_BENCHMARK_PIXEL_SIZE(pixelSize) \
         for (int y = 0; y < TILES_IN_HEIGHT; y++){                                              \
             for (int x = 0; x < TILES_IN_WIDTH; x++) {                                           \
-                const int rowStride = IMG_WIDTH * KoBgrU8Traits::pixelSize;  \
-                const int bufOffset = y * rowStride + x * TILE_WIDTH * KoBgrU8Traits::pixelSize;  \
+                const int rowStride = IMG_WIDTH * pixelSize;  \
+                const int bufOffset = y * rowStride + x * TILE_WIDTH * pixelSize;  \
                 compositeOp->composite(m_dstBuffer + bufOffset, rowStride,      \
                                       m_srcBuffer + bufOffset, rowStride,      \
                                       m_mskBuffer + bufOffset, rowStride,                                                            \
@@ -52,9 +55,12 @@ const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
             }                                                                                   \
         }
 
+#define COMPOSITE_BENCHMARK COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU8Traits::pixelSize)
+
 void KoCompositeOpsBenchmark::initTestCase()
 {
-    const int bufLen = IMG_HEIGHT * IMG_WIDTH * KoBgrU8Traits::pixelSize;
+    // big enough for 16-bit colorspaces as well
+    const int bufLen = IMG_HEIGHT * IMG_WIDTH * KoBgrU16Traits::pixelSize;
 
     m_dstBuffer = new quint8[bufLen];
     m_srcBuffer = new quint8[bufLen];
@@ -66,7 +72,7 @@ void KoCompositeOpsBenchmark::init()
 {
     qsrand(42);
 
-    for (int i = 0; i < int(IMG_WIDTH * IMG_HEIGHT * KoBgrU8Traits::pixelSize); i++) {
+    for (int i = 0; i < int(IMG_WIDTH * IMG_HEIGHT * KoBgrU16Traits::pixelSize); i++) {
         const int randVal = qrand();
 
         m_srcBuffer[i] = randVal & 0x0000FF;
@@ -108,5 +114,56 @@ void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenCreamy()
     }
 }
 
+void KoCompositeOpsBenchmark::benchmarkCompositeOverU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createOverOp64(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOverU16Legacy()
+{
+    KoCompositeOp *compositeOp = new KoCompositeOpOver<KoBgrU16Traits>(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenU16()
+{
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamy64(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenU16Legacy()
+{
+    KoCompositeOp *compositeOp = new KoCompositeOpAlphaDarken<KoBgrU16Traits, KoAlphaDarkenParamsWrapperCreamy>(KoColorSpaceRegistry::instance()->rgb16());
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL_SIZE(KoBgrU16Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAllModes_data()
+{
+    QTest::addColumn<QString>("compositeOpId");
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    Q_FOREACH (const KoCompositeOp *op, cs->compositeOps()) {
+        QTest::newRow(op->id().toLatin1()) << op->id();
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAllModes()
+{
+    QFETCH(QString, compositeOpId);
+
+    const KoCompositeOp *compositeOp = KoColorSpaceRegistry::instance()->rgb8()->compositeOp(compositeOpId);
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK
+    }
+}
 
 QTEST_GUILESS_MAIN(KoCompositeOpsBenchmark)
@@ -34,6 +34,14 @@ private Q_SLOTS:
     void benchmarkCompositeAlphaDarkenHard();
     void benchmarkCompositeAlphaDarkenCreamy();
 
+    void benchmarkCompositeOverU16();
+    void benchmarkCompositeOverU16Legacy();
+    void benchmarkCompositeAlphaDarkenU16();
+    void benchmarkCompositeAlphaDarkenU16Legacy();
+
+    void benchmarkCompositeAllModes_data();
+    void benchmarkCompositeAllModes();
+
 private:
     quint8 * m_dstBuffer;
     quint8 * m_srcBuffer;
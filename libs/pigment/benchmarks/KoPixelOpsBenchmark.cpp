@@ -0,0 +1,224 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoPixelOpsBenchmark.h"
+
+#include <QTest>
+#include <QScopedPointer>
+
+#include <KoColorSpaceTraits.h>
+#include <KoMixColorsOpImpl.h>
+#include <KoConvolutionOpImpl.h>
+#include <KoOptimizedPixelOpsFactory.h>
+
+// number of mixes/convolutions per benchmark iteration
+#define NUM_OPERATIONS 100000
+#define NUM_SOURCE_PIXELS 4096
+
+namespace {
+
+enum PixelType {
+    U8,
+    U16,
+    F32
+};
+
+int pixelSize(PixelType type)
+{
+    return type == U8 ? 4 : type == U16 ? 8 : 16;
+}
+
+KoMixColorsOp* createMixColorsOp(PixelType type, bool optimized)
+{
+    switch (type) {
+    case U8:
+        return optimized ? KoOptimizedPixelOpsFactory::createMixColorsOpU8() : new KoMixColorsOpImpl<KoBgrU8Traits>();
+    case U16:
+        return optimized ? KoOptimizedPixelOpsFactory::createMixColorsOpU16() : new KoMixColorsOpImpl<KoBgrU16Traits>();
+    default:
+        return optimized ? KoOptimizedPixelOpsFactory::createMixColorsOpF32() : new KoMixColorsOpImpl<KoRgbF32Traits>();
+    }
+}
+
+KoConvolutionOp* createConvolutionOp(PixelType type, bool optimized)
+{
+    switch (type) {
+    case U8:
+        return optimized ? KoOptimizedPixelOpsFactory::createConvolutionOpU8() : new KoConvolutionOpImpl<KoBgrU8Traits>();
+    case U16:
+        return optimized ? KoOptimizedPixelOpsFactory::createConvolutionOpU16() : new KoConvolutionOpImpl<KoBgrU16Traits>();
+    default:
+        return optimized ? KoOptimizedPixelOpsFactory::createConvolutionOpF32() : new KoConvolutionOpImpl<KoRgbF32Traits>();
+    }
+}
+
+/**
+ * Random opaque-ish pixels. For F32 the pixels are filled with
+ * values in [0, 1] range.
+ */
+QVector<quint8> createSourcePixels(PixelType type)
+{
+    const int size = pixelSize(type);
+    QVector<quint8> pixels(NUM_SOURCE_PIXELS * size);
+
+    qsrand(1);
+
+    if (type == F32) {
+        float *it = reinterpret_cast<float*>(pixels.data());
+        for (int i = 0; i < NUM_SOURCE_PIXELS * 4; i++) {
+            it[i] = float(qrand()) / RAND_MAX;
+        }
+    } else {
+        for (int i = 0; i < pixels.size(); i++) {
+            pixels[i] = qrand() & 0xFF;
+        }
+    }
+
+    return pixels;
+}
+
+}
+
+void KoPixelOpsBenchmark::createRowsColumns()
+{
+    QTest::addColumn<int>("pixelType");
+    QTest::addColumn<int>("numColors");
+    QTest::addColumn<bool>("optimized");
+
+    const char *typeNames[] = {"U8", "U16", "F32"};
+    const int counts[] = {4, 9, 25, 49};
+
+    for (int type = U8; type <= F32; type++) {
+        for (int numColors : counts) {
+            for (int optimized = 0; optimized < 2; optimized++) {
+                const QString name = QString("%1, %2 colors, %3")
+                    .arg(typeNames[type])
+                    .arg(numColors)
+                    .arg(optimized ? "vector" : "scalar");
+
+                QTest::newRow(name.toLatin1()) << type << numColors << bool(optimized);
+            }
+        }
+    }
+}
+
+void KoPixelOpsBenchmark::benchmarkMixColors_data()
+{
+    createRowsColumns();
+}
+
+void KoPixelOpsBenchmark::benchmarkMixColors()
+{
+    QFETCH(int, pixelType);
+    QFETCH(int, numColors);
+    QFETCH(bool, optimized);
+
+    const PixelType type = PixelType(pixelType);
+    const int size = pixelSize(type);
+
+    QScopedPointer<KoMixColorsOp> op(createMixColorsOp(type, optimized));
+    const QVector<quint8> pixels = createSourcePixels(type);
+    quint8 dst[16];
+
+    QBENCHMARK {
+        for (int i = 0; i < NUM_OPERATIONS; i++) {
+            const int offset = (i % (NUM_SOURCE_PIXELS - numColors)) * size;
+            op->mixColors(pixels.constData() + offset, numColors, dst);
+        }
+    }
+}
+
+void KoPixelOpsBenchmark::benchmarkMixColorsWeighted_data()
+{
+    createRowsColumns();
+}
+
+/**
+ * The common case for the color smudge and the color picker: an
+ * array of pointers with weights
+ */
+void KoPixelOpsBenchmark::benchmarkMixColorsWeighted()
+{
+    QFETCH(int, pixelType);
+    QFETCH(int, numColors);
+    QFETCH(bool, optimized);
+
+    const PixelType type = PixelType(pixelType);
+    const int size = pixelSize(type);
+
+    QScopedPointer<KoMixColorsOp> op(createMixColorsOp(type, optimized));
+    const QVector<quint8> pixels = createSourcePixels(type);
+    quint8 dst[16];
+
+    QVector<const quint8*> colors(NUM_SOURCE_PIXELS);
+    for (int i = 0; i < NUM_SOURCE_PIXELS; i++) {
+        // use a stride to emulate sampling of a 2D area
+        colors[i] = pixels.constData() + ((i * 7) % NUM_SOURCE_PIXELS) * size;
+    }
+
+    QVector<qint16> weights(numColors, 255 / numColors);
+    weights[0] += 255 - (255 / numColors) * numColors;
+
+    QBENCHMARK {
+        for (int i = 0; i < NUM_OPERATIONS; i++) {
+            const int offset = i % (NUM_SOURCE_PIXELS - numColors);
+            op->mixColors(colors.constData() + offset, weights.constData(), numColors, dst);
+        }
+    }
+}
+
+void KoPixelOpsBenchmark::benchmarkConvolution_data()
+{
+    createRowsColumns();
+}
+
+void KoPixelOpsBenchmark::benchmarkConvolution()
+{
+    QFETCH(int, pixelType);
+    QFETCH(int, numColors);
+    QFETCH(bool, optimized);
+
+    const PixelType type = PixelType(pixelType);
+    const int size = pixelSize(type);
+
+    QScopedPointer<KoConvolutionOp> op(createConvolutionOp(type, optimized));
+    const QVector<quint8> pixels = createSourcePixels(type);
+    quint8 dst[16];
+
+    QVector<const quint8*> colors(NUM_SOURCE_PIXELS);
+    for (int i = 0; i < NUM_SOURCE_PIXELS; i++) {
+        colors[i] = pixels.constData() + ((i * 7) % NUM_SOURCE_PIXELS) * size;
+    }
+
+    QVector<qreal> kernel(numColors);
+    qreal factor = 0;
+    for (int i = 0; i < numColors; i++) {
+        kernel[i] = 1 + i % 3;
+        factor += kernel[i];
+    }
+
+    QBENCHMARK {
+        for (int i = 0; i < NUM_OPERATIONS; i++) {
+            const int offset = i % (NUM_SOURCE_PIXELS - numColors);
+            op->convolveColors(colors.constData() + offset, kernel.constData(), dst, factor, 0, numColors, QBitArray());
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(KoPixelOpsBenchmark)
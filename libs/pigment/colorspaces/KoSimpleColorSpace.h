@@ -186,6 +186,8 @@ public:
         }
     }
 
+    using KoColorSpace::convertPixelsTo;
+
     bool convertPixelsTo(const quint8 *src,
                                  quint8 *dst, const KoColorSpace * dstColorSpace,
                                  quint32 numPixels,
@@ -57,8 +57,11 @@ public:
 
     void composite(const KoCompositeOp::ParameterInfo& params) const override {
 
-        const QBitArray& flags           = params.channelFlags.isEmpty() ? QBitArray(channels_nb,true) : params.channelFlags;
-        bool             allChannelFlags = params.channelFlags.isEmpty() || params.channelFlags == QBitArray(channels_nb,true);
+        // shared by all the calls to avoid allocating a bit array every time
+        static const QBitArray allChannels(channels_nb, true);
+
+        const QBitArray& flags           = params.channelFlags.isEmpty() ? allChannels : params.channelFlags;
+        bool             allChannelFlags = params.channelFlags.isEmpty() || params.channelFlags == allChannels;
         bool             alphaLocked     = (alpha_pos != -1) && !flags.testBit(alpha_pos);
         bool             useMask         = params.maskRowStart != 0;
 
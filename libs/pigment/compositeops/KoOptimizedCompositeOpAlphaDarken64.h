@@ -0,0 +1,229 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPALPHADARKEN64_H
+#define KOOPTIMIZEDCOMPOSITEOPALPHADARKEN64_H
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoAlphaDarkenParamsWrapper.h"
+
+template<typename _ParamsWrapper>
+struct AlphaDarkenCompositor64 {
+    using ParamsWrapper = _ParamsWrapper;
+
+    /**
+     * This is a vector equivalent of compositeOnePixelScalar(). It is considered
+     * to process Vc::float_v::size() pixels in a single pass.
+     *
+     * The color channels are processed in the native [0, 65535] range,
+     * the alpha channel is normalized to [0.0, 1.0].
+     *
+     * \see docs in AlphaDarkenCompositor32
+     */
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const Vc::float_v uint16Max((float)65535.0);
+        const Vc::float_v uint16MaxRec1((float)1.0 / 65535.0);
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+        Vc::float_v src_alpha;
+
+        KoStreamedMath<_impl>::fetch_channels_64(src, src_c1, src_c2, src_c3, src_alpha);
+
+        Vc::float_v msk_norm_alpha;
+        if (haveMask) {
+            const Vc::float_v uint8Rec1((float)1.0 / 255.0);
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            msk_norm_alpha = mask_vec * uint8Rec1 * uint16MaxRec1 * src_alpha;
+        }
+        else {
+            msk_norm_alpha = uint16MaxRec1 * src_alpha;
+        }
+
+        // we don't use directly passed value
+        Q_UNUSED(opacity);
+
+        // instead we use value calculated by ParamsWrapper
+        opacity = oparams.opacity;
+        Vc::float_v opacity_vec(opacity);
+
+        src_alpha = msk_norm_alpha * opacity_vec;
+
+        const Vc::float_v zeroValue(Vc::Zero);
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+        Vc::float_v dst_alpha;
+
+        KoStreamedMath<_impl>::fetch_channels_64(dst, dst_c1, dst_c2, dst_c3, dst_alpha);
+        dst_alpha *= uint16MaxRec1;
+
+        Vc::float_m empty_dst_pixels_mask = dst_alpha == zeroValue;
+
+        if (!empty_dst_pixels_mask.isFull()) {
+            if (empty_dst_pixels_mask.isEmpty()) {
+                dst_c1 = (src_c1 - dst_c1) * src_alpha + dst_c1;
+                dst_c2 = (src_c2 - dst_c2) * src_alpha + dst_c2;
+                dst_c3 = (src_c3 - dst_c3) * src_alpha + dst_c3;
+            }
+            else {
+                dst_c1(empty_dst_pixels_mask) = src_c1;
+                dst_c2(empty_dst_pixels_mask) = src_c2;
+                dst_c3(empty_dst_pixels_mask) = src_c3;
+                Vc::float_m not_empty_dst_pixels_mask = !empty_dst_pixels_mask;
+                dst_c1(not_empty_dst_pixels_mask) = (src_c1 - dst_c1) * src_alpha + dst_c1;
+                dst_c2(not_empty_dst_pixels_mask) = (src_c2 - dst_c2) * src_alpha + dst_c2;
+                dst_c3(not_empty_dst_pixels_mask) = (src_c3 - dst_c3) * src_alpha + dst_c3;
+            }
+        }
+        else {
+            dst_c1 = src_c1;
+            dst_c2 = src_c2;
+            dst_c3 = src_c3;
+        }
+
+        Vc::float_v fullFlowAlpha(dst_alpha);
+
+        if (oparams.averageOpacity > opacity) {
+            Vc::float_v average_opacity_vec(oparams.averageOpacity);
+            Vc::float_m fullFlowAlpha_mask = average_opacity_vec > dst_alpha;
+            fullFlowAlpha(fullFlowAlpha_mask) = (average_opacity_vec - src_alpha) * (dst_alpha / average_opacity_vec) + src_alpha;
+        }
+        else {
+            Vc::float_m fullFlowAlpha_mask = opacity_vec > dst_alpha;
+            fullFlowAlpha(fullFlowAlpha_mask) = (opacity_vec - dst_alpha) * msk_norm_alpha + dst_alpha;
+        }
+
+        if (oparams.flow == 1.0) {
+            dst_alpha = fullFlowAlpha;
+        }
+        else {
+            Vc::float_v zeroFlowAlpha = ParamsWrapper::calculateZeroFlowAlpha(src_alpha, dst_alpha);
+            Vc::float_v flow_norm_vec(oparams.flow);
+            dst_alpha = (fullFlowAlpha - zeroFlowAlpha) * flow_norm_vec + zeroFlowAlpha;
+        }
+
+        KoStreamedMath<_impl>::write_channels_64(dst, dst_alpha * uint16Max, dst_c1, dst_c2, dst_c3);
+    }
+
+    /**
+     * Composes one pixel of the source into the destination
+     */
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *s, quint8 *d, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        using namespace Arithmetic;
+        const qint32 alpha_pos = 3;
+
+        const quint16 *src = reinterpret_cast<const quint16*>(s);
+        quint16 *dst = reinterpret_cast<quint16*>(d);
+
+        const float uint16Rec1 = 1.0 / 65535.0;
+        const float uint16Max = 65535.0;
+        const float uint8Rec1 = 1.0 / 255.0;
+
+        float dstAlphaNorm = dst[alpha_pos] * uint16Rec1;
+        float mskAlphaNorm = haveMask ?
+            float(*mask) * uint8Rec1 * src[alpha_pos] * uint16Rec1 :
+            src[alpha_pos] * uint16Rec1;
+
+        Q_UNUSED(opacity);
+        opacity = oparams.opacity;
+
+        float srcAlphaNorm = mskAlphaNorm * opacity;
+
+        if (dst[alpha_pos] != 0) {
+            dst[0] = KoStreamedMath<_impl>::round_float_to_u16(lerp(float(dst[0]), float(src[0]), srcAlphaNorm));
+            dst[1] = KoStreamedMath<_impl>::round_float_to_u16(lerp(float(dst[1]), float(src[1]), srcAlphaNorm));
+            dst[2] = KoStreamedMath<_impl>::round_float_to_u16(lerp(float(dst[2]), float(src[2]), srcAlphaNorm));
+        } else {
+            KoStreamedMathFunctions::copyPixel<8>(s, d);
+        }
+
+        float flow = oparams.flow;
+        float averageOpacity = oparams.averageOpacity;
+
+        float fullFlowAlpha;
+
+        if (averageOpacity > opacity) {
+            fullFlowAlpha = averageOpacity > dstAlphaNorm ? lerp(srcAlphaNorm, averageOpacity, dstAlphaNorm / averageOpacity) : dstAlphaNorm;
+        } else {
+            fullFlowAlpha = opacity > dstAlphaNorm ? lerp(dstAlphaNorm, opacity, mskAlphaNorm) : dstAlphaNorm;
+        }
+
+        float dstAlpha;
+
+        if (flow == 1.0) {
+            dstAlpha = fullFlowAlpha;
+        } else {
+            float zeroFlowAlpha = ParamsWrapper::calculateZeroFlowAlpha(srcAlphaNorm, dstAlphaNorm);
+            dstAlpha = lerp(zeroFlowAlpha, fullFlowAlpha, flow);
+        }
+
+        dst[alpha_pos] = KoStreamedMath<_impl>::round_float_to_u16(dstAlpha * uint16Max);
+    }
+};
+
+/**
+ * An optimized version of a composite op for the use in 8 byte
+ * colorspaces with 16-bit integer channels and alpha channel placed
+ * at the last channel of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, typename ParamsWrapper>
+class KoOptimizedCompositeOpAlphaDarken64Impl : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpAlphaDarken64Impl(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_ALPHA_DARKEN, i18n("Alpha darken"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            KoStreamedMath<_impl>::template genericComposite64<true, true, AlphaDarkenCompositor64<ParamsWrapper> >(params);
+        } else {
+            KoStreamedMath<_impl>::template genericComposite64<false, true, AlphaDarkenCompositor64<ParamsWrapper> >(params);
+        }
+    }
+};
+
+template<Vc::Implementation _impl>
+struct KoOptimizedCompositeOpAlphaDarkenHard64
+    : public KoOptimizedCompositeOpAlphaDarken64Impl<_impl, KoAlphaDarkenParamsWrapperHard>
+{
+    KoOptimizedCompositeOpAlphaDarkenHard64(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpAlphaDarken64Impl<_impl, KoAlphaDarkenParamsWrapperHard>(cs) {}
+};
+
+template<Vc::Implementation _impl>
+struct KoOptimizedCompositeOpAlphaDarkenCreamy64
+    : public KoOptimizedCompositeOpAlphaDarken64Impl<_impl, KoAlphaDarkenParamsWrapperCreamy>
+{
+    KoOptimizedCompositeOpAlphaDarkenCreamy64(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpAlphaDarken64Impl<_impl, KoAlphaDarkenParamsWrapperCreamy>(cs) {}
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPALPHADARKEN64_H
@@ -44,6 +44,25 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp32(const KoColorSpace
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver32> >(cs);
 }
 
+KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpHard64(const KoColorSpace *cs)
+{
+    return createOptimizedClass<
+        KoOptimizedCompositeOpFactoryPerArch<
+            KoOptimizedCompositeOpAlphaDarkenHard64>>(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamy64(const KoColorSpace *cs)
+{
+    return createOptimizedClass<
+        KoOptimizedCompositeOpFactoryPerArch<
+            KoOptimizedCompositeOpAlphaDarkenCreamy64>>(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp64(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver64> >(cs);
+}
+
 KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpHard128(const KoColorSpace *cs)
 {
     return createOptimizedClass<
@@ -63,3 +82,15 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    KoOptimizedGenericCompositeOpParams params = {cs, id, description, category};
+    return createOptimizedClass<KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32> >(params);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    KoOptimizedGenericCompositeOpParams params = {cs, id, description, category};
+    return createOptimizedClass<KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128> >(params);
+}
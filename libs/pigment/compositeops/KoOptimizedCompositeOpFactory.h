@@ -24,6 +24,7 @@
 
 class KoCompositeOp;
 class KoColorSpace;
+class QString;
 
 /**
  * The creation of the optimized composite ops is moved into a separate
@@ -43,9 +44,20 @@ public:
     static KoCompositeOp* createAlphaDarkenOpHard32(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpCreamy32(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp32(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpHard64(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpCreamy64(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOp64(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpHard128(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpCreamy128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+
+    /**
+     * Create a vectorized version of the KoCompositeOpGenericSC-based
+     * composite op \p id. Return null if there is no vectorized version
+     * of this blending mode.
+     */
+    static KoCompositeOp* createGenericOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
+    static KoCompositeOp* createGenericOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
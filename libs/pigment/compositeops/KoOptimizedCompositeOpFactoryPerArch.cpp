@@ -26,6 +26,10 @@
 #include "KoOptimizedCompositeOpAlphaDarken128.h"
 #include "KoOptimizedCompositeOpOver32.h"
 #include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedCompositeOpAlphaDarken64.h"
+#include "KoOptimizedCompositeOpOver64.h"
+#include "KoOptimizedCompositeOpGeneric32.h"
+#include "KoOptimizedCompositeOpGeneric128.h"
 
 #include <QString>
 #include "DebugPigment.h"
@@ -61,6 +65,30 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver32>::create<Vc::C
     return new KoOptimizedCompositeOpOver32<Vc::CurrentImplementation::current()>(param);
 }
 
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenHard64>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenHard64>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpAlphaDarkenHard64<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenCreamy64>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenCreamy64>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpAlphaDarkenCreamy64<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver64>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver64>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpOver64<Vc::CurrentImplementation::current()>(param);
+}
+
 template<>
 template<>
 KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenHard128>::ReturnType
@@ -85,3 +113,19 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoOptimizedCompositeOpOver128<Vc::CurrentImplementation::current()>(param);
 }
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return createStreamedGenericCompositeOp<KoOptimizedCompositeOpGeneric32, Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return createStreamedGenericCompositeOp<KoOptimizedCompositeOpGeneric128, Vc::CurrentImplementation::current()>(param);
+}
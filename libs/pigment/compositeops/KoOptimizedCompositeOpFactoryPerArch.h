@@ -23,6 +23,8 @@
 
 #include <compositeops/KoVcMultiArchBuildSupport.h>
 
+#include <QString>
+
 
 class KoCompositeOp;
 class KoColorSpace;
@@ -37,6 +39,15 @@ class KoOptimizedCompositeOpAlphaDarkenHard32;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver32;
 
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHard64;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamy64;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOver64;
+
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpAlphaDarkenHard128;
 
@@ -46,6 +57,12 @@ class KoOptimizedCompositeOpAlphaDarkenCreamy128;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver128;
 
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGeneric32;
+
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGeneric128;
+
 template<template<Vc::Implementation I> class CompositeOp>
 struct KoOptimizedCompositeOpFactoryPerArch
 {
@@ -56,5 +73,31 @@ struct KoOptimizedCompositeOpFactoryPerArch
     static ReturnType create(ParamType param);
 };
 
+/**
+ * The description of a KoCompositeOpGenericSC-like composite op
+ */
+struct KoOptimizedGenericCompositeOpParams
+{
+    const KoColorSpace *cs;
+    QString id;
+    QString description;
+    QString category;
+};
+
+/**
+ * Creates a vectorized version of a generic composite op. Returns
+ * null if the blending mode \p id has no vectorized version (or
+ * the scalar implementation is requested), then the caller should
+ * fall back to KoCompositeOpGenericSC.
+ */
+template<template<Vc::Implementation I, class BlendFunction> class CompositeOp>
+struct KoOptimizedGenericCompositeOpFactoryPerArch
+{
+    typedef const KoOptimizedGenericCompositeOpParams& ParamType;
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORYPERARCH_H */
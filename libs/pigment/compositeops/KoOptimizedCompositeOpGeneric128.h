@@ -0,0 +1,232 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERIC128_H_
+#define KOOPTIMIZEDCOMPOSITEOPGENERIC128_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoStreamedBlendFunctions.h"
+
+
+/**
+ * A vectorized version of KoCompositeOpGenericSC for 16 byte
+ * (float) C1_C2_C3_A colorspaces. The blending function is passed
+ * as \p BlendFunction (see KoStreamedBlendFunctions.h).
+ *
+ * The result of the blending function is not clamped, the same way
+ * as KoColorSpaceMaths<float>::clamp() does.
+ */
+template<class BlendFunction, bool alphaLocked, bool allChannelsFlag>
+struct GenericCompositor128 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    struct Pixel {
+        float red;
+        float green;
+        float blue;
+        float alpha;
+    };
+
+    /**
+     * Only the (!alphaLocked && allChannelsFlag) case is vectorized,
+     * the other ones go through compositeOnePixelScalar()
+     */
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Pixel *sp = reinterpret_cast<const Pixel*>(src);
+        Pixel *dp = reinterpret_cast<Pixel*>(dst);
+
+        Vc::float_v src_alpha;
+        Vc::float_v dst_alpha;
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> data(const_cast<Pixel*>(sp));
+        tie(src_c1, src_c2, src_c3, src_alpha) = data[indexes];
+
+        src_alpha *= Vc::float_v(opacity);
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1((float)1.0 / 255);
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> dataDest(dp);
+        tie(dst_c1, dst_c2, dst_c3, dst_alpha) = dataDest[indexes];
+
+        const Vc::float_v new_alpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+
+        /**
+         * The value of new_alpha can have *some* zero values, the
+         * corresponding lanes are restored from the destination
+         * after the division.
+         */
+        const Vc::float_m emptyMask = new_alpha == zeroValue;
+        const Vc::float_v new_alpha_rec = oneValue / new_alpha;
+
+        const Vc::float_v dst_weight = (oneValue - src_alpha) * dst_alpha * new_alpha_rec;
+        const Vc::float_v src_weight = (oneValue - dst_alpha) * src_alpha * new_alpha_rec;
+        const Vc::float_v blend_weight = src_alpha * dst_alpha * new_alpha_rec;
+
+        dst_c1 = blendChannel(src_c1, dst_c1, src_weight, dst_weight, blend_weight, emptyMask);
+        dst_c2 = blendChannel(src_c2, dst_c2, src_weight, dst_weight, blend_weight, emptyMask);
+        dst_c3 = blendChannel(src_c3, dst_c3, src_weight, dst_weight, blend_weight, emptyMask);
+
+        dataDest[indexes] = tie(dst_c1, dst_c2, dst_c3, new_alpha);
+    }
+
+    static ALWAYS_INLINE Vc::float_v blendChannel(Vc::float_v::AsArg src, Vc::float_v::AsArg dst,
+                                                  Vc::float_v::AsArg src_weight, Vc::float_v::AsArg dst_weight,
+                                                  Vc::float_v::AsArg blend_weight, const Vc::float_m &emptyMask)
+    {
+        const Vc::float_v f = BlendFunction::template apply<false>(src, dst);
+        const Vc::float_v result = dst_weight * dst + src_weight * src + blend_weight * f;
+        return Vc::iif(emptyMask, dst, result);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+
+        const float *s = reinterpret_cast<const float*>(src);
+        float *d = reinterpret_cast<float*>(dst);
+
+        float srcAlpha = s[alpha_pos] * opacity;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0 / 255;
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        const float dstAlpha = d[alpha_pos];
+
+        if (!allChannelsFlag && dstAlpha == 0.0) {
+            KoStreamedMathFunctions::clearPixel<16>(dst);
+        }
+
+        if (alphaLocked) {
+            if (dstAlpha != 0.0) {
+                for (int i = 0; i < 3; i++) {
+                    if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                        const float f = BlendFunction::template apply<false>(s[i], d[i]);
+                        d[i] += srcAlpha * (f - d[i]);
+                    }
+                }
+            }
+        } else {
+            const float newAlpha = srcAlpha + dstAlpha - srcAlpha * dstAlpha;
+
+            if (newAlpha != 0.0) {
+                for (int i = 0; i < 3; i++) {
+                    if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                        const float f = BlendFunction::template apply<false>(s[i], d[i]);
+                        const float result =
+                            (1.0f - srcAlpha) * dstAlpha * d[i] +
+                            (1.0f - dstAlpha) * srcAlpha * s[i] +
+                            srcAlpha * dstAlpha * f;
+
+                        d[i] = result / newAlpha;
+                    }
+                }
+            }
+
+            d[alpha_pos] = newAlpha;
+        }
+    }
+};
+
+/**
+ * An optimized version of KoCompositeOpGenericSC for the use in
+ * 16 byte colorspaces with alpha channel placed at the last float
+ * of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGeneric128 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGeneric128(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : KoCompositeOp(cs, id, description, category) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite128<haveMask, false, GenericCompositor128<BlendFunction, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericCompositor128<BlendFunction, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericCompositor128<BlendFunction, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericCompositor128<BlendFunction, true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERIC128_H_
@@ -0,0 +1,229 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERIC32_H_
+#define KOOPTIMIZEDCOMPOSITEOPGENERIC32_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoStreamedBlendFunctions.h"
+
+
+/**
+ * A vectorized version of KoCompositeOpGenericSC for 4 byte
+ * C1_C2_C3_A colorspaces. The blending function is passed as
+ * \p BlendFunction (see KoStreamedBlendFunctions.h).
+ *
+ * All the calculations are done in floating point on the values
+ * normalized to [0.0, 1.0], so the result may differ from the
+ * integer implementation by a rounding error.
+ */
+template<class BlendFunction, bool alphaLocked, bool allChannelsFlag>
+struct GenericCompositor32 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    /**
+     * Only the (!alphaLocked && allChannelsFlag) case is vectorized,
+     * the other ones go through compositeOnePixelScalar()
+     */
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Vc::float_v uint8Max((float)255.0);
+        const Vc::float_v uint8MaxRec1((float)1.0 / 255.0);
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v src_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<src_aligned>(src);
+        src_alpha *= Vc::float_v(opacity) * uint8MaxRec1;
+
+        if (haveMask) {
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<true>(dst);
+        dst_alpha *= uint8MaxRec1;
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+
+        KoStreamedMath<_impl>::template fetch_colors_32<src_aligned>(src, src_c1, src_c2, src_c3);
+        KoStreamedMath<_impl>::template fetch_colors_32<true>(dst, dst_c1, dst_c2, dst_c3);
+
+        const Vc::float_v new_alpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+
+        /**
+         * The value of new_alpha can have *some* zero values, the
+         * corresponding lanes are restored from the destination
+         * after the division.
+         */
+        const Vc::float_m emptyMask = new_alpha == zeroValue;
+        const Vc::float_v new_alpha_rec = oneValue / new_alpha;
+
+        const Vc::float_v dst_weight = (oneValue - src_alpha) * dst_alpha * new_alpha_rec;
+        const Vc::float_v src_weight = (oneValue - dst_alpha) * src_alpha * new_alpha_rec;
+        const Vc::float_v blend_weight = src_alpha * dst_alpha * new_alpha_rec;
+
+        dst_c1 = blendChannel(src_c1, dst_c1, src_weight, dst_weight, blend_weight, emptyMask, uint8Max, uint8MaxRec1);
+        dst_c2 = blendChannel(src_c2, dst_c2, src_weight, dst_weight, blend_weight, emptyMask, uint8Max, uint8MaxRec1);
+        dst_c3 = blendChannel(src_c3, dst_c3, src_weight, dst_weight, blend_weight, emptyMask, uint8Max, uint8MaxRec1);
+
+        KoStreamedMath<_impl>::write_channels_32(dst, new_alpha * uint8Max, dst_c1, dst_c2, dst_c3);
+    }
+
+    static ALWAYS_INLINE Vc::float_v blendChannel(Vc::float_v::AsArg src, Vc::float_v::AsArg dst,
+                                                  Vc::float_v::AsArg src_weight, Vc::float_v::AsArg dst_weight,
+                                                  Vc::float_v::AsArg blend_weight, const Vc::float_m &emptyMask,
+                                                  Vc::float_v::AsArg uint8Max, Vc::float_v::AsArg uint8MaxRec1)
+    {
+        const Vc::float_v s = src * uint8MaxRec1;
+        const Vc::float_v d = dst * uint8MaxRec1;
+        const Vc::float_v f = BlendFunction::template apply<true>(s, d);
+
+        const Vc::float_v result = (dst_weight * d + src_weight * s + blend_weight * f) * uint8Max;
+        return Vc::iif(emptyMask, dst, result);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+        const float uint8Rec1 = 1.0 / 255.0;
+        const float uint8Max = 255.0;
+
+        float srcAlpha = src[alpha_pos] * opacity * uint8Rec1;
+
+        if (haveMask) {
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        const float dstAlpha = dst[alpha_pos] * uint8Rec1;
+
+        if (!allChannelsFlag && dst[alpha_pos] == 0) {
+            KoStreamedMathFunctions::clearPixel<4>(dst);
+        }
+
+        if (alphaLocked) {
+            if (dstAlpha != 0.0) {
+                for (int i = 0; i < 3; i++) {
+                    if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                        const float s = src[i] * uint8Rec1;
+                        const float d = dst[i] * uint8Rec1;
+                        const float f = BlendFunction::template apply<true>(s, d);
+                        dst[i] = KoStreamedMath<_impl>::round_float_to_uint((d + srcAlpha * (f - d)) * uint8Max);
+                    }
+                }
+            }
+        } else {
+            const float newAlpha = srcAlpha + dstAlpha - srcAlpha * dstAlpha;
+
+            if (newAlpha != 0.0) {
+                const float newAlphaRec = 1.0 / newAlpha;
+
+                for (int i = 0; i < 3; i++) {
+                    if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                        const float s = src[i] * uint8Rec1;
+                        const float d = dst[i] * uint8Rec1;
+                        const float f = BlendFunction::template apply<true>(s, d);
+                        const float result =
+                            (1.0 - srcAlpha) * dstAlpha * d +
+                            (1.0 - dstAlpha) * srcAlpha * s +
+                            srcAlpha * dstAlpha * f;
+
+                        dst[i] = KoStreamedMath<_impl>::round_float_to_uint(result * newAlphaRec * uint8Max);
+                    }
+                }
+            }
+
+            dst[alpha_pos] = KoStreamedMath<_impl>::round_float_to_uint(newAlpha * uint8Max);
+        }
+    }
+};
+
+/**
+ * An optimized version of KoCompositeOpGenericSC for the use in
+ * 4 byte colorspaces with alpha channel placed at the last byte
+ * of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGeneric32 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGeneric32(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : KoCompositeOp(cs, id, description, category) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite32<haveMask, false, GenericCompositor32<BlendFunction, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericCompositor32<BlendFunction, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericCompositor32<BlendFunction, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericCompositor32<BlendFunction, true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERIC32_H_
@@ -0,0 +1,220 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPOVER64_H_
+#define KOOPTIMIZEDCOMPOSITEOPOVER64_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+
+
+template<bool alphaLocked, bool allChannelsFlag>
+struct OverCompositor64 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    /**
+     * The color channels are processed in the native [0, 65535]
+     * range, since lerp does not depend on the scale. The alpha
+     * channel is normalized to [0.0, 1.0].
+     *
+     * \see docs in AlphaDarkenCompositor32
+     */
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Vc::float_v uint16Max((float)65535.0);
+        const Vc::float_v uint16MaxRec1((float)1.0 / 65535.0);
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+        Vc::float_v src_alpha;
+
+        KoStreamedMath<_impl>::fetch_channels_64(src, src_c1, src_c2, src_c3, src_alpha);
+
+        src_alpha *= Vc::float_v(opacity) * uint16MaxRec1;
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1((float)1.0 / 255.0);
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+        Vc::float_v dst_alpha;
+
+        KoStreamedMath<_impl>::fetch_channels_64(dst, dst_c1, dst_c2, dst_c3, dst_alpha);
+        dst_alpha *= uint16MaxRec1;
+
+        Vc::float_v src_blend;
+        Vc::float_v new_alpha;
+
+        if ((dst_alpha == oneValue).isFull()) {
+            new_alpha = dst_alpha;
+            src_blend = src_alpha;
+        } else if ((dst_alpha == zeroValue).isFull()) {
+            new_alpha = src_alpha;
+            src_blend = oneValue;
+        } else {
+            /**
+             * The value of new_alpha can have *some* zero values,
+             * which will result in NaN values while division.
+             */
+            new_alpha = dst_alpha + (oneValue - dst_alpha) * src_alpha;
+            Vc::float_m mask = (new_alpha == zeroValue);
+            src_blend = src_alpha / new_alpha;
+            src_blend.setZero(mask);
+        }
+
+        if (!(src_blend == oneValue).isFull()) {
+            dst_c1 = src_blend * (src_c1 - dst_c1) + dst_c1;
+            dst_c2 = src_blend * (src_c2 - dst_c2) + dst_c2;
+            dst_c3 = src_blend * (src_c3 - dst_c3) + dst_c3;
+        } else {
+            dst_c1 = src_c1;
+            dst_c2 = src_c2;
+            dst_c3 = src_c3;
+        }
+
+        KoStreamedMath<_impl>::write_channels_64(dst, new_alpha * uint16Max, dst_c1, dst_c2, dst_c3);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+
+        const float uint16Rec1 = 1.0 / 65535.0;
+        const float uint16Max = 65535.0;
+
+        const quint16 *s = reinterpret_cast<const quint16*>(src);
+        quint16 *d = reinterpret_cast<quint16*>(dst);
+
+        float srcAlpha = s[alpha_pos] * opacity * uint16Rec1;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0 / 255.0;
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (srcAlpha != 0.0) {
+
+            float dstAlpha = d[alpha_pos] * uint16Rec1;
+            float srcBlendNorm;
+
+            if (d[alpha_pos] == 0xFFFF) {
+                srcBlendNorm = srcAlpha;
+            } else if (d[alpha_pos] == 0) {
+                dstAlpha = srcAlpha;
+                srcBlendNorm = 1.0;
+
+                if (!allChannelsFlag) {
+                    KoStreamedMathFunctions::clearPixel<8>(dst);
+                }
+            } else {
+                dstAlpha += (1.0 - dstAlpha) * srcAlpha;
+                srcBlendNorm = srcAlpha / dstAlpha;
+            }
+
+            for (int i = 0; i < 3; i++) {
+                if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                    if (srcBlendNorm == 1.0) {
+                        d[i] = s[i];
+                    } else if (srcBlendNorm != 0.0) {
+                        d[i] = KoStreamedMath<_impl>::round_float_to_u16(srcBlendNorm * (float(s[i]) - d[i]) + d[i]);
+                    }
+                }
+            }
+
+            if (!alphaLocked) {
+                d[alpha_pos] = KoStreamedMath<_impl>::round_float_to_u16(dstAlpha * uint16Max);
+            }
+        }
+    }
+};
+
+/**
+ * An optimized version of a composite op for the use in 8 byte
+ * colorspaces with 16-bit integer channels and alpha channel placed
+ * at the last channel of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOver64 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpOver64(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_OVER, i18n("Normal"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite64<haveMask, false, OverCompositor64<false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, OverCompositor64<true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, OverCompositor64<false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, OverCompositor64<true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPOVER64_H_
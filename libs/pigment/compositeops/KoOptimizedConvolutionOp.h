@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCONVOLUTIONOP_H
+#define KOOPTIMIZEDCONVOLUTIONOP_H
+
+#include "KoConvolutionOpImpl.h"
+#include "KoOptimizedPixelFetcher.h"
+
+/**
+ * A vectorized version of KoConvolutionOpImpl for color spaces with four
+ * channels and alpha at the last position (RGBA U8, U16 and F32).
+ *
+ * The pixels are copied into a packed buffer Vc::float_v::size() items
+ * at a time, while the weights are split into the ones of opaque and
+ * the ones of transparent pixels. The weighted sums are accumulated in
+ * vectors, the final result is written by the scalar implementation,
+ * so transparent pixels are handled exactly like in KoConvolutionOpImpl.
+ *
+ * The sums are calculated in single precision, so the results may
+ * differ from KoConvolutionOpImpl by one.
+ */
+template<Vc::Implementation _impl, class _CSTrait>
+class KoOptimizedConvolutionOp : public KoConvolutionOp
+{
+    typedef typename _CSTrait::channels_type channels_type;
+    typedef KoOptimizedPixelFetcher<_impl, _CSTrait::pixelSize> Fetcher;
+
+    static_assert(_CSTrait::channels_nb == 4 && _CSTrait::alpha_pos == 3,
+                  "KoOptimizedConvolutionOp supports only four-channel color spaces with alpha at the end");
+
+public:
+    void convolveColors(const quint8* const* colors, const qreal* kernelValues, quint8 *dst, qreal factor, qreal offset, qint32 nPixels, const QBitArray & channelFlags) const override {
+        using Vc::float_v;
+
+        const int vectorSize = float_v::size();
+        Vc::Memory<float_v, float_v::size()> opaqueWeights;
+        quint8 buffer[float_v::size() * _CSTrait::pixelSize];
+
+        float_v totalC0(Vc::Zero);
+        float_v totalC1(Vc::Zero);
+        float_v totalC2(Vc::Zero);
+        float_v totalC3(Vc::Zero);
+
+        qreal totalWeight = 0;
+        qreal totalWeightTransparent = 0;
+
+        qint32 i = 0;
+
+        for (; i + vectorSize <= nPixels; i += vectorSize) {
+            for (int j = 0; j < vectorSize; j++) {
+                const qreal weight = kernelValues[j];
+                const quint8 *color = colors[j];
+
+                KoStreamedMathFunctions::copyPixel<_CSTrait::pixelSize>(color, buffer + j * _CSTrait::pixelSize);
+
+                if (weight != 0 && _CSTrait::opacityU8(color) == 0) {
+                    totalWeightTransparent += weight;
+                    opaqueWeights[j] = 0;
+                } else {
+                    opaqueWeights[j] = weight;
+                }
+                totalWeight += weight;
+            }
+
+            float_v c0, c1, c2, c3;
+            Fetcher::fetch(buffer, c0, c1, c2, c3);
+
+            const float_v w = opaqueWeights.vector(0);
+            totalC0 += c0 * w;
+            totalC1 += c1 * w;
+            totalC2 += c2 * w;
+            totalC3 += c3 * w;
+
+            colors += vectorSize;
+            kernelValues += vectorSize;
+        }
+
+        qreal totals[4] = {totalC0.sum(), totalC1.sum(), totalC2.sum(), totalC3.sum()};
+
+        for (; i < nPixels; i++, colors++, kernelValues++) {
+            const qreal weight = *kernelValues;
+            if (weight == 0) continue;
+
+            if (_CSTrait::opacityU8(*colors) == 0) {
+                totalWeightTransparent += weight;
+            } else {
+                const channels_type *color = _CSTrait::nativeArray(*colors);
+                for (int ch = 0; ch < 4; ch++) {
+                    totals[ch] += color[ch] * weight;
+                }
+            }
+            totalWeight += weight;
+        }
+
+        KoConvolutionOpImpl<_CSTrait>::writeConvolutionResult(totals, totalWeight, totalWeightTransparent,
+                                                              dst, factor, offset, channelFlags);
+    }
+};
+
+#endif /* KOOPTIMIZEDCONVOLUTIONOP_H */
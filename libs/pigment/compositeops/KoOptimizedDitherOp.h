@@ -0,0 +1,171 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDDITHEROP_H
+#define KOOPTIMIZEDDITHEROP_H
+
+#include <type_traits>
+#include <utility>
+
+#include "KoDitherOpImpl.h"
+#include "KoOptimizedPixelFetcher.h"
+
+/**
+ * Fetches Vc::float_v::size() pixels into the vectors of channels
+ * in the order they are stored in memory
+ */
+template<Vc::Implementation _impl, class _CSTraits,
+         int channels_nb = _CSTraits::channels_nb,
+         typename channels_type = typename _CSTraits::channels_type>
+struct KoOptimizedDitherFetcher
+{
+    static ALWAYS_INLINE void fetch(const quint8 *data, Vc::float_v *channels) {
+        KoOptimizedPixelFetcher<_impl, _CSTraits::pixelSize>::fetch(data,
+                                                                   channels[0], channels[1],
+                                                                   channels[2], channels[3]);
+    }
+};
+
+template<Vc::Implementation _impl, class _CSTraits>
+struct KoOptimizedDitherFetcher<_impl, _CSTraits, 2, quint16>
+{
+    static ALWAYS_INLINE void fetch(const quint8 *data, Vc::float_v *channels) {
+        typedef typename KoStreamedMath<_impl>::int_v int_v;
+        typedef typename KoStreamedMath<_impl>::uint_v uint_v;
+
+        uint_v words;
+        words.load(reinterpret_cast<const quint32*>(data), Vc::Unaligned);
+
+        const uint_v mask(quint32(0xFFFF));
+        channels[0] = Vc::simd_cast<Vc::float_v>(int_v(words & mask));
+        channels[1] = Vc::simd_cast<Vc::float_v>(int_v(words >> 16));
+    }
+};
+
+template<Vc::Implementation _impl, class _CSTraits>
+struct KoOptimizedDitherFetcher<_impl, _CSTraits, 2, float>
+{
+    struct Pixel {
+        float c0;
+        float c1;
+    };
+
+    static ALWAYS_INLINE void fetch(const quint8 *data, Vc::float_v *channels) {
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> pixels(reinterpret_cast<Pixel*>(const_cast<quint8*>(data)));
+        tie(channels[0], channels[1]) = pixels[indexes];
+    }
+};
+
+/**
+ * A vectorized version of KoDitherOpImpl for the conversions into
+ * RGBA U8 and GrayA U8.
+ *
+ * Vc::float_v::size() pixels are converted at once: the channels are
+ * deinterleaved into separate vectors, scaled, dithered with the same
+ * vector of thresholds and packed back into 8-bit pixels. The rest of
+ * the row is processed by the scalar version. The results may differ
+ * from KoDitherOpImpl by one in rare cases, when the compiler fuses
+ * the multiplication and the addition.
+ */
+template<Vc::Implementation _impl, class _SrcCSTraits, class _DstCSTraits, bool swapRedBlue>
+class KoOptimizedDitherOp : public KoDitherOp
+{
+    typedef typename _SrcCSTraits::channels_type src_channels_type;
+    typedef typename KoStreamedMath<_impl>::int_v int_v;
+    typedef typename KoStreamedMath<_impl>::uint_v uint_v;
+
+    static const int channels_nb = _DstCSTraits::channels_nb;
+    static const int alpha_pos = _DstCSTraits::alpha_pos;
+
+    static_assert(std::is_same<typename _DstCSTraits::channels_type, quint8>::value,
+                  "KoOptimizedDitherOp converts only into 8-bit color spaces");
+
+    static_assert((channels_nb == 4 || channels_nb == 2) && alpha_pos == channels_nb - 1,
+                  "KoOptimizedDitherOp supports only RGBA and GrayA color spaces");
+
+public:
+    KoOptimizedDitherOp(const KoDitherMatrix *matrix)
+        : m_matrix(matrix),
+          m_scalarOp(matrix)
+    {
+    }
+
+    void dither(const quint8 *src, quint8 *dst, int columns, int x, int y) const override {
+        const int vectorSize = Vc::float_v::size();
+        const int mask = KoDitherMatrix::size() - 1;
+        const float *thresholds = m_matrix->row(y);
+
+        const Vc::float_v scale(255.0f / float(KoColorSpaceMathsTraits<src_channels_type>::unitValue));
+        const Vc::float_v minValue(Vc::Zero);
+        const Vc::float_v maxValue(255.0f);
+        const Vc::float_v half(0.5f);
+
+        int i = 0;
+
+        for (; i + vectorSize <= columns; i += vectorSize) {
+            Vc::float_v channels[channels_nb];
+            KoOptimizedDitherFetcher<_impl, _SrcCSTraits>::fetch(src, channels);
+
+            if (swapRedBlue) {
+                std::swap(channels[0], channels[2]);
+            }
+
+            const Vc::float_v threshold(thresholds + ((x + i) & mask), Vc::Unaligned);
+
+            uint_v packed(Vc::Zero);
+
+            for (int channel = 0; channel < channels_nb; channel++) {
+                Vc::float_v value = Vc::floor(channels[channel] * scale +
+                                              (channel == alpha_pos ? half : threshold));
+                value = Vc::min(maxValue, Vc::max(minValue, value));
+
+                packed |= uint_v(int_v(value)) << (8 * channel);
+            }
+
+            store(packed, dst);
+
+            src += vectorSize * _SrcCSTraits::pixelSize;
+            dst += vectorSize * _DstCSTraits::pixelSize;
+        }
+
+        if (i < columns) {
+            m_scalarOp.dither(src, dst, columns - i, x + i, y);
+        }
+    }
+
+private:
+    static ALWAYS_INLINE void store(const uint_v &packed, quint8 *dst) {
+        if (channels_nb == 4) {
+            packed.store(reinterpret_cast<quint32*>(dst), Vc::Unaligned);
+        } else {
+            quint16 *dstPixels = reinterpret_cast<quint16*>(dst);
+
+            for (int i = 0; i < int(Vc::float_v::size()); i++) {
+                dstPixels[i] = quint16(packed[i]);
+            }
+        }
+    }
+
+private:
+    const KoDitherMatrix *m_matrix;
+    KoDitherOpImpl<_SrcCSTraits, _DstCSTraits, swapRedBlue> m_scalarOp;
+};
+
+#endif // KOOPTIMIZEDDITHEROP_H
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoOptimizedDitherOpFactoryPerArch.h" // vc.h must come first
+#include "KoOptimizedDitherOpFactory.h"
+
+#include "KoColorModelStandardIds.h"
+#include "KoColorSpaceTraits.h"
+
+#if defined(__clang__)
+#pragma GCC diagnostic ignored "-Wundef"
+#endif
+
+
+bool KoOptimizedDitherOpFactory::isSupported(const KoID &colorModelId, const KoID &srcColorDepthId)
+{
+    return (colorModelId == RGBAColorModelID || colorModelId == GrayAColorModelID) &&
+        (srcColorDepthId == Integer16BitsColorDepthID || srcColorDepthId == Float32BitsColorDepthID);
+}
+
+KoDitherOp* KoOptimizedDitherOpFactory::createDitherOp(const KoID &colorModelId,
+                                                       const KoID &srcColorDepthId,
+                                                       const KoDitherMatrix *matrix)
+{
+    if (!isSupported(colorModelId, srcColorDepthId)) return 0;
+
+    const bool isRgb = colorModelId == RGBAColorModelID;
+    const bool isInteger = srcColorDepthId == Integer16BitsColorDepthID;
+
+    if (isRgb) {
+        return isInteger ?
+            createOptimizedClass<KoOptimizedDitherOpFactoryPerArch<KoBgrU16Traits, KoBgrU8Traits, false>>(matrix) :
+            createOptimizedClass<KoOptimizedDitherOpFactoryPerArch<KoRgbF32Traits, KoBgrU8Traits, true>>(matrix);
+    } else {
+        return isInteger ?
+            createOptimizedClass<KoOptimizedDitherOpFactoryPerArch<KoGrayU16Traits, KoGrayU8Traits, false>>(matrix) :
+            createOptimizedClass<KoOptimizedDitherOpFactoryPerArch<KoGrayF32Traits, KoGrayU8Traits, false>>(matrix);
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDDITHEROPFACTORY_H
+#define KOOPTIMIZEDDITHEROPFACTORY_H
+
+#include "kritapigment_export.h"
+
+class KoID;
+class KoDitherOp;
+class KoDitherMatrix;
+
+/**
+ * Creates vectorized versions of KoDitherOp. The implementation is
+ * selected at runtime, like it is done for composite ops (see
+ * KoOptimizedCompositeOpFactory).
+ *
+ * The supported conversions are RGBA and GrayA from U16 and F32
+ * into U8 of the same color model.
+ */
+class KRITAPIGMENT_EXPORT KoOptimizedDitherOpFactory
+{
+public:
+    /**
+     * Returns true if there is a dither op converting pixels of
+     * \p colorModelId and \p srcColorDepthId into 8-bit pixels of the
+     * same color model
+     */
+    static bool isSupported(const KoID &colorModelId, const KoID &srcColorDepthId);
+
+    /**
+     * Returns a new dither op or null if the conversion is not supported
+     */
+    static KoDitherOp* createDitherOp(const KoID &colorModelId,
+                                      const KoID &srcColorDepthId,
+                                      const KoDitherMatrix *matrix);
+};
+
+#endif /* KOOPTIMIZEDDITHEROPFACTORY_H */
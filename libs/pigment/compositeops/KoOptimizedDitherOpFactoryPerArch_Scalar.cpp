@@ -0,0 +1,38 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoOptimizedDitherOpFactoryPerArch.h"
+
+#include "KoDitherOpImpl.h"
+
+#include "KoColorSpaceTraits.h"
+
+#define DECLARE_DITHER_OP_FOR_TRAITS(_SrcTraits, _DstTraits, _swapRedBlue)       \
+template<>                                                                      \
+template<>                                                                      \
+KoOptimizedDitherOpFactoryPerArch<_SrcTraits, _DstTraits, _swapRedBlue>::ReturnType \
+KoOptimizedDitherOpFactoryPerArch<_SrcTraits, _DstTraits, _swapRedBlue>::create<Vc::ScalarImpl>(ParamType matrix) \
+{                                                                               \
+    return new KoDitherOpImpl<_SrcTraits, _DstTraits, _swapRedBlue>(matrix);    \
+}
+
+DECLARE_DITHER_OP_FOR_TRAITS(KoBgrU16Traits, KoBgrU8Traits, false)
+DECLARE_DITHER_OP_FOR_TRAITS(KoRgbF32Traits, KoBgrU8Traits, true)
+DECLARE_DITHER_OP_FOR_TRAITS(KoGrayU16Traits, KoGrayU8Traits, false)
+DECLARE_DITHER_OP_FOR_TRAITS(KoGrayF32Traits, KoGrayU8Traits, false)
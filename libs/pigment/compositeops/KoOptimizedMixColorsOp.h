@@ -0,0 +1,184 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOP_H
+#define KOOPTIMIZEDMIXCOLORSOP_H
+
+#include "KoMixColorsOp.h"
+#include "KoOptimizedPixelFetcher.h"
+
+/**
+ * A vectorized version of KoMixColorsOpImpl for color spaces with four
+ * channels and alpha at the last position (RGBA U8, U16 and F32).
+ *
+ * The pixels are processed in chunks of Vc::float_v::size() items, every
+ * channel having its own vector of partial sums. The partial sums are
+ * reduced in the end, the rest of the pixels is processed in scalar.
+ *
+ * The sums are calculated in single precision and the result is rounded
+ * to the nearest integer (the scalar version truncates it), so the
+ * results may differ from KoMixColorsOpImpl by one.
+ */
+template<Vc::Implementation _impl, class _CSTrait>
+class KoOptimizedMixColorsOp : public KoMixColorsOp
+{
+    typedef typename _CSTrait::channels_type channels_type;
+    typedef KoOptimizedPixelFetcher<_impl, _CSTrait::pixelSize> Fetcher;
+
+    static_assert(_CSTrait::channels_nb == 4 && _CSTrait::alpha_pos == 3,
+                  "KoOptimizedMixColorsOp supports only four-channel color spaces with alpha at the end");
+
+public:
+    void mixColors(const quint8 * const* colors, const qint16 *weights, quint32 nColors, quint8 *dst) const override {
+        mixColorsImpl(ArrayOfPointers(colors), weights, nColors, dst);
+    }
+
+    void mixColors(const quint8 *colors, const qint16 *weights, quint32 nColors, quint8 *dst) const override {
+        mixColorsImpl(PointerToArray(colors), weights, nColors, dst);
+    }
+
+    void mixColors(const quint8 * const* colors, quint32 nColors, quint8 *dst) const override {
+        mixColorsImpl(ArrayOfPointers(colors), 0, nColors, dst);
+    }
+
+    void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const override {
+        mixColorsImpl(PointerToArray(colors), 0, nColors, dst);
+    }
+
+private:
+    struct ArrayOfPointers {
+        ArrayOfPointers(const quint8 * const* colors)
+            : m_colors(colors)
+        {
+        }
+
+        /**
+         * Returns a pointer to \p numPixels packed pixels, copying them
+         * into \p buffer if needed
+         */
+        const quint8* fetchChunk(int numPixels, quint8 *buffer) {
+            for (int i = 0; i < numPixels; i++) {
+                KoStreamedMathFunctions::copyPixel<_CSTrait::pixelSize>(m_colors[i], buffer + i * _CSTrait::pixelSize);
+            }
+            m_colors += numPixels;
+            return buffer;
+        }
+
+        const quint8* fetchPixel() {
+            return *m_colors++;
+        }
+
+    private:
+        const quint8 * const * m_colors;
+    };
+
+    struct PointerToArray {
+        PointerToArray(const quint8 *colors)
+            : m_colors(colors)
+        {
+        }
+
+        const quint8* fetchChunk(int numPixels, quint8 *buffer) {
+            Q_UNUSED(buffer);
+            const quint8 *result = m_colors;
+            m_colors += numPixels * _CSTrait::pixelSize;
+            return result;
+        }
+
+        const quint8* fetchPixel() {
+            const quint8 *result = m_colors;
+            m_colors += _CSTrait::pixelSize;
+            return result;
+        }
+
+    private:
+        const quint8 *m_colors;
+    };
+
+    template<class AbstractSource>
+    void mixColorsImpl(AbstractSource source, const qint16 *weights, quint32 nColors, quint8 *dst) const {
+        using Vc::float_v;
+
+        const int vectorSize = float_v::size();
+        Vc::Memory<float_v, float_v::size()> weightsChunk;
+        quint8 buffer[float_v::size() * _CSTrait::pixelSize];
+
+        float_v totalC0(Vc::Zero);
+        float_v totalC1(Vc::Zero);
+        float_v totalC2(Vc::Zero);
+        float_v totalAlphaV(Vc::Zero);
+
+        quint32 i = 0;
+
+        for (; i + vectorSize <= nColors; i += vectorSize) {
+            float_v c0, c1, c2, alpha;
+            Fetcher::fetch(source.fetchChunk(vectorSize, buffer), c0, c1, c2, alpha);
+
+            if (weights) {
+                for (int j = 0; j < vectorSize; j++) {
+                    weightsChunk[j] = weights[j];
+                }
+                weights += vectorSize;
+                alpha *= weightsChunk.vector(0);
+            }
+
+            totalC0 += c0 * alpha;
+            totalC1 += c1 * alpha;
+            totalC2 += c2 * alpha;
+            totalAlphaV += alpha;
+        }
+
+        float totals[3] = {totalC0.sum(), totalC1.sum(), totalC2.sum()};
+        float totalAlpha = totalAlphaV.sum();
+
+        for (; i < nColors; i++) {
+            const channels_type *color = _CSTrait::nativeArray(source.fetchPixel());
+
+            float alphaTimesWeight = color[_CSTrait::alpha_pos];
+            if (weights) {
+                alphaTimesWeight *= *weights++;
+            }
+
+            for (int ch = 0; ch < 3; ch++) {
+                totals[ch] += color[ch] * alphaTimesWeight;
+            }
+            totalAlpha += alphaTimesWeight;
+        }
+
+        const float sumOfWeights = weights ? 255 : nColors;
+        const float unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
+
+        if (totalAlpha > unitValue * sumOfWeights) {
+            totalAlpha = unitValue * sumOfWeights;
+        }
+
+        channels_type *dstColor = _CSTrait::nativeArray(dst);
+
+        if (totalAlpha > 0) {
+            for (int ch = 0; ch < 3; ch++) {
+                dstColor[ch] = koOptimizedStoreChannel<channels_type>(totals[ch] / totalAlpha);
+            }
+            dstColor[_CSTrait::alpha_pos] = koOptimizedStoreChannel<channels_type>(totalAlpha / sumOfWeights);
+        } else {
+            memset(dst, 0, _CSTrait::pixelSize);
+        }
+    }
+};
+
+#endif /* KOOPTIMIZEDMIXCOLORSOP_H */
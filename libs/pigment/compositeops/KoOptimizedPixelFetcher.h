@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDPIXELFETCHER_H
+#define KOOPTIMIZEDPIXELFETCHER_H
+
+#include "KoCompositeOp.h"
+#include "KoStreamedMath.h"
+#include "KoColorSpaceMaths.h"
+
+/**
+ * Fetches Vc::float_v::size() pixels of four channels from a packed
+ * array into four vectors. The channels are returned in the order they
+ * are stored in memory, the values are not normalized.
+ *
+ * Used by the vectorized versions of KoMixColorsOp and KoConvolutionOp,
+ * so \p data need not be aligned.
+ */
+template<Vc::Implementation _impl, int pixelSize>
+struct KoOptimizedPixelFetcher;
+
+template<Vc::Implementation _impl>
+struct KoOptimizedPixelFetcher<_impl, 4>
+{
+    static ALWAYS_INLINE void fetch(const quint8 *data,
+                                    Vc::float_v &c0, Vc::float_v &c1,
+                                    Vc::float_v &c2, Vc::float_v &c3) {
+        // fetch_colors_32() returns the channels starting from the most
+        // significant byte
+        KoStreamedMath<_impl>::template fetch_colors_32<false>(data, c2, c1, c0);
+        c3 = KoStreamedMath<_impl>::template fetch_alpha_32<false>(data);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct KoOptimizedPixelFetcher<_impl, 8>
+{
+    static ALWAYS_INLINE void fetch(const quint8 *data,
+                                    Vc::float_v &c0, Vc::float_v &c1,
+                                    Vc::float_v &c2, Vc::float_v &c3) {
+        KoStreamedMath<_impl>::fetch_channels_64(data, c0, c1, c2, c3);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct KoOptimizedPixelFetcher<_impl, 16>
+{
+    struct Pixel {
+        float c0;
+        float c1;
+        float c2;
+        float c3;
+    };
+
+    static ALWAYS_INLINE void fetch(const quint8 *data,
+                                    Vc::float_v &c0, Vc::float_v &c1,
+                                    Vc::float_v &c2, Vc::float_v &c3) {
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> pixels(reinterpret_cast<Pixel*>(const_cast<quint8*>(data)));
+        tie(c0, c1, c2, c3) = pixels[indexes];
+    }
+};
+
+/**
+ * Converts a float value into a channel value: integer channels
+ * are rounded and clamped, float channels are stored as they are.
+ */
+template<typename channels_type>
+ALWAYS_INLINE channels_type koOptimizedStoreChannel(float value)
+{
+    const float minValue = KoColorSpaceMathsTraits<channels_type>::min;
+    const float maxValue = KoColorSpaceMathsTraits<channels_type>::max;
+    return channels_type(qBound(minValue, value, maxValue) + 0.5f);
+}
+
+template<>
+ALWAYS_INLINE float koOptimizedStoreChannel<float>(float value)
+{
+    return value;
+}
+
+#endif /* KOOPTIMIZEDPIXELFETCHER_H */
@@ -0,0 +1,58 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoOptimizedPixelOpsFactoryPerArch.h" // vc.h must come first
+#include "KoOptimizedPixelOpsFactory.h"
+
+#include "KoColorSpaceTraits.h"
+
+#if defined(__clang__)
+#pragma GCC diagnostic ignored "-Wundef"
+#endif
+
+
+KoMixColorsOp* KoOptimizedPixelOpsFactory::createMixColorsOpU8()
+{
+    return createOptimizedClass<KoOptimizedMixColorsOpFactoryPerArch<KoBgrU8Traits>>(0);
+}
+
+KoMixColorsOp* KoOptimizedPixelOpsFactory::createMixColorsOpU16()
+{
+    return createOptimizedClass<KoOptimizedMixColorsOpFactoryPerArch<KoBgrU16Traits>>(0);
+}
+
+KoMixColorsOp* KoOptimizedPixelOpsFactory::createMixColorsOpF32()
+{
+    return createOptimizedClass<KoOptimizedMixColorsOpFactoryPerArch<KoRgbF32Traits>>(0);
+}
+
+KoConvolutionOp* KoOptimizedPixelOpsFactory::createConvolutionOpU8()
+{
+    return createOptimizedClass<KoOptimizedConvolutionOpFactoryPerArch<KoBgrU8Traits>>(0);
+}
+
+KoConvolutionOp* KoOptimizedPixelOpsFactory::createConvolutionOpU16()
+{
+    return createOptimizedClass<KoOptimizedConvolutionOpFactoryPerArch<KoBgrU16Traits>>(0);
+}
+
+KoConvolutionOp* KoOptimizedPixelOpsFactory::createConvolutionOpF32()
+{
+    return createOptimizedClass<KoOptimizedConvolutionOpFactoryPerArch<KoRgbF32Traits>>(0);
+}
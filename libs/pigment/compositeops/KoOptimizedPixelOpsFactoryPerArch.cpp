@@ -0,0 +1,53 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#if !defined _MSC_VER
+#pragma GCC diagnostic ignored "-Wundef"
+#endif
+
+#include "KoOptimizedPixelOpsFactoryPerArch.h"
+#include "KoOptimizedMixColorsOp.h"
+#include "KoOptimizedConvolutionOp.h"
+
+#include "KoColorSpaceTraits.h"
+
+#if defined(__clang__)
+#pragma GCC diagnostic ignored "-Wlocal-type-template-args"
+#endif
+
+#define DECLARE_PIXEL_OPS_FOR_TRAITS(_Traits)                                   \
+template<>                                                                      \
+template<>                                                                      \
+KoOptimizedMixColorsOpFactoryPerArch<_Traits>::ReturnType                       \
+KoOptimizedMixColorsOpFactoryPerArch<_Traits>::create<Vc::CurrentImplementation::current()>(ParamType) \
+{                                                                               \
+    return new KoOptimizedMixColorsOp<Vc::CurrentImplementation::current(), _Traits>(); \
+}                                                                               \
+                                                                                \
+template<>                                                                      \
+template<>                                                                      \
+KoOptimizedConvolutionOpFactoryPerArch<_Traits>::ReturnType                     \
+KoOptimizedConvolutionOpFactoryPerArch<_Traits>::create<Vc::CurrentImplementation::current()>(ParamType) \
+{                                                                               \
+    return new KoOptimizedConvolutionOp<Vc::CurrentImplementation::current(), _Traits>(); \
+}
+
+DECLARE_PIXEL_OPS_FOR_TRAITS(KoBgrU8Traits)
+DECLARE_PIXEL_OPS_FOR_TRAITS(KoBgrU16Traits)
+DECLARE_PIXEL_OPS_FOR_TRAITS(KoRgbF32Traits)
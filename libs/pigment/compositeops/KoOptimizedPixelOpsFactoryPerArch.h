@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDPIXELOPSFACTORYPERARCH_H
+#define KOOPTIMIZEDPIXELOPSFACTORYPERARCH_H
+
+#include <compositeops/KoVcMultiArchBuildSupport.h>
+
+class KoMixColorsOp;
+class KoConvolutionOp;
+
+template<class _CSTrait>
+struct KoOptimizedMixColorsOpFactoryPerArch
+{
+    typedef void* ParamType;
+    typedef KoMixColorsOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType);
+};
+
+template<class _CSTrait>
+struct KoOptimizedConvolutionOpFactoryPerArch
+{
+    typedef void* ParamType;
+    typedef KoConvolutionOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType);
+};
+
+#endif /* KOOPTIMIZEDPIXELOPSFACTORYPERARCH_H */
@@ -0,0 +1,46 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoOptimizedPixelOpsFactoryPerArch.h"
+
+#include "KoMixColorsOpImpl.h"
+#include "KoConvolutionOpImpl.h"
+
+#include "KoColorSpaceTraits.h"
+
+#define DECLARE_PIXEL_OPS_FOR_TRAITS(_Traits)                                   \
+template<>                                                                      \
+template<>                                                                      \
+KoOptimizedMixColorsOpFactoryPerArch<_Traits>::ReturnType                       \
+KoOptimizedMixColorsOpFactoryPerArch<_Traits>::create<Vc::ScalarImpl>(ParamType) \
+{                                                                               \
+    return new KoMixColorsOpImpl<_Traits>();                                    \
+}                                                                               \
+                                                                                \
+template<>                                                                      \
+template<>                                                                      \
+KoOptimizedConvolutionOpFactoryPerArch<_Traits>::ReturnType                     \
+KoOptimizedConvolutionOpFactoryPerArch<_Traits>::create<Vc::ScalarImpl>(ParamType) \
+{                                                                               \
+    return new KoConvolutionOpImpl<_Traits>();                                  \
+}
+
+DECLARE_PIXEL_OPS_FOR_TRAITS(KoBgrU8Traits)
+DECLARE_PIXEL_OPS_FOR_TRAITS(KoBgrU16Traits)
+DECLARE_PIXEL_OPS_FOR_TRAITS(KoRgbF32Traits)
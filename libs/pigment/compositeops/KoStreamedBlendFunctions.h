@@ -0,0 +1,244 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KOSTREAMED_BLEND_FUNCTIONS_H
+#define __KOSTREAMED_BLEND_FUNCTIONS_H
+
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+
+#include <cmath>
+#include <algorithm>
+
+/**
+ * Vectorized versions of the separable blending functions defined in
+ * KoCompositeOpFunctions.h, used by KoOptimizedCompositeOpGeneric32
+ * and KoOptimizedCompositeOpGeneric128.
+ *
+ * Every function is a template over the value type, so the same code
+ * is used for a vector of pixels (Vc::float_v) and for the unaligned
+ * pixels at the borders of the row (float). The channel values are
+ * normalized to [0.0, 1.0]. The result is clamped only when
+ * \p clampResult is set, which corresponds to the integer colorspaces.
+ * KoColorSpaceMaths<float>::clamp() does not clamp anything either.
+ */
+namespace KoStreamedBlendFunctions {
+
+ALWAYS_INLINE float select(bool cond, float a, float b) {
+    return cond ? a : b;
+}
+
+ALWAYS_INLINE Vc::float_v select(Vc::float_m cond, Vc::float_v::AsArg a, Vc::float_v::AsArg b) {
+    return Vc::iif(cond, a, b);
+}
+
+ALWAYS_INLINE float min(float a, float b) {
+    return std::min(a, b);
+}
+
+ALWAYS_INLINE Vc::float_v min(Vc::float_v::AsArg a, Vc::float_v::AsArg b) {
+    return Vc::min(a, b);
+}
+
+ALWAYS_INLINE float max(float a, float b) {
+    return std::max(a, b);
+}
+
+ALWAYS_INLINE Vc::float_v max(Vc::float_v::AsArg a, Vc::float_v::AsArg b) {
+    return Vc::max(a, b);
+}
+
+ALWAYS_INLINE float sqrt(float a) {
+    return std::sqrt(a);
+}
+
+ALWAYS_INLINE Vc::float_v sqrt(Vc::float_v::AsArg a) {
+    return Vc::sqrt(a);
+}
+
+template <bool clampResult, class V>
+ALWAYS_INLINE V clampUnit(const V &a) {
+    return clampResult ? max(min(a, V(1.0f)), V(0.0f)) : a;
+}
+
+}
+
+struct KoStreamedBlendMultiply {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return src * dst;
+    }
+};
+
+struct KoStreamedBlendScreen {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return src + dst - src * dst;
+    }
+};
+
+struct KoStreamedBlendHardLight {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        using namespace KoStreamedBlendFunctions;
+
+        const V src2 = src + src;
+        const V screenSrc = src2 - V(1.0f);
+
+        return select(src > V(0.5f),
+                      screenSrc + dst - screenSrc * dst,
+                      src2 * dst);
+    }
+};
+
+struct KoStreamedBlendOverlay {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return KoStreamedBlendHardLight::apply<clampResult>(dst, src);
+    }
+};
+
+/**
+ * The Photoshop version of the Soft Light, see cfSoftLight()
+ */
+struct KoStreamedBlendSoftLight {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        using namespace KoStreamedBlendFunctions;
+
+        const V src2 = src + src;
+
+        return select(src > V(0.5f),
+                      dst + (src2 - V(1.0f)) * (sqrt(dst) - dst),
+                      dst - (V(1.0f) - src2) * dst * (V(1.0f) - dst));
+    }
+};
+
+struct KoStreamedBlendColorDodge {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        using namespace KoStreamedBlendFunctions;
+
+        // the division by zero happens in the discarded lanes only
+        return select(src == V(1.0f),
+                      V(1.0f),
+                      clampUnit<clampResult>(dst / (V(1.0f) - src)));
+    }
+};
+
+struct KoStreamedBlendColorBurn {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        using namespace KoStreamedBlendFunctions;
+
+        const V invDst = V(1.0f) - dst;
+        V result = V(1.0f) - clampUnit<clampResult>(invDst / src);
+
+        result = select(src < invDst, V(0.0f), result);
+        return select(dst == V(1.0f), V(1.0f), result);
+    }
+};
+
+struct KoStreamedBlendAddition {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return KoStreamedBlendFunctions::clampUnit<clampResult>(src + dst);
+    }
+};
+
+struct KoStreamedBlendSubtract {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return KoStreamedBlendFunctions::clampUnit<clampResult>(dst - src);
+    }
+};
+
+struct KoStreamedBlendLinearBurn {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return KoStreamedBlendFunctions::clampUnit<clampResult>(src + dst - V(1.0f));
+    }
+};
+
+struct KoStreamedBlendDarken {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return KoStreamedBlendFunctions::min(src, dst);
+    }
+};
+
+struct KoStreamedBlendLighten {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        return KoStreamedBlendFunctions::max(src, dst);
+    }
+};
+
+struct KoStreamedBlendDifference {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        using namespace KoStreamedBlendFunctions;
+        return max(src, dst) - min(src, dst);
+    }
+};
+
+struct KoStreamedBlendExclusion {
+    template <bool clampResult, class V>
+    static ALWAYS_INLINE V apply(const V &src, const V &dst) {
+        const V x = src * dst;
+        return KoStreamedBlendFunctions::clampUnit<clampResult>(dst + src - (x + x));
+    }
+};
+
+/**
+ * Creates a vectorized composite op for \p params.id, or returns
+ * null if there is no vectorized version of this blending mode
+ */
+template <template<Vc::Implementation, class> class CompositeOp,
+          Vc::Implementation _impl,
+          class Params>
+KoCompositeOp* createStreamedGenericCompositeOp(const Params &params)
+{
+#define KO_STREAMED_BLEND_MODE(modeId, BlendFunction)                   \
+    if (params.id == modeId) {                                          \
+        return new CompositeOp<_impl, BlendFunction>(params.cs, params.id, params.description, params.category); \
+    }
+
+    KO_STREAMED_BLEND_MODE(COMPOSITE_MULT, KoStreamedBlendMultiply);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_SCREEN, KoStreamedBlendScreen);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_OVERLAY, KoStreamedBlendOverlay);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_HARD_LIGHT, KoStreamedBlendHardLight);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_SOFT_LIGHT_PHOTOSHOP, KoStreamedBlendSoftLight);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_DODGE, KoStreamedBlendColorDodge);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_BURN, KoStreamedBlendColorBurn);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_ADD, KoStreamedBlendAddition);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_LINEAR_DODGE, KoStreamedBlendAddition);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_SUBTRACT, KoStreamedBlendSubtract);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_LINEAR_BURN, KoStreamedBlendLinearBurn);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_DARKEN, KoStreamedBlendDarken);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_LIGHTEN, KoStreamedBlendLighten);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_DIFF, KoStreamedBlendDifference);
+    KO_STREAMED_BLEND_MODE(COMPOSITE_EXCLUSION, KoStreamedBlendExclusion);
+
+#undef KO_STREAMED_BLEND_MODE
+
+    return 0;
+}
+
+#endif /* __KOSTREAMED_BLEND_FUNCTIONS_H */
@@ -96,6 +96,12 @@ template<bool useMask, bool useFlow, class Compositor>
     genericComposite_novector<useMask, useFlow, Compositor, 4>(params);
 }
 
+template<bool useMask, bool useFlow, class Compositor>
+    static void genericComposite64_novector(const KoCompositeOp::ParameterInfo& params)
+{
+    genericComposite_novector<useMask, useFlow, Compositor, 8>(params);
+}
+
 template<bool useMask, bool useFlow, class Compositor>
     static void genericComposite128_novector(const KoCompositeOp::ParameterInfo& params)
 {
@@ -208,6 +214,63 @@ static inline void write_channels_32(quint8 *data,
     (v1 | v3).store((quint32*)data, Vc::Aligned);
 }
 
+static inline quint16 round_float_to_u16(float value) {
+    return quint16(value + float(0.5));
+}
+
+/**
+ * Get color and alpha values from Vc::float_v::size() pixels 64-bit each
+ * (4 channels, 16 bit per channel). The channels are returned in the
+ * order they are stored in memory, the values are not normalized.
+ *
+ * Every pixel is fetched as two 32-bit words: C1_C2 and C3_A, so
+ * \p data should be aligned to a 4-byte boundary only.
+ */
+static inline void fetch_channels_64(const quint8 *data,
+                                     Vc::float_v &c1,
+                                     Vc::float_v &c2,
+                                     Vc::float_v &c3,
+                                     Vc::float_v &alpha) {
+    const quint32 *words = reinterpret_cast<const quint32*>(data);
+    const int_v indexes = int_v::IndexesFromZero() * 2;
+
+    const uint_v data_c1c2(words, indexes);
+    const uint_v data_c3a(words + 1, indexes);
+
+    const quint32 lowWordMask = 0xFFFF;
+    uint_v mask(lowWordMask);
+
+    c1 = Vc::simd_cast<Vc::float_v>(int_v(data_c1c2 & mask));
+    c2 = Vc::simd_cast<Vc::float_v>(int_v(data_c1c2 >> 16));
+    c3 = Vc::simd_cast<Vc::float_v>(int_v(data_c3a & mask));
+    alpha = Vc::simd_cast<Vc::float_v>(int_v(data_c3a >> 16));
+}
+
+/**
+ * Pack color and alpha values to Vc::float_v::size() pixels 64-bit each
+ * (4 channels, 16 bit per channel). The values are rounded to the
+ * nearest integer, they are not clamped.
+ */
+static inline void write_channels_64(quint8 *data,
+                                     Vc::float_v::AsArg alpha,
+                                     Vc::float_v::AsArg c1,
+                                     Vc::float_v::AsArg c2,
+                                     Vc::float_v::AsArg c3) {
+    quint32 *words = reinterpret_cast<quint32*>(data);
+    const int_v indexes = int_v::IndexesFromZero() * 2;
+
+    const quint32 lowWordMask = 0xFFFF;
+    uint_v mask(lowWordMask);
+
+    uint_v v1 = uint_v(int_v(Vc::round(c1))) & mask;
+    uint_v v2 = uint_v(int_v(Vc::round(c2))) << 16;
+    uint_v v3 = uint_v(int_v(Vc::round(c3))) & mask;
+    uint_v v4 = uint_v(int_v(Vc::round(alpha))) << 16;
+
+    (v1 | v2).scatter(words, indexes);
+    (v3 | v4).scatter(words + 1, indexes);
+}
+
 /**
  * Composes src pixels into dst pixles. Is optimized for 32-bit-per-pixel
  * colorspaces. Uses \p Compositor strategy parameter for doing actual
@@ -375,6 +438,12 @@ template<bool useMask, bool useFlow, class Compositor>
     genericComposite<useMask, useFlow, Compositor, 4>(params);
 }
 
+template<bool useMask, bool useFlow, class Compositor>
+    static void genericComposite64(const KoCompositeOp::ParameterInfo& params)
+{
+    genericComposite<useMask, useFlow, Compositor, 8>(params);
+}
+
 template<bool useMask, bool useFlow, class Compositor>
     static void genericComposite128(const KoCompositeOp::ParameterInfo& params)
 {
@@ -395,6 +464,13 @@ ALWAYS_INLINE void clearPixel<4>(quint8* dst)
     *d = 0;
 }
 
+template<>
+ALWAYS_INLINE void clearPixel<8>(quint8* dst)
+{
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = 0;
+}
+
 template<>
 ALWAYS_INLINE void clearPixel<16>(quint8* dst)
 {
@@ -414,6 +490,14 @@ ALWAYS_INLINE void copyPixel<4>(const quint8 *src, quint8* dst)
     *d = *s;
 }
 
+template<>
+ALWAYS_INLINE void copyPixel<8>(const quint8 *src, quint8* dst)
+{
+    const quint64 *s = reinterpret_cast<const quint64*>(src);
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = *s;
+}
+
 template<>
 ALWAYS_INLINE void copyPixel<16>(const quint8 *src, quint8* dst)
 {
@@ -62,10 +62,75 @@ namespace Vc {
 
 
 #include <QDebug>
+#include <QByteArray>
 #include <ksharedconfig.h>
 #include <kconfig.h>
 #include <kconfiggroup.h>
 
+namespace KoVcMultiArchBuildSupportPrivate {
+
+/**
+ * Returns the implementation requested by KRITA_VC_IMPLEMENTATION
+ * environment variable. It lets one compare the implementations on the
+ * same hardware, e.g. for benchmarking:
+ *
+ *     KRITA_VC_IMPLEMENTATION=sse4.1 ./KisCompositionBenchmark
+ *
+ * Possible values are: scalar, sse2, ssse3, sse4.1, avx, avx2. Returns
+ * false if the variable is not set or has an unknown value.
+ *
+ * NOTE: there are no separate AVX-512 and NEON implementations, since
+ *       Vc does not support them. AVX-512 CPUs use the AVX2 code, ARM
+ *       builds go without Vc at all (see the top-level CMakeLists.txt).
+ */
+inline bool forcedImplementation(Vc::Implementation *impl)
+{
+    static bool isInitialized = false;
+    static bool isForced = false;
+    static Vc::Implementation forcedImpl = Vc::ScalarImpl;
+
+    if (!isInitialized) {
+        const QByteArray value = qgetenv("KRITA_VC_IMPLEMENTATION").toLower();
+
+        if (!value.isEmpty()) {
+            isForced = true;
+
+            if (value == "scalar") {
+                forcedImpl = Vc::ScalarImpl;
+#ifdef HAVE_VC
+            } else if (value == "sse2") {
+                forcedImpl = Vc::SSE2Impl;
+            } else if (value == "ssse3") {
+                forcedImpl = Vc::SSSE3Impl;
+            } else if (value == "sse4.1" || value == "sse41") {
+                forcedImpl = Vc::SSE41Impl;
+            } else if (value == "avx") {
+                forcedImpl = Vc::AVXImpl;
+            } else if (value == "avx2") {
+                forcedImpl = Vc::AVX2Impl;
+#endif
+            } else {
+                isForced = false;
+                qWarning() << "WARNING: unknown implementation requested by KRITA_VC_IMPLEMENTATION:" << value;
+            }
+
+#ifdef HAVE_VC
+            if (isForced && !Vc::isImplementationSupported(forcedImpl)) {
+                isForced = false;
+                qWarning() << "WARNING: implementation requested by KRITA_VC_IMPLEMENTATION is not supported by the CPU:" << value;
+            }
+#endif
+        }
+
+        isInitialized = true;
+    }
+
+    *impl = forcedImpl;
+    return isForced;
+}
+
+}
+
 template<class FactoryType>
 typename FactoryType::ReturnType
 createOptimizedClass(typename FactoryType::ParamType param)
@@ -81,6 +146,26 @@ createOptimizedClass(typename FactoryType::ParamType param)
         isConfigInitialized = true;
     }
 
+    Vc::Implementation forcedImpl;
+    if (KoVcMultiArchBuildSupportPrivate::forcedImplementation(&forcedImpl)) {
+        switch (forcedImpl) {
+#ifdef HAVE_VC
+        case Vc::AVX2Impl:
+            return FactoryType::template create<Vc::AVX2Impl>(param);
+        case Vc::AVXImpl:
+            return FactoryType::template create<Vc::AVXImpl>(param);
+        case Vc::SSE41Impl:
+            return FactoryType::template create<Vc::SSE41Impl>(param);
+        case Vc::SSSE3Impl:
+            return FactoryType::template create<Vc::SSSE3Impl>(param);
+        case Vc::SSE2Impl:
+            return FactoryType::template create<Vc::SSE2Impl>(param);
+#endif
+        default:
+            return FactoryType::template create<Vc::ScalarImpl>(param);
+        }
+    }
+
     if (!useVectorization) {
         qWarning() << "WARNING: vector instructions disabled by \'amdDisableVectorWorkaround\' option!";
         return FactoryType::template create<Vc::ScalarImpl>(param);
@@ -97,6 +182,8 @@ createOptimizedClass(typename FactoryType::ParamType param)
     /**
      * We use SSE2, SSSE3, SSE4.1, AVX and AVX2.
      * The rest are integer and string instructions mostly.
+     * AVX-512 CPUs report AVX2 support, so they take the
+     * AVX2 path.
      *
      * TODO: Add FMA3/4 when it is adopted by Vc
      */
@@ -20,11 +20,14 @@
 #include "TestColorConversionSystem.h"
 
 #include <QTest>
+#include <QThread>
+#include <QSemaphore>
 
 #include <DebugPigment.h>
 #include <KoColorProfile.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorConversionSystem.h>
+#include <KoColorConversionCache.h>
 #include <KoColorModelStandardIds.h>
 #include <sdk/tests/kistest.h>
 
@@ -187,6 +190,99 @@ void TestColorConversionSystem::testAlphaU16Conversions()
     }
 }
 
+namespace {
+
+const KoColorConversionTransformation* cachedTransformation(KoColorConversionCache *cache,
+                                                            const KoColorSpace *src,
+                                                            const KoColorSpace *dst)
+{
+    /**
+     * The transformation stays alive after the handle is destroyed,
+     * because the thread-local cache of the calling thread keeps it
+     */
+    KoCachedColorConversionTransformation cct =
+        cache->cachedConverter(src, dst,
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               KoColorConversionTransformation::internalConversionFlags());
+    return cct.transformation();
+}
+
+/**
+ * Fetches the transformation twice in the same thread, the main
+ * thread may invalidate the cache in between
+ */
+class CachedConverterThread : public QThread
+{
+public:
+    CachedConverterThread(KoColorConversionCache *cache, const KoColorSpace *src, const KoColorSpace *dst)
+        : m_cache(cache), m_src(src), m_dst(dst)
+    {
+    }
+
+    void run() override {
+        firstTransformation = cachedTransformation(m_cache, m_src, m_dst);
+        fetched.release();
+
+        proceed.acquire();
+        secondTransformation = cachedTransformation(m_cache, m_src, m_dst);
+    }
+
+    QSemaphore fetched;
+    QSemaphore proceed;
+
+    const KoColorConversionTransformation *firstTransformation = 0;
+    const KoColorConversionTransformation *secondTransformation = 0;
+
+private:
+    KoColorConversionCache *m_cache;
+    const KoColorSpace *m_src;
+    const KoColorSpace *m_dst;
+};
+
+}
+
+void TestColorConversionSystem::testCachedConverterInvalidation()
+{
+    const KoColorSpace *src = KoColorSpaceRegistry::instance()->rgb16();
+    const KoColorSpace *dst = KoColorSpaceRegistry::instance()->rgb8();
+
+    KoColorConversionCache cache;
+
+    const KoColorConversionTransformation *mainTransformation = cachedTransformation(&cache, src, dst);
+    QVERIFY(mainTransformation);
+
+    // the repeated request is served from the thread-local cache
+    QCOMPARE(cachedTransformation(&cache, src, dst), mainTransformation);
+
+    CachedConverterThread thread(&cache, src, dst);
+    thread.start();
+    thread.fetched.acquire();
+
+    // the transformation is owned by the main thread, so the other one creates its own copy
+    QVERIFY(thread.firstTransformation);
+    QVERIFY(thread.firstTransformation != mainTransformation);
+
+    /**
+     * The color space is not really deleted, the transformations
+     * are just dropped as if it were. The copy of the other thread is
+     * still referenced by its thread-local cache, so it stays alive
+     * and its address cannot be reused.
+     */
+    cache.colorSpaceIsDestroyed(src);
+
+    thread.proceed.release();
+    QVERIFY(thread.wait(10000));
+
+    QVERIFY(thread.secondTransformation);
+    QVERIFY(thread.secondTransformation != thread.firstTransformation);
+    QCOMPARE(thread.secondTransformation->srcColorSpace(), src);
+
+    const KoColorConversionTransformation *newMainTransformation = cachedTransformation(&cache, src, dst);
+    QVERIFY(newMainTransformation);
+    QVERIFY(newMainTransformation != thread.firstTransformation);
+    QCOMPARE(newMainTransformation->srcColorSpace(), src);
+}
+
 void TestColorConversionSystem::benchmarkAlphaToRgbConversion()
 {
     const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
@@ -43,6 +43,7 @@ private Q_SLOTS:
     void testGoodConnections();
     void testAlphaConversions();
     void testAlphaU16Conversions();
+    void testCachedConverterInvalidation();
     void benchmarkAlphaToRgbConversion();
     void benchmarkRgbToAlphaConversion();
 private:
@@ -24,6 +24,7 @@
 #include "../KoColorSpaceAbstract.h"
 #include "../KoColorSpaceTraits.h"
 #include "../DebugPigment.h"
+#include "../compositeops/KoOptimizedPixelOpsFactory.h"
 
 void TestConvolutionOpImpl::testConvolutionOpImpl()
 {
@@ -217,5 +218,71 @@ void TestConvolutionOpImpl::testOneFullyTransparent()
     }
 }
 
+template <class Traits>
+void compareConvolutionOps(KoConvolutionOp *optimizedOp, qreal tolerance)
+{
+    typedef typename Traits::channels_type channels_type;
+    const qreal unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
+
+    QScopedPointer<KoConvolutionOp> op(optimizedOp);
+    KoConvolutionOpImpl<Traits> refOp;
+
+    const int counts[] = {4, 9, 25, 49};
+
+    for (int numPixels : counts) {
+        QVector<channels_type> pixels(numPixels * Traits::channels_nb);
+        QVector<const quint8*> colors(numPixels);
+        QVector<qreal> kernel(numPixels);
+
+        for (int i = 0; i < pixels.size(); i++) {
+            pixels[i] = channels_type(unitValue * qrand() / RAND_MAX);
+        }
+
+        qreal factor = 0;
+        for (int i = 0; i < numPixels; i++) {
+            colors[i] = reinterpret_cast<const quint8*>(pixels.constData() + i * Traits::channels_nb);
+            kernel[i] = 1 + i % 3;
+            factor += kernel[i];
+        }
+
+        for (int transparentStep = 0; transparentStep < 3; transparentStep++) {
+            // 0: no transparent pixels (case A), 1: case B, 2: case C
+            if (transparentStep > 0) {
+                for (int i = 0; i < numPixels; i += 3) {
+                    pixels[i * Traits::channels_nb + Traits::alpha_pos] = 0;
+                }
+            }
+
+            const qreal usedFactor = transparentStep == 2 ? 2 * factor : factor;
+
+            channels_type expected[Traits::channels_nb];
+            channels_type result[Traits::channels_nb];
+            memset(expected, 0, sizeof(expected));
+            memset(result, 0, sizeof(result));
+
+            refOp.convolveColors(colors.constData(), kernel.constData(), reinterpret_cast<quint8*>(expected),
+                                 usedFactor, 0, numPixels, QBitArray());
+            op->convolveColors(colors.constData(), kernel.constData(), reinterpret_cast<quint8*>(result),
+                               usedFactor, 0, numPixels, QBitArray());
+
+            for (int ch = 0; ch < (int)Traits::channels_nb; ch++) {
+                if (qAbs(qreal(expected[ch]) - qreal(result[ch])) > tolerance) {
+                    QFAIL(QString("Convolution results differ: pixels %1, case %2, channel %3, expected %4, result %5")
+                          .arg(numPixels).arg(transparentStep).arg(ch)
+                          .arg(qreal(expected[ch])).arg(qreal(result[ch])).toLatin1());
+                }
+            }
+        }
+    }
+}
+
+void TestConvolutionOpImpl::testOptimizedConvolutionOp()
+{
+    qsrand(1);
+
+    compareConvolutionOps<KoBgrU8Traits>(KoOptimizedPixelOpsFactory::createConvolutionOpU8(), 1);
+    compareConvolutionOps<KoBgrU16Traits>(KoOptimizedPixelOpsFactory::createConvolutionOpU16(), 1);
+    compareConvolutionOps<KoRgbF32Traits>(KoOptimizedPixelOpsFactory::createConvolutionOpF32(), 1e-5);
+}
 
 QTEST_GUILESS_MAIN(TestConvolutionOpImpl)
@@ -2,6 +2,7 @@
 
 #include "KoColorSpaceAbstract.h"
 #include "KoColorSpaceTraits.h"
+#include "KoOptimizedPixelOpsFactory.h"
 
 #include <cfloat>
 
@@ -385,5 +386,94 @@ void TestKoColorSpaceAbstract::testMixColorsOpU8NoAlphaLinear()
     QCOMPARE(outputPixel[COLOR_CHANNEL_2], mixOpNoAlphaExpectedColor(pixel1[COLOR_CHANNEL_2], pixel2[COLOR_CHANNEL_2], weights));
 }
 
+template <class Traits>
+void fillRandomPixels(QVector<typename Traits::channels_type> &pixels, int numPixels)
+{
+    typedef typename Traits::channels_type channels_type;
+    const qreal unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
+
+    pixels.resize(numPixels * Traits::channels_nb);
+
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = channels_type(unitValue * qrand() / RAND_MAX);
+    }
+
+    // make some of the pixels fully transparent
+    for (int i = 0; i < numPixels; i += 5) {
+        pixels[i * Traits::channels_nb + Traits::alpha_pos] = 0;
+    }
+}
+
+template <class Traits>
+void compareMixColorsOps(KoMixColorsOp *optimizedOp, qreal tolerance)
+{
+    typedef typename Traits::channels_type channels_type;
+
+    QScopedPointer<KoMixColorsOp> op(optimizedOp);
+    KoMixColorsOpImpl<Traits> refOp;
+
+    const int counts[] = {1, 4, 9, 25, 49};
+
+    for (int numPixels : counts) {
+        QVector<channels_type> pixels;
+        fillRandomPixels<Traits>(pixels, numPixels);
+
+        QVector<const quint8*> pixelPtrs(numPixels);
+        QVector<qint16> weights(numPixels);
+
+        int sumOfWeights = 0;
+        for (int i = 0; i < numPixels; i++) {
+            pixelPtrs[i] = reinterpret_cast<const quint8*>(pixels.constData() + i * Traits::channels_nb);
+            weights[i] = 255 / numPixels;
+            sumOfWeights += weights[i];
+        }
+        weights[0] += 255 - sumOfWeights;
+
+        channels_type expected[Traits::channels_nb];
+        channels_type result[Traits::channels_nb];
+
+        for (int mode = 0; mode < 4; mode++) {
+            const quint8 *array = reinterpret_cast<const quint8*>(pixels.constData());
+            quint8 *expectedPtr = reinterpret_cast<quint8*>(expected);
+            quint8 *resultPtr = reinterpret_cast<quint8*>(result);
+
+            switch (mode) {
+            case 0:
+                refOp.mixColors(pixelPtrs.constData(), weights.constData(), numPixels, expectedPtr);
+                op->mixColors(pixelPtrs.constData(), weights.constData(), numPixels, resultPtr);
+                break;
+            case 1:
+                refOp.mixColors(array, weights.constData(), numPixels, expectedPtr);
+                op->mixColors(array, weights.constData(), numPixels, resultPtr);
+                break;
+            case 2:
+                refOp.mixColors(pixelPtrs.constData(), numPixels, expectedPtr);
+                op->mixColors(pixelPtrs.constData(), numPixels, resultPtr);
+                break;
+            case 3:
+                refOp.mixColors(array, numPixels, expectedPtr);
+                op->mixColors(array, numPixels, resultPtr);
+                break;
+            }
+
+            for (int ch = 0; ch < (int)Traits::channels_nb; ch++) {
+                if (qAbs(qreal(expected[ch]) - qreal(result[ch])) > tolerance) {
+                    QFAIL(QString("Mixed colors differ: pixels %1, mode %2, channel %3, expected %4, result %5")
+                          .arg(numPixels).arg(mode).arg(ch)
+                          .arg(qreal(expected[ch])).arg(qreal(result[ch])).toLatin1());
+                }
+            }
+        }
+    }
+}
+
+void TestKoColorSpaceAbstract::testOptimizedMixColorsOp()
+{
+    qsrand(1);
+
+    compareMixColorsOps<KoBgrU8Traits>(KoOptimizedPixelOpsFactory::createMixColorsOpU8(), 1);
+    compareMixColorsOps<KoBgrU16Traits>(KoOptimizedPixelOpsFactory::createMixColorsOpU16(), 1);
+    compareMixColorsOps<KoRgbF32Traits>(KoOptimizedPixelOpsFactory::createMixColorsOpF32(), 1e-5);
+}
 
 QTEST_GUILESS_MAIN(TestKoColorSpaceAbstract)
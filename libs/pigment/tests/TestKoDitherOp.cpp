@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoDitherOp.h"
+
+#include <QTest>
+#include <QScopedPointer>
+
+#include <algorithm>
+
+#include "../KoColorModelStandardIds.h"
+#include "../KoColorSpaceTraits.h"
+#include "../KoDitherMatrix.h"
+#include "../KoDitherOpImpl.h"
+#include "../compositeops/KoOptimizedDitherOpFactory.h"
+
+void TestKoDitherOp::testMatrices()
+{
+    const int size = KoDitherMatrix::size();
+    const KoDitherMatrix::Type types[] = {KoDitherMatrix::Ordered, KoDitherMatrix::BlueNoise};
+
+    for (KoDitherMatrix::Type type : types) {
+        const KoDitherMatrix *matrix = KoDitherMatrix::instance(type);
+        QCOMPARE(matrix->type(), type);
+
+        QVector<float> thresholds;
+
+        for (int y = 0; y < size; y++) {
+            const float *row = matrix->row(y);
+
+            for (int x = 0; x < size; x++) {
+                QCOMPARE(row[x], row[x + size]);
+                QCOMPARE(matrix->threshold(x - size, y + size), row[x]);
+                thresholds << row[x];
+            }
+        }
+
+        // every threshold of the uniform distribution is present exactly once
+        std::sort(thresholds.begin(), thresholds.end());
+
+        for (int i = 0; i < thresholds.size(); i++) {
+            QCOMPARE(thresholds[i], (i + 0.5f) / thresholds.size());
+        }
+    }
+}
+
+void TestKoDitherOp::testExactValues()
+{
+    KoDitherOpImpl<KoBgrU16Traits, KoBgrU8Traits, false> op(KoDitherMatrix::instance(KoDitherMatrix::BlueNoise));
+
+    QVector<quint16> src(256 * 4);
+    QVector<quint8> dst(256 * 4);
+
+    for (int i = 0; i < 256; i++) {
+        for (int channel = 0; channel < 4; channel++) {
+            src[4 * i + channel] = quint16((i + channel) % 256 * 257);
+        }
+    }
+
+    for (int y = 0; y < KoDitherMatrix::size(); y++) {
+        op.dither(reinterpret_cast<const quint8*>(src.constData()), dst.data(), 256, 0, y);
+
+        for (int i = 0; i < 256; i++) {
+            for (int channel = 0; channel < 4; channel++) {
+                QCOMPARE(int(dst[4 * i + channel]), (i + channel) % 256);
+            }
+        }
+    }
+}
+
+void TestKoDitherOp::testAverageColor()
+{
+    const int size = KoDitherMatrix::size();
+    const KoDitherMatrix::Type types[] = {KoDitherMatrix::Ordered, KoDitherMatrix::BlueNoise};
+    const quint16 values[] = {1000, 12345, 40000, 65000};
+
+    for (KoDitherMatrix::Type type : types) {
+        KoDitherOpImpl<KoGrayU16Traits, KoGrayU8Traits, false> op(KoDitherMatrix::instance(type));
+
+        for (quint16 value : values) {
+            QVector<quint16> src(size * 2, value);
+            QVector<quint8> dst(size * 2);
+
+            qreal sum = 0;
+
+            for (int y = 0; y < size; y++) {
+                op.dither(reinterpret_cast<const quint8*>(src.constData()), dst.data(), size, 7, y);
+
+                for (int x = 0; x < size; x++) {
+                    sum += dst[2 * x];
+                }
+            }
+
+            const qreal average = sum / (size * size);
+            const qreal expected = value / 257.0;
+
+            if (qAbs(average - expected) > 0.01) {
+                qDebug() << "Type" << type << "value" << value;
+                QCOMPARE(average, expected);
+            }
+        }
+    }
+}
+
+template<class SrcTraits>
+void fillRandomPixels(QVector<quint8> &data, int numPixels)
+{
+    typedef typename SrcTraits::channels_type channels_type;
+
+    data.resize(numPixels * SrcTraits::pixelSize);
+    channels_type *pixels = SrcTraits::nativeArray(data.data());
+
+    for (int i = 0; i < numPixels * int(SrcTraits::channels_nb); i++) {
+        pixels[i] = KoColorSpaceMaths<float, channels_type>::scaleToA(float(qrand()) / RAND_MAX);
+    }
+}
+
+template<class SrcTraits, class DstTraits, bool swapRedBlue>
+void compareDitherOps(const KoID &colorModelId, const KoID &srcColorDepthId)
+{
+    const int numPixels = 301;
+    const KoDitherMatrix *matrix = KoDitherMatrix::instance(KoDitherMatrix::BlueNoise);
+
+    QScopedPointer<KoDitherOp> optimizedOp(KoOptimizedDitherOpFactory::createDitherOp(colorModelId, srcColorDepthId, matrix));
+    QVERIFY(optimizedOp);
+
+    KoDitherOpImpl<SrcTraits, DstTraits, swapRedBlue> scalarOp(matrix);
+
+    QVector<quint8> src;
+    fillRandomPixels<SrcTraits>(src, numPixels);
+
+    QVector<quint8> scalarDst(numPixels * DstTraits::pixelSize);
+    QVector<quint8> optimizedDst(numPixels * DstTraits::pixelSize);
+
+    const int offsets[] = {0, 5, -3, 63};
+
+    for (int x : offsets) {
+        for (int y = 0; y < 4; y++) {
+            scalarOp.dither(src.constData(), scalarDst.data(), numPixels, x, y);
+            optimizedOp->dither(src.constData(), optimizedDst.data(), numPixels, x, y);
+
+            // FMA may change the rounding of the vectorized version
+            for (int i = 0; i < scalarDst.size(); i++) {
+                if (qAbs(int(scalarDst[i]) - int(optimizedDst[i])) > 1) {
+                    qDebug() << colorModelId.id() << srcColorDepthId.id() << "x" << x << "y" << y << "byte" << i;
+                    QCOMPARE(optimizedDst[i], scalarDst[i]);
+                }
+            }
+        }
+    }
+}
+
+void TestKoDitherOp::testOptimizedDitherOp()
+{
+    qsrand(1);
+
+    compareDitherOps<KoBgrU16Traits, KoBgrU8Traits, false>(RGBAColorModelID, Integer16BitsColorDepthID);
+    compareDitherOps<KoRgbF32Traits, KoBgrU8Traits, true>(RGBAColorModelID, Float32BitsColorDepthID);
+    compareDitherOps<KoGrayU16Traits, KoGrayU8Traits, false>(GrayAColorModelID, Integer16BitsColorDepthID);
+    compareDitherOps<KoGrayF32Traits, KoGrayU8Traits, false>(GrayAColorModelID, Float32BitsColorDepthID);
+
+    QVERIFY(!KoOptimizedDitherOpFactory::createDitherOp(CMYKAColorModelID, Integer16BitsColorDepthID,
+                                                         KoDitherMatrix::instance(KoDitherMatrix::Ordered)));
+}
+
+QTEST_GUILESS_MAIN(TestKoDitherOp)
@@ -0,0 +1,165 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoScratchBuffer.h"
+
+#include <QTest>
+
+#include "../KoScratchBuffer.h"
+#include "../KoColorSpace.h"
+#include "../KoColorSpaceRegistry.h"
+#include "../KoCompositeOpRegistry.h"
+
+void TestKoScratchBuffer::testNesting()
+{
+    KoScratchBuffer outer(1000);
+    memset(outer.data(), 0x11, 1000);
+
+    quint8 *innerData = 0;
+
+    {
+        KoScratchBuffer inner1(2000);
+        innerData = inner1.data();
+
+        KoScratchBuffer inner2(10);
+
+        QVERIFY(inner1.data() != outer.data());
+        QVERIFY(inner2.data() != outer.data());
+        QVERIFY(inner2.data() != inner1.data());
+
+        QCOMPARE(quintptr(inner1.data()) % 64, quintptr(0));
+        QCOMPARE(quintptr(inner2.data()) % 64, quintptr(0));
+
+        memset(inner1.data(), 0x22, 2000);
+        memset(inner2.data(), 0x33, 10);
+    }
+
+    // the nested buffers must not overwrite the outer one
+    for (int i = 0; i < 1000; i++) {
+        QCOMPARE(outer.data()[i], quint8(0x11));
+    }
+
+    {
+        // the same nesting level reuses its block
+        KoScratchBuffer inner(100);
+        QCOMPARE(inner.data(), innerData);
+    }
+}
+
+void TestKoScratchBuffer::testSteadyState()
+{
+    const size_t sizes[] = {64, 4096, 100000, 5000, 100001};
+
+    for (size_t size : sizes) {
+        KoScratchBuffer buffer1(size);
+        KoScratchBuffer buffer2(size / 2);
+    }
+
+    const qint64 allocationsBefore = KoScratchBuffer::poolGrowthCount();
+
+    for (int i = 0; i < 10; i++) {
+        for (size_t size : sizes) {
+            KoScratchBuffer buffer1(size);
+            KoScratchBuffer buffer2(size / 2);
+            buffer1.data()[size - 1] = 0;
+            buffer2.data()[size / 2 - 1] = 0;
+        }
+    }
+
+    QCOMPARE(KoScratchBuffer::poolGrowthCount(), allocationsBefore);
+
+    {
+        // a bigger request grows the block
+        KoScratchBuffer buffer(1000000);
+        buffer.data()[999999] = 0;
+    }
+
+    QVERIFY(KoScratchBuffer::poolGrowthCount() > allocationsBefore);
+}
+
+void TestKoScratchBuffer::testHugeBuffersAreNotRetained()
+{
+    const size_t hugeSize = 2 * KoScratchBuffer::maxRetainedSize;
+
+    {
+        KoScratchBuffer buffer(hugeSize);
+        buffer.data()[hugeSize - 1] = 0;
+    }
+
+    const qint64 allocationsBefore = KoScratchBuffer::poolGrowthCount();
+
+    {
+        // the huge block has been freed, so it is allocated again
+        KoScratchBuffer buffer(hugeSize);
+        buffer.data()[hugeSize - 1] = 0;
+    }
+
+    QCOMPARE(KoScratchBuffer::poolGrowthCount(), allocationsBefore + 1);
+
+    {
+        KoScratchBuffer buffer(KoScratchBuffer::maxRetainedSize);
+        buffer.data()[KoScratchBuffer::maxRetainedSize - 1] = 0;
+    }
+
+    const qint64 allocationsAfterRetained = KoScratchBuffer::poolGrowthCount();
+
+    {
+        // the block of the maximum size is kept by the pool
+        KoScratchBuffer buffer(KoScratchBuffer::maxRetainedSize);
+        buffer.data()[KoScratchBuffer::maxRetainedSize - 1] = 0;
+    }
+
+    QCOMPARE(KoScratchBuffer::poolGrowthCount(), allocationsAfterRetained);
+}
+
+void TestKoScratchBuffer::testConversionSteadyState()
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *rgb16 = KoColorSpaceRegistry::instance()->rgb16();
+
+    const int numPixels = 64 * 64;
+
+    QVector<quint8> src(numPixels * rgb16->pixelSize(), 0x80);
+    QVector<quint8> dst(numPixels * rgb8->pixelSize(), 0x80);
+
+    KoCompositeOp::ParameterInfo params;
+    params.dstRowStart = dst.data();
+    params.dstRowStride = 64 * rgb8->pixelSize();
+    params.srcRowStart = src.constData();
+    params.srcRowStride = 64 * rgb16->pixelSize();
+    params.rows = 64;
+    params.cols = 64;
+
+    // warm up the conversion cache and the scratch buffers
+    rgb8->bitBlt(rgb16, params, rgb8->compositeOp(COMPOSITE_OVER),
+                 KoColorConversionTransformation::internalRenderingIntent(),
+                 KoColorConversionTransformation::internalConversionFlags());
+
+    const qint64 allocationsBefore = KoScratchBuffer::poolGrowthCount();
+
+    for (int i = 0; i < 10; i++) {
+        rgb8->bitBlt(rgb16, params, rgb8->compositeOp(COMPOSITE_OVER),
+                     KoColorConversionTransformation::internalRenderingIntent(),
+                     KoColorConversionTransformation::internalConversionFlags());
+    }
+
+    QCOMPARE(KoScratchBuffer::poolGrowthCount(), allocationsBefore);
+}
+
+QTEST_GUILESS_MAIN(TestKoScratchBuffer)
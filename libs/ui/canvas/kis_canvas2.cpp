@@ -152,6 +152,12 @@ public:
     KisSignalCompressor regionOfInterestUpdateCompressor;
     QRect regionOfInterest;
 
+    /**
+     * The image we have reported our visible rect to
+     * \see KisImage::setViewportRect()
+     */
+    KisImageWSP viewportImage;
+
     QRect renderingLimit;
     int isBatchUpdateActive = 0;
 
@@ -288,6 +294,11 @@ KisCanvas2::~KisCanvas2()
     if (m_d->animationPlayer->isPlaying()) {
         m_d->animationPlayer->forcedStopOnExit();
     }
+
+    if (m_d->viewportImage) {
+        m_d->viewportImage->setViewportRect(this, QRect());
+    }
+
     delete m_d;
 }
 
@@ -979,6 +990,24 @@ void KisCanvas2::slotUpdateRegionOfInterest()
     if (m_d->regionOfInterest != oldRegionOfInterest) {
         emit sigRegionOfInterestChanged(m_d->regionOfInterest);
     }
+
+    /**
+     * Let the scheduler process the updates of the visible area first
+     */
+    KisImageWSP image = this->image();
+
+    if (m_d->viewportImage && m_d->viewportImage != image) {
+        m_d->viewportImage->setViewportRect(this, QRect());
+    }
+
+    if (image) {
+        const QRect viewportRect =
+            m_d->coordinatesConverter->widgetRectInImagePixels().toAlignedRect() & imageRect;
+
+        image->setViewportRect(this, viewportRect);
+    }
+
+    m_d->viewportImage = image;
 }
 
 void KisCanvas2::slotReferenceImagesChanged()
@@ -421,6 +421,8 @@ KisDisplayColorConverter::conversionFlags()
 
     if (cfg.useBlackPointCompensation()) conversionFlags |= KoColorConversionTransformation::BlackpointCompensation;
     if (!cfg.allowLCMSOptimization()) conversionFlags |= KoColorConversionTransformation::NoOptimization;
+    if (cfg.displayDitherType() == KisConfig::ORDERED_DITHER) conversionFlags |= KoColorConversionTransformation::OrderedDithering;
+    if (cfg.displayDitherType() == KisConfig::BLUE_NOISE_DITHER) conversionFlags |= KoColorConversionTransformation::BlueNoiseDithering;
 
     return conversionFlags;
 }
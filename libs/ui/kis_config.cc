@@ -590,6 +590,16 @@ void KisConfig::setForcePaletteColors(bool forcePaletteColors)
     m_cfg.writeEntry("colorsettings/forcepalettecolors", forcePaletteColors);
 }
 
+KisConfig::DisplayDitherType KisConfig::displayDitherType(bool defaultValue) const
+{
+    return (KisConfig::DisplayDitherType)(defaultValue ? NO_DITHER : m_cfg.readEntry("displayDitherType", (int)NO_DITHER));
+}
+
+void KisConfig::setDisplayDitherType(KisConfig::DisplayDitherType value)
+{
+    m_cfg.writeEntry("displayDitherType", (int)value);
+}
+
 bool KisConfig::showRulers(bool defaultValue) const
 {
     return (defaultValue ? false : m_cfg.readEntry("showrulers", false));
@@ -156,6 +156,19 @@ public:
     bool forcePaletteColors(bool defaultValue = false) const;
     void setForcePaletteColors(bool forcePaletteColors);
 
+    /**
+     * Dithering applied when high bit depth images are converted
+     * into the 8-bit display color space
+     */
+    enum DisplayDitherType {
+        NO_DITHER = 0,
+        ORDERED_DITHER,
+        BLUE_NOISE_DITHER
+    };
+
+    DisplayDitherType displayDitherType(bool defaultValue = false) const;
+    void setDisplayDitherType(DisplayDitherType value);
+
     void writeKoColor(const QString& name, const KoColor& color) const;
     KoColor readKoColor(const QString& name, const KoColor& color = KoColor()) const;
 
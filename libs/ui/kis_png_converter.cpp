@@ -956,6 +956,24 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
         device->convertTo(cs);
     }
 
+    KIS_SAFE_ASSERT_RECOVER(!options.saveAsHDR || !options.ditherTo8Bit) {
+        options.ditherTo8Bit = false;
+    }
+
+    if (options.ditherTo8Bit && device->colorSpace()->colorDepthId() != Integer8BitsColorDepthID) {
+        const KoColorSpace *cs =
+            KoColorSpaceRegistry::instance()->colorSpace(
+                device->colorSpace()->colorModelId().id(),
+                Integer8BitsColorDepthID.id(),
+                device->colorSpace()->profile());
+
+        device = new KisPaintDevice(*device);
+        device->convertTo(cs,
+                          KoColorConversionTransformation::internalRenderingIntent(),
+                          KoColorConversionTransformation::internalConversionFlags() |
+                          KoColorConversionTransformation::BlueNoiseDithering);
+    }
+
     // Initialize structures
     png_structp png_ptr =  png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
     if (!png_ptr) {
@@ -56,6 +56,7 @@ struct KisPNGOptions {
         , storeMetaData(false)
         , storeAuthor(false)
         , saveAsHDR(false)
+        , ditherTo8Bit(false)
         , transparencyFillColor(Qt::white)
     {}
 
@@ -71,6 +72,7 @@ struct KisPNGOptions {
     bool storeMetaData;
     bool storeAuthor;
     bool saveAsHDR;
+    bool ditherTo8Bit;
     QList<const KisMetaData::Filter*> filters;
     QColor transparencyFillColor;
 
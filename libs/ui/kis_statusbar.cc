@@ -267,11 +267,14 @@ void KisStatusBar::updateMemoryStatus()
                   "Image size:\t %1\n"
                   "  - layers:\t\t %2\n"
                   "  - projections:\t %3\n"
-                  "  - instant preview:\t %4\n",
+                  "  - instant preview:\t %4\n"
+                  "Undo history:\t %5 (%6 per revision)\n",
                   format.formatByteSize(stats.imageSize),
                   format.formatByteSize(stats.layersSize),
                   format.formatByteSize(stats.projectionsSize),
-                  format.formatByteSize(stats.lodSize));
+                  format.formatByteSize(stats.lodSize),
+                  format.formatByteSize(stats.historySize),
+                  format.formatByteSize(stats.averageRevisionSize()));
 
     const QString memoryStatsMsg =
             i18nc("tooltip on statusbar memory reporting button (total stats)",
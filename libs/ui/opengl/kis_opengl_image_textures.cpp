@@ -72,6 +72,8 @@ KisOpenGLImageTextures::KisOpenGLImageTextures()
     m_conversionFlags = KoColorConversionTransformation::HighQuality;
     if (cfg.useBlackPointCompensation()) m_conversionFlags |= KoColorConversionTransformation::BlackpointCompensation;
     if (!cfg.allowLCMSOptimization()) m_conversionFlags |= KoColorConversionTransformation::NoOptimization;
+    if (cfg.displayDitherType() == KisConfig::ORDERED_DITHER) m_conversionFlags |= KoColorConversionTransformation::OrderedDithering;
+    if (cfg.displayDitherType() == KisConfig::BLUE_NOISE_DITHER) m_conversionFlags |= KoColorConversionTransformation::BlueNoiseDithering;
     m_useOcio = cfg.useOcio();
 }
 
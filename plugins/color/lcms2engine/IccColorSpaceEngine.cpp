@@ -22,7 +22,21 @@
 
 #include "KoColorModelStandardIds.h"
 
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRect>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
 #include <klocalizedstring.h>
+#include <kconfiggroup.h>
+#include <ksharedconfig.h>
+
+#include <KoColorConversionLut.h>
+#include <KoDitherMatrix.h>
+#include <KoDitherOp.h>
+#include "compositeops/KoOptimizedDitherOpFactory.h"
 
 #include "LcmsColorSpace.h"
 
@@ -92,6 +106,140 @@ private:
     mutable cmsHTRANSFORM m_transform;
 };
 
+class KoLcmsLutColorConversionTransformation : public KoColorConversionTransformation
+{
+public:
+    KoLcmsLutColorConversionTransformation(const KoColorSpace *srcCs, const KoColorSpace *dstCs,
+                                           Intent renderingIntent,
+                                           ConversionFlags conversionFlags,
+                                           QSharedPointer<const KoColorConversionLut> lut)
+        : KoColorConversionTransformation(srcCs, dstCs, renderingIntent, conversionFlags)
+        , m_lut(lut)
+    {
+        Q_ASSERT(m_lut);
+    }
+
+public:
+
+    void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const override
+    {
+        qint32 srcPixelSize = srcColorSpace()->pixelSize();
+        qint32 dstPixelSize = dstColorSpace()->pixelSize();
+
+        m_lut->transform(src, dst, numPixels);
+        // the LUT does not know anything about alpha, so copy it manually
+        while (numPixels > 0) {
+            qreal alpha = srcColorSpace()->opacityF(src);
+            dstColorSpace()->setOpacity(dst, alpha, 1);
+
+            src += srcPixelSize;
+            dst += dstPixelSize;
+            numPixels--;
+        }
+    }
+private:
+    QSharedPointer<const KoColorConversionLut> m_lut;
+};
+
+// -- KoLcmsDitherColorConversionTransformation --
+
+/**
+ * Converts high bit depth pixels into 8-bit ones applying a dithering
+ * matrix (see KoDitherOp). When the profiles or the color models of the
+ * color spaces differ, lcms first converts the pixels into a 16-bit
+ * version of the destination color space, which is then dithered.
+ */
+class KoLcmsDitherColorConversionTransformation : public KoColorConversionTransformation
+{
+    static const int chunkSize = 256;
+    static const int maxIntermediatePixelSize = 4 * sizeof(quint16);
+
+public:
+    KoLcmsDitherColorConversionTransformation(const KoColorSpace *srcCs, const KoColorSpace *dstCs,
+                                              Intent renderingIntent,
+                                              ConversionFlags conversionFlags,
+                                              KoDitherOp *ditherOp,
+                                              cmsHTRANSFORM preTransform)
+        : KoColorConversionTransformation(srcCs, dstCs, renderingIntent, conversionFlags)
+        , m_ditherOp(ditherOp)
+        , m_preTransform(preTransform)
+    {
+        Q_ASSERT(m_ditherOp);
+        Q_ASSERT(dstCs->pixelSize() * sizeof(quint16) <= maxIntermediatePixelSize);
+    }
+
+    ~KoLcmsDitherColorConversionTransformation() override
+    {
+        delete m_ditherOp;
+
+        if (m_preTransform) {
+            cmsDeleteTransform(m_preTransform);
+        }
+    }
+
+public:
+
+    /**
+     * The position of the pixels is unknown here, so they are dithered
+     * as if they were the first row of the image. It keeps the result
+     * the same for the same input, e.g. when a single color is converted
+     * for the color selectors. Only transformRect() aligns the pattern
+     * with the image.
+     */
+    void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const override
+    {
+        transformRow(src, dst, numPixels, 0, 0);
+    }
+
+    void transformRect(const quint8 *src, quint8 *dst, const QRect &rect) const override
+    {
+        const qint32 srcRowStride = rect.width() * srcColorSpace()->pixelSize();
+        const qint32 dstRowStride = rect.width() * dstColorSpace()->pixelSize();
+
+        for (int y = rect.y(); y <= rect.bottom(); y++) {
+            transformRow(src, dst, rect.width(), rect.x(), y);
+
+            src += srcRowStride;
+            dst += dstRowStride;
+        }
+    }
+
+private:
+    void transformRow(const quint8 *src, quint8 *dst, qint32 numPixels, int x, int y) const
+    {
+        if (!m_preTransform) {
+            m_ditherOp->dither(src, dst, numPixels, x, y);
+            return;
+        }
+
+        qint32 srcPixelSize = srcColorSpace()->pixelSize();
+        qint32 dstPixelSize = dstColorSpace()->pixelSize();
+
+        // the buffer is fully written by lcms before being read
+        quint8 buffer[chunkSize * maxIntermediatePixelSize];
+
+        for (int i = 0; i < numPixels; i += chunkSize) {
+            const int numChunkPixels = qMin(chunkSize, numPixels - i);
+
+            cmsDoTransform(m_preTransform, const_cast<quint8 *>(src), buffer, numChunkPixels);
+            m_ditherOp->dither(buffer, dst, numChunkPixels, x + i, y);
+
+            // Lcms does nothing to the destination alpha channel so we must convert that manually.
+            for (int j = 0; j < numChunkPixels; j++) {
+                qreal alpha = srcColorSpace()->opacityF(src);
+                dstColorSpace()->setOpacity(dst, alpha, 1);
+
+                src += srcPixelSize;
+                dst += dstPixelSize;
+            }
+        }
+    }
+
+private:
+    KoDitherOp *m_ditherOp;
+    mutable cmsHTRANSFORM m_preTransform;
+};
+
 class KoLcmsColorProofingConversionTransformation : public KoColorProofingConversionTransformation
 {
 public:
@@ -174,10 +322,163 @@ private:
 };
 
 struct IccColorSpaceEngine::Private {
+    bool useLutByDefault = false;
+    int lutGridSize = KoColorConversionLut::defaultGridSize();
+
+    /**
+     * The transformations are cached by KoColorConversionCache, which
+     * keeps a separate copy for every thread. The LUTs are immutable,
+     * so all the copies of the transformation of the same profile pair
+     * share a single table.
+     */
+    QMutex lutCacheMutex;
+    QHash<QString, QWeakPointer<const KoColorConversionLut>> lutCache;
+
+    QSharedPointer<const KoColorConversionLut> lutForTransformation(const KoColorConversionTransformation *exactTransform);
+
+    KoColorConversionTransformation* createDitherTransformation(const IccColorSpaceEngine *q,
+                                                                const KoColorSpace *srcColorSpace,
+                                                                const KoColorSpace *dstColorSpace,
+                                                                KoColorConversionTransformation::Intent renderingIntent,
+                                                                KoColorConversionTransformation::ConversionFlags conversionFlags);
 };
 
+QSharedPointer<const KoColorConversionLut>
+IccColorSpaceEngine::Private::lutForTransformation(const KoColorConversionTransformation *exactTransform)
+{
+    const KoColorSpace *srcCs = exactTransform->srcColorSpace();
+    const KoColorSpace *dstCs = exactTransform->dstColorSpace();
+
+    const QByteArray srcProfileId = srcCs->profile()->uniqueId();
+    const QByteArray dstProfileId = dstCs->profile()->uniqueId();
+
+    /**
+     * The id is empty when the hash of the profile could not be
+     * calculated. Such profiles cannot be told apart, so their
+     * tables are never shared.
+     */
+    if (srcProfileId.isEmpty() || dstProfileId.isEmpty()) {
+        return QSharedPointer<const KoColorConversionLut>(new KoColorConversionLut(exactTransform, lutGridSize));
+    }
+
+    /**
+     * Profile names are not unique: two different profiles may be
+     * embedded into documents under the same name, so key the cache
+     * on the hash of the profile data instead.
+     */
+    const QString key = QString("%1|%2|%3|%4|%5|%6|%7")
+        .arg(srcCs->id()).arg(QString::fromLatin1(srcProfileId.toHex()))
+        .arg(dstCs->id()).arg(QString::fromLatin1(dstProfileId.toHex()))
+        .arg(exactTransform->renderingIntent())
+        .arg(int(exactTransform->conversionFlags()))
+        .arg(lutGridSize);
+
+    {
+        QMutexLocker l(&lutCacheMutex);
+
+        QSharedPointer<const KoColorConversionLut> lut = lutCache.value(key).toStrongRef();
+        if (lut) return lut;
+    }
+
+    /**
+     * Building the table takes a while, so do it without holding
+     * the lock. If another thread has built the same table in the
+     * meantime, its copy is used and ours is dropped.
+     */
+    QSharedPointer<const KoColorConversionLut> newLut(new KoColorConversionLut(exactTransform, lutGridSize));
+
+    QMutexLocker l(&lutCacheMutex);
+
+    QSharedPointer<const KoColorConversionLut> lut = lutCache.value(key).toStrongRef();
+
+    if (!lut) {
+        lut = newLut;
+
+        for (auto it = lutCache.begin(); it != lutCache.end();) {
+            if (it.value().isNull()) {
+                it = lutCache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        lutCache.insert(key, lut);
+    }
+
+    return lut;
+}
+
+KoColorConversionTransformation*
+IccColorSpaceEngine::Private::createDitherTransformation(const IccColorSpaceEngine *q,
+                                                         const KoColorSpace *srcColorSpace,
+                                                         const KoColorSpace *dstColorSpace,
+                                                         KoColorConversionTransformation::Intent renderingIntent,
+                                                         KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    const KoID colorModelId = dstColorSpace->colorModelId();
+
+    if (dstColorSpace->colorDepthId() != Integer8BitsColorDepthID ||
+        srcColorSpace->colorDepthId() == Integer8BitsColorDepthID ||
+        !KoOptimizedDitherOpFactory::isSupported(colorModelId, Integer16BitsColorDepthID)) {
+
+        return 0;
+    }
+
+    const KoDitherMatrix *matrix =
+        KoDitherMatrix::instance(conversionFlags.testFlag(KoColorConversionTransformation::BlueNoiseDithering) ?
+                                 KoDitherMatrix::BlueNoise : KoDitherMatrix::Ordered);
+
+    const KoColorConversionTransformation::ConversionFlags lcmsFlags =
+        conversionFlags & ~(KoColorConversionTransformation::LutInterpolation |
+                            KoColorConversionTransformation::OrderedDithering |
+                            KoColorConversionTransformation::BlueNoiseDithering);
+
+    const bool canDitherDirectly =
+        srcColorSpace->colorModelId() == colorModelId &&
+        *srcColorSpace->profile() == *dstColorSpace->profile() &&
+        KoOptimizedDitherOpFactory::isSupported(colorModelId, srcColorSpace->colorDepthId());
+
+    if (canDitherDirectly) {
+        return new KoLcmsDitherColorConversionTransformation(srcColorSpace, dstColorSpace,
+                                                             renderingIntent, conversionFlags,
+                                                             KoOptimizedDitherOpFactory::createDitherOp(colorModelId, srcColorSpace->colorDepthId(), matrix),
+                                                             0);
+    }
+
+    /**
+     * We cannot ask the registry for the 16-bit version of the
+     * destination color space here, because it is locked while the
+     * transformation is being created, so just describe its layout
+     * to lcms.
+     */
+    const quint32 intermediateColorSpaceType =
+        (q->computeColorSpaceType(dstColorSpace) & ~BYTES_SH(7)) | BYTES_SH(2);
+
+    cmsHTRANSFORM preTransform =
+        cmsCreateTransform(dynamic_cast<const IccColorProfile *>(srcColorSpace->profile())->asLcms()->lcmsProfile(),
+                           q->computeColorSpaceType(srcColorSpace),
+                           dynamic_cast<const IccColorProfile *>(dstColorSpace->profile())->asLcms()->lcmsProfile(),
+                           intermediateColorSpaceType,
+                           renderingIntent,
+                           lcmsFlags);
+
+    if (!preTransform) {
+        return 0;
+    }
+
+    return new KoLcmsDitherColorConversionTransformation(srcColorSpace, dstColorSpace,
+                                                         renderingIntent, conversionFlags,
+                                                         KoOptimizedDitherOpFactory::createDitherOp(colorModelId, Integer16BitsColorDepthID, matrix),
+                                                         preTransform);
+}
+
 IccColorSpaceEngine::IccColorSpaceEngine() : KoColorSpaceEngine("icc", i18n("ICC Engine")), d(new Private)
 {
+    KConfigGroup cfg = KSharedConfig::openConfig()->group("");
+    d->useLutByDefault = cfg.readEntry("useLutColorConversion", false);
+    d->lutGridSize = qBound(KoColorConversionLut::minGridSize(),
+                            cfg.readEntry("lutColorConversionGridSize", KoColorConversionLut::defaultGridSize()),
+                            KoColorConversionLut::maxGridSize());
 }
 
 IccColorSpaceEngine::~IccColorSpaceEngine()
@@ -254,11 +555,43 @@ KoColorConversionTransformation *IccColorSpaceEngine::createColorTransformation(
     Q_ASSERT(srcColorSpace);
     Q_ASSERT(dstColorSpace);
 
-    return new KoLcmsColorConversionTransformation(
+    const bool useLut =
+        (conversionFlags.testFlag(KoColorConversionTransformation::LutInterpolation) || d->useLutByDefault) &&
+        KoColorConversionLut::isSupported(srcColorSpace, dstColorSpace);
+
+    if (conversionFlags & (KoColorConversionTransformation::OrderedDithering |
+                           KoColorConversionTransformation::BlueNoiseDithering)) {
+
+        KoColorConversionTransformation *ditherTransform =
+            d->createDitherTransformation(this, srcColorSpace, dstColorSpace, renderingIntent, conversionFlags);
+
+        if (ditherTransform) {
+            return ditherTransform;
+        }
+    }
+
+    // the flags are not known to lcms
+    conversionFlags &= ~(KoColorConversionTransformation::LutInterpolation |
+                         KoColorConversionTransformation::OrderedDithering |
+                         KoColorConversionTransformation::BlueNoiseDithering);
+
+    KoColorConversionTransformation *exactTransform =
+        new KoLcmsColorConversionTransformation(
                 srcColorSpace, computeColorSpaceType(srcColorSpace),
                 dynamic_cast<const IccColorProfile *>(srcColorSpace->profile())->asLcms(), dstColorSpace, computeColorSpaceType(dstColorSpace),
                 dynamic_cast<const IccColorProfile *>(dstColorSpace->profile())->asLcms(), renderingIntent, conversionFlags);
 
+    if (!useLut) {
+        return exactTransform;
+    }
+
+    QSharedPointer<const KoColorConversionLut> lut = d->lutForTransformation(exactTransform);
+    delete exactTransform;
+
+    return new KoLcmsLutColorConversionTransformation(srcColorSpace, dstColorSpace,
+                                                      renderingIntent,
+                                                      conversionFlags | KoColorConversionTransformation::LutInterpolation,
+                                                      lut);
 }
 KoColorProofingConversionTransformation *IccColorSpaceEngine::createColorProofingTransformation(const KoColorSpace *srcColorSpace,
                                                                                                 const KoColorSpace *dstColorSpace,
@@ -272,6 +605,10 @@ KoColorProofingConversionTransformation *IccColorSpaceEngine::createColorProofin
     Q_ASSERT(srcColorSpace);
     Q_ASSERT(dstColorSpace);
 
+    conversionFlags &= ~(KoColorConversionTransformation::LutInterpolation |
+                         KoColorConversionTransformation::OrderedDithering |
+                         KoColorConversionTransformation::BlueNoiseDithering);
+
     return new KoLcmsColorProofingConversionTransformation(
                 srcColorSpace, computeColorSpaceType(srcColorSpace),
                 dynamic_cast<const IccColorProfile *>(srcColorSpace->profile())->asLcms(), dstColorSpace, computeColorSpaceType(dstColorSpace),
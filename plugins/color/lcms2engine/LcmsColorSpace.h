@@ -24,6 +24,7 @@
 
 #include <colorprofiles/LcmsColorProfileContainer.h>
 #include <KoColorSpaceAbstract.h>
+#include <KoScratchBuffer.h>
 #include <QMutex>
 #include <QMutexLocker>
 
@@ -118,8 +119,11 @@ class LcmsColorSpace : public KoColorSpaceAbstract<_CSTraits>, public KoLcmsInfo
             int index = 0;
 
             if (cmsAlphaTransform) {
-                qreal *alpha = new qreal[nPixels];
-                qreal *dstalpha = new qreal[nPixels];
+                KoScratchBuffer alphaBuffer(nPixels * sizeof(qreal));
+                KoScratchBuffer dstAlphaBuffer(nPixels * sizeof(qreal));
+
+                qreal *alpha = alphaBuffer.dataAs<qreal>();
+                qreal *dstalpha = dstAlphaBuffer.dataAs<qreal>();
 
                 while (index < nPixels) {
                     alpha[index] = m_colorSpace->opacityF(src);
@@ -132,9 +136,6 @@ class LcmsColorSpace : public KoColorSpaceAbstract<_CSTraits>, public KoLcmsInfo
                     m_colorSpace->setOpacity(dst, dstalpha[i], 1);
                     dst += pixelSize;
                 }
-
-                delete [] alpha;
-                delete [] dstalpha;
             } else {
                 while (numPixels > 0) {
                     qreal alpha = m_colorSpace->opacityF(src);
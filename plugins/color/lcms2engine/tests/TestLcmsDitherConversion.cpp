@@ -0,0 +1,220 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestLcmsDitherConversion.h"
+
+#include <QTest>
+#include "sdk/tests/kistest.h"
+
+#include "KoColorProfile.h"
+#include "KoColorSpace.h"
+#include "KoColorSpaceRegistry.h"
+#include "KoColorModelStandardIds.h"
+#include "KoColorConversionTransformation.h"
+
+namespace {
+
+const KoColorSpace* sourceColorSpace(bool sameProfile)
+{
+    /**
+     * The same profile is dithered directly, a different one is
+     * converted by lcms into 16 bits first
+     */
+    const KoColorProfile *profile =
+        sameProfile ? 0 : KoColorSpaceRegistry::instance()->p709G10Profile();
+
+    return KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(),
+                                                        Integer16BitsColorDepthID.id(),
+                                                        profile);
+}
+
+void addConversionRows()
+{
+    QTest::addColumn<bool>("sameProfile");
+    QTest::addColumn<int>("ditherFlag");
+
+    QTest::newRow("direct, ordered") << true << int(KoColorConversionTransformation::OrderedDithering);
+    QTest::newRow("direct, blue noise") << true << int(KoColorConversionTransformation::BlueNoiseDithering);
+    QTest::newRow("lcms, ordered") << false << int(KoColorConversionTransformation::OrderedDithering);
+    QTest::newRow("lcms, blue noise") << false << int(KoColorConversionTransformation::BlueNoiseDithering);
+}
+
+KoColorConversionTransformation::ConversionFlags ditherFlags(int ditherFlag)
+{
+    return KoColorConversionTransformation::internalConversionFlags() |
+        KoColorConversionTransformation::ConversionFlags(ditherFlag);
+}
+
+/**
+ * A horizontal gradient, the rows are equal, the values have
+ * fractional parts in 8 bits
+ */
+QVector<quint16> createGradient(int width, int height)
+{
+    QVector<quint16> pixels(width * height * 4);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            quint16 *pixel = pixels.data() + (y * width + x) * 4;
+            pixel[0] = 20000 + 37 * x;
+            pixel[1] = 30000 + 53 * x;
+            pixel[2] = 40000 + 71 * x;
+            pixel[3] = 0xFFFF;
+        }
+    }
+
+    return pixels;
+}
+
+}
+
+void TestLcmsDitherConversion::testSingleColorIsStable_data()
+{
+    addConversionRows();
+}
+
+void TestLcmsDitherConversion::testSingleColorIsStable()
+{
+    QFETCH(bool, sameProfile);
+    QFETCH(int, ditherFlag);
+
+    const KoColorSpace *srcCs = sourceColorSpace(sameProfile);
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->rgb8();
+    QVERIFY(srcCs);
+
+    const QVector<quint16> src = createGradient(64, 1);
+
+    for (int i = 0; i < 64; i++) {
+        const quint8 *srcPixel = reinterpret_cast<const quint8*>(src.constData() + i * 4);
+
+        quint8 firstResult[4];
+        quint8 secondResult[4];
+
+        srcCs->convertPixelsTo(srcPixel, firstResult, dstCs, 1,
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               ditherFlags(ditherFlag));
+
+        srcCs->convertPixelsTo(srcPixel, secondResult, dstCs, 1,
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               ditherFlags(ditherFlag));
+
+        QVERIFY(!memcmp(firstResult, secondResult, sizeof(firstResult)));
+    }
+}
+
+void TestLcmsDitherConversion::testTransformRect_data()
+{
+    addConversionRows();
+}
+
+void TestLcmsDitherConversion::testTransformRect()
+{
+    QFETCH(bool, sameProfile);
+    QFETCH(int, ditherFlag);
+
+    const KoColorSpace *srcCs = sourceColorSpace(sameProfile);
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->rgb8();
+    QVERIFY(srcCs);
+
+    const int width = 64;
+    const int height = 16;
+    const int dstRowStride = width * dstCs->pixelSize();
+
+    const QVector<quint16> src = createGradient(width, height);
+    const quint8 *srcData = reinterpret_cast<const quint8*>(src.constData());
+
+    QVector<quint8> rectResult(height * dstRowStride);
+    QVector<quint8> shiftedResult(height * dstRowStride);
+    QVector<quint8> rowResult(dstRowStride);
+
+    srcCs->convertPixelsTo(srcData, rectResult.data(), dstCs, QRect(0, 0, width, height),
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           ditherFlags(ditherFlag));
+
+    srcCs->convertPixelsTo(srcData, shiftedResult.data(), dstCs, QRect(0, 1, width, height),
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           ditherFlags(ditherFlag));
+
+    srcCs->convertPixelsTo(srcData, rowResult.data(), dstCs, width,
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           ditherFlags(ditherFlag));
+
+    // a conversion without a rect is dithered as the first row of the image
+    QVERIFY(!memcmp(rowResult.constData(), rectResult.constData(), dstRowStride));
+
+    // the source rows are equal, so the pattern depends on the position only
+    bool rowsDiffer = false;
+
+    for (int y = 0; y < height - 1; y++) {
+        const quint8 *row = rectResult.constData() + y * dstRowStride;
+        const quint8 *nextRow = row + dstRowStride;
+        const quint8 *shiftedRow = shiftedResult.constData() + y * dstRowStride;
+
+        QVERIFY(!memcmp(shiftedRow, nextRow, dstRowStride));
+        rowsDiffer |= bool(memcmp(row, nextRow, dstRowStride));
+    }
+
+    QVERIFY(rowsDiffer);
+}
+
+void TestLcmsDitherConversion::testDitheredAverage()
+{
+    const KoColorSpace *srcCs = sourceColorSpace(true);
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->rgb8();
+
+    const int size = 64;
+
+    // halfway between 128 and 129 in 8 bits
+    const quint16 value = 128 * 257 + 128;
+    const qreal expectedAverage = qreal(value) / 257;
+
+    QVector<quint16> src(size * size * 4, value);
+    for (int i = 0; i < size * size; i++) {
+        src[i * 4 + 3] = 0xFFFF;
+    }
+
+    QVector<quint8> dst(size * size * 4);
+
+    const int flags[] = {
+        KoColorConversionTransformation::OrderedDithering,
+        KoColorConversionTransformation::BlueNoiseDithering
+    };
+
+    for (int flag : flags) {
+        srcCs->convertPixelsTo(reinterpret_cast<const quint8*>(src.constData()), dst.data(), dstCs,
+                               QRect(0, 0, size, size),
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               ditherFlags(flag));
+
+        qint64 sum = 0;
+
+        for (int i = 0; i < size * size; i++) {
+            for (int channel = 0; channel < 3; channel++) {
+                const quint8 result = dst[i * 4 + channel];
+                QVERIFY(result == 128 || result == 129);
+                sum += result;
+            }
+            QCOMPARE(dst[i * 4 + 3], quint8(255));
+        }
+
+        const qreal average = qreal(sum) / (size * size * 3);
+        QVERIFY(qAbs(average - expectedAverage) < 0.05);
+    }
+}
+
+KISTEST_MAIN(TestLcmsDitherConversion)
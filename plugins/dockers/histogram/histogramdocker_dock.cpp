@@ -68,8 +68,9 @@ void HistogramDockerDock::setCanvas(KoCanvasBase * canvas)
 
         m_imageIdleWatcher->setTrackedImage(m_canvas->image());
 
-        connect(m_canvas->image(), SIGNAL(sigImageUpdated(QRect)), this, SLOT(startUpdateCanvasProjection()), Qt::UniqueConnection);
+        connect(m_canvas->image(), SIGNAL(sigImageUpdated(QRect)), this, SLOT(startUpdateCanvasProjection(QRect)), Qt::UniqueConnection);
         connect(m_canvas->image(), SIGNAL(sigColorSpaceChanged(const KoColorSpace*)), this, SLOT(sigColorSpaceChanged(const KoColorSpace*)), Qt::UniqueConnection);
+        connect(m_canvas->image(), SIGNAL(sigSizeChanged(QPointF,QPointF)), this, SLOT(resetHistogram()), Qt::UniqueConnection);
         m_imageIdleWatcher->startCountdown();
     }
 }
@@ -82,8 +83,14 @@ void HistogramDockerDock::unsetCanvas()
     m_imageIdleWatcher->startCountdown();
 }
 
-void HistogramDockerDock::startUpdateCanvasProjection()
+void HistogramDockerDock::startUpdateCanvasProjection(const QRect &rc)
 {
+    /**
+     * The changed areas are collected even when the docker is hidden,
+     * so that only they are recalculated when it is shown again
+     */
+    m_histogramWidget->addDirtyRect(rc);
+
     if (isVisible()) {
         m_imageIdleWatcher->startCountdown();
     }
@@ -98,6 +105,15 @@ void HistogramDockerDock::showEvent(QShowEvent *event)
 
 void HistogramDockerDock::sigColorSpaceChanged(const KoColorSpace */*cs*/)
 {
+    resetHistogram();
+}
+
+void HistogramDockerDock::resetHistogram()
+{
+    if (m_canvas) {
+        m_histogramWidget->setPaintDevice(m_canvas);
+    }
+
     if (isVisible()) {
         m_imageIdleWatcher->startCountdown();
     }
@@ -25,14 +25,51 @@
 #include <QPainter>
 #include <functional>
 
+#include <KoConfig.h>
 #include "KoChannelInfo.h"
+#include "KoColorModelStandardIds.h"
+#include "KoBasicHistogramProducers.h"
 #include "kis_paint_device.h"
 #include "KoColorSpace.h"
-#include "kis_iterator_ng.h"
 #include "kis_canvas2.h"
+#include "KisIncrementalHistogram.h"
+
+namespace {
+
+KoHistogramProducer *createProducer(const KoColorSpace *cs)
+{
+    const KoID id("HISTOGRAMDOCKER", "Histogram Docker");
+    const KoID depthId = cs->colorDepthId();
+
+    KoHistogramProducer *producer = 0;
+
+    /**
+     * The producers work in the color space of the image,
+     * so the pixels are not converted while counting
+     */
+    if (depthId == Integer8BitsColorDepthID) {
+        producer = new KoBasicU8HistogramProducer(id, cs);
+    } else if (depthId == Integer16BitsColorDepthID) {
+        producer = new KoBasicU16HistogramProducer(id, cs);
+#ifdef HAVE_OPENEXR
+    } else if (depthId == Float16BitsColorDepthID) {
+        producer = new KoBasicF16HalfHistogramProducer(id, cs);
+#endif
+    } else if (depthId == Float32BitsColorDepthID) {
+        producer = new KoBasicF32HistogramProducer(id, cs);
+    } else {
+        producer = new KoGenericRGBHistogramProducer();
+    }
+
+    producer->setSkipTransparent(false);
+    return producer;
+}
+
+}
 
 HistogramDockerWidget::HistogramDockerWidget(QWidget *parent, const char *name, Qt::WindowFlags f)
-    : QLabel(parent, f), m_paintDevice(nullptr), m_smoothHistogram(true)
+    : QLabel(parent, f), m_paintDevice(nullptr), m_smoothHistogram(true),
+      m_computationRunning(false), m_updatePending(false)
 {
     setObjectName(name);
 }
@@ -47,21 +84,57 @@ void HistogramDockerWidget::setPaintDevice(KisCanvas2* canvas)
     if (canvas) {
         m_paintDevice = canvas->image()->projection();
         m_bounds = canvas->image()->bounds();
+
+        /**
+         * The running computation keeps its own reference to the old
+         * histogram, so it is safe to replace it here
+         */
+        m_histogram.reset(new KisIncrementalHistogram(m_paintDevice, m_bounds,
+                                                      createProducer(m_paintDevice->colorSpace())));
+        m_channels = m_histogram->producer()->channels();
+        m_updatePending = m_computationRunning;
     } else {
         m_paintDevice.clear();
+        m_histogram.clear();
+        m_channels.clear();
         m_bounds = QRect();
         m_histogramData.clear();
     }
 }
 
+void HistogramDockerWidget::addDirtyRect(const QRect &rc)
+{
+    if (m_histogram) {
+        m_histogram->addDirtyRect(rc);
+    }
+}
+
 void HistogramDockerWidget::updateHistogram()
 {
     if (!m_paintDevice.isNull()) {
-        KisPaintDeviceSP m_devClone = new KisPaintDevice(m_paintDevice->colorSpace());
+        if (m_computationRunning) {
+            m_updatePending = true;
+            return;
+        }
+
+        m_computationRunning = true;
+        m_updatePending = false;
 
-        m_devClone->makeCloneFrom(m_paintDevice, m_bounds);
+        /**
+         * The merger keeps writing into the projection while the
+         * histogram is being calculated, so the worker reads a
+         * copy-on-write snapshot of it. The clone shares the tiles
+         * with the projection, so it is cheap to create.
+         *
+         * The dirty cells are taken together with the snapshot: the
+         * cells changed after that are left dirty for the next update.
+         */
+        const QVector<int> dirtyCells = m_histogram->takeDirtyCells();
 
-        HistogramComputationThread *workerThread = new HistogramComputationThread(m_devClone, m_bounds);
+        KisPaintDeviceSP snapshot = new KisPaintDevice(m_paintDevice->colorSpace());
+        snapshot->makeCloneFrom(m_paintDevice, m_bounds);
+
+        HistogramComputationThread *workerThread = new HistogramComputationThread(m_histogram, dirtyCells, snapshot);
         connect(workerThread, &HistogramComputationThread::resultReady, this, &HistogramDockerWidget::receiveNewHistogram);
         connect(workerThread, &HistogramComputationThread::finished, workerThread, &QObject::deleteLater);
         workerThread->start();
@@ -73,15 +146,25 @@ void HistogramDockerWidget::updateHistogram()
 
 void HistogramDockerWidget::receiveNewHistogram(HistVector *histogramData)
 {
-    m_histogramData = *histogramData;
+    m_computationRunning = false;
+
+    if (histogramData->size() == (size_t)m_channels.size()) {
+        m_histogramData = *histogramData;
+    } else {
+        // the histogram has been reset while the computation was running
+        m_updatePending = true;
+    }
     update();
+
+    if (m_updatePending) {
+        updateHistogram();
+    }
 }
 
 void HistogramDockerWidget::paintEvent(QPaintEvent *event)
 {
     if (!m_histogramData.empty()) {
         int nBins = m_histogramData.at(0).size();
-        const KoColorSpace* cs = m_paintDevice->colorSpace();
 
         QLabel::paintEvent(event);
         QPainter painter(this);
@@ -94,8 +177,8 @@ void HistogramDockerWidget::paintEvent(QPaintEvent *event)
             painter.drawLine(0., this->height()*i / NGRID, this->width(), this->height()*i / NGRID);
         }
 
-        unsigned int nChannels = cs->channelCount();
-        QList<KoChannelInfo *> channels = cs->channels();
+        unsigned int nChannels = m_channels.size();
+        const QList<KoChannelInfo *> &channels = m_channels;
         unsigned int highest = 0;
         //find the most populous bin in the histogram to scale it properly
         for (int chan = 0; chan < channels.size(); chan++) {
@@ -120,7 +203,7 @@ void HistogramDockerWidget::paintEvent(QPaintEvent *event)
                 QColor color = channels.at(chan)->color();
 
                 //special handling of grayscale color spaces. can't use color returned above.
-                if(cs->colorChannelCount()==1){
+                if(m_paintDevice->colorSpace()->colorChannelCount()==1){
                     color = QColor(Qt::gray);
                 }
 
@@ -157,41 +240,23 @@ void HistogramDockerWidget::paintEvent(QPaintEvent *event)
 
 void HistogramComputationThread::run()
 {
-    const KoColorSpace *cs = m_dev->colorSpace();
-    quint32 channelCount = m_dev->channelCount();
-    quint32 pixelSize = m_dev->pixelSize();
+    m_histogram->update(m_dirtyCells, m_snapshot);
 
-    quint32 imageSize = m_bounds.width() * m_bounds.height();
-    quint32 nSkip = 1 + (imageSize >> 20); //for speed use about 1M pixels for computing histograms
+    const int channelCount = m_histogram->channelCount();
+    const int numBins = m_histogram->numberOfBins();
 
-    //allocate space for the histogram data
-    bins.resize((int)channelCount);
-    for (auto &bin : bins) {
-        bin.resize(std::numeric_limits<quint8>::max() + 1);
-    }
-
-    QRect bounds = m_dev->exactBounds();
-    if (bounds.isEmpty())
-        return;
-
-    quint32 toSkip = nSkip;
-
-    KisSequentialConstIterator it(m_dev, m_dev->exactBounds());
+    bins.resize(channelCount);
+    for (int chan = 0; chan < channelCount; ++chan) {
+        std::vector<quint32> &bin = bins[chan];
+        bin.resize(numBins);
 
-    int numConseqPixels = it.nConseqPixels();
-    while (it.nextPixels(numConseqPixels)) {
-
-        numConseqPixels = it.nConseqPixels();
-        const quint8* pixel = it.rawDataConst();
-        for (int k = 0; k < numConseqPixels; ++k) {
-            if (--toSkip == 0) {
-                for (int chan = 0; chan < (int)channelCount; ++chan) {
-                    bins[chan][cs->scaleToU8(pixel, chan)]++;
-                }
-                toSkip = nSkip;
-            }
-            pixel += pixelSize;
+        for (int i = 0; i < numBins; ++i) {
+            bin[i] = m_histogram->binAt(chan, i);
         }
+
+        // show the values out of range (e.g. in HDR images) at the edges
+        bin[0] += m_histogram->outOfViewLeft(chan);
+        bin[numBins - 1] += m_histogram->outOfViewRight(chan);
     }
 
     emit resultReady(&bins);
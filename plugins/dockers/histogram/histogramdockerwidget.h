@@ -23,10 +23,14 @@
 #include <QWidget>
 #include <QLabel>
 #include <QThread>
+#include <QSharedPointer>
+#include <QVector>
 #include "kis_types.h"
 #include <vector>
 
 class KisCanvas2;
+class KoChannelInfo;
+class KisIncrementalHistogram;
 
 typedef std::vector<std::vector<quint32> > HistVector; //Don't use QVector here - it's too slow for this purpose
 
@@ -35,7 +39,8 @@ class HistogramComputationThread : public QThread
 {
     Q_OBJECT
 public:
-    HistogramComputationThread(KisPaintDeviceSP _dev, const QRect& _bounds) : m_dev(_dev), m_bounds(_bounds)
+    HistogramComputationThread(QSharedPointer<KisIncrementalHistogram> _histogram, const QVector<int> &_dirtyCells, KisPaintDeviceSP _snapshot)
+        : m_histogram(_histogram), m_dirtyCells(_dirtyCells), m_snapshot(_snapshot)
     {}
 
     void run() override;
@@ -44,8 +49,9 @@ Q_SIGNALS:
     void resultReady(HistVector*);
 
 private:
-    KisPaintDeviceSP m_dev;
-    QRect m_bounds;
+    QSharedPointer<KisIncrementalHistogram> m_histogram;
+    QVector<int> m_dirtyCells;
+    KisPaintDeviceSP m_snapshot;
     HistVector bins;
 };
 
@@ -58,6 +64,7 @@ public:
     HistogramDockerWidget(QWidget *parent = 0, const char *name = 0, Qt::WindowFlags f = 0);
     ~HistogramDockerWidget() override;
     void setPaintDevice(KisCanvas2* canvas);
+    void addDirtyRect(const QRect &rc);
     void paintEvent(QPaintEvent *event) override;
 
 public Q_SLOTS:
@@ -66,9 +73,13 @@ public Q_SLOTS:
 
 private:
     KisPaintDeviceSP m_paintDevice;
+    QSharedPointer<KisIncrementalHistogram> m_histogram;
+    QList<KoChannelInfo *> m_channels;
     HistVector m_histogramData;
     QRect m_bounds;
     bool m_smoothHistogram;
+    bool m_computationRunning;
+    bool m_updatePending;
 };
 
 #endif // HISTOGRAMDOCKERWIDGET_H
@@ -628,6 +628,18 @@ KisImageBuilder_Result KisJPEGConverter::buildFile(QIODevice *io, KisPaintLayerS
     gc.bitBlt(QPoint(0, 0), layer->paintDevice(), QRect(0, 0, width, height));
     gc.end();
 
+    if (options.dither && cs->colorDepthId() != Integer8BitsColorDepthID) {
+        const KoColorSpace *dst =
+            KoColorSpaceRegistry::instance()->colorSpace(cs->colorModelId().id(),
+                                                         Integer8BitsColorDepthID.id(),
+                                                         cs->profile());
+        dev->convertTo(dst,
+                       KoColorConversionTransformation::internalRenderingIntent(),
+                       KoColorConversionTransformation::internalConversionFlags() |
+                       KoColorConversionTransformation::BlueNoiseDithering);
+        cs = dst;
+    }
+
 
     if (options.saveProfile) {
         const KoColorProfile* colorProfile = layer->colorSpace()->profile();
@@ -638,7 +650,7 @@ KisImageBuilder_Result KisJPEGConverter::buildFile(QIODevice *io, KisPaintLayerS
     // Write data information
 
     JSAMPROW row_pointer = new JSAMPLE[width*cinfo.input_components];
-    int color_nb_bits = 8 * layer->paintDevice()->pixelSize() / layer->paintDevice()->channelCount();
+    int color_nb_bits = 8 * dev->pixelSize() / dev->channelCount();
 
     for (; cinfo.next_scanline < height;) {
         KisHLineConstIteratorSP it = dev->createHLineConstIteratorNG(0, cinfo.next_scanline, width);
@@ -53,6 +53,7 @@ struct KisJPEGOptions {
     QColor transparencyFillColor;
     bool forceSRGB;
     bool saveProfile;
+    bool dither; //this is for dithering high bit depth images when reducing them to 8 bits.
     bool storeDocumentMetaData; //this is for getting the metadata from the document info.
     bool storeAuthor; //this is for storing author data from the document info.
 };
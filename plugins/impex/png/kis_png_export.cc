@@ -74,6 +74,7 @@ KisImportExportFilter::ConversionStatus KisPNGExport::convert(KisDocument *docum
     options.storeAuthor = configuration->getBool("storeAuthor", false);
     options.storeMetaData = configuration->getBool("storeMetaData", false);
     options.saveAsHDR = configuration->getBool("saveAsHDR", false);
+    options.ditherTo8Bit = !options.saveAsHDR && configuration->getBool("ditherTo8Bit", false);
 
     vKisAnnotationSP_it beginIt = image->beginAnnotations();
     vKisAnnotationSP_it endIt = image->endAnnotations();
@@ -121,6 +122,7 @@ KisPropertiesConfigurationSP KisPNGExport::defaultConfiguration(const QByteArray
     cfg->setProperty("saveSRGBProfile", false);
     cfg->setProperty("forceSRGB", true);
     cfg->setProperty("saveAsHDR", false);
+    cfg->setProperty("ditherTo8Bit", false);
     cfg->setProperty("storeMetaData", false);
     cfg->setProperty("storeAuthor", false);
 
@@ -192,6 +194,7 @@ void KisWdgOptionsPNG::setConfiguration(const KisPropertiesConfigurationSP cfg)
     chkForceSRGB->setChecked(cfg->getBool("forceSRGB", false));
 
     chkSaveAsHDR->setChecked(cfg->getBool("saveAsHDR", false));
+    chkDitherTo8Bit->setChecked(cfg->getBool("ditherTo8Bit", false));
     slotUseHDRChanged(chkSaveAsHDR->isChecked());
 
     chkAuthor->setChecked(cfg->getBool("storeAuthor", false));
@@ -215,6 +218,7 @@ KisPropertiesConfigurationSP KisWdgOptionsPNG::configuration() const
     bool tryToSaveAsIndexed = !saveAsHDR && this->tryToSaveAsIndexed->isChecked();
     bool saveSRGB = !saveAsHDR && chkSRGB->isChecked();
     bool forceSRGB = !saveAsHDR && chkForceSRGB->isChecked();
+    bool ditherTo8Bit = !saveAsHDR && chkDitherTo8Bit->isChecked();
     bool storeAuthor = chkAuthor->isChecked();
     bool storeMetaData = chkMetaData->isChecked();
 
@@ -230,6 +234,7 @@ KisPropertiesConfigurationSP KisWdgOptionsPNG::configuration() const
     cfg->setProperty("saveAsHDR", saveAsHDR);
     cfg->setProperty("saveSRGBProfile", saveSRGB);
     cfg->setProperty("forceSRGB", forceSRGB);
+    cfg->setProperty("ditherTo8Bit", ditherTo8Bit);
     cfg->setProperty("storeAuthor", storeAuthor);
     cfg->setProperty("storeMetaData", storeMetaData);
 
@@ -246,6 +251,7 @@ void KisWdgOptionsPNG::slotUseHDRChanged(bool value)
     tryToSaveAsIndexed->setDisabled(value);
     chkForceSRGB->setDisabled(value);
     chkSRGB->setDisabled(value);
+    chkDitherTo8Bit->setDisabled(value);
 }
 
 #include "kis_png_export.moc"
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2019 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __IMAGE_CONFIG_OVERRIDE_H
+#define __IMAGE_CONFIG_OVERRIDE_H
+
+#include "kis_image_config.h"
+
+
+namespace TestUtil {
+
+/**
+ * Sets an option of KisImageConfig for the lifetime of the object
+ * and restores the previous value in the destructor. The options
+ * are stored in the user's config file, so the value is restored
+ * even when a QVERIFY() fails and the test returns early.
+ *
+ * TestUtil::ImageConfigOverride<bool> fused(&KisImageConfig::fusedLayersComposition,
+ *                                           &KisImageConfig::setFusedLayersComposition,
+ *                                           true);
+ */
+template <typename T>
+class ImageConfigOverride
+{
+public:
+    typedef T (KisImageConfig::*Getter)(bool) const;
+    typedef void (KisImageConfig::*Setter)(T);
+
+public:
+    ImageConfigOverride(Getter getter, Setter setter, T value)
+        : m_setter(setter)
+    {
+        KisImageConfig cfg(false);
+        m_oldValue = (cfg.*getter)(false);
+        (cfg.*setter)(value);
+    }
+
+    ~ImageConfigOverride() {
+        KisImageConfig cfg(false);
+        (cfg.*m_setter)(m_oldValue);
+    }
+
+private:
+    Q_DISABLE_COPY(ImageConfigOverride)
+
+    Setter m_setter;
+    T m_oldValue;
+};
+
+}
+
+#endif /* __IMAGE_CONFIG_OVERRIDE_H */